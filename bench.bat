@@ -0,0 +1 @@
+meson test -C build --benchmark -v
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "CorpusGenerator.hpp"
+
+#include <format>
+
+namespace ry {
+
+    static constexpr std::size_t NESTING_DEPTH = 6;
+    static constexpr std::size_t CHAIN_LENGTH = 32;
+    static constexpr std::size_t STRUCT_FIELDS = 64;
+    static constexpr std::size_t TABLE_COLUMNS = 16;
+
+    static const char * const BINARY_OPERATORS[] = {
+        "+", "-", "*", "/", "%", "<<", ">>", "&", "|", "^", "<", "<=", "==", "!=", ">", ">="
+    };
+    static const char * const PRIMITIVE_TYPES[] = {
+        "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "f32", "f64", "bool", "char"
+    };
+
+    CorpusGenerator::CorpusGenerator(std::size_t scale, std::uint64_t seed):
+        m_scale(scale),
+        m_state(seed)
+    {}
+
+    std::vector<CorpusGenerator::Corpus> CorpusGenerator::GenerateAll() {
+        return {
+            {"identifiers",   GenerateIdentifiers()},
+            {"nested_blocks", GenerateNestedBlocks()},
+            {"binary_chains", GenerateBinaryChains()},
+            {"struct_types",  GenerateStructTypes()},
+            {"strings",       GenerateStrings()},
+            {"numbers",       GenerateNumbers()}
+        };
+    }
+
+    // splitmix64
+    std::uint64_t CorpusGenerator::nextRandom() {
+        std::uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    std::string CorpusGenerator::makeName(std::size_t length) {
+        static constexpr std::string_view FIRST = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+        static constexpr std::string_view REST = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+        std::string name(1, FIRST[nextRandom() % FIRST.size()]);
+        while(name.size() < length)
+            name += REST[nextRandom() % REST.size()];
+        return name;
+    }
+
+    std::string CorpusGenerator::GenerateIdentifiers() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale * 64; i++)
+            src += std::format("    {} := {};\n", makeName(8 + nextRandom() % 48), makeName(8 + nextRandom() % 48));
+        return src + "}\n";
+    }
+
+    std::string CorpusGenerator::GenerateNestedBlocks() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale * 4; i++) {
+            for(std::size_t depth = 1; depth <= NESTING_DEPTH; depth++)
+                src += std::string(depth * 4, ' ') + "{\n";
+            src += std::string((NESTING_DEPTH + 1) * 4, ' ') + std::format("x{} := {};\n", i, i);
+            for(std::size_t depth = NESTING_DEPTH; depth >= 1; depth--)
+                src += std::string(depth * 4, ' ') + "};\n";
+        }
+        return src + "}\n";
+    }
+
+    std::string CorpusGenerator::GenerateBinaryChains() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale * 4; i++) {
+            src += std::format("    c{} := a0", i);
+            for(std::size_t j = 1; j < CHAIN_LENGTH; j++) {
+                const char * op = BINARY_OPERATORS[nextRandom() % std::size(BINARY_OPERATORS)];
+                src += std::format(" {} a{}", op, j);
+            }
+            src += ";\n";
+        }
+        return src + "}\n";
+    }
+
+    std::string CorpusGenerator::GenerateStructTypes() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale; i++) {
+            src += std::format("    s{} [\n", i);
+            for(std::size_t j = 0; j < STRUCT_FIELDS; j++) {
+                const char * type = PRIMITIVE_TYPES[nextRandom() % std::size(PRIMITIVE_TYPES)];
+                switch(nextRandom() % 4) {
+                    case 0:  src += std::format("        m{} {},\n", j, type); break;
+                    case 1:  src += std::format("        m{} *{},\n", j, type); break;
+                    case 2:  src += std::format("        m{} ~{},\n", j, type); break;
+                    default: src += std::format("        m{}, n{} [x {}, y {}],\n", j, j, type, type); break;
+                }
+            }
+            src += "    ];\n";
+        }
+        return src + "}\n";
+    }
+
+    std::string CorpusGenerator::GenerateStrings() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale * 16; i++) {
+            src += std::format("    // line comment {} {}\n", i, makeName(40));
+            src += std::format("    /* block comment\n       {}\n    */\n", makeName(60));
+            src += std::format("    s{} := \"{} \\\"quoted\\\" \\n {}\";\n", i, makeName(32), makeName(32));
+            src += std::format("    c{} := '{}';\n", i, char('a' + nextRandom() % 26));
+        }
+        return src + "}\n";
+    }
+
+    std::string CorpusGenerator::GenerateNumbers() {
+        std::string src = "{\n";
+        for(std::size_t i = 0; i < m_scale * 4; i++) {
+            src += std::format("    t{} := [", i);
+            for(std::size_t j = 0; j < TABLE_COLUMNS; j++) {
+                std::uint64_t value = nextRandom();
+                if(j != 0)
+                    src += ", ";
+                switch(value % 3) {
+                    case 0:  src += std::format("{}", value % 1000000); break;
+                    case 1:  src += std::format("0x{:x}", value % 0xFFFFFF); break;
+                    default: src += std::format("{}.{}", value % 1000, value % 997); break;
+                }
+            }
+            src += "];\n";
+        }
+        return src + "}\n";
+    }
+
+}
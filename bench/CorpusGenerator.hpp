@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Generates synthetic .ry sources that stress one front-end path each.
+    // Every corpus is a single top-level block, so one Parser::Parse() call covers the whole file.
+    // Output is deterministic for a given scale and seed.
+    //
+    class CorpusGenerator {
+    public:
+        struct Corpus {
+            std::string name;
+            std::string source;
+        };
+
+        CorpusGenerator(std::size_t scale, std::uint64_t seed = 1);
+
+        std::vector<Corpus> GenerateAll();
+
+        std::string GenerateIdentifiers();  // long identifier streams
+        std::string GenerateNestedBlocks(); // deep nested blocks
+        std::string GenerateBinaryChains(); // long binary operator chains
+        std::string GenerateStructTypes();  // big struct types
+        std::string GenerateStrings();      // string and comment heavy
+        std::string GenerateNumbers();      // numeric tables
+
+    private:
+        std::uint64_t nextRandom();
+        std::string makeName(std::size_t length);
+
+        std::size_t m_scale;
+        std::uint64_t m_state;
+    };
+
+}
@@ -0,0 +1,137 @@
+#include "CorpusGenerator.hpp"
+
+#include "ASTStats.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Profiling.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//
+// Front-end benchmark: generates the synthetic corpora and measures
+// Lexer::Lex, Parser::Parse and ASTNode::Stringify on each of them.
+//
+// Usage: ry-bench [--scale <n>] [--iterations <n>] [--output <file.json>] [--dump-corpora <dir>]
+//
+// Reports the fastest iteration of every phase (the least disturbed by noise),
+// allocations of that iteration, and the process peak RSS after each corpus.
+//
+
+struct PhaseResult {
+    ry::Profiling::Sample best;
+    std::size_t items = 0;
+};
+
+template<typename F>
+static PhaseResult measure(std::size_t iterations, F&& func) {
+    PhaseResult result;
+    for(std::size_t i = 0; i < iterations; i++) {
+        ry::Profiling::Sample start = ry::Profiling::Sample::Take();
+        std::size_t items = func();
+        ry::Profiling::Sample sample = ry::Profiling::Sample::Take() - start;
+        if(i == 0 || sample.wallTime < result.best.wallTime) {
+            result.best = sample;
+            result.items = items;
+        }
+    }
+    return result;
+}
+
+static std::string stringifyPhase(std::string_view name, const PhaseResult& result, std::size_t srcSize, std::string_view itemsName) {
+    double seconds = std::max(result.best.wallTime, 1e-9);
+    return std::format(
+        "\"{}\": {{\"wall_s\": {:.9f}, \"cpu_s\": {:.9f}, \"mb_per_s\": {:.3f}, \"{}\": {}, \"{}_per_s\": {:.1f}, \"allocations\": {}, \"allocated_bytes\": {}}}",
+        name, result.best.wallTime, result.best.cpuTime,
+        double(srcSize) / (1024.0 * 1024.0) / seconds,
+        itemsName, result.items, itemsName, double(result.items) / seconds,
+        result.best.allocations, result.best.allocatedBytes
+    );
+}
+
+int main(int argc, char ** argv) {
+    std::size_t scale = 64;
+    std::size_t iterations = 5;
+    std::optional<std::string> outputPath;
+    std::optional<std::string> dumpDir;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if(arg == "--scale")
+            scale = std::stoull(argv[i + 1]);
+        else if(arg == "--iterations")
+            iterations = std::max<std::size_t>(std::stoull(argv[i + 1]), 1);
+        else if(arg == "--output")
+            outputPath = argv[i + 1];
+        else if(arg == "--dump-corpora")
+            dumpDir = argv[i + 1];
+    }
+
+    ry::CorpusGenerator generator(scale);
+    std::vector<ry::CorpusGenerator::Corpus> corpora = generator.GenerateAll();
+
+    std::string json = std::format("{{\n  \"scale\": {},\n  \"iterations\": {},\n  \"corpora\": [\n", scale, iterations);
+    for(std::size_t corpusIdx = 0; corpusIdx < corpora.size(); corpusIdx++) {
+        const ry::CorpusGenerator::Corpus& corpus = corpora[corpusIdx];
+        std::string filename = corpus.name + ".ry";
+        if(dumpDir.has_value())
+            std::ofstream(dumpDir.value() + "/" + filename) << corpus.source;
+
+        std::vector<ry::Token> tokens;
+        PhaseResult lexResult = measure(iterations, [&]() {
+            ry::Lexer lexer(filename, corpus.source);
+            tokens = lexer.Lex();
+            return tokens.size();
+        });
+
+        ry::Lexer lexer(filename, corpus.source);
+        tokens = lexer.Lex();
+
+        // the nodes are counted once, out of the measured phases
+        std::size_t numNodes = 0;
+        if(std::optional<ry::ASTNode> parsed = ry::Parser(tokens, lexer.GetInfos()).Parse()) {
+            ry::ASTStats stats;
+            stats.Add(parsed.value());
+            numNodes = stats.GetNodeCount();
+        }
+
+        std::optional<ry::ASTNode> ast;
+        std::size_t numInfos = 0;
+        PhaseResult parseResult = measure(iterations, [&]() {
+            ry::Parser parser(tokens, lexer.GetInfos());
+            ast.reset();
+            if(std::optional<ry::ASTNode> parsed = parser.Parse())
+                ast.emplace(std::move(parsed.value()));
+            numInfos = parser.GetInfos().Get().size();
+            return numNodes;
+        });
+
+        PhaseResult stringifyResult = measure(iterations, [&]() {
+            if(!ast.has_value())
+                return std::size_t(0);
+            std::string str = ast.value().Stringify();
+            return numNodes;
+        });
+
+        json += std::format(
+            "    {{\"name\": \"{}\", \"bytes\": {}, \"diagnostics\": {}, {}, {}, {}, \"peak_rss_bytes\": {}}}{}\n",
+            corpus.name, corpus.source.size(), numInfos,
+            stringifyPhase("lex", lexResult, corpus.source.size(), "tokens"),
+            stringifyPhase("parse", parseResult, corpus.source.size(), "nodes"),
+            stringifyPhase("stringify", stringifyResult, corpus.source.size(), "nodes"),
+            ry::Profiling::GetPeakRSS(),
+            corpusIdx + 1 < corpora.size() ? "," : ""
+        );
+    }
+    json += "  ]\n}\n";
+
+    if(outputPath.has_value())
+        std::ofstream(outputPath.value()) << json;
+    std::cout << json;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ry {
+
+    //
+    // Binary AST format, shared by ASTWriter and ASTView.
+    //
+    // Layout:
+    //        <header> <nodes...> <string table>
+    //
+    //        Every node starts with a 4 byte <node header> followed by 4 byte wide fields.
+    //        Nodes never store pointers, a reference to another node is an int32 offset
+    //        relative to the position of the referencing field itself (0 meaning "none").
+    //        Names and string literals are interned into the string table and referenced by index.
+    //        Expression and statement nodes are immediately preceded by their <position>.
+    //
+    //        <position>     :: <u32 startLn> <u32 startCol> <u32 endLn> <u32 endCol> (all 0 if unknown)
+    //
+    //        <string table> :: <u32 count> {<u32 offset> <u32 length>} <chars...>
+    //                          (offsets relative to the first char)
+    //
+    // Bump VERSION whenever a node layout changes.
+    //
+    class ASTBinary {
+    public:
+        static constexpr std::uint32_t MAGIC = 0x42415952; // "RYAB"
+        static constexpr std::uint32_t VERSION = 5;
+        static constexpr std::uint32_t NO_STRING = 0xFFFFFFFF;
+        static constexpr std::size_t FIELD_SIZE = 4;
+
+        struct Header {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t size;
+            std::uint32_t stringTableOffset;
+            std::uint32_t rootOffset;
+        };
+
+        enum class Tag : std::uint8_t {
+            None,
+
+            // [u32 primitive]
+            TypePrimitive,
+            // [rel base]
+            TypePointer,
+            // [u32 count] {[rel field]}
+            TypeStruct,
+            // [rel args (TypeStruct)] [rel return type]
+            TypeFunction,
+            // [rel type] [rel default] [u32 count] {[u32 name]}
+            TypeStructNamedField,
+            // [rel type] [rel reps] [rel default]
+            TypeStructUnnamedField,
+
+            // [u32 kind] [u64 value]
+            Constant,
+
+            // every expression: [rel constant] ...
+            // [u32 literal kind] [payload (8 bytes)]
+            ExpressionLiteral,
+            // [rel function] [rel parameters (StructLiteral)]
+            ExpressionFunctionCall,
+            // [u32 label] [u32 count] {[rel statement]}
+            ExpressionBlock,
+            // [rel condition] [rel success] [rel fail]
+            ExpressionIf,
+            // [rel init] [rel condition] [rel post] [rel body]
+            ExpressionLoop,
+            // [u32 kind] [rel operand]
+            ExpressionUnaryOperation,
+            // [u32 kind] [rel first] [rel second]
+            ExpressionBinaryOperation,
+            // [u32 name]
+            ExpressionName,
+
+            // [u32 count] {[rel field]}
+            StructLiteral,
+            // [u32 name] [rel value]
+            StructLiteralField,
+
+            // [u32 name]
+            LValueName,
+            // [rel operand]
+            LValuePointerDereference,
+            // [rel first] [rel second]
+            LValueStructMemberAccess,
+
+            // [rel expression]
+            StatementExpression,
+            // [u32 kind] [rel lvalue] [rel expression]
+            StatementBinaryOperation,
+            // [u32 name] [rel type] [rel value]
+            StatementTypedVariableDefinition,
+            // [u32 name] [rel value]
+            StatementUntypedVariableDefinition,
+            // [rel lvalue] [rel rvalue]
+            StatementAssignment,
+            //
+            StatementContinue,
+            // [u32 label] [rel value]
+            StatementBreak
+        };
+
+        // <node header> flags
+        static constexpr std::uint8_t FLAG_MUTABLE  = 1 << 0; // types
+        static constexpr std::uint8_t FLAG_OPTIONAL = 1 << 1; // types
+        static constexpr std::uint8_t FLAG_ORDERED  = 1 << 2; // types
+        static constexpr std::uint8_t FLAG_SOA      = 1 << 3; // types
+        static constexpr std::uint8_t FLAG_GROUPED  = 1 << 0; // expressions
+
+        struct Position {
+            std::uint32_t startLine;
+            std::uint32_t startColumn;
+            std::uint32_t endLine;
+            std::uint32_t endColumn;
+        };
+
+        struct NodeHeader {
+            Tag tag;
+            std::uint8_t flags;
+            std::uint16_t reserved;
+        };
+
+        enum class LiteralKind : std::uint32_t {
+            Null, Int, Float, String, Char, Bool, Struct
+        };
+
+        enum class ConstantKind : std::uint32_t {
+            Int, Float, Bool
+        };
+
+        // Unaligned-safe field access
+
+        template<typename T>
+        static T Read(const std::uint8_t * ptr) {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        static void Write(std::uint8_t * ptr, const T& value) {
+            std::memcpy(ptr, &value, sizeof(T));
+        }
+    };
+
+}
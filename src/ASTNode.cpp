@@ -1,6 +1,9 @@
 #include "ASTNode.hpp"
 #include "src/ASTNode.hpp"
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <ratio>
 #include <stdexcept>
@@ -35,6 +38,41 @@ namespace ry {
         RY_ASTNODE__PRIMITIVE_TYPES(RY_ASTNODE__PRIMITIVE_TYPES_E_VALUES)
     };
 
+    const std::unordered_map<ASTNode::TypePrimitive, ASTNode::VectorShape> ASTNode::VECTOR_SHAPES_MAP = {
+        RY_ASTNODE__VECTOR_TYPES(RY_ASTNODE__VECTOR_TYPES_E_MAP)
+    };
+
+    std::optional<ASTNode::VectorShape> ASTNode::GetVectorShape(TypePrimitive primitive) {
+        if(auto it = VECTOR_SHAPES_MAP.find(primitive); it != VECTOR_SHAPES_MAP.end())
+            return it->second;
+        return {};
+    }
+
+    std::optional<ASTNode::TypePrimitive> ASTNode::GetVectorPrimitive(TypePrimitive element, std::uint32_t numLanes) {
+        for(const auto& [primitive, shape] : VECTOR_SHAPES_MAP)
+            if(shape.element == element && shape.numLanes == numLanes)
+                return primitive;
+        return {};
+    }
+
+    std::optional<std::vector<std::uint32_t>> ASTNode::GetLanes(std::string_view name, std::uint32_t numLanes) {
+        static constexpr std::string_view XYZW = "xyzw";
+        static constexpr std::string_view HEX_DIGITS = "0123456789abcdef";
+
+        bool isIndexed = name.size() > 1 && name.front() == 's';
+        std::string_view lanes = isIndexed ? name.substr(1) : name;
+        if(lanes.empty())
+            return {};
+        std::vector<std::uint32_t> indices;
+        for(char c : lanes) {
+            std::size_t idx = (isIndexed ? HEX_DIGITS : XYZW).find(c);
+            if(idx == std::string_view::npos || idx >= numLanes)
+                return {};
+            indices.push_back(std::uint32_t(idx));
+        }
+        return indices;
+    }
+
     // 
 
     using TypeStruct = ASTNode::TypeStruct;
@@ -303,6 +341,16 @@ namespace ry {
             + "Optional: "
             + std::to_string(m_attribs.isOptional)
             + '\n';
+        str +=
+            GetIndentString(indent + 2)
+            + "Ordered: "
+            + std::to_string(m_attribs.isOrdered)
+            + '\n';
+        str +=
+            GetIndentString(indent + 2)
+            + "SoA: "
+            + std::to_string(m_attribs.isSoA)
+            + '\n';
 
         str +=
             GetIndentString(indent + 1)
@@ -332,6 +380,10 @@ namespace ry {
             str += '~';
         if(m_attribs.isOptional)
             str += '?';
+        if(m_attribs.isOrdered)
+            str += '!';
+        if(m_attribs.isSoA)
+            str += '^';
 
         return std::visit(overloaded{
             [&](const TypePrimitive& primitive) -> std::string {
@@ -368,6 +420,30 @@ namespace ry {
         }, m_data);
     }
 
+    /*
+     *
+     * Constant
+     *
+     */
+
+    using Constant = ASTNode::Constant;
+
+    Constant::Constant(const Data& data):
+        m_data(data)
+    {}
+
+    const Constant::Data& Constant::Get() const {
+        return m_data;
+    }
+
+    std::string Constant::Stringify() const {
+        return std::visit(overloaded{
+            [](Int intValue)     -> std::string { return "Int(" + std::to_string(intValue) + ')'; },
+            [](Float floatValue) -> std::string { return "Float(" + std::to_string(floatValue) + ')'; },
+            [](Bool boolValue)   -> std::string { return std::string("Bool(") + (boolValue ? "true" : "false") + ')'; }
+        }, m_data);
+    }
+
     /*
      *
      * Expression
@@ -524,13 +600,18 @@ namespace ry {
         }, m_data.value());
     }
 
-    std::optional<ExpressionLiteral::Float> ExpressionLiteral::TryGetNumberValue() const {
+    std::optional<Constant> ExpressionLiteral::FoldConstant() const {
         if(!m_data)
             return {};
-        if(auto intValue = std::get_if<Int>(&m_data.value()))
-            return *intValue;
+        if(auto intValue = std::get_if<Int>(&m_data.value())) {
+            if(*intValue > Int(std::numeric_limits<Constant::Int>::max()))
+                return {};
+            return Constant(Constant::Int(*intValue));
+        }
         if(auto floatValue = std::get_if<Float>(&m_data.value()))
-            return *floatValue;
+            return Constant(*floatValue);
+        if(auto boolValue = std::get_if<Bool>(&m_data.value()))
+            return Constant(*boolValue);
         return {};
     }
 
@@ -854,11 +935,34 @@ namespace ry {
         return StringifyPretty(m_kind, m_operand);
     }
 
-    std::optional<ExpressionLiteral::Float> ExpressionUnaryOperation::TryGetNumberValue() const {
-        if(m_kind == Kind::ArithmeticNegation)
-            if(auto optNumValue = m_operand->TryGetNumberValue())
-                return - optNumValue.value();
-        return {};
+    std::optional<Constant> ExpressionUnaryOperation::FoldConstant() const {
+        return FoldConstant(m_kind, m_operand);
+    }
+
+    std::optional<Constant> ExpressionUnaryOperation::FoldConstant(Kind kind, const Operand& operand) {
+        const auto& optConstant = operand->GetConstant();
+        if(!optConstant)
+            return {};
+        const Constant::Data& value = optConstant->Get();
+        using UInt = std::uint64_t;
+        switch(kind) {
+            case Kind::ArithmeticNegation:
+                if(auto intValue = std::get_if<Constant::Int>(&value))
+                    return Constant(Constant::Int(UInt(0) - UInt(*intValue)));
+                if(auto floatValue = std::get_if<Constant::Float>(&value))
+                    return Constant(- *floatValue);
+                return {};
+            case Kind::BitwiseNegation:
+                if(auto intValue = std::get_if<Constant::Int>(&value))
+                    return Constant(~ *intValue);
+                return {};
+            case Kind::LogicalNegation:
+                if(auto boolValue = std::get_if<Constant::Bool>(&value))
+                    return Constant(! *boolValue);
+                return {};
+            default:
+                return {};
+        }
     }
 
     std::string ExpressionUnaryOperation::Stringify(Kind kind, const Operand& operand, std::size_t indent) {
@@ -964,11 +1068,11 @@ namespace ry {
             + StringifyPretty(kind, operands)
             + '\n';
 
-        auto optNumValue = TryGetNumberValue(kind, operands);
+        auto optConstant = FoldConstant(kind, operands);
         str +=
             GetIndentString(indent + 1)
             + "[InterpretedValue]: "
-            + (optNumValue ? std::to_string(optNumValue.value()) : "none")
+            + (optConstant ? optConstant->Stringify() : "none")
             + '\n';
 
         str +=
@@ -995,45 +1099,149 @@ namespace ry {
         return operands.first->StringifyPretty() + ' ' + StringifyKindPretty(kind) + ' ' + operands.second->StringifyPretty();
     }
 
-    std::optional<ExpressionLiteral::Float> ExpressionBinaryOperation::TryGetNumberValue() const {
-        return TryGetNumberValue(m_kind, m_operands);
-    }
-
-    std::optional<ExpressionLiteral::Float> ExpressionBinaryOperation::TryGetNumberValue(Kind kind, const Operands& operands) {
-        auto optNum1 = operands.first->TryGetNumberValue();
-        auto optNum2 = operands.second->TryGetNumberValue();
-        if(optNum1 && optNum2) {
-            auto a = optNum1.value();
-            auto b = optNum2.value();
-            using Int = ExpressionLiteral::Int;
-            switch(kind) { 
-                case Kind::Add : return a + b;
-                case Kind::Sub : return a - b;
-                case Kind::Div : return a / b;
-                case Kind::Mul : return a * b;
-                case Kind::Mod : return std::fmod(a, b);
-                // 
-                case Kind::BitOr     : return Int(a) | Int(b);
-                case Kind::BitXor    : return Int(a) ^ Int(b);
-                case Kind::BitAnd    : return Int(a) & Int(b);
-                case Kind::BitLShift : return Int(a) << Int(b);
-                case Kind::BitRShift : return Int(a) >> Int(b);
-                // 
-                case Kind::Eq         : return a == b;
-                case Kind::Uneq       : return a != b;
-                case Kind::Less       : return a < b;
-                case Kind::LessEqual  : return a <= b;
-                case Kind::Great      : return a > b;
-                case Kind::GreatEqual : return a >= b;
-                // 
-                case Kind::Or  : return a || b;
-                case Kind::And : return a && b;
-                // 
-                default:
+    std::optional<Constant> ExpressionBinaryOperation::FoldConstant() const {
+        return FoldConstant(m_kind, m_operands);
+    }
+
+    // Operands are already folded, so this is O(1) regardless of the subtree size
+    std::optional<Constant> ExpressionBinaryOperation::FoldConstant(Kind kind, const Operands& operands) {
+        const auto& optConstant1 = operands.first->GetConstant();
+        const auto& optConstant2 = operands.second->GetConstant();
+        if(!optConstant1 || !optConstant2)
+            return {};
+        const Constant::Data& value1 = optConstant1->Get();
+        const Constant::Data& value2 = optConstant2->Get();
+
+        using Int = Constant::Int;
+        using UInt = std::uint64_t;
+        using Float = Constant::Float;
+        using Bool = Constant::Bool;
+
+        auto intValue1 = std::get_if<Int>(&value1);
+        auto intValue2 = std::get_if<Int>(&value2);
+        auto boolValue1 = std::get_if<Bool>(&value1);
+        auto boolValue2 = std::get_if<Bool>(&value2);
+        bool isNumber1 = !boolValue1;
+        bool isNumber2 = !boolValue2;
+
+        auto toFloat = [](const Constant::Data& value) -> Float {
+            if(auto intValue = std::get_if<Int>(&value))
+                return Float(*intValue);
+            return std::get<Float>(value);
+        };
+
+        switch(kind) {
+            case Kind::Add:
+            case Kind::Sub:
+            case Kind::Mul:
+            case Kind::Div:
+            case Kind::Mod: {
+                if(!isNumber1 || !isNumber2)
                     return {};
+                if(intValue1 && intValue2) {
+                    // wrap around instead of invoking signed overflow UB
+                    Int a = *intValue1;
+                    Int b = *intValue2;
+                    switch(kind) {
+                        case Kind::Add: return Constant(Int(UInt(a) + UInt(b)));
+                        case Kind::Sub: return Constant(Int(UInt(a) - UInt(b)));
+                        case Kind::Mul: return Constant(Int(UInt(a) * UInt(b)));
+                        case Kind::Div:
+                            if(b == 0)
+                                return {};
+                            if(b == -1)
+                                return Constant(Int(UInt(0) - UInt(a)));
+                            return Constant(Int(a / b));
+                        case Kind::Mod:
+                            if(b == 0)
+                                return {};
+                            if(b == -1)
+                                return Constant(Int(0));
+                            return Constant(Int(a % b));
+                        default:
+                            return {};
+                    }
+                }
+                Float a = toFloat(value1);
+                Float b = toFloat(value2);
+                switch(kind) {
+                    case Kind::Add: return Constant(a + b);
+                    case Kind::Sub: return Constant(a - b);
+                    case Kind::Mul: return Constant(a * b);
+                    case Kind::Div: return Constant(a / b);
+                    case Kind::Mod: return Constant(std::fmod(a, b));
+                    default:
+                        return {};
+                }
             }
+            // 
+            case Kind::BitOr:
+            case Kind::BitXor:
+            case Kind::BitAnd:
+            case Kind::BitLShift:
+            case Kind::BitRShift: {
+                if(!intValue1 || !intValue2)
+                    return {};
+                Int a = *intValue1;
+                Int b = *intValue2;
+                switch(kind) {
+                    case Kind::BitOr  : return Constant(Int(a | b));
+                    case Kind::BitXor : return Constant(Int(a ^ b));
+                    case Kind::BitAnd : return Constant(Int(a & b));
+                    case Kind::BitLShift:
+                        if(b < 0 || b >= 64)
+                            return {};
+                        return Constant(Int(UInt(a) << b));
+                    case Kind::BitRShift:
+                        if(b < 0 || b >= 64)
+                            return {};
+                        return Constant(Int(a >> b));
+                    default:
+                        return {};
+                }
+            }
+            // 
+            case Kind::Eq:
+            case Kind::Uneq:
+                if(boolValue1 && boolValue2) {
+                    bool isEqual = (*boolValue1 == *boolValue2);
+                    return Constant(kind == Kind::Eq ? isEqual : !isEqual);
+                }
+                [[fallthrough]];
+            case Kind::Less:
+            case Kind::LessEqual:
+            case Kind::Great:
+            case Kind::GreatEqual: {
+                if(!isNumber1 || !isNumber2)
+                    return {};
+                auto compare = [&](auto a, auto b) -> Bool {
+                    switch(kind) {
+                        case Kind::Eq         : return a == b;
+                        case Kind::Uneq       : return a != b;
+                        case Kind::Less       : return a < b;
+                        case Kind::LessEqual  : return a <= b;
+                        case Kind::Great      : return a > b;
+                        case Kind::GreatEqual : return a >= b;
+                        default:
+                            return false;
+                    }
+                };
+                if(intValue1 && intValue2)
+                    return Constant(compare(*intValue1, *intValue2));
+                return Constant(compare(toFloat(value1), toFloat(value2)));
+            }
+            // 
+            case Kind::Or:
+            case Kind::And:
+                if(!boolValue1 || !boolValue2)
+                    return {};
+                if(kind == Kind::Or)
+                    return Constant(*boolValue1 || *boolValue2);
+                return Constant(*boolValue1 && *boolValue2);
+            // 
+            default:
+                return {};
         }
-        return {};
     }
 
     // 
@@ -1052,9 +1260,15 @@ namespace ry {
         return m_isGrouped;
     }
 
-    Expression::Expression(const Data& data, bool isGrouped):
+    const std::optional<SourcePosition>& Expression::GetSourcePosition() const {
+        return m_srcPos;
+    }
+
+    Expression::Expression(const Data& data, bool isGrouped, const std::optional<SourcePosition>& srcPos):
         m_data(data),
-        m_isGrouped(isGrouped)
+        m_isGrouped(isGrouped),
+        m_constant(foldConstant(m_data)),
+        m_srcPos(srcPos)
     {}
 
     std::optional<Expression::LValue> Expression::ToLValue() const {
@@ -1082,11 +1296,10 @@ namespace ry {
             + StringifyPretty()
             + '\n';
 
-        auto optNumValue = TryGetNumberValue();
         str +=
             GetIndentString(indent + 1)
             + "[InterpretedValue]: "
-            + (optNumValue ? std::to_string(optNumValue.value()) : "none")
+            + (m_constant ? m_constant->Stringify() : "none")
             + '\n';
 
         str +=
@@ -1131,13 +1344,17 @@ namespace ry {
         return str;
     }
 
-    std::optional<ExpressionLiteral::Float> Expression::TryGetNumberValue() const {
-        if(auto literal = std::get_if<ExpressionLiteral>(&m_data))
-            return literal->TryGetNumberValue();
-        if(auto unaryOp = std::get_if<ExpressionUnaryOperation>(&m_data))
-            return unaryOp->TryGetNumberValue();
-        if(auto binOp = std::get_if<ExpressionBinaryOperation>(&m_data))
-            return binOp->TryGetNumberValue();
+    const std::optional<Constant>& Expression::GetConstant() const {
+        return m_constant;
+    }
+
+    std::optional<Constant> Expression::foldConstant(const Data& data) {
+        if(auto literal = std::get_if<ExpressionLiteral>(&data))
+            return literal->FoldConstant();
+        if(auto unaryOp = std::get_if<ExpressionUnaryOperation>(&data))
+            return unaryOp->FoldConstant();
+        if(auto binOp = std::get_if<ExpressionBinaryOperation>(&data))
+            return binOp->FoldConstant();
         return {};
     }
 
@@ -1491,14 +1708,19 @@ namespace ry {
 
     using Statement = ASTNode::Statement;
 
-    Statement::Statement(const Data& data):
-        m_data(data)
+    Statement::Statement(const Data& data, const std::optional<SourcePosition>& srcPos):
+        m_data(data),
+        m_srcPos(srcPos)
     {}
 
     const Statement::Data& Statement::Get() const {
         return m_data;
     }
 
+    const std::optional<SourcePosition>& Statement::GetSourcePosition() const {
+        return m_srcPos;
+    }
+
     std::string Statement::Stringify(std::size_t indent) const {
         std::string str = "Statement";
         str += '\n';
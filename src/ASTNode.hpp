@@ -1,9 +1,11 @@
 #pragma once
 
+#include "SourcePosition.hpp"
 #include "Token.hpp"
 #include "ry.hpp"
 #include "src/ASTNode.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string_view>
@@ -49,7 +51,41 @@ namespace ry {
         E(U128, TK::KeywordU128) \
         E(F32, TK::KeywordF32) \
         E(F64, TK::KeywordF64) \
-        E(Bool, TK::KeywordBool)
+        E(Bool, TK::KeywordBool) \
+        E(I8x16, TK::KeywordI8x16) \
+        E(I16x8, TK::KeywordI16x8) \
+        E(I32x4, TK::KeywordI32x4) \
+        E(I32x8, TK::KeywordI32x8) \
+        E(I64x2, TK::KeywordI64x2) \
+        E(I64x4, TK::KeywordI64x4) \
+        E(U8x16, TK::KeywordU8x16) \
+        E(U16x8, TK::KeywordU16x8) \
+        E(U32x4, TK::KeywordU32x4) \
+        E(U32x8, TK::KeywordU32x8) \
+        E(U64x2, TK::KeywordU64x2) \
+        E(U64x4, TK::KeywordU64x4) \
+        E(F32x4, TK::KeywordF32x4) \
+        E(F32x8, TK::KeywordF32x8) \
+        E(F64x2, TK::KeywordF64x2) \
+        E(F64x4, TK::KeywordF64x4)
+    #define RY_ASTNODE__VECTOR_TYPES_E_MAP(NAME, ELEMENT, NUM_LANES) { TypePrimitive::NAME, VectorShape{TypePrimitive::ELEMENT, NUM_LANES} } ,
+    #define RY_ASTNODE__VECTOR_TYPES(E) /* E - expand macro */ \
+        E(I8x16, I8, 16) \
+        E(I16x8, I16, 8) \
+        E(I32x4, I32, 4) \
+        E(I32x8, I32, 8) \
+        E(I64x2, I64, 2) \
+        E(I64x4, I64, 4) \
+        E(U8x16, U8, 16) \
+        E(U16x8, U16, 8) \
+        E(U32x4, U32, 4) \
+        E(U32x8, U32, 8) \
+        E(U64x2, U64, 2) \
+        E(U64x4, U64, 4) \
+        E(F32x4, F32, 4) \
+        E(F32x8, F32, 8) \
+        E(F64x2, F64, 2) \
+        E(F64x4, F64, 4)
 
         enum class TypePrimitive {
             RY_ASTNODE__PRIMITIVE_TYPES(RY_ASTNODE__PRIMITIVE_TYPES_E_ENUM)
@@ -57,6 +93,18 @@ namespace ry {
         static const std::unordered_map<TypePrimitive, const char *> PRIMITIVE_TYPES_STRINGS_MAP;
         static const std::set<Token::NumericKind> PRIMITIVE_TYPES_TOKEN_KINDS;
 
+        // A vector primitive is a fixed number of lanes of a scalar one, e.g. f32x4
+        struct VectorShape {
+            TypePrimitive element;
+            std::uint32_t numLanes;
+        };
+        static const std::unordered_map<TypePrimitive, VectorShape> VECTOR_SHAPES_MAP;
+
+        static std::optional<VectorShape> GetVectorShape(TypePrimitive primitive);
+        static std::optional<TypePrimitive> GetVectorPrimitive(TypePrimitive element, std::uint32_t numLanes);
+        // Lanes named by a member of a vector, from x, y, z and w, or s and hexadecimal indices, e.g. "wzyx" or "s01ef"
+        static std::optional<std::vector<std::uint32_t>> GetLanes(std::string_view name, std::uint32_t numLanes);
+
     #undef RY_ASTNODE__PRIMITIVE_TYPES_E_STR
     #undef RY_ASTNODE__PRIMITIVE_TYPES_E_ENUM
 
@@ -146,6 +194,8 @@ namespace ry {
             struct Attribs {
                 bool isMutable = false;
                 bool isOptional = false;
+                bool isOrdered = false; // structs: fields laid out in declaration order
+                bool isSoA = false;     // structs: repeated struct fields laid out as one array per field
             };
             using Data = std::variant<TypePrimitive, TypeFunction, TypeStruct, TypePointer>;
 
@@ -166,6 +216,32 @@ namespace ry {
             Data m_data;
         };
 
+        /*
+         *
+         * Constant
+         *
+         */
+
+        // Compile-time value of a constant expression.
+        // Integers are folded with 64-bit two's complement wrapping,
+        // floats stay floats, and mixed integer/float operands promote to float.
+        class Constant {
+        public:
+            using Int = std::int64_t;
+            using Float = TokenLiteral::Float;
+            using Bool = bool;
+            using Data = std::variant<Int, Float, Bool>;
+
+            Constant(const Data& data);
+
+            const Data& Get() const;
+
+            std::string Stringify() const;
+
+        private:
+            Data m_data;
+        };
+
         /*
          *
          * Expression
@@ -224,7 +300,7 @@ namespace ry {
             std::string Stringify(std::size_t indent = 0) const;
             std::string StringifyPretty() const;
 
-            std::optional<Float> TryGetNumberValue() const;
+            std::optional<Constant> FoldConstant() const;
 
         private:
             Data m_data;
@@ -365,7 +441,8 @@ namespace ry {
             static std::string Stringify(Kind kind, const Operand& operand, std::size_t indent = 0);
             static std::string StringifyPretty(Kind kind, const Operand& operand);
 
-            std::optional<ExpressionLiteral::Float> TryGetNumberValue() const;
+            std::optional<Constant> FoldConstant() const;
+            static std::optional<Constant> FoldConstant(Kind kind, const Operand& operand);
 
         private:
             static const std::set<Token::NumericKind> TOKEN_KINDS;
@@ -430,8 +507,8 @@ namespace ry {
             static std::string Stringify(Kind kind, const Operands& operands, std::size_t indent = 0);
             static std::string StringifyPretty(Kind kind, const Operands& operands);
 
-            std::optional<ExpressionLiteral::Float> TryGetNumberValue() const;
-            static std::optional<ExpressionLiteral::Float> TryGetNumberValue(Kind kind, const Operands& operands);
+            std::optional<Constant> FoldConstant() const;
+            static std::optional<Constant> FoldConstant(Kind kind, const Operands& operands);
 
         private:
             Kind m_kind;
@@ -465,24 +542,30 @@ namespace ry {
                 ExpressionName
             >;
 
-            Expression(const Data& data, bool isGrouped = false);
+            Expression(const Data& data, bool isGrouped = false, const std::optional<SourcePosition>& srcPos = {});
 
             const Data& Get() const;
             bool IsGrouped() const;
+            const std::optional<SourcePosition>& GetSourcePosition() const;
             
             std::optional<LValue> ToLValue() const;
 
             std::string Stringify(std::size_t indent = 0) const;
             std::string StringifyPretty() const;
 
-            std::optional<ExpressionLiteral::Float> TryGetNumberValue() const;
+            // Folded once on construction, children are always built before their parents
+            const std::optional<Constant>& GetConstant() const;
 
             static std::string StringifyLValue(const LValue& lvalue, std::size_t indent = 0);
             static std::string StringifyLValuePretty(const LValue& lvalue);
 
         private:
+            static std::optional<Constant> foldConstant(const Data& data);
+
             bool m_isGrouped; // ( ... )
             Data m_data;
+            std::optional<Constant> m_constant;
+            std::optional<SourcePosition> m_srcPos;
         };
 
         /*
@@ -644,15 +727,17 @@ namespace ry {
                 StatementBreak
             >;
 
-            Statement(const Data& data);
+            Statement(const Data& data, const std::optional<SourcePosition>& srcPos = {});
 
             const Data& Get() const;
+            const std::optional<SourcePosition>& GetSourcePosition() const;
 
             std::string Stringify(std::size_t indent = 0) const;
             std::string StringifyPretty() const;
     
         private:
             Data m_data;
+            std::optional<SourcePosition> m_srcPos;
         };
 
         /*
@@ -0,0 +1,209 @@
+#include "ASTStats.hpp"
+#include "ry.hpp"
+
+#include <variant>
+
+namespace ry {
+
+    ASTStats::ASTStats():
+        m_nodeCount(0)
+    {}
+
+    void ASTStats::Add(const ASTNode& ast) {
+        std::visit(overloaded{
+            [&](const ASTNode::Type& type)       { addType(type); },
+            [&](const ASTNode::Expression& expr) { addExpression(expr); },
+            [&](const ASTNode::Statement& stmt)  { addStatement(stmt); }
+        }, ast.Get());
+    }
+
+    void ASTStats::Add(const ASTStats& other) {
+        m_nodeCount += other.m_nodeCount;
+        for(const auto& [kind, count] : other.m_kindCounts)
+            m_kindCounts[kind] += count;
+    }
+
+    std::size_t ASTStats::GetNodeCount() const {
+        return m_nodeCount;
+    }
+
+    const ASTStats::KindCounts& ASTStats::GetKindCounts() const {
+        return m_kindCounts;
+    }
+
+    void ASTStats::count(std::string_view kind) {
+        m_nodeCount++;
+        m_kindCounts[kind]++;
+    }
+
+    /*
+     *
+     * Type
+     *
+     */
+
+    void ASTStats::addType(const ASTNode::Type& type) {
+        std::visit(overloaded{
+            [&](ASTNode::TypePrimitive) {
+                count("TypePrimitive");
+            },
+            [&](const ASTNode::TypePointer& pointer) {
+                count("TypePointer");
+                addType(*pointer);
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                count("TypeFunction");
+                addTypeStruct(function.GetArgumentsType());
+                addType(*function.GetReturnType());
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                addTypeStruct(structType);
+            }
+        }, type.Get());
+    }
+
+    void ASTStats::addTypeStruct(const ASTNode::TypeStruct& structType) {
+        count("TypeStruct");
+        for(const ASTNode::TypeStruct::Field& field : structType.GetFields()) {
+            std::visit(overloaded{
+                [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                    addType(*namedField.GetType());
+                    if(namedField.GetDefaultValue())
+                        addExpression(*namedField.GetDefaultValue().value());
+                },
+                [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                    addType(*unnamedField.GetType());
+                    if(unnamedField.GetTypeReps())
+                        addExpression(*unnamedField.GetTypeReps().value());
+                    if(unnamedField.GetDefaultValue())
+                        addExpression(*unnamedField.GetDefaultValue().value());
+                }
+            }, field);
+        }
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    void ASTStats::addStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit) {
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields())
+            addExpression(*field.GetValue());
+    }
+
+    void ASTStats::addExpression(const ASTNode::Expression& expr) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                count("ExprLit");
+                if(literal.Get())
+                    if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                        addStructLiteral(*structLit);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                count("ExprFuncCall");
+                addExpression(*funcCall.GetFunction());
+                addStructLiteral(funcCall.GetParameters());
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                count("ExprBlock");
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    addStatement(stmt);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                count("ExprIf");
+                addExpression(*ifExpr.GetCondition());
+                addStatement(*ifExpr.GetSuccessStatement());
+                if(ifExpr.GetFailStatement())
+                    addStatement(*ifExpr.GetFailStatement().value());
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                count("ExprLoop");
+                if(loop.GetInitStatement())
+                    addStatement(*loop.GetInitStatement().value());
+                if(loop.GetCondition())
+                    addExpression(*loop.GetCondition().value());
+                if(loop.GetPostStatement())
+                    addStatement(*loop.GetPostStatement().value());
+                addStatement(*loop.GetBodyStatement());
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                count("ExprUnaryOp");
+                addExpression(*unaryOp.GetOperand());
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                count("ExprBinOp");
+                addExpression(*binOp.GetOperands().first);
+                addExpression(*binOp.GetOperands().second);
+            },
+            [&](const ASTNode::ExpressionName&) {
+                count("ExprName");
+            }
+        }, expr.Get());
+    }
+
+    void ASTStats::addLValue(const ASTNode::Expression::LValue& lvalue) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName&) {
+                count("ExprName");
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                count("ExprUnaryOp");
+                addExpression(*operand);
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                count("ExprBinOp");
+                addExpression(*operands.first);
+                addExpression(*operands.second);
+            }
+        }, lvalue);
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    void ASTStats::addStatement(const ASTNode::Statement& stmt) {
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                addExpression(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                count("StmtBinOp");
+                addLValue(binOp.GetOperands().first);
+                addExpression(binOp.GetOperands().second);
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        count("StmtTypedVarDef");
+                        addType(typedVarDef.GetType());
+                        if(typedVarDef.GetValue())
+                            addExpression(typedVarDef.GetValue().value());
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        count("StmtUntypedVarDef");
+                        addExpression(untypedVarDef.GetValue());
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                count("StmtAssign");
+                addLValue(assign.GetLValue());
+                addExpression(assign.GetRValue());
+            },
+            [&](const ASTNode::StatementContinue&) {
+                count("StmtContinue");
+            },
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                count("StmtBreak");
+                if(stmtBreak.GetValue())
+                    addExpression(stmtBreak.GetValue().value());
+            }
+        }, stmt.Get());
+    }
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ASTNode.hpp"
+
+#include <cstddef>
+#include <map>
+#include <string_view>
+
+namespace ry {
+
+    // Counts AST nodes by kind, kinds are named like in ASTNode::Stringify
+    class ASTStats {
+    public:
+        using KindCounts = std::map<std::string_view, std::size_t>;
+
+        ASTStats();
+
+        void Add(const ASTNode& ast);
+        void Add(const ASTStats& other);
+
+        std::size_t GetNodeCount() const;
+        const KindCounts& GetKindCounts() const;
+
+    private:
+        void count(std::string_view kind);
+
+        void addType(const ASTNode::Type& type);
+        void addTypeStruct(const ASTNode::TypeStruct& structType);
+        void addStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit);
+        void addExpression(const ASTNode::Expression& expr);
+        void addLValue(const ASTNode::Expression::LValue& lvalue);
+        void addStatement(const ASTNode::Statement& stmt);
+
+        std::size_t m_nodeCount;
+        KindCounts m_kindCounts;
+    };
+
+}
@@ -0,0 +1,775 @@
+#include "ASTView.hpp"
+#include "ry.hpp"
+
+#include <memory>
+#include <assert.h>
+
+namespace ry {
+
+    using Tag = ASTBinary::Tag;
+    using Base = const std::uint8_t *;
+
+    /*
+     *
+     * Node
+     *
+     */
+
+    ASTView::NodeRef::NodeRef(Base base, Base node):
+        m_base(base),
+        m_node(node)
+    {}
+
+    Tag ASTView::NodeRef::getTag() const {
+        return ASTBinary::Read<ASTBinary::NodeHeader>(m_node).tag;
+    }
+
+    std::uint8_t ASTView::NodeRef::getFlags() const {
+        return ASTBinary::Read<ASTBinary::NodeHeader>(m_node).flags;
+    }
+
+    const std::uint8_t * ASTView::NodeRef::getFieldPointer(std::size_t fieldIdx) const {
+        return m_node + sizeof(ASTBinary::NodeHeader) + fieldIdx * ASTBinary::FIELD_SIZE;
+    }
+
+    std::uint32_t ASTView::NodeRef::getField(std::size_t fieldIdx) const {
+        return ASTBinary::Read<std::uint32_t>(getFieldPointer(fieldIdx));
+    }
+
+    const std::uint8_t * ASTView::NodeRef::getRelField(std::size_t fieldIdx) const {
+        const std::uint8_t * field = getFieldPointer(fieldIdx);
+        std::int32_t rel = ASTBinary::Read<std::int32_t>(field);
+        if(rel == 0)
+            return nullptr;
+        return field + rel;
+    }
+
+    std::string_view ASTView::NodeRef::getString(std::uint32_t idx) const {
+        auto header = ASTBinary::Read<ASTBinary::Header>(m_base);
+        const std::uint8_t * table = m_base + header.stringTableOffset;
+        std::uint32_t count = ASTBinary::Read<std::uint32_t>(table);
+        const std::uint8_t * entry = table + ASTBinary::FIELD_SIZE + idx * 2 * ASTBinary::FIELD_SIZE;
+        std::uint32_t offset = ASTBinary::Read<std::uint32_t>(entry);
+        std::uint32_t length = ASTBinary::Read<std::uint32_t>(entry + ASTBinary::FIELD_SIZE);
+        const std::uint8_t * chars = table + ASTBinary::FIELD_SIZE + count * 2 * ASTBinary::FIELD_SIZE;
+        return std::string_view(reinterpret_cast<const char *>(chars + offset), length);
+    }
+
+    std::optional<std::string_view> ASTView::NodeRef::getOptionalString(std::size_t fieldIdx) const {
+        std::uint32_t idx = getField(fieldIdx);
+        if(idx == ASTBinary::NO_STRING)
+            return {};
+        return getString(idx);
+    }
+
+    std::optional<SourcePosition> ASTView::NodeRef::getSourcePosition() const {
+        auto position = ASTBinary::Read<ASTBinary::Position>(m_node - sizeof(ASTBinary::Position));
+        if(position.startLine == 0)
+            return {};
+        return SourcePosition(position.startLine, position.startColumn, position.endLine, position.endColumn);
+    }
+
+    /*
+     *
+     * Type
+     *
+     */
+
+    using TypeStruct = ASTView::TypeStruct;
+
+        TypeStruct::NamedField::NamedField(Base base, Base node): NodeRef(base, node) {}
+        ASTView::Type                            TypeStruct::NamedField::GetType         () const { return makeChild<Type>(0);                }
+        ASTView::List<std::string_view>          TypeStruct::NamedField::GetNames        () const { return List<Name>(m_base, m_node, 3, getField(2)); }
+        std::optional<ASTView::Expression>       TypeStruct::NamedField::GetDefaultValue () const { return makeOptionalChild<Expression>(1); }
+
+        TypeStruct::UnnamedField::UnnamedField(Base base, Base node): NodeRef(base, node) {}
+        ASTView::Type                            TypeStruct::UnnamedField::GetType         () const { return makeChild<Type>(0);                }
+        std::optional<ASTView::Expression>       TypeStruct::UnnamedField::GetTypeReps     () const { return makeOptionalChild<Expression>(1); }
+        std::optional<ASTView::Expression>       TypeStruct::UnnamedField::GetDefaultValue () const { return makeOptionalChild<Expression>(2); }
+
+        TypeStruct::Field TypeStruct::Field::FromNode(Base base, Base node) {
+            if(ASTBinary::Read<ASTBinary::NodeHeader>(node).tag == Tag::TypeStructNamedField)
+                return NamedField(base, node);
+            return UnnamedField(base, node);
+        }
+
+    TypeStruct::TypeStruct(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ASTView::List<TypeStruct::Field> TypeStruct::GetFields() const {
+        return List<Field>(m_base, m_node, 1, getField(0));
+    }
+
+    //
+
+    using TypeFunction = ASTView::TypeFunction;
+
+    TypeFunction::TypeFunction(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    TypeStruct TypeFunction::GetArgumentsType() const {
+        return makeChild<TypeStruct>(0);
+    }
+
+    ASTView::Type TypeFunction::GetReturnType() const {
+        return makeChild<Type>(1);
+    }
+
+    //
+
+    using TypePointer = ASTView::TypePointer;
+
+    TypePointer::TypePointer(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ASTView::Type TypePointer::operator*() const {
+        return makeChild<Type>(0);
+    }
+
+    //
+
+    using Type = ASTView::Type;
+
+    Type::Type(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    Type Type::FromNode(Base base, Base node) {
+        return Type(base, node);
+    }
+
+    Type::Attribs Type::GetAttribs() const {
+        Attribs attribs;
+        attribs.isMutable = getFlags() & ASTBinary::FLAG_MUTABLE;
+        attribs.isOptional = getFlags() & ASTBinary::FLAG_OPTIONAL;
+        attribs.isOrdered = getFlags() & ASTBinary::FLAG_ORDERED;
+        attribs.isSoA = getFlags() & ASTBinary::FLAG_SOA;
+        return attribs;
+    }
+
+    Type::Data Type::Get() const {
+        switch(getTag()) {
+            case Tag::TypePrimitive: return TypePrimitive(getField(0));
+            case Tag::TypePointer:   return TypePointer(m_base, m_node);
+            case Tag::TypeFunction:  return TypeFunction(m_base, m_node);
+            case Tag::TypeStruct:    return TypeStruct(m_base, m_node);
+            default:
+                assert(false);
+                return TypePrimitive(getField(0));
+        }
+    }
+
+    const char * Type::StringifyKind() const {
+        switch(getTag()) {
+            case Tag::TypePrimitive: return "primitive";
+            case Tag::TypePointer:   return "pointer";
+            case Tag::TypeFunction:  return "function";
+            case Tag::TypeStruct:    return "struct";
+            default:
+                return "???";
+        }
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    using ExpressionLiteral = ASTView::ExpressionLiteral;
+    using StructLit = ExpressionLiteral::Struct;
+    using StructLitField = StructLit::Field;
+
+    StructLitField::Field(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    StructLitField StructLitField::FromNode(Base base, Base node) {
+        return StructLitField(base, node);
+    }
+
+    StructLitField::FieldName StructLitField::GetName() const {
+        return getOptionalString(0);
+    }
+
+    ASTView::Expression StructLitField::GetValue() const {
+        return makeChild<Expression>(1);
+    }
+
+    StructLit::Struct(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ASTView::List<StructLitField> StructLit::GetFields() const {
+        return List<Field>(m_base, m_node, 1, getField(0));
+    }
+
+    ExpressionLiteral::ExpressionLiteral(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ExpressionLiteral::Data ExpressionLiteral::Get() const {
+        using LiteralKind = ASTBinary::LiteralKind;
+        switch(LiteralKind(getField(1))) {
+            case LiteralKind::Null:   return {};
+            case LiteralKind::Int:    return ASTBinary::Read<Int>(getFieldPointer(2));
+            case LiteralKind::Float:  return ASTBinary::Read<Float>(getFieldPointer(2));
+            case LiteralKind::String: return getString(getField(2));
+            case LiteralKind::Char:   return Char(getField(2));
+            case LiteralKind::Bool:   return Bool(getField(2));
+            case LiteralKind::Struct: return makeChild<Struct>(2);
+        }
+        assert(false);
+        return {};
+    }
+
+    //
+
+    using ExpressionFunctionCall = ASTView::ExpressionFunctionCall;
+
+    ExpressionFunctionCall::ExpressionFunctionCall(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ASTView::Expression ExpressionFunctionCall::GetFunction() const {
+        return makeChild<Expression>(1);
+    }
+
+    ExpressionFunctionCall::Parameters ExpressionFunctionCall::GetParameters() const {
+        return makeChild<Parameters>(2);
+    }
+
+    //
+
+    using ExpressionBlock = ASTView::ExpressionBlock;
+
+    ExpressionBlock::ExpressionBlock(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ExpressionBlock::Label ExpressionBlock::GetLabel() const {
+        return getOptionalString(1);
+    }
+
+    ASTView::List<ASTView::Statement> ExpressionBlock::GetStatements() const {
+        return List<Statement>(m_base, m_node, 3, getField(2));
+    }
+
+    //
+
+    using ExpressionIf = ASTView::ExpressionIf;
+
+    ExpressionIf::ExpressionIf(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ASTView::Expression              ExpressionIf::GetCondition        () const { return makeChild<Expression>(1);        }
+    ASTView::Statement               ExpressionIf::GetSuccessStatement () const { return makeChild<Statement>(2);         }
+    std::optional<ASTView::Statement> ExpressionIf::GetFailStatement   () const { return makeOptionalChild<Statement>(3); }
+
+    //
+
+    using ExpressionLoop = ASTView::ExpressionLoop;
+
+    ExpressionLoop::ExpressionLoop(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    std::optional<ASTView::Statement>  ExpressionLoop::GetInitStatement () const { return makeOptionalChild<Statement>(1);  }
+    std::optional<ASTView::Expression> ExpressionLoop::GetCondition     () const { return makeOptionalChild<Expression>(2); }
+    std::optional<ASTView::Statement>  ExpressionLoop::GetPostStatement () const { return makeOptionalChild<Statement>(3);  }
+    ASTView::Statement                 ExpressionLoop::GetBodyStatement () const { return makeChild<Statement>(4);          }
+
+    //
+
+    using ExpressionUnaryOperation = ASTView::ExpressionUnaryOperation;
+
+    ExpressionUnaryOperation::ExpressionUnaryOperation(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ExpressionUnaryOperation::Kind ExpressionUnaryOperation::GetKind() const {
+        return Kind(getField(1));
+    }
+
+    ASTView::Expression ExpressionUnaryOperation::GetOperand() const {
+        return makeChild<Expression>(2);
+    }
+
+    //
+
+    using ExpressionBinaryOperation = ASTView::ExpressionBinaryOperation;
+
+    ExpressionBinaryOperation::ExpressionBinaryOperation(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ExpressionBinaryOperation::Kind ExpressionBinaryOperation::GetKind() const {
+        return Kind(getField(1));
+    }
+
+    ExpressionBinaryOperation::Operands ExpressionBinaryOperation::GetOperands() const {
+        return {makeChild<Expression>(2), makeChild<Expression>(3)};
+    }
+
+    //
+
+    using Expression = ASTView::Expression;
+
+    Expression::Expression(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    Expression Expression::FromNode(Base base, Base node) {
+        return Expression(base, node);
+    }
+
+    Expression::Data Expression::Get() const {
+        switch(getTag()) {
+            case Tag::ExpressionLiteral:         return ExpressionLiteral(m_base, m_node);
+            case Tag::ExpressionFunctionCall:    return ExpressionFunctionCall(m_base, m_node);
+            case Tag::ExpressionBlock:           return ExpressionBlock(m_base, m_node);
+            case Tag::ExpressionIf:              return ExpressionIf(m_base, m_node);
+            case Tag::ExpressionLoop:            return ExpressionLoop(m_base, m_node);
+            case Tag::ExpressionUnaryOperation:  return ExpressionUnaryOperation(m_base, m_node);
+            case Tag::ExpressionBinaryOperation: return ExpressionBinaryOperation(m_base, m_node);
+            case Tag::ExpressionName:            return ExpressionName(getString(getField(1)));
+            default:
+                assert(false);
+                return ExpressionName();
+        }
+    }
+
+    bool Expression::IsGrouped() const {
+        return getFlags() & ASTBinary::FLAG_GROUPED;
+    }
+
+    std::optional<SourcePosition> Expression::GetSourcePosition() const {
+        return getSourcePosition();
+    }
+
+    std::optional<ASTNode::Constant> Expression::GetConstant() const {
+        using ConstantKind = ASTBinary::ConstantKind;
+        using Constant = ASTNode::Constant;
+        const std::uint8_t * node = getRelField(0);
+        if(!node)
+            return {};
+        const std::uint8_t * kindField = node + sizeof(ASTBinary::NodeHeader);
+        const std::uint8_t * payload = kindField + ASTBinary::FIELD_SIZE;
+        switch(ConstantKind(ASTBinary::Read<std::uint32_t>(kindField))) {
+            case ConstantKind::Int:   return Constant(ASTBinary::Read<Constant::Int>(payload));
+            case ConstantKind::Float: return Constant(ASTBinary::Read<Constant::Float>(payload));
+            case ConstantKind::Bool:  return Constant(ASTBinary::Read<std::uint64_t>(payload) != 0);
+        }
+        return {};
+    }
+
+    //
+
+    using ExpressionLValue = ASTView::ExpressionLValue;
+
+    ExpressionLValue ExpressionLValue::FromNode(Base base, Base node) {
+        class LValueNode : public NodeRef {
+        public:
+            using NodeRef::NodeRef;
+            ExpressionLValue Get() const {
+                switch(getTag()) {
+                    case Tag::LValuePointerDereference:
+                        return Expression::PointerDereference(makeChild<Expression>(0));
+                    case Tag::LValueStructMemberAccess:
+                        return Expression::StructMemberAccess(makeChild<Expression>(0), makeChild<Expression>(1));
+                    default:
+                        return ExpressionName(getString(getField(0)));
+                }
+            }
+        };
+        return LValueNode(base, node).Get();
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    using StatementBinaryOperation = ASTView::StatementBinaryOperation;
+
+    StatementBinaryOperation::StatementBinaryOperation(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    StatementBinaryOperation::Kind StatementBinaryOperation::GetKind() const {
+        return Kind(getField(0));
+    }
+
+    StatementBinaryOperation::Operands StatementBinaryOperation::GetOperands() const {
+        return {ExpressionLValue::FromNode(m_base, getRelField(1)), makeChild<Expression>(2)};
+    }
+
+    //
+
+    using StatementTypedVariableDefinition = ASTView::StatementTypedVariableDefinition;
+
+    StatementTypedVariableDefinition::StatementTypedVariableDefinition(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    std::string_view          StatementTypedVariableDefinition::GetName () const { return getString(getField(0));          }
+    Type                      StatementTypedVariableDefinition::GetType () const { return makeChild<Type>(1);              }
+    std::optional<Expression> StatementTypedVariableDefinition::GetValue() const { return makeOptionalChild<Expression>(2); }
+
+    using StatementUntypedVariableDefinition = ASTView::StatementUntypedVariableDefinition;
+
+    StatementUntypedVariableDefinition::StatementUntypedVariableDefinition(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    std::string_view StatementUntypedVariableDefinition::GetName () const { return getString(getField(0)); }
+    Expression       StatementUntypedVariableDefinition::GetValue() const { return makeChild<Expression>(1); }
+
+    //
+
+    using StatementAssignment = ASTView::StatementAssignment;
+
+    StatementAssignment::StatementAssignment(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    ExpressionLValue StatementAssignment::GetLValue() const {
+        return ExpressionLValue::FromNode(m_base, getRelField(0));
+    }
+
+    Expression StatementAssignment::GetRValue() const {
+        return makeChild<Expression>(1);
+    }
+
+    //
+
+    using StatementBreak = ASTView::StatementBreak;
+
+    StatementBreak::StatementBreak(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    StatementBreak::Label StatementBreak::GetLabel() const {
+        return getOptionalString(0);
+    }
+
+    std::optional<Expression> StatementBreak::GetValue() const {
+        return makeOptionalChild<Expression>(1);
+    }
+
+    //
+
+    using Statement = ASTView::Statement;
+
+    Statement::Statement(Base base, Base node):
+        NodeRef(base, node)
+    {}
+
+    Statement Statement::FromNode(Base base, Base node) {
+        return Statement(base, node);
+    }
+
+    Statement::Data Statement::Get() const {
+        switch(getTag()) {
+            case Tag::StatementExpression:                return makeChild<Expression>(0);
+            case Tag::StatementBinaryOperation:           return StatementBinaryOperation(m_base, m_node);
+            case Tag::StatementTypedVariableDefinition:   return StatementVariableDefinition(StatementTypedVariableDefinition(m_base, m_node));
+            case Tag::StatementUntypedVariableDefinition: return StatementVariableDefinition(StatementUntypedVariableDefinition(m_base, m_node));
+            case Tag::StatementAssignment:                return StatementAssignment(m_base, m_node);
+            case Tag::StatementBreak:                     return StatementBreak(m_base, m_node);
+            default:                                      return StatementContinue();
+        }
+    }
+
+    std::optional<SourcePosition> Statement::GetSourcePosition() const {
+        return getSourcePosition();
+    }
+
+    /*
+     *
+     * AST View
+     *
+     */
+
+    ASTView::ASTView(Base base, Base root):
+        m_base(base),
+        m_root(root)
+    {}
+
+    std::optional<ASTView> ASTView::Open(std::span<const std::uint8_t> bytes) {
+        if(bytes.size() < sizeof(ASTBinary::Header))
+            return {};
+        auto header = ASTBinary::Read<ASTBinary::Header>(bytes.data());
+        if(header.magic != ASTBinary::MAGIC || header.version != ASTBinary::VERSION)
+            return {};
+        if(header.size != bytes.size())
+            return {};
+        if(header.rootOffset < sizeof(ASTBinary::Header) || header.rootOffset >= header.stringTableOffset)
+            return {};
+        if(std::size_t(header.stringTableOffset) + ASTBinary::FIELD_SIZE > bytes.size())
+            return {};
+
+        // string table entries must stay in bounds
+        const std::uint8_t * table = bytes.data() + header.stringTableOffset;
+        std::uint64_t count = ASTBinary::Read<std::uint32_t>(table);
+        std::uint64_t charsOffset = header.stringTableOffset + ASTBinary::FIELD_SIZE + count * 2 * ASTBinary::FIELD_SIZE;
+        if(charsOffset > bytes.size())
+            return {};
+        std::uint64_t charsSize = bytes.size() - charsOffset;
+        for(std::uint64_t i = 0; i < count; i++) {
+            const std::uint8_t * entry = table + ASTBinary::FIELD_SIZE + i * 2 * ASTBinary::FIELD_SIZE;
+            std::uint64_t offset = ASTBinary::Read<std::uint32_t>(entry);
+            std::uint64_t length = ASTBinary::Read<std::uint32_t>(entry + ASTBinary::FIELD_SIZE);
+            if(offset + length > charsSize)
+                return {};
+        }
+
+        return ASTView(bytes.data(), bytes.data() + header.rootOffset);
+    }
+
+    ASTView::Data ASTView::Get() const {
+        switch(ASTBinary::Read<ASTBinary::NodeHeader>(m_root).tag) {
+            case Tag::TypePrimitive:
+            case Tag::TypePointer:
+            case Tag::TypeStruct:
+            case Tag::TypeFunction:
+                return Type(m_base, m_root);
+            case Tag::ExpressionLiteral:
+            case Tag::ExpressionFunctionCall:
+            case Tag::ExpressionBlock:
+            case Tag::ExpressionIf:
+            case Tag::ExpressionLoop:
+            case Tag::ExpressionUnaryOperation:
+            case Tag::ExpressionBinaryOperation:
+            case Tag::ExpressionName:
+                return Expression(m_base, m_root);
+            default:
+                return Statement(m_base, m_root);
+        }
+    }
+
+    /*
+     *
+     * Materialization
+     *
+     */
+
+    static ASTNode::Type toType(const Type& type);
+    static ASTNode::Expression toExpression(const Expression& expr);
+    static ASTNode::Statement toStatement(const Statement& stmt);
+
+    static ASTNode::TypeStruct toTypeStruct(const TypeStruct& structType) {
+        using Struct = ASTNode::TypeStruct;
+        auto toDefaultValue = [](const std::optional<Expression>& defaultValue) -> Struct::FieldDefaultValue {
+            if(defaultValue)
+                return std::make_shared<ASTNode::Expression>(toExpression(defaultValue.value()));
+            return {};
+        };
+        Struct::Fields fields;
+        for(const TypeStruct::Field& field : structType.GetFields()) {
+            fields.push_back(std::visit(overloaded{
+                [&](const TypeStruct::NamedField& namedField) -> Struct::Field {
+                    Struct::NamedField::Names names;
+                    for(std::string_view name : namedField.GetNames())
+                        names.push_back(name);
+                    auto type = std::make_shared<ASTNode::Type>(toType(namedField.GetType()));
+                    return Struct::NamedField(names, type, toDefaultValue(namedField.GetDefaultValue()));
+                },
+                [&](const TypeStruct::UnnamedField& unnamedField) -> Struct::Field {
+                    auto type = std::make_shared<ASTNode::Type>(toType(unnamedField.GetType()));
+                    Struct::UnnamedField::TypeReps typeReps;
+                    if(auto optTypeReps = unnamedField.GetTypeReps())
+                        typeReps = std::make_shared<ASTNode::Expression>(toExpression(optTypeReps.value()));
+                    return Struct::UnnamedField(type, typeReps, toDefaultValue(unnamedField.GetDefaultValue()));
+                }
+            }, field));
+        }
+        return Struct(fields);
+    }
+
+    static ASTNode::Type toType(const Type& type) {
+        return ASTNode::Type(std::visit(overloaded{
+            [](ASTNode::TypePrimitive primitive) -> ASTNode::Type::Data {
+                return primitive;
+            },
+            [](const TypePointer& pointer) -> ASTNode::Type::Data {
+                return std::make_shared<ASTNode::Type>(toType(*pointer));
+            },
+            [](const TypeFunction& function) -> ASTNode::Type::Data {
+                auto retType = std::make_shared<ASTNode::Type>(toType(function.GetReturnType()));
+                return ASTNode::TypeFunction(toTypeStruct(function.GetArgumentsType()), retType);
+            },
+            [](const TypeStruct& structType) -> ASTNode::Type::Data {
+                return toTypeStruct(structType);
+            }
+        }, type.Get()), type.GetAttribs());
+    }
+
+    static ASTNode::ExpressionLiteral::Struct toStructLiteral(const StructLit& structLit) {
+        ASTNode::ExpressionLiteral::Struct::Fields fields;
+        for(const StructLitField& field : structLit.GetFields()) {
+            auto value = std::make_shared<ASTNode::Expression>(toExpression(field.GetValue()));
+            fields.push_back(ASTNode::ExpressionLiteral::Struct::Field(value, field.GetName()));
+        }
+        return ASTNode::ExpressionLiteral::Struct(fields);
+    }
+
+    static ASTNode::Expression::LValue toLValue(const ExpressionLValue& lvalue) {
+        return std::visit(overloaded{
+            [](std::string_view name) -> ASTNode::Expression::LValue {
+                return name;
+            },
+            [](const Expression& operand) -> ASTNode::Expression::LValue {
+                return std::make_shared<ASTNode::Expression>(toExpression(operand));
+            },
+            [](const Expression::StructMemberAccess& operands) -> ASTNode::Expression::LValue {
+                return ASTNode::Expression::StructMemberAccess(
+                    std::make_shared<ASTNode::Expression>(toExpression(operands.first)),
+                    std::make_shared<ASTNode::Expression>(toExpression(operands.second))
+                );
+            }
+        }, lvalue);
+    }
+
+    static ASTNode::Expression toExpression(const Expression& expr) {
+        using Literal = ASTNode::ExpressionLiteral;
+        auto toStatementPtr = [](const Statement& stmt) {
+            return std::make_shared<ASTNode::Statement>(toStatement(stmt));
+        };
+        auto toExpressionPtr = [](const Expression& expr) {
+            return std::make_shared<ASTNode::Expression>(toExpression(expr));
+        };
+
+        ASTNode::Expression::Data data = std::visit(overloaded{
+            [&](const ExpressionLiteral& literal) -> ASTNode::Expression::Data {
+                auto optData = literal.Get();
+                if(!optData)
+                    return Literal();
+                return Literal(std::visit(overloaded{
+                    [](ExpressionLiteral::Int intValue)     -> Literal::Data { return intValue; },
+                    [](ExpressionLiteral::Float floatValue) -> Literal::Data { return floatValue; },
+                    [](ExpressionLiteral::String strValue)  -> Literal::Data { return Literal::String(strValue); },
+                    [](ExpressionLiteral::Char charValue)   -> Literal::Data { return charValue; },
+                    [](ExpressionLiteral::Bool boolValue)   -> Literal::Data { return boolValue; },
+                    [](const StructLit& structLit)          -> Literal::Data { return toStructLiteral(structLit); }
+                }, optData.value()));
+            },
+            [&](const ExpressionFunctionCall& funcCall) -> ASTNode::Expression::Data {
+                return ASTNode::ExpressionFunctionCall(toExpressionPtr(funcCall.GetFunction()), toStructLiteral(funcCall.GetParameters()));
+            },
+            [&](const ExpressionBlock& block) -> ASTNode::Expression::Data {
+                ASTNode::ExpressionBlock::Statements stmts;
+                for(const Statement& stmt : block.GetStatements())
+                    stmts.push_back(toStatement(stmt));
+                ASTNode::ExpressionBlock::Label label;
+                if(auto optLabel = block.GetLabel())
+                    label = std::string(optLabel.value());
+                return ASTNode::ExpressionBlock(label, stmts);
+            },
+            [&](const ExpressionIf& ifExpr) -> ASTNode::Expression::Data {
+                ASTNode::ExpressionIf::FailStatement failStmt;
+                if(auto optFailStmt = ifExpr.GetFailStatement())
+                    failStmt = toStatementPtr(optFailStmt.value());
+                return ASTNode::ExpressionIf(toExpressionPtr(ifExpr.GetCondition()), toStatementPtr(ifExpr.GetSuccessStatement()), failStmt);
+            },
+            [&](const ExpressionLoop& loop) -> ASTNode::Expression::Data {
+                ASTNode::ExpressionLoop::InitStatement initStmt;
+                ASTNode::ExpressionLoop::Condition cond;
+                ASTNode::ExpressionLoop::PostStatement postStmt;
+                if(auto optInitStmt = loop.GetInitStatement())
+                    initStmt = toStatementPtr(optInitStmt.value());
+                if(auto optCond = loop.GetCondition())
+                    cond = toExpressionPtr(optCond.value());
+                if(auto optPostStmt = loop.GetPostStatement())
+                    postStmt = toStatementPtr(optPostStmt.value());
+                return ASTNode::ExpressionLoop(initStmt, cond, postStmt, toStatementPtr(loop.GetBodyStatement()));
+            },
+            [&](const ExpressionUnaryOperation& unaryOp) -> ASTNode::Expression::Data {
+                return ASTNode::ExpressionUnaryOperation(unaryOp.GetKind(), toExpressionPtr(unaryOp.GetOperand()));
+            },
+            [&](const ExpressionBinaryOperation& binOp) -> ASTNode::Expression::Data {
+                auto operands = binOp.GetOperands();
+                return ASTNode::ExpressionBinaryOperation(binOp.GetKind(), toExpressionPtr(operands.first), toExpressionPtr(operands.second));
+            },
+            [&](std::string_view name) -> ASTNode::Expression::Data {
+                return name;
+            }
+        }, expr.Get());
+
+        return ASTNode::Expression(data, expr.IsGrouped(), expr.GetSourcePosition());
+    }
+
+    static ASTNode::Statement toStatement(const Statement& stmt) {
+        return ASTNode::Statement(std::visit(overloaded{
+            [](const Expression& expr) -> ASTNode::Statement::Data {
+                return toExpression(expr);
+            },
+            [](const StatementBinaryOperation& binOp) -> ASTNode::Statement::Data {
+                auto operands = binOp.GetOperands();
+                return ASTNode::StatementBinaryOperation(binOp.GetKind(), {toLValue(operands.first), toExpression(operands.second)});
+            },
+            [](const ASTView::StatementVariableDefinition& varDef) -> ASTNode::Statement::Data {
+                return std::visit(overloaded{
+                    [](const StatementTypedVariableDefinition& typedVarDef) -> ASTNode::StatementVariableDefinition {
+                        ASTNode::StatementTypedVariableDefinition::VarValue value;
+                        if(auto optValue = typedVarDef.GetValue())
+                            value = toExpression(optValue.value());
+                        return ASTNode::StatementTypedVariableDefinition(typedVarDef.GetName(), toType(typedVarDef.GetType()), value);
+                    },
+                    [](const StatementUntypedVariableDefinition& untypedVarDef) -> ASTNode::StatementVariableDefinition {
+                        return ASTNode::StatementUntypedVariableDefinition(untypedVarDef.GetName(), toExpression(untypedVarDef.GetValue()));
+                    }
+                }, varDef);
+            },
+            [](const StatementAssignment& assign) -> ASTNode::Statement::Data {
+                return ASTNode::StatementAssignment(toLValue(assign.GetLValue()), toExpression(assign.GetRValue()));
+            },
+            [](const ASTView::StatementContinue&) -> ASTNode::Statement::Data {
+                return ASTNode::StatementContinue();
+            },
+            [](const StatementBreak& stmtBreak) -> ASTNode::Statement::Data {
+                ASTNode::StatementBreak::Label label;
+                if(auto optLabel = stmtBreak.GetLabel())
+                    label = std::string(optLabel.value());
+                ASTNode::StatementBreak::Value value;
+                if(auto optValue = stmtBreak.GetValue())
+                    value = toExpression(optValue.value());
+                return ASTNode::StatementBreak(label, value);
+            }
+        }, stmt.Get()), stmt.GetSourcePosition());
+    }
+
+    ASTNode ASTView::ToASTNode() const {
+        return std::visit(overloaded{
+            [](const Type& type)       { return ASTNode(toType(type)); },
+            [](const Expression& expr) { return ASTNode(toExpression(expr)); },
+            [](const Statement& stmt)  { return ASTNode(toStatement(stmt)); }
+        }, Get());
+    }
+
+    /*
+     *
+     * AST Reader
+     *
+     */
+
+    ASTReader::ASTReader() {}
+
+    bool ASTReader::Open(const std::string& path) {
+        m_view.reset();
+        if(!m_file.Open(path))
+            return false;
+        m_view = ASTView::Open(m_file.GetBytes());
+        return m_view.has_value();
+    }
+
+    const std::optional<ASTView>& ASTReader::GetView() const {
+        return m_view;
+    }
+
+}
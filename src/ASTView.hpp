@@ -0,0 +1,420 @@
+#pragma once
+
+#include "ASTBinary.hpp"
+#include "ASTNode.hpp"
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace ry {
+
+    //
+    // Zero-copy views over the binary AST format (see ASTBinary.hpp).
+    //
+    // Every view class mirrors its ASTNode counterpart (same names, same getters, same Get() variants),
+    // so code written as std::visit(overloaded{...}, node.Get()) works on both representations.
+    // Child nodes are returned by value (a view is two pointers), strings as string_views into the buffer.
+    // The underlying buffer must outlive every view created from it.
+    //
+    class ASTView {
+    private:
+        using Name = std::string_view;
+
+        class NodeRef {
+        public:
+            NodeRef(const std::uint8_t * base, const std::uint8_t * node);
+
+        protected:
+            ASTBinary::Tag getTag() const;
+            std::uint8_t getFlags() const;
+            std::uint32_t getField(std::size_t fieldIdx) const;
+            const std::uint8_t * getFieldPointer(std::size_t fieldIdx) const;
+            const std::uint8_t * getRelField(std::size_t fieldIdx) const; // nullptr if none
+            std::string_view getString(std::uint32_t idx) const;
+            std::optional<std::string_view> getOptionalString(std::size_t fieldIdx) const;
+            std::optional<SourcePosition> getSourcePosition() const; // expressions and statements only
+
+            template<typename T>
+            T makeChild(std::size_t fieldIdx) const {
+                return T(m_base, getRelField(fieldIdx));
+            }
+            template<typename T>
+            std::optional<T> makeOptionalChild(std::size_t fieldIdx) const {
+                if(auto node = getRelField(fieldIdx))
+                    return T(m_base, node);
+                return {};
+            }
+
+            const std::uint8_t * m_base;
+            const std::uint8_t * m_node;
+        };
+
+    public:
+        // Random-access range over consecutive fields of a node.
+        // Elements are constructed on access: child nodes for relative fields, string_views for name fields.
+        template<typename T>
+        class List : private NodeRef {
+        public:
+            class Iterator {
+            public:
+                Iterator(const List * list, std::size_t idx): m_list(list), m_idx(idx) {}
+                T operator*() const { return (*m_list)[m_idx]; }
+                Iterator& operator++() { m_idx++; return *this; }
+                bool operator==(const Iterator& other) const { return m_idx == other.m_idx; }
+                bool operator!=(const Iterator& other) const { return m_idx != other.m_idx; }
+            private:
+                const List * m_list;
+                std::size_t m_idx;
+            };
+
+            List(const std::uint8_t * base, const std::uint8_t * node, std::size_t firstFieldIdx, std::size_t size):
+                NodeRef(base, node), m_firstFieldIdx(firstFieldIdx), m_size(size) {}
+
+            std::size_t size() const { return m_size; }
+            bool empty() const { return m_size == 0; }
+            Iterator begin() const { return Iterator(this, 0); }
+            Iterator end() const { return Iterator(this, m_size); }
+
+            T operator[](std::size_t idx) const {
+                if constexpr (std::is_same_v<T, Name>)
+                    return getString(getField(m_firstFieldIdx + idx));
+                else
+                    return T::FromNode(m_base, getRelField(m_firstFieldIdx + idx));
+            }
+
+        private:
+            std::size_t m_firstFieldIdx;
+            std::size_t m_size;
+        };
+
+        class Expression;
+        class Statement;
+
+        /*
+         *
+         * Type
+         *
+         */
+
+        class Type;
+        using TypePrimitive = ASTNode::TypePrimitive;
+
+        class TypeStruct : private NodeRef {
+        public:
+            class NamedField : private NodeRef {
+            public:
+                NamedField(const std::uint8_t * base, const std::uint8_t * node);
+
+                Type                      GetType         () const;
+                List<Name>                GetNames        () const;
+                std::optional<Expression> GetDefaultValue () const;
+            };
+            class UnnamedField : private NodeRef {
+            public:
+                UnnamedField(const std::uint8_t * base, const std::uint8_t * node);
+
+                Type                      GetType         () const;
+                std::optional<Expression> GetTypeReps     () const;
+                std::optional<Expression> GetDefaultValue () const;
+            };
+
+            class Field : public std::variant<NamedField, UnnamedField> {
+            public:
+                using std::variant<NamedField, UnnamedField>::variant;
+                static Field FromNode(const std::uint8_t * base, const std::uint8_t * node);
+            };
+
+            TypeStruct(const std::uint8_t * base, const std::uint8_t * node);
+
+            List<Field> GetFields() const;
+        };
+
+        class TypeFunction : private NodeRef {
+        public:
+            TypeFunction(const std::uint8_t * base, const std::uint8_t * node);
+
+            TypeStruct GetArgumentsType () const;
+            Type       GetReturnType    () const;
+        };
+
+        class TypePointer : private NodeRef {
+        public:
+            TypePointer(const std::uint8_t * base, const std::uint8_t * node);
+
+            Type operator*() const;
+        };
+
+        class Type : private NodeRef {
+        public:
+            using Attribs = ASTNode::Type::Attribs;
+            using Data = std::variant<TypePrimitive, TypeFunction, TypeStruct, TypePointer>;
+
+            Type(const std::uint8_t * base, const std::uint8_t * node);
+            static Type FromNode(const std::uint8_t * base, const std::uint8_t * node);
+
+            Attribs GetAttribs() const;
+            Data Get() const;
+
+            const char * StringifyKind() const;
+        };
+
+        /*
+         *
+         * Expression
+         *
+         */
+
+        class ExpressionLiteral : private NodeRef {
+        public:
+            using Int = ASTNode::ExpressionLiteral::Int;
+            using Float = ASTNode::ExpressionLiteral::Float;
+            using String = std::string_view;
+            using Char = ASTNode::ExpressionLiteral::Char;
+            using Bool = ASTNode::ExpressionLiteral::Bool;
+            class Struct : private NodeRef {
+            public:
+                class Field : private NodeRef {
+                public:
+                    using FieldName = std::optional<Name>;
+
+                    Field(const std::uint8_t * base, const std::uint8_t * node);
+                    static Field FromNode(const std::uint8_t * base, const std::uint8_t * node);
+
+                    FieldName  GetName  () const;
+                    Expression GetValue () const;
+                };
+
+                Struct(const std::uint8_t * base, const std::uint8_t * node);
+
+                List<Field> GetFields() const;
+            };
+
+            using Data = std::optional<std::variant<Int, Float, String, Char, Bool, Struct>>;
+
+            ExpressionLiteral(const std::uint8_t * base, const std::uint8_t * node);
+
+            Data Get() const;
+        };
+
+        class ExpressionFunctionCall : private NodeRef {
+        public:
+            using Parameters = ExpressionLiteral::Struct;
+
+            ExpressionFunctionCall(const std::uint8_t * base, const std::uint8_t * node);
+
+            Expression GetFunction   () const;
+            Parameters GetParameters () const;
+        };
+
+        class ExpressionBlock : private NodeRef {
+        public:
+            using Label = std::optional<std::string_view>;
+
+            ExpressionBlock(const std::uint8_t * base, const std::uint8_t * node);
+
+            Label           GetLabel      () const;
+            List<Statement> GetStatements () const;
+        };
+
+        class ExpressionIf : private NodeRef {
+        public:
+            ExpressionIf(const std::uint8_t * base, const std::uint8_t * node);
+
+            Expression               GetCondition        () const;
+            Statement                GetSuccessStatement () const;
+            std::optional<Statement> GetFailStatement    () const;
+        };
+
+        class ExpressionLoop : private NodeRef {
+        public:
+            ExpressionLoop(const std::uint8_t * base, const std::uint8_t * node);
+
+            std::optional<Statement>  GetInitStatement () const;
+            std::optional<Expression> GetCondition     () const;
+            std::optional<Statement>  GetPostStatement () const;
+            Statement                 GetBodyStatement () const;
+        };
+
+        class ExpressionUnaryOperation : private NodeRef {
+        public:
+            using Kind = ASTNode::ExpressionUnaryOperation::Kind;
+
+            ExpressionUnaryOperation(const std::uint8_t * base, const std::uint8_t * node);
+
+            Kind GetKind() const;
+            Expression GetOperand() const;
+        };
+
+        class ExpressionBinaryOperation : private NodeRef {
+        public:
+            using Kind = ASTNode::ExpressionBinaryOperation::Kind;
+            using Operands = std::pair<Expression, Expression>;
+
+            ExpressionBinaryOperation(const std::uint8_t * base, const std::uint8_t * node);
+
+            Kind GetKind() const;
+            Operands GetOperands() const;
+        };
+
+        using ExpressionName = std::string_view;
+
+        class ExpressionLValue;
+
+        class Expression : private NodeRef {
+        public:
+            using PointerDereference = Expression;
+            using StructMemberAccess = std::pair<Expression, Expression>;
+            using LValue = ExpressionLValue;
+
+            using Data = std::variant<
+                ExpressionLiteral,
+                ExpressionFunctionCall,
+                ExpressionBlock,
+                ExpressionIf,
+                ExpressionLoop,
+                ExpressionUnaryOperation,
+                ExpressionBinaryOperation,
+                ExpressionName
+            >;
+
+            Expression(const std::uint8_t * base, const std::uint8_t * node);
+            static Expression FromNode(const std::uint8_t * base, const std::uint8_t * node);
+
+            Data Get() const;
+            bool IsGrouped() const;
+            std::optional<ASTNode::Constant> GetConstant() const;
+            std::optional<SourcePosition> GetSourcePosition() const;
+        };
+
+        class ExpressionLValue : public std::variant<ExpressionName, Expression::PointerDereference, Expression::StructMemberAccess> {
+        public:
+            using std::variant<ExpressionName, Expression::PointerDereference, Expression::StructMemberAccess>::variant;
+            static ExpressionLValue FromNode(const std::uint8_t * base, const std::uint8_t * node);
+        };
+
+        /*
+         *
+         * Statement
+         *
+         */
+
+        using StatementExpression = Expression;
+
+        class StatementBinaryOperation : private NodeRef {
+        public:
+            using Kind = ASTNode::StatementBinaryOperation::Kind;
+            using Operands = std::pair<Expression::LValue, Expression>;
+
+            StatementBinaryOperation(const std::uint8_t * base, const std::uint8_t * node);
+
+            Kind GetKind() const;
+            Operands GetOperands() const;
+        };
+
+        class StatementTypedVariableDefinition : private NodeRef {
+        public:
+            StatementTypedVariableDefinition(const std::uint8_t * base, const std::uint8_t * node);
+
+            Name                      GetName () const;
+            Type                      GetType () const;
+            std::optional<Expression> GetValue() const;
+        };
+
+        class StatementUntypedVariableDefinition : private NodeRef {
+        public:
+            StatementUntypedVariableDefinition(const std::uint8_t * base, const std::uint8_t * node);
+
+            Name       GetName () const;
+            Expression GetValue() const;
+        };
+
+        using StatementVariableDefinition = std::variant<
+            StatementTypedVariableDefinition,
+            StatementUntypedVariableDefinition
+        >;
+
+        class StatementAssignment : private NodeRef {
+        public:
+            StatementAssignment(const std::uint8_t * base, const std::uint8_t * node);
+
+            Expression::LValue GetLValue() const;
+            Expression         GetRValue() const;
+        };
+
+        using StatementContinue = ASTNode::StatementContinue;
+
+        class StatementBreak : private NodeRef {
+        public:
+            using Label = ExpressionBlock::Label;
+
+            StatementBreak(const std::uint8_t * base, const std::uint8_t * node);
+
+            Label                     GetLabel() const;
+            std::optional<Expression> GetValue() const;
+        };
+
+        class Statement : private NodeRef {
+        public:
+            using Data = std::variant<
+                StatementExpression,
+                StatementBinaryOperation,
+                StatementVariableDefinition,
+                StatementAssignment,
+                StatementContinue,
+                StatementBreak
+            >;
+
+            Statement(const std::uint8_t * base, const std::uint8_t * node);
+            static Statement FromNode(const std::uint8_t * base, const std::uint8_t * node);
+
+            Data Get() const;
+            std::optional<SourcePosition> GetSourcePosition() const;
+        };
+
+        /*
+         *
+         * AST View
+         *
+         */
+
+    public:
+        using Data = std::variant<Type, Expression, Statement>;
+
+        // Validates the header and string table, nodes are trusted
+        static std::optional<ASTView> Open(std::span<const std::uint8_t> bytes);
+
+        Data Get() const;
+
+        // Materializes an in-memory ASTNode for passes that need one,
+        // names keep pointing into the buffer
+        ASTNode ToASTNode() const;
+
+    private:
+        ASTView(const std::uint8_t * base, const std::uint8_t * root);
+
+        const std::uint8_t * m_base;
+        const std::uint8_t * m_root;
+    };
+
+    // Memory-maps a binary AST file and exposes it as an ASTView
+    class ASTReader {
+    public:
+        ASTReader();
+
+        bool Open(const std::string& path);
+        const std::optional<ASTView>& GetView() const;
+
+    private:
+        MappedFile m_file;
+        std::optional<ASTView> m_view;
+    };
+
+}
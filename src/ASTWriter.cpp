@@ -0,0 +1,472 @@
+#include "ASTWriter.hpp"
+#include "ry.hpp"
+
+#include <cstdio>
+#include <variant>
+#include <assert.h>
+
+namespace ry {
+
+    using FieldIdx = std::size_t;
+
+    ASTWriter::ASTWriter() {}
+
+    std::vector<std::uint8_t> ASTWriter::Write(const ASTNode& ast) {
+        m_bytes.clear();
+        m_strings.clear();
+        m_stringIndices.clear();
+
+        m_bytes.resize(sizeof(ASTBinary::Header));
+
+        Offset root = std::visit(overloaded{
+            [&](const ASTNode::Type& type)       { return writeType(type); },
+            [&](const ASTNode::Expression& expr) { return writeExpression(expr); },
+            [&](const ASTNode::Statement& stmt)  { return writeStatement(stmt); }
+        }, ast.Get());
+
+        Offset stringTableOffset = m_bytes.size();
+        writeStringTable();
+
+        ASTBinary::Header header;
+        header.magic = ASTBinary::MAGIC;
+        header.version = ASTBinary::VERSION;
+        header.size = m_bytes.size();
+        header.stringTableOffset = stringTableOffset;
+        header.rootOffset = root;
+        ASTBinary::Write(m_bytes.data(), header);
+
+        return std::move(m_bytes);
+    }
+
+    bool ASTWriter::WriteToFile(const ASTNode& ast, const std::string& path) {
+        std::vector<std::uint8_t> bytes = Write(ast);
+        std::FILE * file = std::fopen(path.c_str(), "wb");
+        if(!file)
+            return false;
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        return (std::fclose(file) == 0) && ok;
+    }
+
+    //
+
+    ASTWriter::Offset ASTWriter::beginNode(Tag tag, std::uint8_t flags, std::size_t numFields) {
+        Offset offset = m_bytes.size();
+        m_bytes.resize(m_bytes.size() + sizeof(ASTBinary::NodeHeader) + numFields * ASTBinary::FIELD_SIZE, 0);
+        ASTBinary::Write(m_bytes.data() + offset, ASTBinary::NodeHeader{tag, flags, 0});
+        return offset;
+    }
+
+    ASTWriter::Offset ASTWriter::beginNode(Tag tag, std::uint8_t flags, std::size_t numFields, const std::optional<SourcePosition>& srcPos) {
+        ASTBinary::Position position{};
+        if(srcPos)
+            position = {
+                std::uint32_t(srcPos->startLine), std::uint32_t(srcPos->startColumn),
+                std::uint32_t(srcPos->endLine), std::uint32_t(srcPos->endColumn)
+            };
+        std::size_t offset = m_bytes.size();
+        m_bytes.resize(offset + sizeof(ASTBinary::Position));
+        ASTBinary::Write(m_bytes.data() + offset, position);
+        return beginNode(tag, flags, numFields);
+    }
+
+    void ASTWriter::setField(Offset node, FieldIdx fieldIdx, std::uint32_t value) {
+        std::size_t pos = node + sizeof(ASTBinary::NodeHeader) + fieldIdx * ASTBinary::FIELD_SIZE;
+        ASTBinary::Write(m_bytes.data() + pos, value);
+    }
+
+    void ASTWriter::setRelField(Offset node, FieldIdx fieldIdx, Offset target) {
+        std::size_t pos = node + sizeof(ASTBinary::NodeHeader) + fieldIdx * ASTBinary::FIELD_SIZE;
+        std::int32_t rel = std::int32_t(target) - std::int32_t(pos);
+        ASTBinary::Write(m_bytes.data() + pos, rel);
+    }
+
+    std::uint32_t ASTWriter::internString(std::string_view str) {
+        auto it = m_stringIndices.find(str);
+        if(it != m_stringIndices.end())
+            return it->second;
+        std::uint32_t idx = m_strings.size();
+        m_strings.push_back(str);
+        m_stringIndices.emplace(str, idx);
+        return idx;
+    }
+
+    void ASTWriter::writeStringTable() {
+        std::size_t tableOffset = m_bytes.size();
+        std::size_t entriesSize = ASTBinary::FIELD_SIZE + m_strings.size() * 2 * ASTBinary::FIELD_SIZE;
+        m_bytes.resize(tableOffset + entriesSize);
+        ASTBinary::Write(m_bytes.data() + tableOffset, std::uint32_t(m_strings.size()));
+
+        std::uint32_t charOffset = 0;
+        for(std::size_t i = 0; i < m_strings.size(); i++) {
+            std::size_t entryPos = tableOffset + ASTBinary::FIELD_SIZE + i * 2 * ASTBinary::FIELD_SIZE;
+            ASTBinary::Write(m_bytes.data() + entryPos, charOffset);
+            ASTBinary::Write(m_bytes.data() + entryPos + ASTBinary::FIELD_SIZE, std::uint32_t(m_strings[i].size()));
+            charOffset += m_strings[i].size();
+        }
+        for(std::string_view str : m_strings)
+            m_bytes.insert(m_bytes.end(), str.begin(), str.end());
+    }
+
+    /*
+     *
+     * Type
+     *
+     */
+
+    ASTWriter::Offset ASTWriter::writeType(const ASTNode::Type& type) {
+        std::uint8_t flags = 0;
+        if(type.GetAttribs().isMutable)
+            flags |= ASTBinary::FLAG_MUTABLE;
+        if(type.GetAttribs().isOptional)
+            flags |= ASTBinary::FLAG_OPTIONAL;
+        if(type.GetAttribs().isOrdered)
+            flags |= ASTBinary::FLAG_ORDERED;
+        if(type.GetAttribs().isSoA)
+            flags |= ASTBinary::FLAG_SOA;
+
+        return std::visit(overloaded{
+            [&](const ASTNode::TypePrimitive& primitive) {
+                Offset node = beginNode(Tag::TypePrimitive, flags, 1);
+                setField(node, 0, std::uint32_t(primitive));
+                return node;
+            },
+            [&](const ASTNode::TypePointer& pointer) {
+                Offset base = writeType(*pointer);
+                Offset node = beginNode(Tag::TypePointer, flags, 1);
+                setRelField(node, 0, base);
+                return node;
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                Offset args = writeTypeStruct(function.GetArgumentsType());
+                Offset ret = writeType(*function.GetReturnType());
+                Offset node = beginNode(Tag::TypeFunction, flags, 2);
+                setRelField(node, 0, args);
+                setRelField(node, 1, ret);
+                return node;
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                return writeTypeStruct(structType, flags);
+            }
+        }, type.Get());
+    }
+
+    ASTWriter::Offset ASTWriter::writeTypeStruct(const ASTNode::TypeStruct& structType, std::uint8_t flags) {
+        const auto& fields = structType.GetFields();
+        std::vector<Offset> fieldNodes;
+        fieldNodes.reserve(fields.size());
+        for(const auto& field : fields)
+            fieldNodes.push_back(writeTypeStructField(field));
+
+        Offset node = beginNode(Tag::TypeStruct, flags, 1 + fields.size());
+        setField(node, 0, fields.size());
+        for(std::size_t i = 0; i < fieldNodes.size(); i++)
+            setRelField(node, 1 + i, fieldNodes[i]);
+        return node;
+    }
+
+    ASTWriter::Offset ASTWriter::writeTypeStructField(const ASTNode::TypeStruct::Field& field) {
+        using TypeStruct = ASTNode::TypeStruct;
+
+        auto writeDefaultValue = [&](const TypeStruct::FieldDefaultValue& defaultValue) -> Offset {
+            return defaultValue ? writeExpression(*defaultValue.value()) : 0;
+        };
+
+        return std::visit(overloaded{
+            [&](const TypeStruct::NamedField& namedField) {
+                Offset type = writeType(*namedField.GetType());
+                Offset defaultValue = writeDefaultValue(namedField.GetDefaultValue());
+                const auto& names = namedField.GetNames();
+                Offset node = beginNode(Tag::TypeStructNamedField, 0, 3 + names.size());
+                setRelField(node, 0, type);
+                if(defaultValue)
+                    setRelField(node, 1, defaultValue);
+                setField(node, 2, names.size());
+                for(std::size_t i = 0; i < names.size(); i++)
+                    setField(node, 3 + i, internString(names[i]));
+                return node;
+            },
+            [&](const TypeStruct::UnnamedField& unnamedField) {
+                Offset type = writeType(*unnamedField.GetType());
+                Offset typeReps = unnamedField.GetTypeReps() ? writeExpression(*unnamedField.GetTypeReps().value()) : 0;
+                Offset defaultValue = writeDefaultValue(unnamedField.GetDefaultValue());
+                Offset node = beginNode(Tag::TypeStructUnnamedField, 0, 3);
+                setRelField(node, 0, type);
+                if(typeReps)
+                    setRelField(node, 1, typeReps);
+                if(defaultValue)
+                    setRelField(node, 2, defaultValue);
+                return node;
+            }
+        }, field);
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    ASTWriter::Offset ASTWriter::writeConstant(const ASTNode::Constant& constant) {
+        using Constant = ASTNode::Constant;
+        Offset node = beginNode(Tag::Constant, 0, 3);
+        std::uint8_t * payload = m_bytes.data() + node + sizeof(ASTBinary::NodeHeader) + ASTBinary::FIELD_SIZE;
+        std::visit(overloaded{
+            [&](Constant::Int intValue) {
+                setField(node, 0, std::uint32_t(ASTBinary::ConstantKind::Int));
+                ASTBinary::Write(payload, intValue);
+            },
+            [&](Constant::Float floatValue) {
+                setField(node, 0, std::uint32_t(ASTBinary::ConstantKind::Float));
+                ASTBinary::Write(payload, floatValue);
+            },
+            [&](Constant::Bool boolValue) {
+                setField(node, 0, std::uint32_t(ASTBinary::ConstantKind::Bool));
+                ASTBinary::Write(payload, std::uint64_t(boolValue));
+            }
+        }, constant.Get());
+        return node;
+    }
+
+    ASTWriter::Offset ASTWriter::writeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit) {
+        const auto& fields = structLit.GetFields();
+        std::vector<Offset> fieldNodes;
+        fieldNodes.reserve(fields.size());
+        for(const auto& field : fields) {
+            Offset value = writeExpression(*field.GetValue());
+            Offset fieldNode = beginNode(Tag::StructLiteralField, 0, 2);
+            setField(fieldNode, 0, field.GetName() ? internString(field.GetName().value()) : ASTBinary::NO_STRING);
+            setRelField(fieldNode, 1, value);
+            fieldNodes.push_back(fieldNode);
+        }
+
+        Offset node = beginNode(Tag::StructLiteral, 0, 1 + fields.size());
+        setField(node, 0, fields.size());
+        for(std::size_t i = 0; i < fieldNodes.size(); i++)
+            setRelField(node, 1 + i, fieldNodes[i]);
+        return node;
+    }
+
+    ASTWriter::Offset ASTWriter::writeExpression(const ASTNode::Expression& expr) {
+        using Literal = ASTNode::ExpressionLiteral;
+        using LiteralKind = ASTBinary::LiteralKind;
+
+        Offset constant = expr.GetConstant() ? writeConstant(expr.GetConstant().value()) : 0;
+        std::uint8_t flags = expr.IsGrouped() ? ASTBinary::FLAG_GROUPED : 0;
+        const std::optional<SourcePosition>& srcPos = expr.GetSourcePosition();
+
+        auto finishNode = [&](Offset node) {
+            if(constant)
+                setRelField(node, 0, constant);
+            return node;
+        };
+
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get()) {
+                    Offset node = beginNode(Tag::ExpressionLiteral, flags, 4, srcPos);
+                    setField(node, 1, std::uint32_t(LiteralKind::Null));
+                    return finishNode(node);
+                }
+                if(auto structLit = std::get_if<Literal::Struct>(&literal.Get().value())) {
+                    Offset structNode = writeStructLiteral(*structLit);
+                    Offset node = beginNode(Tag::ExpressionLiteral, flags, 4, srcPos);
+                    setField(node, 1, std::uint32_t(LiteralKind::Struct));
+                    setRelField(node, 2, structNode);
+                    return finishNode(node);
+                }
+                Offset node = beginNode(Tag::ExpressionLiteral, flags, 4, srcPos);
+                std::uint8_t * payload = m_bytes.data() + node + sizeof(ASTBinary::NodeHeader) + 2 * ASTBinary::FIELD_SIZE;
+                std::visit(overloaded{
+                    [&](Literal::Int intValue) {
+                        setField(node, 1, std::uint32_t(LiteralKind::Int));
+                        ASTBinary::Write(payload, intValue);
+                    },
+                    [&](Literal::Float floatValue) {
+                        setField(node, 1, std::uint32_t(LiteralKind::Float));
+                        ASTBinary::Write(payload, floatValue);
+                    },
+                    [&](const Literal::String& stringValue) {
+                        std::uint32_t idx = internString(stringValue);
+                        setField(node, 1, std::uint32_t(LiteralKind::String));
+                        setField(node, 2, idx);
+                    },
+                    [&](Literal::Char charValue) {
+                        setField(node, 1, std::uint32_t(LiteralKind::Char));
+                        setField(node, 2, std::uint8_t(charValue));
+                    },
+                    [&](Literal::Bool boolValue) {
+                        setField(node, 1, std::uint32_t(LiteralKind::Bool));
+                        setField(node, 2, boolValue);
+                    },
+                    [&](const Literal::Struct&) {
+                        assert(false);
+                    }
+                }, literal.Get().value());
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                Offset function = writeExpression(*funcCall.GetFunction());
+                Offset params = writeStructLiteral(funcCall.GetParameters());
+                Offset node = beginNode(Tag::ExpressionFunctionCall, flags, 3, srcPos);
+                setRelField(node, 1, function);
+                setRelField(node, 2, params);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                const auto& stmts = block.GetStatements();
+                std::vector<Offset> stmtNodes;
+                stmtNodes.reserve(stmts.size());
+                for(const auto& stmt : stmts)
+                    stmtNodes.push_back(writeStatement(stmt));
+                std::uint32_t label = block.GetLabel() ? internString(block.GetLabel().value()) : ASTBinary::NO_STRING;
+
+                Offset node = beginNode(Tag::ExpressionBlock, flags, 3 + stmts.size(), srcPos);
+                setField(node, 1, label);
+                setField(node, 2, stmts.size());
+                for(std::size_t i = 0; i < stmtNodes.size(); i++)
+                    setRelField(node, 3 + i, stmtNodes[i]);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                Offset cond = writeExpression(*ifExpr.GetCondition());
+                Offset success = writeStatement(*ifExpr.GetSuccessStatement());
+                Offset fail = ifExpr.GetFailStatement() ? writeStatement(*ifExpr.GetFailStatement().value()) : 0;
+                Offset node = beginNode(Tag::ExpressionIf, flags, 4, srcPos);
+                setRelField(node, 1, cond);
+                setRelField(node, 2, success);
+                if(fail)
+                    setRelField(node, 3, fail);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                Offset init = loop.GetInitStatement() ? writeStatement(*loop.GetInitStatement().value()) : 0;
+                Offset cond = loop.GetCondition() ? writeExpression(*loop.GetCondition().value()) : 0;
+                Offset post = loop.GetPostStatement() ? writeStatement(*loop.GetPostStatement().value()) : 0;
+                Offset body = writeStatement(*loop.GetBodyStatement());
+                Offset node = beginNode(Tag::ExpressionLoop, flags, 5, srcPos);
+                if(init)
+                    setRelField(node, 1, init);
+                if(cond)
+                    setRelField(node, 2, cond);
+                if(post)
+                    setRelField(node, 3, post);
+                setRelField(node, 4, body);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                Offset operand = writeExpression(*unaryOp.GetOperand());
+                Offset node = beginNode(Tag::ExpressionUnaryOperation, flags, 3, srcPos);
+                setField(node, 1, std::uint32_t(unaryOp.GetKind()));
+                setRelField(node, 2, operand);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                Offset first = writeExpression(*binOp.GetOperands().first);
+                Offset second = writeExpression(*binOp.GetOperands().second);
+                Offset node = beginNode(Tag::ExpressionBinaryOperation, flags, 4, srcPos);
+                setField(node, 1, std::uint32_t(binOp.GetKind()));
+                setRelField(node, 2, first);
+                setRelField(node, 3, second);
+                return finishNode(node);
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                Offset node = beginNode(Tag::ExpressionName, flags, 2, srcPos);
+                setField(node, 1, internString(name));
+                return finishNode(node);
+            }
+        }, expr.Get());
+    }
+
+    ASTWriter::Offset ASTWriter::writeLValue(const ASTNode::Expression::LValue& lvalue) {
+        using Expression = ASTNode::Expression;
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                Offset node = beginNode(Tag::LValueName, 0, 1);
+                setField(node, 0, internString(name));
+                return node;
+            },
+            [&](const Expression::PointerDereference& operand) {
+                Offset operandNode = writeExpression(*operand);
+                Offset node = beginNode(Tag::LValuePointerDereference, 0, 1);
+                setRelField(node, 0, operandNode);
+                return node;
+            },
+            [&](const Expression::StructMemberAccess& operands) {
+                Offset first = writeExpression(*operands.first);
+                Offset second = writeExpression(*operands.second);
+                Offset node = beginNode(Tag::LValueStructMemberAccess, 0, 2);
+                setRelField(node, 0, first);
+                setRelField(node, 1, second);
+                return node;
+            }
+        }, lvalue);
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    ASTWriter::Offset ASTWriter::writeStatement(const ASTNode::Statement& stmt) {
+        const std::optional<SourcePosition>& srcPos = stmt.GetSourcePosition();
+        return std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                Offset exprNode = writeExpression(expr);
+                Offset node = beginNode(Tag::StatementExpression, 0, 1, srcPos);
+                setRelField(node, 0, exprNode);
+                return node;
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                Offset lvalue = writeLValue(binOp.GetOperands().first);
+                Offset value = writeExpression(binOp.GetOperands().second);
+                Offset node = beginNode(Tag::StatementBinaryOperation, 0, 3, srcPos);
+                setField(node, 0, std::uint32_t(binOp.GetKind()));
+                setRelField(node, 1, lvalue);
+                setRelField(node, 2, value);
+                return node;
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                return std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        Offset type = writeType(typedVarDef.GetType());
+                        Offset value = typedVarDef.GetValue() ? writeExpression(typedVarDef.GetValue().value()) : 0;
+                        Offset node = beginNode(Tag::StatementTypedVariableDefinition, 0, 3, srcPos);
+                        setField(node, 0, internString(typedVarDef.GetName()));
+                        setRelField(node, 1, type);
+                        if(value)
+                            setRelField(node, 2, value);
+                        return node;
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        Offset value = writeExpression(untypedVarDef.GetValue());
+                        Offset node = beginNode(Tag::StatementUntypedVariableDefinition, 0, 2, srcPos);
+                        setField(node, 0, internString(untypedVarDef.GetName()));
+                        setRelField(node, 1, value);
+                        return node;
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                Offset lvalue = writeLValue(assign.GetLValue());
+                Offset rvalue = writeExpression(assign.GetRValue());
+                Offset node = beginNode(Tag::StatementAssignment, 0, 2, srcPos);
+                setRelField(node, 0, lvalue);
+                setRelField(node, 1, rvalue);
+                return node;
+            },
+            [&](const ASTNode::StatementContinue&) {
+                return beginNode(Tag::StatementContinue, 0, 0, srcPos);
+            },
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                Offset value = stmtBreak.GetValue() ? writeExpression(stmtBreak.GetValue().value()) : 0;
+                Offset node = beginNode(Tag::StatementBreak, 0, 2, srcPos);
+                setField(node, 0, stmtBreak.GetLabel() ? internString(stmtBreak.GetLabel().value()) : ASTBinary::NO_STRING);
+                if(value)
+                    setRelField(node, 1, value);
+                return node;
+            }
+        }, stmt.Get());
+    }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "ASTBinary.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ry {
+
+    // Serializes an ASTNode into the binary AST format (see ASTBinary.hpp)
+    class ASTWriter {
+    public:
+        ASTWriter();
+
+        std::vector<std::uint8_t> Write(const ASTNode& ast);
+        bool WriteToFile(const ASTNode& ast, const std::string& path);
+
+    private:
+        using Offset = std::uint32_t;
+        using Tag = ASTBinary::Tag;
+
+        Offset beginNode(Tag tag, std::uint8_t flags, std::size_t numFields);
+        Offset beginNode(Tag tag, std::uint8_t flags, std::size_t numFields, const std::optional<SourcePosition>& srcPos); // expressions and statements
+        void setField(Offset node, std::size_t fieldIdx, std::uint32_t value);
+        void setRelField(Offset node, std::size_t fieldIdx, Offset target);
+        std::uint32_t internString(std::string_view str);
+
+        Offset writeType(const ASTNode::Type& type);
+        Offset writeTypeStruct(const ASTNode::TypeStruct& structType, std::uint8_t flags = 0);
+        Offset writeTypeStructField(const ASTNode::TypeStruct::Field& field);
+        Offset writeConstant(const ASTNode::Constant& constant);
+        Offset writeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit);
+        Offset writeExpression(const ASTNode::Expression& expr);
+        Offset writeLValue(const ASTNode::Expression::LValue& lvalue);
+        Offset writeStatement(const ASTNode::Statement& stmt);
+        void writeStringTable();
+
+        std::vector<std::uint8_t> m_bytes;
+        std::vector<std::string_view> m_strings;
+        std::unordered_map<std::string_view, std::uint32_t> m_stringIndices;
+    };
+
+}
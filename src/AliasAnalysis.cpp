@@ -0,0 +1,553 @@
+#include "AliasAnalysis.hpp"
+#include "ry.hpp"
+
+#include <optional>
+#include <string_view>
+#include <variant>
+
+namespace ry {
+
+    using TypeKind = TypeInterner::Kind;
+    using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+    using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+
+    AliasAnalysis::AliasAnalysis(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types):
+        m_analyzer(analyzer),
+        m_typer(typer),
+        m_types(types)
+    {}
+
+    void AliasAnalysis::Analyze(const ASTNode& ast) {
+        std::size_t numDecls = m_analyzer.GetDeclarationCount();
+        m_function = GLOBAL;
+        m_nameUses.clear();
+        m_addressUses.clear();
+        m_calls.clear();
+        m_functions.clear();
+        m_parameters.clear();
+        m_owners.assign(numDecls, NONE);
+        m_targets.assign(numDecls, NONE);
+        for(std::uint32_t id = 0; id < numDecls; id++) {
+            const Declaration& decl = m_analyzer.GetDeclaration(id);
+            if(decl.kind == Declaration::Kind::Parameter && decl.parameter)
+                m_parameters[decl.parameter].push_back(id);
+        }
+
+        if(auto stmt = std::get_if<ASTNode::Statement>(&ast.Get()))
+            walkStatement(*stmt);
+        else if(auto expr = std::get_if<ASTNode::Expression>(&ast.Get()))
+            walkExpression(*expr, Use{UseKind::Copy});
+
+        m_isCalledOnly.assign(numDecls, false);
+        for(const auto& [id, function] : m_functions)
+            m_isCalledOnly[id] = true;
+        m_isReassigned.assign(numDecls, false);
+        m_isAddressed.assign(numDecls, false);
+        for(const NameUse& nameUse : m_nameUses) {
+            if(nameUse.use.kind != UseKind::Callee)
+                m_isCalledOnly[nameUse.decl] = false;
+            if(nameUse.use.kind == UseKind::Place || nameUse.use.kind == UseKind::Exposed)
+                m_isReassigned[nameUse.decl] = true;
+            if(nameUse.use.kind == UseKind::Exposed)
+                m_isAddressed[nameUse.decl] = true;
+        }
+        for(const NameUse& addressUse : m_addressUses) {
+            m_isCalledOnly[addressUse.decl] = false;
+            m_isReassigned[addressUse.decl] = true;
+            m_isAddressed[addressUse.decl] = true;
+        }
+
+        solveEscapes();
+        solveConsts();
+        solveRestricts();
+    }
+
+    bool AliasAnalysis::IsConst(const Declaration& function, std::size_t argumentIdx) const {
+        return isQualified(m_isConst, function, argumentIdx);
+    }
+
+    bool AliasAnalysis::IsRestrict(const Declaration& function, std::size_t argumentIdx) const {
+        return isQualified(m_isRestrict, function, argumentIdx);
+    }
+
+    bool AliasAnalysis::IsCalledOnly(const Declaration& function) const {
+        return m_functions.contains(function.id) && m_isCalledOnly[function.id];
+    }
+
+    bool AliasAnalysis::IsReadOnly(const Declaration& function, std::size_t argumentIdx) const {
+        auto it = m_functions.find(function.id);
+        if(it == m_functions.end() || argumentIdx >= it->second.parameters.size())
+            return false;
+        std::uint32_t parameter = it->second.parameters[argumentIdx];
+        return parameter == NONE || !m_isReassigned[parameter];
+    }
+
+    bool AliasAnalysis::IsAddressed(const Declaration& decl) const {
+        return m_isAddressed[decl.id];
+    }
+
+    const ASTNode::TypeFunction * AliasAnalysis::getFunctionDefinition(const Declaration& decl) {
+        if(decl.kind != Declaration::Kind::Variable)
+            return nullptr;
+        auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get());
+        if(!varDef)
+            return nullptr;
+        auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef);
+        if(!typedVarDef || !typedVarDef->GetValue())
+            return nullptr;
+        return std::get_if<ASTNode::TypeFunction>(&typedVarDef->GetType().Get());
+    }
+
+    /*
+     *
+     * Walk
+     *
+     */
+
+    void AliasAnalysis::walkExpression(const ASTNode::Expression& expr, const Use& use) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get())
+                    return;
+                if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                    for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit->GetFields())
+                        walkExpression(*field.GetValue(), Use{UseKind::Copy});
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                walkCall(funcCall);
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    walkStatement(stmt);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                walkExpression(*ifExpr.GetCondition(), Use{UseKind::Copy});
+                walkStatement(*ifExpr.GetSuccessStatement());
+                if(ifExpr.GetFailStatement())
+                    walkStatement(*ifExpr.GetFailStatement().value());
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                if(loop.GetInitStatement())
+                    walkStatement(*loop.GetInitStatement().value());
+                if(loop.GetCondition())
+                    walkExpression(*loop.GetCondition().value(), Use{UseKind::Copy});
+                if(loop.GetPostStatement())
+                    walkStatement(*loop.GetPostStatement().value());
+                walkStatement(*loop.GetBodyStatement());
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                const ASTNode::Expression& operand = *unaryOp.GetOperand();
+                switch(unaryOp.GetKind()) {
+                    case UnOpKind::AddressOf: {
+                        auto name = std::get_if<ASTNode::ExpressionName>(&operand.Get());
+                        if(!name) {
+                            walkExpression(operand, Use{UseKind::Exposed});
+                            return;
+                        }
+                        const Declaration * decl = m_analyzer.GetDeclaration(*name);
+                        if(!decl)
+                            return;
+                        std::uint32_t owner = m_owners[decl->id];
+                        if(owner != NONE && owner != GLOBAL && owner != m_function) {
+                            m_addressUses.push_back(NameUse{decl->id, Use{UseKind::Exposed}});
+                            return;
+                        }
+                        if(use.kind == UseKind::Init)
+                            m_targets[use.target] = decl->id;
+                        m_addressUses.push_back(NameUse{decl->id, use});
+                        return;
+                    }
+                    case UnOpKind::PointerDereference:
+                        // a pointer to what it points to is a copy of it
+                        if(use.kind == UseKind::Exposed)
+                            walkExpression(operand, Use{UseKind::Copy});
+                        else
+                            walkExpression(operand, Use{use.kind == UseKind::Place ? UseKind::DerefWrite : UseKind::Deref});
+                        return;
+                    default:
+                        walkExpression(operand, Use{UseKind::Copy});
+                        return;
+                }
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                const ASTNode::ExpressionBinaryOperation::Operands& operands = binOp.GetOperands();
+                switch(binOp.GetKind()) {
+                    case BinOpKind::StructMemberAccess: {
+                        // the member is not a name, a place or an exposed storage is the object's
+                        bool isStorage = use.kind == UseKind::Place || use.kind == UseKind::Exposed;
+                        walkExpression(*operands.first, isStorage ? use : Use{UseKind::Copy});
+                        return;
+                    }
+                    default:
+                        walkExpression(*operands.first, Use{UseKind::Copy});
+                        walkExpression(*operands.second, Use{UseKind::Copy});
+                        return;
+                }
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                walkName(name, use);
+            }
+        }, expr.Get());
+    }
+
+    // Locals used by another function, nested in theirs, are exposed
+    void AliasAnalysis::walkName(const ASTNode::ExpressionName& name, const Use& use) {
+        const Declaration * decl = m_analyzer.GetDeclaration(name);
+        if(!decl)
+            return;
+        std::uint32_t owner = m_owners[decl->id];
+        if(owner != NONE && owner != GLOBAL && owner != m_function)
+            m_nameUses.push_back(NameUse{decl->id, Use{UseKind::Exposed}});
+        else
+            m_nameUses.push_back(NameUse{decl->id, use});
+    }
+
+    void AliasAnalysis::walkLValue(const ASTNode::Expression::LValue& lvalue) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                walkName(name, Use{UseKind::Place});
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                walkExpression(*operand, Use{UseKind::DerefWrite});
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                walkExpression(*operands.first, Use{UseKind::Place});
+            }
+        }, lvalue);
+    }
+
+    void AliasAnalysis::walkStatement(const ASTNode::Statement& stmt) {
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                walkExpression(expr, Use{UseKind::Copy});
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                walkLValue(binOp.GetOperands().first);
+                walkExpression(binOp.GetOperands().second, Use{UseKind::Copy});
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                const Declaration * decl = m_analyzer.GetDeclaration(stmt);
+                Use init{UseKind::Copy};
+                if(decl) {
+                    if(const ASTNode::TypeFunction * function = getFunctionDefinition(*decl)) {
+                        walkFunction(*decl, *function, std::get<ASTNode::StatementTypedVariableDefinition>(varDef).GetValue().value());
+                        return;
+                    }
+                    m_owners[decl->id] = m_function;
+                    init = Use{UseKind::Init, 0, 0, decl->id};
+                }
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        if(typedVarDef.GetValue())
+                            walkExpression(typedVarDef.GetValue().value(), init);
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        walkExpression(untypedVarDef.GetValue(), init);
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                walkLValue(assign.GetLValue());
+                walkExpression(assign.GetRValue(), Use{UseKind::Copy});
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& breakStmt) {
+                if(breakStmt.GetValue())
+                    walkExpression(breakStmt.GetValue().value(), Use{UseKind::Copy});
+            }
+        }, stmt.Get());
+    }
+
+    // Arguments are matched by name or position like the typer does
+    void AliasAnalysis::walkCall(const ASTNode::ExpressionFunctionCall& funcCall) {
+        const ASTNode::ExpressionLiteral::Struct::Fields& fields = funcCall.GetParameters().GetFields();
+        auto name = std::get_if<ASTNode::ExpressionName>(&funcCall.GetFunction()->Get());
+        const Declaration * decl = name ? m_analyzer.GetDeclaration(*name) : nullptr;
+        std::optional<TypeId> type = decl ? m_typer.GetType(*decl) : std::nullopt;
+        if(!decl || !getFunctionDefinition(*decl) || !type || m_types.Get(type.value()).kind != TypeKind::Function) {
+            walkExpression(*funcCall.GetFunction(), Use{UseKind::Copy});
+            for(const ASTNode::ExpressionLiteral::Struct::Field& field : fields)
+                walkExpression(*field.GetValue(), Use{UseKind::Copy});
+            return;
+        }
+        walkName(*name, Use{UseKind::Callee});
+
+        std::vector<std::string_view> slotNames;
+        for(const TypeInterner::Field& argument : getArguments(type.value()))
+            for(std::uint64_t rep = 0; rep < argument.reps; rep++)
+                slotNames.push_back(argument.name);
+        std::uint32_t callIdx = std::uint32_t(m_calls.size());
+        m_calls.push_back(Call{decl->id, m_function, std::vector<const ASTNode::Expression *>(slotNames.size(), nullptr)});
+
+        std::size_t slot = 0;
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : fields) {
+            if(field.GetName()) {
+                slot = slotNames.size();
+                for(std::size_t i = 0; i < slotNames.size(); i++) {
+                    if(slotNames[i] == field.GetName().value()) {
+                        slot = i;
+                        break;
+                    }
+                }
+            }
+            if(slot >= slotNames.size()) {
+                walkExpression(*field.GetValue(), Use{UseKind::Copy});
+                continue;
+            }
+            m_calls[callIdx].arguments[slot] = field.GetValue().get();
+            walkExpression(*field.GetValue(), Use{UseKind::Argument, callIdx, std::uint32_t(slot)});
+            slot++;
+        }
+    }
+
+    void AliasAnalysis::walkFunction(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body) {
+        // defaults are evaluated by the caller
+        std::unordered_map<std::string_view, std::uint32_t> parameters;
+        for(const ASTNode::TypeStruct::Field& field : function.GetArgumentsType().GetFields()) {
+            std::visit([&](const auto& typeField) {
+                if(typeField.GetDefaultValue())
+                    walkExpression(*typeField.GetDefaultValue().value(), Use{UseKind::Copy});
+            }, field);
+            if(auto namedField = std::get_if<ASTNode::TypeStruct::NamedField>(&field)) {
+                auto it = m_parameters.find(namedField);
+                if(it == m_parameters.end())
+                    continue;
+                for(std::uint32_t id : it->second) {
+                    m_owners[id] = decl.id;
+                    parameters[m_analyzer.GetDeclaration(id).name] = id;
+                }
+            }
+        }
+
+        std::optional<TypeId> type = m_typer.GetType(decl);
+        if(type && m_types.Get(type.value()).kind == TypeKind::Function) {
+            Function& entry = m_functions[decl.id];
+            entry.type = type.value();
+            for(const TypeInterner::Field& argument : getArguments(type.value())) {
+                auto it = argument.name.empty() ? parameters.end() : parameters.find(argument.name);
+                for(std::uint64_t rep = 0; rep < argument.reps; rep++)
+                    entry.parameters.push_back(it == parameters.end() ? NONE : it->second);
+            }
+        }
+
+        std::uint32_t enclosing = m_function;
+        m_function = decl.id;
+        walkExpression(body, Use{UseKind::Copy});
+        m_function = enclosing;
+    }
+
+    /*
+     *
+     * Facts
+     *
+     */
+
+    std::span<const TypeInterner::Field> AliasAnalysis::getArguments(TypeId function) const {
+        return m_types.GetFields(m_types.Get(function).arguments);
+    }
+
+    bool AliasAnalysis::isPointer(std::uint32_t decl) const {
+        std::optional<TypeId> type = m_typer.GetType(m_analyzer.GetDeclaration(decl));
+        return type && m_types.Get(type.value()).kind == TypeKind::Pointer;
+    }
+
+    bool AliasAnalysis::containsPointer(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(info.kind == TypeKind::Pointer)
+            return true;
+        if(info.kind != TypeKind::Struct)
+            return false;
+        for(const TypeInterner::Field& field : m_types.GetFields(type))
+            if(containsPointer(field.type))
+                return true;
+        return false;
+    }
+
+    bool AliasAnalysis::isLocal(std::uint32_t decl) const {
+        return m_owners[decl] != NONE && m_owners[decl] != GLOBAL;
+    }
+
+    // A local pointer that is only ever the address of a local of the same function
+    bool AliasAnalysis::isTransparent(std::uint32_t decl) const {
+        std::uint32_t target = m_targets[decl];
+        return isLocal(decl) && target != NONE && m_owners[target] == m_owners[decl] && !m_isReassigned[decl] && isPointer(decl);
+    }
+
+    std::uint32_t AliasAnalysis::getParameter(const Call& call, std::uint32_t slot) const {
+        auto it = m_functions.find(call.callee);
+        if(it == m_functions.end() || slot >= it->second.parameters.size())
+            return NONE;
+        return it->second.parameters[slot];
+    }
+
+    bool AliasAnalysis::isEscaping(const Use& use) const {
+        switch(use.kind) {
+            case UseKind::Deref:
+            case UseKind::DerefWrite:
+                return false;
+            case UseKind::Argument: {
+                std::uint32_t parameter = getParameter(m_calls[use.call], use.slot);
+                return parameter == NONE || m_isEscaping[parameter];
+            }
+            default:
+                return true;
+        }
+    }
+
+    std::uint32_t AliasAnalysis::getOrigin(const ASTNode::Expression * argument, std::uint32_t caller) const {
+        if(!argument || caller == GLOBAL)
+            return NONE;
+        const ASTNode::Expression * operand = argument;
+        bool isAddress = false;
+        if(auto unaryOp = std::get_if<ASTNode::ExpressionUnaryOperation>(&argument->Get())) {
+            if(unaryOp->GetKind() != UnOpKind::AddressOf)
+                return NONE;
+            operand = unaryOp->GetOperand().get();
+            isAddress = true;
+        }
+        auto name = std::get_if<ASTNode::ExpressionName>(&operand->Get());
+        const Declaration * decl = name ? m_analyzer.GetDeclaration(*name) : nullptr;
+        if(!decl || m_owners[decl->id] != caller)
+            return NONE;
+        std::uint32_t origin = decl->id;
+        if(!isAddress) {
+            if(decl->kind == Declaration::Kind::Parameter)
+                return m_isRestrict[origin] ? origin : NONE;
+            if(!isTransparent(origin))
+                return NONE;
+            origin = m_targets[origin];
+        }
+        return m_isEscaping[origin] ? NONE : origin;
+    }
+
+    bool AliasAnalysis::isQualified(const std::vector<bool>& facts, const Declaration& function, std::size_t argumentIdx) const {
+        auto it = m_functions.find(function.id);
+        if(it == m_functions.end() || argumentIdx >= it->second.parameters.size())
+            return false;
+        std::uint32_t parameter = it->second.parameters[argumentIdx];
+        return parameter != NONE && facts[parameter];
+    }
+
+    /*
+     *
+     * Fixed points
+     *
+     */
+
+    // Locals and parameters are assumed not to escape until a use shows they do
+    void AliasAnalysis::solveEscapes() {
+        m_isEscaping.assign(m_owners.size(), true);
+        for(std::uint32_t id = 0; id < m_owners.size(); id++)
+            if(isLocal(id))
+                m_isEscaping[id] = false;
+
+        bool isChanged = true;
+        auto escape = [&](std::uint32_t decl) {
+            if(!m_isEscaping[decl]) {
+                m_isEscaping[decl] = true;
+                isChanged = true;
+            }
+        };
+        while(isChanged) {
+            isChanged = false;
+            for(const NameUse& nameUse : m_nameUses) {
+                if(nameUse.use.kind == UseKind::Exposed)
+                    escape(nameUse.decl);
+                else if(!isEscaping(nameUse.use))
+                    continue;
+                // copies of a pointer parameter, or of a pointer to a local
+                const Declaration& decl = m_analyzer.GetDeclaration(nameUse.decl);
+                if(decl.kind == Declaration::Kind::Parameter && isPointer(nameUse.decl))
+                    escape(nameUse.decl);
+                else if(isTransparent(nameUse.decl))
+                    escape(m_targets[nameUse.decl]);
+            }
+            for(const NameUse& addressUse : m_addressUses) {
+                if(addressUse.use.kind == UseKind::Init && isTransparent(addressUse.use.target))
+                    continue;
+                // what a pointer parameter points to can be read through its address
+                const Declaration& decl = m_analyzer.GetDeclaration(addressUse.decl);
+                if(isEscaping(addressUse.use) || (decl.kind == Declaration::Kind::Parameter && isPointer(addressUse.decl)))
+                    escape(addressUse.decl);
+            }
+        }
+    }
+
+    // Parameters that are only read through, or passed on to const parameters
+    void AliasAnalysis::solveConsts() {
+        m_isConst.assign(m_owners.size(), false);
+        for(const auto& [id, function] : m_functions) {
+            if(!m_isCalledOnly[id])
+                continue;
+            for(std::uint32_t parameter : function.parameters) {
+                if(parameter == NONE || m_isReassigned[parameter] || !isPointer(parameter))
+                    continue;
+                TypeId type = m_typer.GetType(m_analyzer.GetDeclaration(parameter)).value();
+                m_isConst[parameter] = !m_types.Get(m_types.Get(type).pointee).attribs.isMutable;
+            }
+        }
+
+        bool isChanged = true;
+        while(isChanged) {
+            isChanged = false;
+            for(const NameUse& nameUse : m_nameUses) {
+                if(!m_isConst[nameUse.decl] || nameUse.use.kind == UseKind::Deref)
+                    continue;
+                if(nameUse.use.kind == UseKind::Argument) {
+                    std::uint32_t parameter = getParameter(m_calls[nameUse.use.call], nameUse.use.slot);
+                    if(parameter != NONE && m_isConst[parameter])
+                        continue;
+                }
+                m_isConst[nameUse.decl] = false;
+                isChanged = true;
+            }
+        }
+    }
+
+    // Parameters that every call passes an origin nothing else passed to it has
+    void AliasAnalysis::solveRestricts() {
+        m_isRestrict.assign(m_owners.size(), false);
+        for(const auto& [id, function] : m_functions) {
+            if(!m_isCalledOnly[id])
+                continue;
+            for(std::uint32_t parameter : function.parameters)
+                if(parameter != NONE && !m_isEscaping[parameter] && isPointer(parameter))
+                    m_isRestrict[parameter] = true;
+        }
+
+        bool isChanged = true;
+        std::vector<bool> hasPointers;
+        while(isChanged) {
+            isChanged = false;
+            for(const Call& call : m_calls) {
+                auto it = m_functions.find(call.callee);
+                if(it == m_functions.end())
+                    continue;
+                const Function& function = it->second;
+                hasPointers.clear();
+                for(const TypeInterner::Field& argument : getArguments(function.type))
+                    for(std::uint64_t rep = 0; rep < argument.reps; rep++)
+                        hasPointers.push_back(containsPointer(argument.type));
+
+                for(std::size_t slot = 0; slot < call.arguments.size(); slot++) {
+                    std::uint32_t parameter = function.parameters[slot];
+                    if(parameter == NONE || !m_isRestrict[parameter])
+                        continue;
+                    std::uint32_t origin = getOrigin(call.arguments[slot], call.caller);
+                    bool isRestrict = origin != NONE;
+                    for(std::size_t otherSlot = 0; isRestrict && otherSlot < call.arguments.size(); otherSlot++) {
+                        if(otherSlot == slot || !hasPointers[otherSlot])
+                            continue;
+                        std::uint32_t otherOrigin = getOrigin(call.arguments[otherSlot], call.caller);
+                        isRestrict = otherOrigin != NONE && otherOrigin != origin;
+                    }
+                    if(!isRestrict) {
+                        m_isRestrict[parameter] = false;
+                        isChanged = true;
+                    }
+                }
+            }
+        }
+    }
+
+}
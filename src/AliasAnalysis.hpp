@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "Analyzer.hpp"
+#include "TypeInterner.hpp"
+#include "Typer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Which pointer parameters can be qualified in C.
+    //
+    // One walk over the typed AST records how every name and address is used: dereferenced,
+    // written through, passed to a parameter, or anything else (copied, stored, compared), where
+    // the pointer is lost track of and escapes. The facts are then solved as greatest fixed points
+    // over the call graph, so a pointer passed down a chain of calls keeps its qualifiers.
+    //
+    // Only functions that are called by name and never used as values qualify, all their callers
+    // are known. A pointer parameter is const if its pointee is not mutable (~) and nothing is
+    // written through it. It is restrict if it does not escape and at every call it points to a
+    // local of the caller, or to what a restrict parameter of the caller does, that does not
+    // escape either and that no other pointer passed to the call points to.
+    //
+    class AliasAnalysis {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+
+        AliasAnalysis(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types);
+
+        void Analyze(const ASTNode& ast);
+
+        // Arguments of a function definition, repetitions expanded
+        bool IsConst(const Declaration& function, std::size_t argumentIdx) const;
+        bool IsRestrict(const Declaration& function, std::size_t argumentIdx) const;
+        // All its callers are known, its signature can change
+        bool IsCalledOnly(const Declaration& function) const;
+        // Never assigned to, nor its address taken or exposed
+        bool IsReadOnly(const Declaration& function, std::size_t argumentIdx) const;
+        // Its address taken or exposed, so it may change other than by assigning its name
+        bool IsAddressed(const Declaration& decl) const;
+
+    private:
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+        static constexpr std::uint32_t GLOBAL = UINT32_MAX - 1; // owner of top-level declarations
+
+        // How the value of an expression is used
+        struct Use {
+            enum class Kind : std::uint8_t {
+                Copy,       // anything that may keep it
+                Place,      // assigned to
+                Exposed,    // its storage may be reached other than through the pointers tracked
+                Deref,      // read through
+                DerefWrite, // written through
+                Callee,
+                Argument,
+                Init        // of a variable defined as its address
+            };
+
+            Kind kind;
+            std::uint32_t call = 0;   // Argument: in m_calls
+            std::uint32_t slot = 0;   // Argument: of the callee's arguments, repetitions expanded
+            std::uint32_t target = 0; // Init: declaration id of the variable
+        };
+        using UseKind = Use::Kind;
+
+        struct NameUse {
+            std::uint32_t decl;
+            Use use;
+        };
+
+        // A call of a function definition by name
+        struct Call {
+            std::uint32_t callee;                               // declaration id
+            std::uint32_t caller;                               // declaration id, GLOBAL at the top level
+            std::vector<const ASTNode::Expression *> arguments; // by slot, nullptr if defaulted
+        };
+
+        struct Function {
+            TypeId type;
+            std::vector<std::uint32_t> parameters; // by slot, declaration ids, NONE if unnamed
+        };
+
+        static const ASTNode::TypeFunction * getFunctionDefinition(const Declaration& decl);
+
+        void walkExpression(const ASTNode::Expression& expr, const Use& use);
+        void walkName(const ASTNode::ExpressionName& name, const Use& use);
+        void walkLValue(const ASTNode::Expression::LValue& lvalue);
+        void walkStatement(const ASTNode::Statement& stmt);
+        void walkCall(const ASTNode::ExpressionFunctionCall& funcCall);
+        void walkFunction(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body);
+
+        std::span<const TypeInterner::Field> getArguments(TypeId function) const;
+        bool isPointer(std::uint32_t decl) const;
+        bool containsPointer(TypeId type) const;
+        bool isLocal(std::uint32_t decl) const;
+        bool isTransparent(std::uint32_t decl) const;
+        std::uint32_t getParameter(const Call& call, std::uint32_t slot) const;
+        bool isEscaping(const Use& use) const;
+        // What an argument points to, a local of the caller or a restrict parameter, NONE if unknown
+        std::uint32_t getOrigin(const ASTNode::Expression * argument, std::uint32_t caller) const;
+        bool isQualified(const std::vector<bool>& facts, const Declaration& function, std::size_t argumentIdx) const;
+
+        void solveEscapes();
+        void solveConsts();
+        void solveRestricts();
+
+        const Analyzer& m_analyzer;
+        const Typer& m_typer;
+        const TypeInterner& m_types;
+
+        std::uint32_t m_function = GLOBAL; // being walked
+        std::vector<NameUse> m_nameUses;
+        std::vector<NameUse> m_addressUses; // of &name
+        std::vector<Call> m_calls;
+
+        std::unordered_map<std::uint32_t, Function> m_functions; // by declaration id
+        std::unordered_map<const ASTNode::TypeStruct::NamedField *, std::vector<std::uint32_t>> m_parameters;
+        std::vector<std::uint32_t> m_owners;       // by declaration id, function it is local to
+        std::vector<std::uint32_t> m_targets;      // by declaration id, variable whose address it is defined as
+        std::vector<bool> m_isCalledOnly;          // by declaration id, function definitions never used as values
+        std::vector<bool> m_isReassigned;          // by declaration id, also an address taken, or exposed
+        std::vector<bool> m_isAddressed;           // by declaration id
+        std::vector<bool> m_isEscaping;            // by declaration id
+        std::vector<bool> m_isConst;               // by declaration id
+        std::vector<bool> m_isRestrict;            // by declaration id
+    };
+
+}
@@ -0,0 +1,334 @@
+#include "Analyzer.hpp"
+#include "ry.hpp"
+
+#include <format>
+#include <variant>
+
+namespace ry {
+
+    using Declaration = Analyzer::Declaration;
+
+    Analyzer::Analyzer(const Infos& infos):
+        m_infos(infos)
+    {}
+
+    const Infos& Analyzer::GetInfos() const {
+        return m_infos;
+    }
+
+    void Analyzer::Analyze(const ASTNode& ast) {
+        std::visit(overloaded{
+            [&](const ASTNode::Type& type)       { analyzeType(type); },
+            [&](const ASTNode::Expression& expr) { analyzeExpression(expr); },
+            [&](const ASTNode::Statement& stmt)  { analyzeStatement(stmt); }
+        }, ast.Get());
+    }
+
+    const Declaration * Analyzer::GetDeclaration(const ASTNode::ExpressionName& name) const {
+        auto it = m_resolutions.find(&name);
+        return it != m_resolutions.end() ? it->second : nullptr;
+    }
+
+    const Declaration * Analyzer::GetDeclaration(const ASTNode::Statement& stmt) const {
+        auto it = m_definitions.find(&stmt);
+        return it != m_definitions.end() ? it->second : nullptr;
+    }
+
+    const Declaration & Analyzer::GetDeclaration(std::uint32_t id) const {
+        return m_declarations[id];
+    }
+
+    std::size_t Analyzer::GetDeclarationCount() const {
+        return m_declarations.size();
+    }
+
+    std::size_t Analyzer::GetResolvedNameCount() const {
+        return m_resolutions.size();
+    }
+
+    void Analyzer::error(std::string_view msg, const std::optional<SourcePosition>& srcPos) {
+        if(srcPos)
+            m_infos.Push(Infos::Info(Infos::Info::Level::ERROR, msg, srcPos.value()));
+        else
+            m_infos.Push(Infos::Info(Infos::Info::Level::ERROR, msg));
+    }
+
+    /*
+     *
+     * Scopes
+     *
+     */
+
+    Analyzer::NameId Analyzer::intern(std::string_view name) {
+        NameId id = m_names.Intern(name);
+        if(id >= m_bindings.size()) {
+            m_bindings.resize(id + 1, nullptr);
+            m_parameterBindings.resize(id + 1, nullptr);
+            m_labelDepths.resize(id + 1, 0);
+        }
+        return id;
+    }
+
+    void Analyzer::pushScope() {
+        m_scopeMarks.push_back(m_undoLog.size());
+    }
+
+    void Analyzer::popScope() {
+        std::size_t mark = m_scopeMarks.back();
+        m_scopeMarks.pop_back();
+        while(m_undoLog.size() > mark) {
+            const Undo& undo = m_undoLog.back();
+            (undo.isParameter ? m_parameterBindings : m_bindings)[undo.name] = undo.previous;
+            m_undoLog.pop_back();
+        }
+    }
+
+    void Analyzer::bind(bool isParameter, NameId name, const Declaration * decl) {
+        auto& bindings = isParameter ? m_parameterBindings : m_bindings;
+        m_undoLog.push_back(Undo{isParameter, name, bindings[name]});
+        bindings[name] = decl;
+    }
+
+    const Declaration * Analyzer::declare(const Declaration& decl) {
+        Declaration * declPtr = &m_declarations.emplace_back(decl);
+        declPtr->id = std::uint32_t(m_declarations.size() - 1);
+        if(declPtr->statement)
+            m_definitions[declPtr->statement] = declPtr;
+        bind(false, intern(decl.name), declPtr);
+        return declPtr;
+    }
+
+    void Analyzer::resolve(const ASTNode::ExpressionName& name, const std::optional<SourcePosition>& srcPos) {
+        NameId id = intern(name);
+        const Declaration * decl = m_parameterBindings[id] ? m_parameterBindings[id] : m_bindings[id];
+        if(!decl) {
+            error(std::format("Unresolved name \"{}\"", name), srcPos);
+            return;
+        }
+        m_resolutions[&name] = decl;
+    }
+
+    /*
+     *
+     * Functions
+     *
+     */
+
+    // The parameters are searched before any block. In nested functions they are only hidden
+    // from that first search, the regular bindings still reach them as an outer scope.
+    void Analyzer::analyzeFunction(const ASTNode::TypeFunction& function, const ASTNode::Expression& body, const std::optional<SourcePosition>& srcPos) {
+        analyzeTypeStruct(function.GetArgumentsType());
+        analyzeType(*function.GetReturnType());
+
+        pushScope();
+        for(NameId name : m_parameters)
+            bind(true, name, nullptr);
+
+        std::vector<NameId> parameters;
+        for(const ASTNode::TypeStruct::Field& field : function.GetArgumentsType().GetFields()) {
+            auto namedField = std::get_if<ASTNode::TypeStruct::NamedField>(&field);
+            if(!namedField)
+                continue;
+            for(std::string_view name : namedField->GetNames()) {
+                const Declaration * decl = declare(Declaration{0, Declaration::Kind::Parameter, name, srcPos, nullptr, namedField});
+                bind(true, intern(name), decl);
+                parameters.push_back(intern(name));
+            }
+        }
+
+        std::swap(m_parameters, parameters);
+        analyzeExpression(body);
+        std::swap(m_parameters, parameters);
+
+        popScope();
+    }
+
+    /*
+     *
+     * Type
+     *
+     */
+
+    void Analyzer::analyzeType(const ASTNode::Type& type) {
+        std::visit(overloaded{
+            [&](ASTNode::TypePrimitive) {},
+            [&](const ASTNode::TypePointer& pointer) {
+                analyzeType(*pointer);
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                analyzeTypeStruct(function.GetArgumentsType());
+                analyzeType(*function.GetReturnType());
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                analyzeTypeStruct(structType);
+            }
+        }, type.Get());
+    }
+
+    void Analyzer::analyzeTypeStruct(const ASTNode::TypeStruct& structType) {
+        for(const ASTNode::TypeStruct::Field& field : structType.GetFields()) {
+            std::visit(overloaded{
+                [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                    analyzeType(*namedField.GetType());
+                    if(namedField.GetDefaultValue())
+                        analyzeExpression(*namedField.GetDefaultValue().value());
+                },
+                [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                    analyzeType(*unnamedField.GetType());
+                    if(unnamedField.GetTypeReps())
+                        analyzeExpression(*unnamedField.GetTypeReps().value());
+                    if(unnamedField.GetDefaultValue())
+                        analyzeExpression(*unnamedField.GetDefaultValue().value());
+                }
+            }, field);
+        }
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    // Field names are not resolved, they name members of the literal
+    void Analyzer::analyzeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit) {
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields())
+            analyzeExpression(*field.GetValue());
+    }
+
+    void Analyzer::analyzeExpression(const ASTNode::Expression& expr) {
+        using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(literal.Get())
+                    if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                        analyzeStructLiteral(*structLit);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                analyzeExpression(*funcCall.GetFunction());
+                analyzeStructLiteral(funcCall.GetParameters());
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                std::optional<NameId> label;
+                if(block.GetLabel()) {
+                    label = intern(block.GetLabel().value());
+                    if(m_labelDepths[label.value()] > 0)
+                        error(std::format("Duplicate block label \"{}\"", block.GetLabel().value()), expr.GetSourcePosition());
+                    m_labelDepths[label.value()]++;
+                }
+
+                pushScope();
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    analyzeStatement(stmt);
+                popScope();
+
+                if(label)
+                    m_labelDepths[label.value()]--;
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                analyzeExpression(*ifExpr.GetCondition());
+                analyzeScopedStatement(*ifExpr.GetSuccessStatement());
+                if(ifExpr.GetFailStatement())
+                    analyzeScopedStatement(*ifExpr.GetFailStatement().value());
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                // the init statement is visible in the whole loop
+                pushScope();
+                if(loop.GetInitStatement())
+                    analyzeStatement(*loop.GetInitStatement().value());
+                if(loop.GetCondition())
+                    analyzeExpression(*loop.GetCondition().value());
+                if(loop.GetPostStatement())
+                    analyzeScopedStatement(*loop.GetPostStatement().value());
+                analyzeScopedStatement(*loop.GetBodyStatement());
+                popScope();
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                analyzeExpression(*unaryOp.GetOperand());
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                analyzeExpression(*binOp.GetOperands().first);
+                // the member name is resolved against the struct type, not the scope
+                if(binOp.GetKind() != BinOpKind::StructMemberAccess)
+                    analyzeExpression(*binOp.GetOperands().second);
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                resolve(name, expr.GetSourcePosition());
+            }
+        }, expr.Get());
+    }
+
+    void Analyzer::analyzeLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                resolve(name, srcPos);
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                analyzeExpression(*operand);
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                analyzeExpression(*operands.first);
+            }
+        }, lvalue);
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    void Analyzer::analyzeStatement(const ASTNode::Statement& stmt) {
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                analyzeExpression(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                analyzeLValue(binOp.GetOperands().first, stmt.GetSourcePosition());
+                analyzeExpression(binOp.GetOperands().second);
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        Declaration decl{0, Declaration::Kind::Variable, typedVarDef.GetName(), stmt.GetSourcePosition(), &stmt, nullptr};
+                        auto function = std::get_if<ASTNode::TypeFunction>(&typedVarDef.GetType().Get());
+                        if(function && typedVarDef.GetValue()) {
+                            // declared before its body so that it can call itself
+                            declare(decl);
+                            analyzeFunction(*function, typedVarDef.GetValue().value(), stmt.GetSourcePosition());
+                            return;
+                        }
+                        analyzeType(typedVarDef.GetType());
+                        if(typedVarDef.GetValue())
+                            analyzeExpression(typedVarDef.GetValue().value());
+                        declare(decl);
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        analyzeExpression(untypedVarDef.GetValue());
+                        declare(Declaration{0, Declaration::Kind::Variable, untypedVarDef.GetName(), stmt.GetSourcePosition(), &stmt, nullptr});
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                analyzeLValue(assign.GetLValue(), stmt.GetSourcePosition());
+                analyzeExpression(assign.GetRValue());
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                if(stmtBreak.GetLabel() && m_labelDepths[intern(stmtBreak.GetLabel().value())] == 0)
+                    error(std::format("Unresolved block label \"{}\"", stmtBreak.GetLabel().value()), stmt.GetSourcePosition());
+                if(stmtBreak.GetValue())
+                    analyzeExpression(stmtBreak.GetValue().value());
+            }
+        }, stmt.Get());
+    }
+
+    // A statement that is not in a block (if/loop bodies) still gets its own scope
+    void Analyzer::analyzeScopedStatement(const ASTNode::Statement& stmt) {
+        pushScope();
+        analyzeStatement(stmt);
+        popScope();
+    }
+
+}
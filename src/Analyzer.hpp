@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "Infos.hpp"
+#include "Interner.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Name resolution.
+    //
+    // Follows the spec: a name is first searched in the parameters of the enclosing function,
+    // then in the block it is used in, then outward. Names are interned to dense ids, the
+    // visible declaration of every id lives in a flat array, and scopes are left by replaying
+    // an undo log back to the mark taken on entry, so the pass is linear in the size of the AST.
+    //
+    // Results are kept in a side table keyed by the address of each ExpressionName,
+    // the analyzed AST must outlive the analyzer and must not be copied in between.
+    //
+    class Analyzer {
+    public:
+        struct Declaration {
+            enum class Kind {
+                Variable, Parameter
+            };
+
+            std::uint32_t id; // dense, in declaration order
+            Kind kind;
+            std::string_view name;
+            std::optional<SourcePosition> srcPos;
+            const ASTNode::Statement * statement;               // Variable: its definition
+            const ASTNode::TypeStruct::NamedField * parameter;  // Parameter: its field
+        };
+
+        Analyzer(const Infos& infos);
+
+        const Infos& GetInfos() const;
+
+        void Analyze(const ASTNode& ast);
+
+        // nullptr if unresolved, or not a name that refers to a declaration (e.g. a struct member)
+        const Declaration * GetDeclaration(const ASTNode::ExpressionName& name) const;
+        // nullptr if not a variable definition
+        const Declaration * GetDeclaration(const ASTNode::Statement& stmt) const;
+        const Declaration & GetDeclaration(std::uint32_t id) const;
+
+        std::size_t GetDeclarationCount() const;
+        std::size_t GetResolvedNameCount() const;
+
+    private:
+        using NameId = Interner::Id;
+
+        struct Undo {
+            bool isParameter;
+            NameId name;
+            const Declaration * previous;
+        };
+
+        void error(std::string_view msg, const std::optional<SourcePosition>& srcPos);
+
+        NameId intern(std::string_view name);
+        void pushScope();
+        void popScope();
+        void bind(bool isParameter, NameId name, const Declaration * decl);
+        const Declaration * declare(const Declaration& decl);
+        void resolve(const ASTNode::ExpressionName& name, const std::optional<SourcePosition>& srcPos);
+
+        void analyzeFunction(const ASTNode::TypeFunction& function, const ASTNode::Expression& body, const std::optional<SourcePosition>& srcPos);
+        void analyzeType(const ASTNode::Type& type);
+        void analyzeTypeStruct(const ASTNode::TypeStruct& structType);
+        void analyzeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit);
+        void analyzeExpression(const ASTNode::Expression& expr);
+        void analyzeLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos);
+        void analyzeStatement(const ASTNode::Statement& stmt);
+        void analyzeScopedStatement(const ASTNode::Statement& stmt);
+
+        Infos m_infos;
+        Interner m_names;
+
+        std::vector<const Declaration *> m_bindings;          // by name, innermost block declaration
+        std::vector<const Declaration *> m_parameterBindings; // by name, parameters of the current function
+        std::vector<NameId> m_parameters;                     // parameters of the current function
+        std::vector<Undo> m_undoLog;
+        std::vector<std::size_t> m_scopeMarks;
+        std::vector<std::uint32_t> m_labelDepths;             // by name, enclosing blocks with that label
+
+        std::deque<Declaration> m_declarations;
+        std::unordered_map<const ASTNode::ExpressionName *, const Declaration *> m_resolutions;
+        std::unordered_map<const ASTNode::Statement *, const Declaration *> m_definitions;
+    };
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SourcePosition.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Register-based bytecode of the compile-time expression evaluator (CTEE).
+    //
+    // Every value is made of 64-bit slots, structs are flattened into consecutive registers.
+    // Integers are computed in 64 bits and then sign or zero extended from their width,
+    // so they wrap exactly like their primitive type. Floats are stored as f64 bits,
+    // f32 results are rounded to f32 after every operation.
+    //
+    // A call's arguments are the top registers of the caller, they become the first registers
+    // of the callee's frame, so calls copy nothing but the returned value.
+    //
+    class Bytecode {
+    public:
+        using Reg = std::uint32_t;
+        using Slot = std::uint64_t;
+
+    #define RY_BYTECODE__OPS_E_ENUM(NAME) NAME,
+    #define RY_BYTECODE__OPS(E) /* E - expand macro */ \
+        E(LoadImm)    /* a = b | c << 32              */ \
+        E(Move)       /* a = b                        */ \
+        E(MoveN)      /* a..a+c = b..b+c              */ \
+        \
+        E(Add) E(Sub) E(Mul)  /* a = b op c, integer  */ \
+        E(DivS) E(DivU) E(ModS) E(ModU) \
+        E(And) E(Or) E(Xor) \
+        E(Shl) E(ShrS) E(ShrU) \
+        E(Neg) E(Not)         /* a = op b             */ \
+        \
+        E(FAdd) E(FSub) E(FMul) E(FDiv) E(FMod) \
+        E(FNeg) \
+        \
+        E(Eq) E(Ne)           /* a = b op c, bool     */ \
+        E(LtS) E(LeS) E(LtU) E(LeU) \
+        E(FEq) E(FNe) E(FLt) E(FLe) \
+        E(LogicalNot)         /* a = !b               */ \
+        \
+        E(Jump)               /* pc = a               */ \
+        E(JumpIf)             /* if b: pc = a         */ \
+        E(JumpIfNot)          /* if !b: pc = a        */ \
+        E(Call)               /* a..a+n = function b, with arguments from c */ \
+        E(Return)             /* return a..a+b        */
+
+        enum class Op : std::uint8_t {
+            RY_BYTECODE__OPS(RY_BYTECODE__OPS_E_ENUM)
+        };
+
+    #undef RY_BYTECODE__OPS_E_ENUM
+
+        struct Instruction {
+            Op op;
+            std::uint8_t width;    // integers: 1 (bool) 8 16 32 64 bits, floats: 32 64
+            bool isSigned;
+            std::uint8_t reserved = 0;
+            Reg a, b, c;
+        };
+
+        struct Function {
+            std::string name;
+            std::uint32_t numParameterSlots = 0;
+            std::uint32_t numReturnSlots = 0;
+            std::uint32_t numRegisters = 0;
+            std::vector<Instruction> code;
+            std::vector<std::optional<SourcePosition>> srcPositions; // by instruction, of the expression it computes
+        };
+
+        // Sign or zero extends the low width bits of the value
+        static Slot Normalize(Slot value, std::uint8_t width, bool isSigned) {
+            if(width >= 64)
+                return value;
+            unsigned shift = 64 - width;
+            if(isSigned)
+                return Slot(std::int64_t(value << shift) >> shift);
+            return (value << shift) >> shift;
+        }
+
+        static double ToFloat(Slot value) {
+            return std::bit_cast<double>(value);
+        }
+        // f32 values are f64s rounded to f32
+        static Slot FromFloat(double value, std::uint8_t width) {
+            if(width == 32)
+                value = double(float(value));
+            return std::bit_cast<Slot>(value);
+        }
+    };
+
+}
@@ -0,0 +1,109 @@
+#include "CodeWriter.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace ry {
+
+    CodeWriter::CodeWriter() {}
+
+    CodeWriter::~CodeWriter() {
+        Close();
+    }
+
+    bool CodeWriter::Open(const std::string& path, std::size_t bufferSize) {
+        Close();
+        m_file = std::fopen(path.c_str(), "wb");
+        if(!m_file)
+            return false;
+        m_buffer.clear();
+        m_buffer.reserve(bufferSize);
+        m_bufferSize = bufferSize;
+        m_numFlushedBytes = 0;
+        m_isOk = true;
+        return true;
+    }
+
+    bool CodeWriter::Close() {
+        if(!m_file)
+            return m_isOk;
+        flush();
+        m_isOk = (std::fclose(m_file) == 0) && m_isOk;
+        m_file = nullptr;
+        return m_isOk;
+    }
+
+    void CodeWriter::Write(std::string_view str) {
+        if(m_file && m_buffer.size() + str.size() > m_bufferSize) {
+            flush();
+            // larger than the buffer, written as is
+            if(str.size() > m_bufferSize) {
+                m_isOk = std::fwrite(str.data(), 1, str.size(), m_file) == str.size() && m_isOk;
+                m_numFlushedBytes += str.size();
+                return;
+            }
+        }
+        m_buffer.append(str);
+    }
+
+    void CodeWriter::Write(char c) {
+        reserve(1);
+        m_buffer.push_back(c);
+    }
+
+    void CodeWriter::WriteInt(std::int64_t value) {
+        char chars[24];
+        auto result = std::to_chars(chars, chars + sizeof(chars), value);
+        Write(std::string_view(chars, std::size_t(result.ptr - chars)));
+    }
+
+    void CodeWriter::WriteUInt(std::uint64_t value) {
+        char chars[24];
+        auto result = std::to_chars(chars, chars + sizeof(chars), value);
+        Write(std::string_view(chars, std::size_t(result.ptr - chars)));
+    }
+
+    void CodeWriter::WriteFloat(double value) {
+        char chars[40];
+        auto result = std::to_chars(chars, chars + sizeof(chars) - 2, value);
+        std::size_t size = std::size_t(result.ptr - chars);
+        if(!std::memchr(chars, '.', size) && !std::memchr(chars, 'e', size)) {
+            chars[size++] = '.';
+            chars[size++] = '0';
+        }
+        Write(std::string_view(chars, size));
+    }
+
+    void CodeWriter::WriteFloat(float value) {
+        char chars[32];
+        auto result = std::to_chars(chars, chars + sizeof(chars) - 2, value);
+        std::size_t size = std::size_t(result.ptr - chars);
+        if(!std::memchr(chars, '.', size) && !std::memchr(chars, 'e', size)) {
+            chars[size++] = '.';
+            chars[size++] = '0';
+        }
+        Write(std::string_view(chars, size));
+    }
+
+    std::string_view CodeWriter::GetText() const {
+        return m_buffer;
+    }
+
+    std::size_t CodeWriter::GetSize() const {
+        return m_numFlushedBytes + m_buffer.size();
+    }
+
+    void CodeWriter::reserve(std::size_t size) {
+        if(m_file && m_buffer.size() + size > m_bufferSize)
+            flush();
+    }
+
+    void CodeWriter::flush() {
+        if(!m_file || m_buffer.empty())
+            return;
+        m_isOk = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size() && m_isOk;
+        m_numFlushedBytes += m_buffer.size();
+        m_buffer.clear();
+    }
+
+}
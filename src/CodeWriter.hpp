@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace ry {
+
+    //
+    // Buffered output of generated code.
+    //
+    // Text is appended to one fixed-size buffer that is written out whenever it fills up,
+    // so a file of any size takes a single allocation and a few large writes, and numbers
+    // are formatted in place. A writer without a file keeps everything in memory.
+    //
+    class CodeWriter {
+    public:
+        static constexpr std::size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+        // In memory
+        CodeWriter();
+        CodeWriter(const CodeWriter&) = delete;
+        ~CodeWriter();
+
+        CodeWriter& operator=(const CodeWriter&) = delete;
+
+        // Truncates the file, false if it can not be created
+        bool Open(const std::string& path, std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+        // Flushes and closes the file, false if any write failed
+        bool Close();
+
+        void Write(std::string_view str);
+        void Write(char c);
+        void WriteInt(std::int64_t value);
+        void WriteUInt(std::uint64_t value);
+        // Finite values, as the shortest text that reads back as the same value, with a '.' or an exponent
+        void WriteFloat(double value);
+        void WriteFloat(float value);
+
+        // Everything written so far, in memory only
+        std::string_view GetText() const;
+        std::size_t GetSize() const; // bytes written
+
+    private:
+        void reserve(std::size_t size);
+        void flush();
+
+        std::FILE * m_file = nullptr;
+        std::string m_buffer;
+        std::size_t m_bufferSize = 0;
+        std::size_t m_numFlushedBytes = 0;
+        bool m_isOk = true;
+    };
+
+}
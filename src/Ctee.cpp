@@ -0,0 +1,1248 @@
+#include "Ctee.hpp"
+#include "Trace.hpp"
+#include "ry.hpp"
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <span>
+#include <utility>
+#include <variant>
+
+namespace ry {
+
+    using TypeId = Ctee::TypeId;
+    using Declaration = Ctee::Declaration;
+    using Slot = Bytecode::Slot;
+    using Reg = Bytecode::Reg;
+    using Op = Bytecode::Op;
+    using TypeKind = TypeInterner::Kind;
+    using Primitive = ASTNode::TypePrimitive;
+    using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+
+    /*
+     *
+     * Compiler
+     *
+     */
+
+    // Compiles one function, or one evaluated expression, to bytecode
+    class Ctee::Compiler {
+    public:
+        Compiler(Ctee& ctee, std::string_view name);
+
+        bool CompileFunction(const ASTNode::TypeFunction& function, TypeId type, const ASTNode::Expression& body);
+        bool CompileExpression(const ASTNode::Expression& expr, std::uint32_t numSlots);
+
+        Bytecode::Function Take();
+
+    private:
+        // A block or loop that can be broken out of
+        struct Target {
+            const ASTNode::ExpressionBlock::Label * label;
+            bool isLoop;
+            Reg value;
+            std::uint32_t numSlots;
+            std::vector<std::uint32_t> breaks;    // jumps to its end
+            std::vector<std::uint32_t> continues; // jumps to the post statement
+        };
+
+        // Registers of a local variable, or of a part of it
+        struct Place {
+            Reg reg;
+            TypeId type;
+        };
+
+        bool error(std::string_view msg, const std::optional<SourcePosition>& srcPos);
+
+        Reg allocate(std::uint32_t numSlots);
+        std::uint32_t emit(Op op, Reg a, Reg b = 0, Reg c = 0, const std::optional<Scalar>& scalar = {});
+        void emitLoad(Reg dst, Slot value);
+        void emitMove(Reg dst, Reg src, std::uint32_t numSlots);
+        void emitBinary(BinOpKind kind, const Scalar& scalar, Reg dst, Reg first, Reg second);
+        void patch(const std::vector<std::uint32_t>& jumps, std::uint32_t pc);
+
+        std::optional<TypeId> getType(const ASTNode::Expression& expr) const;
+        std::optional<std::uint32_t> getSlotCount(TypeId type, const std::optional<SourcePosition>& srcPos);
+        std::optional<Scalar> getScalar(TypeId type, const std::optional<SourcePosition>& srcPos);
+        std::optional<FieldSlots> getField(TypeId type, const ASTNode::Expression& member);
+
+        std::optional<Reg> getLocal(const Declaration& decl) const;
+        std::optional<Place> getPlace(const ASTNode::Expression& expr);
+        std::optional<Place> compileLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos);
+
+        bool compileStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults, Reg dst);
+        bool compileExpression(const ASTNode::Expression& expr, Reg dst);
+        bool compileExpressionData(const ASTNode::Expression& expr, TypeId type, Reg dst);
+        bool compileDiscarded(const ASTNode::Expression& expr);
+        bool compileStatementValue(const ASTNode::Statement& stmt, Reg dst, std::uint32_t numSlots);
+        bool compileStatement(const ASTNode::Statement& stmt);
+
+        Ctee& m_ctee;
+        Bytecode::Function m_function;
+        Reg m_nextReg = 0;
+        std::optional<SourcePosition> m_srcPos; // of the expression being compiled
+
+        std::unordered_map<std::uint32_t, Reg> m_locals; // by declaration id
+        std::map<std::pair<const ASTNode::TypeStruct::NamedField *, std::string_view>, Reg> m_parameters;
+        std::vector<Target> m_targets;
+    };
+
+    Ctee::Compiler::Compiler(Ctee& ctee, std::string_view name):
+        m_ctee(ctee)
+    {
+        m_function.name = name;
+    }
+
+    bool Ctee::Compiler::CompileFunction(const ASTNode::TypeFunction& function, TypeId type, const ASTNode::Expression& body) {
+        const TypeInterner::TypeInfo& info = m_ctee.m_types.Get(type);
+        auto numParameterSlots = getSlotCount(info.arguments, body.GetSourcePosition());
+        auto numReturnSlots = getSlotCount(info.pointee, body.GetSourcePosition());
+        if(!numParameterSlots || !numReturnSlots)
+            return false;
+
+        // parameters are the first registers, in the order of the arguments type
+        std::vector<FieldSlots> fields = m_ctee.getFieldSlots(info.arguments);
+        std::size_t fieldIdx = 0;
+        for(const ASTNode::TypeStruct::Field& field : function.GetArgumentsType().GetFields()) {
+            std::visit(overloaded{
+                [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                    for(std::string_view name : namedField.GetNames())
+                        m_parameters[{&namedField, name}] = fields[fieldIdx++].offset;
+                },
+                [&](const ASTNode::TypeStruct::UnnamedField&) {
+                    fieldIdx++;
+                }
+            }, field);
+        }
+
+        m_function.numParameterSlots = numParameterSlots.value();
+        m_function.numReturnSlots = numReturnSlots.value();
+        allocate(numParameterSlots.value());
+        Reg value = allocate(numReturnSlots.value());
+        if(!compileExpression(body, value))
+            return false;
+        emit(Op::Return, value, numReturnSlots.value());
+        return true;
+    }
+
+    bool Ctee::Compiler::CompileExpression(const ASTNode::Expression& expr, std::uint32_t numSlots) {
+        m_function.numReturnSlots = numSlots;
+        Reg value = allocate(numSlots);
+        if(!compileExpression(expr, value))
+            return false;
+        emit(Op::Return, value, numSlots);
+        return true;
+    }
+
+    Bytecode::Function Ctee::Compiler::Take() {
+        return std::move(m_function);
+    }
+
+    bool Ctee::Compiler::error(std::string_view msg, const std::optional<SourcePosition>& srcPos) {
+        m_ctee.error(msg, srcPos);
+        return false;
+    }
+
+    Reg Ctee::Compiler::allocate(std::uint32_t numSlots) {
+        Reg reg = m_nextReg;
+        m_nextReg += numSlots;
+        m_function.numRegisters = std::max(m_function.numRegisters, m_nextReg);
+        return reg;
+    }
+
+    std::uint32_t Ctee::Compiler::emit(Op op, Reg a, Reg b, Reg c, const std::optional<Scalar>& scalar) {
+        Bytecode::Instruction ins{op, 64, false, 0, 0, 0, 0};
+        if(scalar) {
+            ins.width = scalar->width;
+            ins.isSigned = scalar->isSigned;
+        }
+        ins.a = a;
+        ins.b = b;
+        ins.c = c;
+        m_function.code.push_back(ins);
+        m_function.srcPositions.push_back(m_srcPos);
+        return std::uint32_t(m_function.code.size() - 1);
+    }
+
+    void Ctee::Compiler::emitLoad(Reg dst, Slot value) {
+        emit(Op::LoadImm, dst, Reg(value), Reg(value >> 32));
+    }
+
+    void Ctee::Compiler::emitMove(Reg dst, Reg src, std::uint32_t numSlots) {
+        if(numSlots == 1)
+            emit(Op::Move, dst, src);
+        else if(numSlots > 1)
+            emit(Op::MoveN, dst, src, numSlots);
+    }
+
+    void Ctee::Compiler::emitBinary(BinOpKind kind, const Scalar& scalar, Reg dst, Reg first, Reg second) {
+        auto pick = [&](Op floatOp, Op signedOp, Op unsignedOp) {
+            return scalar.isFloat ? floatOp : scalar.isSigned ? signedOp : unsignedOp;
+        };
+
+        Op op = Op::Add;
+        bool isSwapped = false; // a > b is b < a
+        switch(kind) {
+            case BinOpKind::Add:        op = pick(Op::FAdd, Op::Add, Op::Add); break;
+            case BinOpKind::Sub:        op = pick(Op::FSub, Op::Sub, Op::Sub); break;
+            case BinOpKind::Mul:        op = pick(Op::FMul, Op::Mul, Op::Mul); break;
+            case BinOpKind::Div:        op = pick(Op::FDiv, Op::DivS, Op::DivU); break;
+            case BinOpKind::Mod:        op = pick(Op::FMod, Op::ModS, Op::ModU); break;
+            case BinOpKind::BitOr:      op = Op::Or; break;
+            case BinOpKind::BitXor:     op = Op::Xor; break;
+            case BinOpKind::BitAnd:     op = Op::And; break;
+            case BinOpKind::BitLShift:  op = Op::Shl; break;
+            case BinOpKind::BitRShift:  op = pick(Op::ShrS, Op::ShrS, Op::ShrU); break;
+            case BinOpKind::Eq:         op = pick(Op::FEq, Op::Eq, Op::Eq); break;
+            case BinOpKind::Uneq:       op = pick(Op::FNe, Op::Ne, Op::Ne); break;
+            case BinOpKind::Less:       op = pick(Op::FLt, Op::LtS, Op::LtU); break;
+            case BinOpKind::LessEqual:  op = pick(Op::FLe, Op::LeS, Op::LeU); break;
+            case BinOpKind::Great:      op = pick(Op::FLt, Op::LtS, Op::LtU); isSwapped = true; break;
+            case BinOpKind::GreatEqual: op = pick(Op::FLe, Op::LeS, Op::LeU); isSwapped = true; break;
+            default: break;
+        }
+        if(isSwapped)
+            std::swap(first, second);
+        emit(op, dst, first, second, scalar);
+    }
+
+    void Ctee::Compiler::patch(const std::vector<std::uint32_t>& jumps, std::uint32_t pc) {
+        for(std::uint32_t jump : jumps)
+            m_function.code[jump].a = pc;
+    }
+
+    // Expressions without a type failed to type, that is reported by the typer
+    std::optional<TypeId> Ctee::Compiler::getType(const ASTNode::Expression& expr) const {
+        return m_ctee.m_typer.GetType(expr);
+    }
+
+    std::optional<std::uint32_t> Ctee::Compiler::getSlotCount(TypeId type, const std::optional<SourcePosition>& srcPos) {
+        auto numSlots = m_ctee.getSlotCount(type);
+        if(!numSlots)
+            error(std::format("Values of type {} are not supported at compile time", m_ctee.m_types.StringifyPretty(type)), srcPos);
+        return numSlots;
+    }
+
+    std::optional<Ctee::Scalar> Ctee::Compiler::getScalar(TypeId type, const std::optional<SourcePosition>& srcPos) {
+        auto scalar = m_ctee.getScalar(type);
+        if(!scalar)
+            error(std::format("Operations on {} are not supported at compile time", m_ctee.m_types.StringifyPretty(type)), srcPos);
+        return scalar;
+    }
+
+    std::optional<Ctee::FieldSlots> Ctee::Compiler::getField(TypeId type, const ASTNode::Expression& member) {
+        auto name = std::get_if<ASTNode::ExpressionName>(&member.Get());
+        if(!name || m_ctee.m_types.Get(type).kind != TypeKind::Struct)
+            return {};
+        for(const FieldSlots& field : m_ctee.getFieldSlots(type))
+            if(field.name == *name)
+                return field;
+        return {};
+    }
+
+    std::optional<Reg> Ctee::Compiler::getLocal(const Declaration& decl) const {
+        if(decl.kind == Declaration::Kind::Parameter) {
+            auto it = m_parameters.find({decl.parameter, decl.name});
+            if(it != m_parameters.end())
+                return it->second;
+            return {};
+        }
+        auto it = m_locals.find(decl.id);
+        if(it != m_locals.end())
+            return it->second;
+        return {};
+    }
+
+    // Registers of a local variable or of its members, none if the expression is not one
+    std::optional<Ctee::Compiler::Place> Ctee::Compiler::getPlace(const ASTNode::Expression& expr) {
+        if(auto name = std::get_if<ASTNode::ExpressionName>(&expr.Get())) {
+            const Declaration * decl = m_ctee.m_analyzer.GetDeclaration(*name);
+            auto type = getType(expr);
+            if(!decl || !type)
+                return {};
+            if(auto reg = getLocal(*decl))
+                return Place{reg.value(), type.value()};
+            return {};
+        }
+        if(auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&expr.Get())) {
+            if(binOp->GetKind() != BinOpKind::StructMemberAccess)
+                return {};
+            auto object = getPlace(*binOp->GetOperands().first);
+            if(!object)
+                return {};
+            if(auto field = getField(object->type, *binOp->GetOperands().second))
+                return Place{object->reg + field->offset, field->type};
+        }
+        return {};
+    }
+
+    std::optional<Ctee::Compiler::Place> Ctee::Compiler::compileLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos) {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) -> std::optional<Place> {
+                const Declaration * decl = m_ctee.m_analyzer.GetDeclaration(name);
+                if(!decl)
+                    return {};
+                auto reg = getLocal(*decl);
+                auto type = m_ctee.m_typer.GetType(*decl);
+                if(!reg) {
+                    error(std::format("\"{}\" can not be assigned at compile time, it is not a local variable", name), srcPos);
+                    return {};
+                }
+                if(!type)
+                    return {};
+                return Place{reg.value(), type.value()};
+            },
+            [&](const ASTNode::Expression::PointerDereference&) -> std::optional<Place> {
+                error("Pointers are not supported at compile time", srcPos);
+                return {};
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) -> std::optional<Place> {
+                auto object = getPlace(*operands.first);
+                if(!object) {
+                    error("Only members of local variables can be assigned at compile time", operands.first->GetSourcePosition());
+                    return {};
+                }
+                return getField(object->type, *operands.second)
+                    .transform([&](const FieldSlots& field) { return Place{object->reg + field.offset, field.type}; });
+            }
+        }, lvalue);
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    // Fields are matched by name or position, like the typer does,
+    // the missing ones take their default value if there is one, or zero
+    bool Ctee::Compiler::compileStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults, Reg dst) {
+        std::vector<FieldSlots> fields = m_ctee.getFieldSlots(type);
+
+        // the AST fields are those of the interned type, whose repetitions are expanded in fields
+        std::vector<const ASTNode::Expression *> defaultValues(fields.size(), nullptr);
+        if(defaults) {
+            std::span<const TypeInterner::Field> typeFields = m_ctee.m_types.GetFields(type);
+            std::size_t typeFieldIdx = 0;
+            std::size_t fieldIdx = 0;
+            auto setDefault = [&](const ASTNode::TypeStruct::FieldDefaultValue& defaultValue) {
+                if(typeFieldIdx >= typeFields.size())
+                    return;
+                for(std::uint64_t rep = 0; rep < typeFields[typeFieldIdx].reps && fieldIdx < fields.size(); rep++)
+                    defaultValues[fieldIdx++] = defaultValue ? defaultValue.value().get() : nullptr;
+                typeFieldIdx++;
+            };
+            for(const ASTNode::TypeStruct::Field& field : defaults->GetFields()) {
+                std::visit(overloaded{
+                    [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                        for(std::size_t i = 0; i < namedField.GetNames().size(); i++)
+                            setDefault(namedField.GetDefaultValue());
+                    },
+                    [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                        setDefault(unnamedField.GetDefaultValue());
+                    }
+                }, field);
+            }
+        }
+
+        std::vector<bool> isSet(fields.size(), false);
+        std::size_t fieldIdx = 0;
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields()) {
+            if(field.GetName()) {
+                auto it = std::find_if(fields.begin(), fields.end(), [&](const FieldSlots& typeField) {
+                    return typeField.name == field.GetName().value();
+                });
+                fieldIdx = std::size_t(it - fields.begin());
+            }
+            if(fieldIdx >= fields.size())
+                return false; // reported by the typer
+            Reg mark = m_nextReg;
+            if(!compileExpression(*field.GetValue(), dst + fields[fieldIdx].offset))
+                return false;
+            m_nextReg = mark;
+            isSet[fieldIdx++] = true;
+        }
+
+        for(std::size_t i = 0; i < fields.size(); i++) {
+            if(isSet[i])
+                continue;
+            Reg mark = m_nextReg;
+            if(defaultValues[i]) {
+                if(!compileExpression(*defaultValues[i], dst + fields[i].offset))
+                    return false;
+            }
+            else {
+                auto numSlots = getSlotCount(fields[i].type, m_srcPos);
+                if(!numSlots)
+                    return false;
+                for(std::uint32_t slot = 0; slot < numSlots.value(); slot++)
+                    emitLoad(dst + fields[i].offset + slot, 0);
+            }
+            m_nextReg = mark;
+        }
+        return true;
+    }
+
+    bool Ctee::Compiler::compileExpression(const ASTNode::Expression& expr, Reg dst) {
+        auto type = getType(expr);
+        if(!type)
+            return false;
+        std::optional<SourcePosition> srcPos = m_srcPos;
+        if(expr.GetSourcePosition())
+            m_srcPos = expr.GetSourcePosition();
+        bool isOk = compileExpressionData(expr, type.value(), dst);
+        m_srcPos = srcPos;
+        return isOk;
+    }
+
+    bool Ctee::Compiler::compileExpressionData(const ASTNode::Expression& expr, TypeId type, Reg dst) {
+        using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+
+        const std::optional<SourcePosition>& srcPos = expr.GetSourcePosition();
+        auto numSlots = getSlotCount(type, srcPos);
+        if(!numSlots)
+            return false;
+
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) -> bool {
+                if(!literal.Get())
+                    return error("null is not supported at compile time", srcPos);
+                auto loadNumber = [&](auto value) {
+                    auto scalar = getScalar(type, srcPos);
+                    if(!scalar)
+                        return false;
+                    if(scalar->isFloat)
+                        emitLoad(dst, Bytecode::FromFloat(double(value), scalar->width));
+                    else
+                        emitLoad(dst, Bytecode::Normalize(Slot(value), scalar->width, scalar->isSigned));
+                    return true;
+                };
+                return std::visit(overloaded{
+                    [&](ASTNode::ExpressionLiteral::Int value)   { return loadNumber(value); },
+                    [&](ASTNode::ExpressionLiteral::Float value) { return loadNumber(value); },
+                    [&](const ASTNode::ExpressionLiteral::String&) {
+                        return error("Strings are not supported at compile time", srcPos);
+                    },
+                    [&](ASTNode::ExpressionLiteral::Char value) {
+                        emitLoad(dst, Slot(std::uint8_t(value)));
+                        return true;
+                    },
+                    [&](ASTNode::ExpressionLiteral::Bool value) {
+                        emitLoad(dst, Slot(value));
+                        return true;
+                    },
+                    [&](const ASTNode::ExpressionLiteral::Struct& structLit) {
+                        return compileStructLiteral(structLit, type, nullptr, dst);
+                    }
+                }, literal.Get().value());
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) -> bool {
+                const ASTNode::Expression& functionExpr = *funcCall.GetFunction();
+                auto name = std::get_if<ASTNode::ExpressionName>(&functionExpr.Get());
+                if(!name)
+                    return error("Only functions called by name can be evaluated at compile time", functionExpr.GetSourcePosition());
+                const Declaration * decl = m_ctee.m_analyzer.GetDeclaration(*name);
+                if(!decl)
+                    return false; // reported by the analyzer
+                const ASTNode::StatementTypedVariableDefinition * definition = getFunctionDefinition(*decl);
+                auto functionType = m_ctee.m_typer.GetType(*decl);
+                if(!definition)
+                    return error(std::format("\"{}\" is not a function known at compile time", *name), functionExpr.GetSourcePosition());
+                if(!functionType)
+                    return false;
+
+                TypeId argumentsType = m_ctee.m_types.Get(functionType.value()).arguments;
+                auto numArgumentSlots = getSlotCount(argumentsType, srcPos);
+                auto functionIdx = m_ctee.getFunction(*decl, functionExpr.GetSourcePosition());
+                if(!numArgumentSlots || !functionIdx)
+                    return false;
+
+                // the arguments are the top registers, the callee's frame starts with them
+                const auto& function = std::get<ASTNode::TypeFunction>(definition->GetType().Get());
+                Reg arguments = allocate(numArgumentSlots.value());
+                if(!compileStructLiteral(funcCall.GetParameters(), argumentsType, &function.GetArgumentsType(), arguments))
+                    return false;
+                emit(Op::Call, dst, functionIdx.value(), arguments);
+                return true;
+            },
+            [&](const ASTNode::ExpressionBlock& block) -> bool {
+                Reg mark = m_nextReg;
+                m_targets.push_back(Target{&block.GetLabel(), false, dst, numSlots.value(), {}, {}});
+                for(const ASTNode::Statement& stmt : block.GetStatements()) {
+                    if(!compileStatement(stmt)) {
+                        m_targets.pop_back();
+                        return false;
+                    }
+                }
+                patch(m_targets.back().breaks, std::uint32_t(m_function.code.size()));
+                m_targets.pop_back();
+                m_nextReg = mark;
+                return true;
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) -> bool {
+                Reg condition = allocate(1);
+                if(!compileExpression(*ifExpr.GetCondition(), condition))
+                    return false;
+                std::uint32_t failJump = emit(Op::JumpIfNot, 0, condition);
+                m_nextReg = condition;
+
+                if(!compileStatementValue(*ifExpr.GetSuccessStatement(), dst, numSlots.value()))
+                    return false;
+                m_nextReg = condition;
+                if(!ifExpr.GetFailStatement()) {
+                    patch({failJump}, std::uint32_t(m_function.code.size()));
+                    return true;
+                }
+                std::uint32_t endJump = emit(Op::Jump, 0);
+                patch({failJump}, std::uint32_t(m_function.code.size()));
+                if(!compileStatementValue(*ifExpr.GetFailStatement().value(), dst, numSlots.value()))
+                    return false;
+                m_nextReg = condition;
+                patch({endJump}, std::uint32_t(m_function.code.size()));
+                return true;
+            },
+            [&](const ASTNode::ExpressionLoop& loop) -> bool {
+                Reg mark = m_nextReg;
+                if(loop.GetInitStatement() && !compileStatement(*loop.GetInitStatement().value()))
+                    return false;
+
+                std::uint32_t start = std::uint32_t(m_function.code.size());
+                std::vector<std::uint32_t> endJumps;
+                if(loop.GetCondition()) {
+                    Reg condition = allocate(1);
+                    if(!compileExpression(*loop.GetCondition().value(), condition))
+                        return false;
+                    endJumps.push_back(emit(Op::JumpIfNot, 0, condition));
+                    m_nextReg = condition;
+                }
+
+                m_targets.push_back(Target{nullptr, true, dst, numSlots.value(), {}, {}});
+                if(!compileStatement(*loop.GetBodyStatement())) {
+                    m_targets.pop_back();
+                    return false;
+                }
+                patch(m_targets.back().continues, std::uint32_t(m_function.code.size()));
+                if(loop.GetPostStatement() && !compileStatement(*loop.GetPostStatement().value())) {
+                    m_targets.pop_back();
+                    return false;
+                }
+                emit(Op::Jump, start);
+
+                std::uint32_t end = std::uint32_t(m_function.code.size());
+                patch(endJumps, end);
+                patch(m_targets.back().breaks, end);
+                m_targets.pop_back();
+                m_nextReg = mark;
+                return true;
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) -> bool {
+                const ASTNode::Expression& operandExpr = *unaryOp.GetOperand();
+                switch(unaryOp.GetKind()) {
+                    case UnOpKind::AddressOf:
+                    case UnOpKind::PointerDereference:
+                        return error("Pointers are not supported at compile time", srcPos);
+                    case UnOpKind::Comp:
+                        return compileExpression(operandExpr, dst);
+                    default:
+                        break;
+                }
+
+                auto scalar = getScalar(type, srcPos);
+                if(!scalar || !compileExpression(operandExpr, dst))
+                    return false;
+                switch(unaryOp.GetKind()) {
+                    case UnOpKind::ArithmeticNegation:
+                        emit(scalar->isFloat ? Op::FNeg : Op::Neg, dst, dst, 0, scalar);
+                        break;
+                    case UnOpKind::BitwiseNegation:
+                        emit(Op::Not, dst, dst, 0, scalar);
+                        break;
+                    case UnOpKind::LogicalNegation:
+                        emit(Op::LogicalNot, dst, dst);
+                        break;
+                    default:
+                        break;
+                }
+                return true;
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) -> bool {
+                const ASTNode::Expression& firstExpr = *binOp.GetOperands().first;
+                const ASTNode::Expression& secondExpr = *binOp.GetOperands().second;
+                switch(binOp.GetKind()) {
+                    case BinOpKind::StructMemberAccess: {
+                        if(auto place = getPlace(expr)) {
+                            emitMove(dst, place->reg, numSlots.value());
+                            return true;
+                        }
+                        auto objectType = getType(firstExpr);
+                        if(!objectType)
+                            return false;
+                        auto numObjectSlots = getSlotCount(objectType.value(), firstExpr.GetSourcePosition());
+                        auto field = getField(objectType.value(), secondExpr);
+                        if(!numObjectSlots || !field)
+                            return false;
+                        Reg object = allocate(numObjectSlots.value());
+                        if(!compileExpression(firstExpr, object))
+                            return false;
+                        emitMove(dst, object + field->offset, numSlots.value());
+                        return true;
+                    }
+                    case BinOpKind::TypeCast:
+                        return error("Type casts are not supported at compile time", srcPos);
+                    case BinOpKind::Or:
+                    case BinOpKind::And: {
+                        if(!compileExpression(firstExpr, dst))
+                            return false;
+                        std::uint32_t jump = emit(binOp.GetKind() == BinOpKind::And ? Op::JumpIfNot : Op::JumpIf, 0, dst);
+                        if(!compileExpression(secondExpr, dst))
+                            return false;
+                        patch({jump}, std::uint32_t(m_function.code.size()));
+                        return true;
+                    }
+                    default:
+                        break;
+                }
+
+                // the operands' type, comparisons are bools
+                auto operandType = getType(firstExpr);
+                if(!operandType)
+                    return false;
+                auto scalar = getScalar(operandType.value(), firstExpr.GetSourcePosition());
+                if(!scalar || !compileExpression(firstExpr, dst))
+                    return false;
+                Reg second = allocate(1);
+                if(!compileExpression(secondExpr, second))
+                    return false;
+                emitBinary(binOp.GetKind(), scalar.value(), dst, dst, second);
+                return true;
+            },
+            [&](const ASTNode::ExpressionName& name) -> bool {
+                const Declaration * decl = m_ctee.m_analyzer.GetDeclaration(name);
+                if(!decl)
+                    return false; // reported by the analyzer
+                if(auto reg = getLocal(*decl)) {
+                    emitMove(dst, reg.value(), numSlots.value());
+                    return true;
+                }
+                if(decl->kind == Declaration::Kind::Parameter)
+                    return error(std::format("\"{}\" is not known at compile time", name), srcPos);
+                const Value * value = m_ctee.getGlobal(*decl, srcPos);
+                if(!value)
+                    return false;
+                for(std::uint32_t slot = 0; slot < value->slots.size(); slot++)
+                    emitLoad(dst + slot, value->slots[slot]);
+                return true;
+            }
+        }, expr.Get());
+    }
+
+    bool Ctee::Compiler::compileDiscarded(const ASTNode::Expression& expr) {
+        auto type = getType(expr);
+        if(!type)
+            return false;
+        auto numSlots = getSlotCount(type.value(), expr.GetSourcePosition());
+        if(!numSlots)
+            return false;
+        Reg mark = m_nextReg;
+        bool isOk = compileExpression(expr, allocate(numSlots.value()));
+        m_nextReg = mark;
+        return isOk;
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    // Only expression statements have a value
+    bool Ctee::Compiler::compileStatementValue(const ASTNode::Statement& stmt, Reg dst, std::uint32_t numSlots) {
+        if(auto expr = std::get_if<ASTNode::StatementExpression>(&stmt.Get()); expr && numSlots > 0)
+            return compileExpression(*expr, dst);
+        return compileStatement(stmt);
+    }
+
+    bool Ctee::Compiler::compileStatement(const ASTNode::Statement& stmt) {
+        using StmtBinOpKind = ASTNode::StatementBinaryOperation::Kind;
+
+        const std::optional<SourcePosition>& srcPos = stmt.GetSourcePosition();
+        Reg mark = m_nextReg;
+
+        bool isOk = std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                return compileDiscarded(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                auto place = compileLValue(binOp.GetOperands().first, srcPos);
+                if(!place)
+                    return false;
+                auto scalar = getScalar(place->type, srcPos);
+                if(!scalar)
+                    return false;
+                Reg value = allocate(1);
+                if(!compileExpression(binOp.GetOperands().second, value))
+                    return false;
+
+                BinOpKind kind = BinOpKind::Add;
+                switch(binOp.GetKind()) {
+                    case StmtBinOpKind::AddEq:       kind = BinOpKind::Add; break;
+                    case StmtBinOpKind::SubEq:       kind = BinOpKind::Sub; break;
+                    case StmtBinOpKind::MulEq:       kind = BinOpKind::Mul; break;
+                    case StmtBinOpKind::DivEq:       kind = BinOpKind::Div; break;
+                    case StmtBinOpKind::ModEq:       kind = BinOpKind::Mod; break;
+                    case StmtBinOpKind::BitOrEq:     kind = BinOpKind::BitOr; break;
+                    case StmtBinOpKind::BitXorEq:    kind = BinOpKind::BitXor; break;
+                    case StmtBinOpKind::BitAndEq:    kind = BinOpKind::BitAnd; break;
+                    case StmtBinOpKind::BitLShiftEq: kind = BinOpKind::BitLShift; break;
+                    case StmtBinOpKind::BitRShiftEq: kind = BinOpKind::BitRShift; break;
+                }
+                emitBinary(kind, scalar.value(), place->reg, place->reg, value);
+                return true;
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                const Declaration * decl = m_ctee.m_analyzer.GetDeclaration(stmt);
+                // functions are compiled when they are called
+                if(!decl || getFunctionDefinition(*decl))
+                    return true;
+                auto type = m_ctee.m_typer.GetType(*decl);
+                if(!type)
+                    return false;
+                auto numSlots = getSlotCount(type.value(), srcPos);
+                if(!numSlots)
+                    return false;
+
+                // the local outlives the statement
+                Reg reg = allocate(numSlots.value());
+                mark = m_nextReg;
+
+                bool isOk = std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        if(!typedVarDef.GetValue()) {
+                            for(std::uint32_t slot = 0; slot < numSlots.value(); slot++)
+                                emitLoad(reg + slot, 0);
+                            return true;
+                        }
+                        // struct literals take the defaults of the declared type
+                        const ASTNode::Expression& value = typedVarDef.GetValue().value();
+                        auto literal = std::get_if<ASTNode::ExpressionLiteral>(&value.Get());
+                        auto structType = std::get_if<ASTNode::TypeStruct>(&typedVarDef.GetType().Get());
+                        if(literal && literal->Get() && structType)
+                            if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal->Get().value()))
+                                return compileStructLiteral(*structLit, type.value(), structType, reg);
+                        return compileExpression(value, reg);
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        return compileExpression(untypedVarDef.GetValue(), reg);
+                    }
+                }, varDef);
+                m_locals[decl->id] = reg;
+                return isOk;
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                auto place = compileLValue(assign.GetLValue(), srcPos);
+                if(!place)
+                    return false;
+                auto numSlots = getSlotCount(place->type, srcPos);
+                if(!numSlots)
+                    return false;
+                // the value may read the assigned variable
+                Reg value = allocate(numSlots.value());
+                if(!compileExpression(assign.GetRValue(), value))
+                    return false;
+                emitMove(place->reg, value, numSlots.value());
+                return true;
+            },
+            [&](const ASTNode::StatementContinue&) {
+                for(auto it = m_targets.rbegin(); it != m_targets.rend(); it++) {
+                    if(it->isLoop) {
+                        it->continues.push_back(emit(Op::Jump, 0));
+                        return true;
+                    }
+                }
+                return error("Continue outside of a loop", srcPos);
+            },
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                // a labelled break leaves its block, otherwise the innermost loop, or block if there is none
+                std::size_t targetIdx = m_targets.size();
+                for(std::size_t idx = m_targets.size(); idx-- > 0;) {
+                    const Target& target = m_targets[idx];
+                    if(stmtBreak.GetLabel() ? target.label && *target.label == stmtBreak.GetLabel() : target.isLoop) {
+                        targetIdx = idx;
+                        break;
+                    }
+                }
+                if(targetIdx == m_targets.size() && !stmtBreak.GetLabel() && !m_targets.empty())
+                    targetIdx = m_targets.size() - 1;
+                if(targetIdx == m_targets.size())
+                    return false; // reported by the analyzer and the typer
+
+                if(stmtBreak.GetValue()) {
+                    const ASTNode::Expression& value = stmtBreak.GetValue().value();
+                    Target& target = m_targets[targetIdx];
+                    if(target.numSlots > 0 ? !compileExpression(value, target.value) : !compileDiscarded(value))
+                        return false;
+                }
+                m_targets[targetIdx].breaks.push_back(emit(Op::Jump, 0));
+                return true;
+            }
+        }, stmt.Get());
+
+        m_nextReg = mark;
+        return isOk;
+    }
+
+    /*
+     *
+     * Ctee
+     *
+     */
+
+    Ctee::Ctee(const Infos& infos, const Analyzer& analyzer, const Typer& typer, const TypeInterner& types, const VM::Limits& limits):
+        m_infos(infos),
+        m_analyzer(analyzer),
+        m_typer(typer),
+        m_types(types),
+        m_vm(m_functions, limits)
+    {}
+
+    const Infos& Ctee::GetInfos() const {
+        return m_infos;
+    }
+
+    std::optional<Ctee::Value> Ctee::Evaluate(const ASTNode::Expression& expr) {
+        auto type = m_typer.GetType(expr);
+        if(!type)
+            return {};
+        auto numSlots = getSlotCount(type.value());
+        if(!numSlots) {
+            error(std::format("Values of type {} are not supported at compile time", m_types.StringifyPretty(type.value())), expr.GetSourcePosition());
+            return {};
+        }
+
+        // functions compiled for a failed evaluation may call one that failed, they are dropped
+        std::uint32_t evaluationBase = std::exchange(m_evaluationBase, std::uint32_t(m_functions.size()));
+        auto rollback = [&]() {
+            m_vm.Discard(m_evaluationBase);
+            m_functions.resize(m_evaluationBase);
+            m_functionStates.resize(m_evaluationBase);
+            std::erase_if(m_functionIndices, [&](const auto& entry) { return entry.second >= m_evaluationBase; });
+            m_evaluationBase = evaluationBase;
+        };
+
+        Compiler compiler(*this, "comp");
+        if(!compiler.CompileExpression(expr, numSlots.value())) {
+            rollback();
+            return {};
+        }
+        m_functions.push_back(compiler.Take());
+        m_functionStates.push_back(State::Done);
+
+        Value value{type.value(), {}};
+        VM::Status status = m_vm.Run(std::uint32_t(m_functions.size() - 1), {}, value.slots);
+        if(status != VM::Status::Ok) {
+            // arithmetic errors are reported at the failed operation, exceeded limits at the evaluation
+            std::optional<SourcePosition> srcPos = expr.GetSourcePosition();
+            const auto& location = m_vm.GetErrorLocation();
+            if(location && (status == VM::Status::DivisionByZero || status == VM::Status::ShiftOutOfRange))
+                if(const auto& instructionPos = m_functions[location->function].srcPositions[location->pc])
+                    srcPos = instructionPos;
+            error(std::format("Compile-time evaluation failed: {}", VM::StringifyStatus(status)), srcPos);
+        }
+
+        // the evaluated expression is not kept, the functions it called are
+        m_vm.Discard(std::uint32_t(m_functions.size() - 1));
+        m_functions.pop_back();
+        m_functionStates.pop_back();
+        m_evaluationBase = evaluationBase;
+        if(status != VM::Status::Ok)
+            return {};
+        return value;
+    }
+
+    void Ctee::EvaluateAll(const ASTNode& ast) {
+        std::visit(overloaded{
+            [&](const ASTNode::Type& type)       { evaluateType(type); },
+            [&](const ASTNode::Expression& expr) { evaluateExpression(expr); },
+            [&](const ASTNode::Statement& stmt)  { evaluateStatement(stmt); }
+        }, ast.Get());
+    }
+
+    const std::vector<Ctee::Result>& Ctee::GetResults() const {
+        return m_results;
+    }
+
+    std::size_t Ctee::GetFunctionCount() const {
+        return m_functions.size();
+    }
+
+    std::size_t Ctee::GetInstructionCount() const {
+        std::size_t numInstructions = 0;
+        for(const Bytecode::Function& function : m_functions)
+            numInstructions += function.code.size();
+        return numInstructions;
+    }
+
+    std::uint64_t Ctee::GetStepCount() const {
+        return m_vm.GetStepCount();
+    }
+
+    std::size_t Ctee::GetNativeFunctionCount() const {
+        return m_vm.GetNativeFunctionCount();
+    }
+
+    std::size_t Ctee::GetNativeCodeSize() const {
+        return m_vm.GetNativeCodeSize();
+    }
+
+    std::string Ctee::StringifyValue(const Value& value) const {
+        std::size_t slotIdx = 0;
+        auto stringify = [&](auto& self, TypeId type) -> std::string {
+            const TypeInterner::TypeInfo& info = m_types.Get(type);
+            if(info.kind == TypeKind::Struct) {
+                std::string str = "[";
+                std::span<const TypeInterner::Field> fields = m_types.GetFields(type);
+                for(std::size_t i = 0; i < fields.size(); i++) {
+                    for(std::uint64_t rep = 0; rep < fields[i].reps; rep++) {
+                        if(str.size() > 1)
+                            str += ", ";
+                        if(!fields[i].name.empty())
+                            str += std::string(fields[i].name) + " = ";
+                        str += self(self, fields[i].type);
+                    }
+                }
+                return str + ']';
+            }
+
+            Slot slot = value.slots[slotIdx++];
+            switch(info.primitive) {
+                case Primitive::Bool: return slot ? "true" : "false";
+                case Primitive::Char: return TokenLiteral::StringifyValue(TokenLiteral::Char(slot));
+                case Primitive::F32:
+                case Primitive::F64:  return TokenLiteral::StringifyValue(Bytecode::ToFloat(slot));
+                default: break;
+            }
+            return getScalar(type)->isSigned ? std::to_string(std::int64_t(slot)) : std::to_string(slot);
+        };
+        return stringify(stringify, value.type);
+    }
+
+    std::string Ctee::StringifyResults() const {
+        std::string str;
+        for(const Result& result : m_results) {
+            if(const auto& srcPos = result.expr->GetSourcePosition())
+                str += std::format("{}:{}: ", srcPos->startLine, srcPos->startColumn);
+            str += result.expr->StringifyPretty();
+            str += " = ";
+            str += result.value ? StringifyValue(result.value.value()) : "?";
+            str += '\n';
+        }
+        return str;
+    }
+
+    const ASTNode::StatementTypedVariableDefinition * Ctee::getFunctionDefinition(const Declaration& decl) {
+        if(decl.kind != Declaration::Kind::Variable)
+            return nullptr;
+        auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get());
+        if(!varDef)
+            return nullptr;
+        auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef);
+        if(!typedVarDef || !typedVarDef->GetValue() || !std::holds_alternative<ASTNode::TypeFunction>(typedVarDef->GetType().Get()))
+            return nullptr;
+        return typedVarDef;
+    }
+
+    void Ctee::error(std::string_view msg, const std::optional<SourcePosition>& srcPos) {
+        if(srcPos)
+            m_infos.Push(Infos::Info(Infos::Info::Level::ERROR, msg, srcPos.value()));
+        else
+            m_infos.Push(Infos::Info(Infos::Info::Level::ERROR, msg));
+    }
+
+    std::optional<std::uint32_t> Ctee::getSlotCount(TypeId type) {
+        if(auto it = m_slotCounts.find(type); it != m_slotCounts.end())
+            return it->second;
+
+        std::optional<std::uint32_t> numSlots;
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(info.attribs.isOptional)
+            numSlots = {};
+        else if(info.kind == TypeKind::Primitive)
+            numSlots = getScalar(type) ? std::optional<std::uint32_t>(1) : std::nullopt;
+        else if(info.kind == TypeKind::Struct) {
+            numSlots = 0;
+            for(const TypeInterner::Field& field : m_types.GetFields(type)) {
+                auto fieldSlots = getSlotCount(field.type);
+                if(!fieldSlots || field.reps == TypeInterner::Field::UNKNOWN_REPS) {
+                    numSlots = {};
+                    break;
+                }
+                numSlots = numSlots.value() + std::uint32_t(field.reps) * fieldSlots.value();
+            }
+        }
+        m_slotCounts[type] = numSlots;
+        return numSlots;
+    }
+
+    std::optional<Ctee::Scalar> Ctee::getScalar(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(info.kind != TypeKind::Primitive || info.attribs.isOptional)
+            return {};
+        switch(info.primitive) {
+            case Primitive::Char: return Scalar{8, false, false};
+            case Primitive::I8:   return Scalar{8, true, false};
+            case Primitive::I16:  return Scalar{16, true, false};
+            case Primitive::I32:  return Scalar{32, true, false};
+            case Primitive::I64:  return Scalar{64, true, false};
+            case Primitive::U8:   return Scalar{8, false, false};
+            case Primitive::U16:  return Scalar{16, false, false};
+            case Primitive::U32:  return Scalar{32, false, false};
+            case Primitive::U64:  return Scalar{64, false, false};
+            case Primitive::F32:  return Scalar{32, false, true};
+            case Primitive::F64:  return Scalar{64, false, true};
+            case Primitive::Bool: return Scalar{1, false, false};
+            default: return {}; // 128-bit integers
+        }
+    }
+
+    // The type's slot count must be known
+    std::vector<Ctee::FieldSlots> Ctee::getFieldSlots(TypeId type) {
+        std::vector<FieldSlots> fields;
+        std::uint32_t offset = 0;
+        for(const TypeInterner::Field& field : m_types.GetFields(type)) {
+            std::uint32_t numSlots = getSlotCount(field.type).value_or(0);
+            for(std::uint64_t rep = 0; rep < field.reps; rep++) {
+                fields.push_back(FieldSlots{field.name, field.type, offset});
+                offset += numSlots;
+            }
+        }
+        return fields;
+    }
+
+    // Compiled on first use, recursive calls use the index reserved before the body is compiled
+    std::optional<std::uint32_t> Ctee::getFunction(const Declaration& decl, const std::optional<SourcePosition>& srcPos) {
+        if(m_failedFunctions.contains(decl.id)) {
+            error(std::format("\"{}\" can not be evaluated at compile time", decl.name), srcPos);
+            return {};
+        }
+        if(auto it = m_functionIndices.find(decl.id); it != m_functionIndices.end()) {
+            // a function compiled by an enclosing evaluation can not run before it is done
+            if(it->second < m_evaluationBase && m_functionStates[it->second] == State::InProgress) {
+                error(std::format("Recursive compile-time evaluation of \"{}\"", decl.name), srcPos);
+                return {};
+            }
+            return it->second;
+        }
+
+        auto type = m_typer.GetType(decl);
+        const ASTNode::StatementTypedVariableDefinition * definition = getFunctionDefinition(decl);
+        if(!type || !definition)
+            return {};
+
+        Trace::Scope traceScope("ctee-compile", m_infos.GetId());
+        std::uint32_t idx = std::uint32_t(m_functions.size());
+        m_functions.emplace_back();
+        m_functionStates.push_back(State::InProgress);
+        m_functionIndices[decl.id] = idx;
+
+        Compiler compiler(*this, decl.name);
+        const auto& function = std::get<ASTNode::TypeFunction>(definition->GetType().Get());
+        if(!compiler.CompileFunction(function, type.value(), definition->GetValue().value())) {
+            m_failedFunctions.insert(decl.id);
+            return {};
+        }
+        m_functions[idx] = compiler.Take();
+        m_functionStates[idx] = State::Done;
+        return idx;
+    }
+
+    const Ctee::Value * Ctee::getGlobal(const Declaration& decl, const std::optional<SourcePosition>& srcPos) {
+        if(auto it = m_globals.find(decl.id); it != m_globals.end()) {
+            if(it->second.state == State::InProgress)
+                error(std::format("Recursive compile-time definition of \"{}\"", decl.name), srcPos);
+            else if(it->second.state == State::Failed)
+                error(std::format("\"{}\" is not known at compile time", decl.name), srcPos);
+            return it->second.value ? &it->second.value.value() : nullptr;
+        }
+
+        if(getFunctionDefinition(decl)) {
+            error(std::format("Function \"{}\" can only be called at compile time", decl.name), srcPos);
+            return nullptr;
+        }
+        auto type = m_typer.GetType(decl);
+        if(type && m_types.Get(type.value()).attribs.isMutable) {
+            error(std::format("\"{}\" is mutable, its value is not known at compile time", decl.name), srcPos);
+            return nullptr;
+        }
+        const ASTNode::Expression * value = nullptr;
+        if(auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get())) {
+            std::visit(overloaded{
+                [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                    if(typedVarDef.GetValue())
+                        value = &typedVarDef.GetValue().value();
+                },
+                [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                    value = &untypedVarDef.GetValue();
+                }
+            }, *varDef);
+        }
+        if(!value) {
+            error(std::format("\"{}\" has no value at compile time", decl.name), srcPos);
+            return nullptr;
+        }
+
+        m_globals[decl.id] = Global{State::InProgress, {}};
+        std::optional<Value> result = Evaluate(*value);
+        Global& global = m_globals[decl.id];
+        global = Global{result ? State::Done : State::Failed, std::move(result)};
+        if(!global.value)
+            error(std::format("\"{}\" is not known at compile time", decl.name), srcPos);
+        return global.value ? &global.value.value() : nullptr;
+    }
+
+    /*
+     *
+     * AST walk
+     *
+     */
+
+    void Ctee::evaluateType(const ASTNode::Type& type) {
+        auto evaluateStruct = [&](const ASTNode::TypeStruct& structType) {
+            for(const ASTNode::TypeStruct::Field& field : structType.GetFields()) {
+                std::visit(overloaded{
+                    [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                        evaluateType(*namedField.GetType());
+                        if(namedField.GetDefaultValue())
+                            evaluateExpression(*namedField.GetDefaultValue().value());
+                    },
+                    [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                        evaluateType(*unnamedField.GetType());
+                        if(const auto& typeReps = unnamedField.GetTypeReps()) {
+                            const ASTNode::Expression& reps = *typeReps.value();
+                            if(reps.GetConstant())
+                                evaluateExpression(reps);
+                            else
+                                m_results.push_back(Result{&reps, Evaluate(reps)});
+                        }
+                        if(unnamedField.GetDefaultValue())
+                            evaluateExpression(*unnamedField.GetDefaultValue().value());
+                    }
+                }, field);
+            }
+        };
+
+        std::visit(overloaded{
+            [&](ASTNode::TypePrimitive) {},
+            [&](const ASTNode::TypePointer& pointer) {
+                evaluateType(*pointer);
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                evaluateStruct(function.GetArgumentsType());
+                evaluateType(*function.GetReturnType());
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                evaluateStruct(structType);
+            }
+        }, type.Get());
+    }
+
+    void Ctee::evaluateExpression(const ASTNode::Expression& expr) {
+        using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get())
+                    return;
+                if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                    for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit->GetFields())
+                        evaluateExpression(*field.GetValue());
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                evaluateExpression(*funcCall.GetFunction());
+                for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields())
+                    evaluateExpression(*field.GetValue());
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    evaluateStatement(stmt);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                evaluateExpression(*ifExpr.GetCondition());
+                evaluateStatement(*ifExpr.GetSuccessStatement());
+                if(ifExpr.GetFailStatement())
+                    evaluateStatement(*ifExpr.GetFailStatement().value());
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                if(loop.GetInitStatement())
+                    evaluateStatement(*loop.GetInitStatement().value());
+                if(loop.GetCondition())
+                    evaluateExpression(*loop.GetCondition().value());
+                if(loop.GetPostStatement())
+                    evaluateStatement(*loop.GetPostStatement().value());
+                evaluateStatement(*loop.GetBodyStatement());
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                // nested comp expressions are part of the outermost one
+                if(unaryOp.GetKind() == UnOpKind::Comp) {
+                    Trace::Scope traceScope("ctee-evaluate", m_infos.GetId());
+                    if(traceScope.IsActive() && expr.GetSourcePosition())
+                        traceScope.SetSpan(expr.GetSourcePosition().value());
+                    m_results.push_back(Result{&expr, Evaluate(expr)});
+                    return;
+                }
+                evaluateExpression(*unaryOp.GetOperand());
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                evaluateExpression(*binOp.GetOperands().first);
+                evaluateExpression(*binOp.GetOperands().second);
+            },
+            [&](const ASTNode::ExpressionName&) {}
+        }, expr.Get());
+    }
+
+    void Ctee::evaluateStatement(const ASTNode::Statement& stmt) {
+        auto evaluateLValue = [&](const ASTNode::Expression::LValue& lvalue) {
+            std::visit(overloaded{
+                [&](const ASTNode::ExpressionName&) {},
+                [&](const ASTNode::Expression::PointerDereference& operand) {
+                    evaluateExpression(*operand);
+                },
+                [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                    evaluateExpression(*operands.first);
+                }
+            }, lvalue);
+        };
+
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                evaluateExpression(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                evaluateLValue(binOp.GetOperands().first);
+                evaluateExpression(binOp.GetOperands().second);
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        evaluateType(typedVarDef.GetType());
+                        if(typedVarDef.GetValue())
+                            evaluateExpression(typedVarDef.GetValue().value());
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        evaluateExpression(untypedVarDef.GetValue());
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                evaluateLValue(assign.GetLValue());
+                evaluateExpression(assign.GetRValue());
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                if(stmtBreak.GetValue())
+                    evaluateExpression(stmtBreak.GetValue().value());
+            }
+        }, stmt.Get());
+    }
+
+}
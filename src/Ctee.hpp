@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "Analyzer.hpp"
+#include "Bytecode.hpp"
+#include "Infos.hpp"
+#include "TypeInterner.hpp"
+#include "Typer.hpp"
+#include "VM.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Compile-time expression evaluation (CTEE).
+    //
+    // Typed expressions are compiled to register bytecode and run by the VM, instead of
+    // walking the AST. The functions they call are compiled once, on first use, and are
+    // shared by later evaluations. Values follow the semantics of their primitive types:
+    // integers wrap at their width, division by zero and shifts by 64 or more are errors,
+    // and f32 results are rounded to f32.
+    //
+    // Integers up to 64 bits, floats, chars, bools and structs of them are supported.
+    // Pointers, optionals and 128-bit integers are reported as not supported at compile time.
+    // Definitions outside of the evaluated code are evaluated once from their initializer,
+    // unless they are mutable. Struct fields without a value or default are zero.
+    //
+    class Ctee {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+
+        struct Value {
+            TypeId type;
+            std::vector<Bytecode::Slot> slots; // struct fields are flattened
+        };
+
+        struct Result {
+            const ASTNode::Expression * expr;
+            std::optional<Value> value;
+        };
+
+        Ctee(const Infos& infos, const Analyzer& analyzer, const Typer& typer, const TypeInterner& types, const VM::Limits& limits = {});
+
+        const Infos& GetInfos() const;
+
+        // none if it can not be evaluated, the reason is reported
+        std::optional<Value> Evaluate(const ASTNode::Expression& expr);
+        // Evaluates every comp expression, and every type repetition that is not a constant
+        void EvaluateAll(const ASTNode& ast);
+
+        const std::vector<Result>& GetResults() const;
+        std::size_t GetFunctionCount() const;
+        std::size_t GetInstructionCount() const;
+        std::uint64_t GetStepCount() const;
+        std::size_t GetNativeFunctionCount() const;
+        std::size_t GetNativeCodeSize() const;
+
+        std::string StringifyValue(const Value& value) const;
+        // Results of EvaluateAll, in source order
+        std::string StringifyResults() const;
+
+    private:
+        class Compiler;
+
+        struct Scalar {
+            std::uint8_t width;
+            bool isSigned;
+            bool isFloat;
+        };
+
+        // Field of a struct type, repetitions expanded
+        struct FieldSlots {
+            std::string_view name;
+            TypeId type;
+            std::uint32_t offset;
+        };
+
+        enum class State : std::uint8_t {
+            InProgress, Done, Failed
+        };
+
+        struct Global {
+            State state;
+            std::optional<Value> value;
+        };
+
+        static const ASTNode::StatementTypedVariableDefinition * getFunctionDefinition(const Declaration& decl);
+
+        void error(std::string_view msg, const std::optional<SourcePosition>& srcPos);
+
+        // none if the type is not supported at compile time
+        std::optional<std::uint32_t> getSlotCount(TypeId type);
+        std::optional<Scalar> getScalar(TypeId type) const;
+        std::vector<FieldSlots> getFieldSlots(TypeId type);
+
+        std::optional<std::uint32_t> getFunction(const Declaration& decl, const std::optional<SourcePosition>& srcPos);
+        const Value * getGlobal(const Declaration& decl, const std::optional<SourcePosition>& srcPos);
+
+        void evaluateType(const ASTNode::Type& type);
+        void evaluateExpression(const ASTNode::Expression& expr);
+        void evaluateStatement(const ASTNode::Statement& stmt);
+
+        Infos m_infos;
+        const Analyzer& m_analyzer;
+        const Typer& m_typer;
+        const TypeInterner& m_types;
+
+        std::vector<Bytecode::Function> m_functions;
+        std::vector<State> m_functionStates;                                // by function
+        std::unordered_map<std::uint32_t, std::uint32_t> m_functionIndices; // by declaration id
+        std::unordered_set<std::uint32_t> m_failedFunctions;                // by declaration id
+        std::uint32_t m_evaluationBase = 0;                                 // first function of the innermost evaluation
+        std::unordered_map<std::uint32_t, Global> m_globals;                // by declaration id
+        std::unordered_map<TypeId, std::optional<std::uint32_t>> m_slotCounts;
+        VM m_vm;
+
+        std::vector<Result> m_results;
+    };
+
+}
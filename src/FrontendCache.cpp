@@ -0,0 +1,230 @@
+#include "FrontendCache.hpp"
+#include "ASTBinary.hpp"
+#include "ASTWriter.hpp"
+#include "Hash.hpp"
+#include "Version.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <utility>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace ry {
+
+    namespace fs = std::filesystem;
+
+    using Info = Infos::Info;
+
+    static constexpr const char * const ENTRY_EXTENSION = ".ryc";
+    static constexpr std::size_t INFO_FIELDS = 6;
+
+    /*
+     *
+     * Entry
+     *
+     */
+
+    FrontendCache::Entry::Entry(MappedFile&& file, std::vector<Info>&& infos, std::optional<ASTView> ast):
+        m_file(std::move(file)),
+        m_infos(std::move(infos)),
+        m_ast(ast)
+    {}
+
+    const std::vector<Info>& FrontendCache::Entry::GetInfos() const {
+        return m_infos;
+    }
+
+    const std::optional<ASTView>& FrontendCache::Entry::GetAST() const {
+        return m_ast;
+    }
+
+    /*
+     *
+     * Frontend Cache
+     *
+     */
+
+    FrontendCache::FrontendCache(std::string_view dir, std::uint64_t maxSize):
+        m_dir(dir),
+        m_maxSize(maxSize)
+    {
+        std::error_code ec;
+        fs::create_directories(m_dir, ec);
+    }
+
+    std::uint64_t FrontendCache::computeKey(std::string_view src) {
+        std::uint64_t key = Hash::Compute(src);
+        key = Hash::Combine(key, Hash::Compute(ry::VERSION));
+        key = Hash::Combine(key, ASTBinary::VERSION);
+        key = Hash::Combine(key, FrontendCache::VERSION);
+        return key;
+    }
+
+    static std::uint64_t getProcessId() {
+    #ifdef _WIN32
+        return GetCurrentProcessId();
+    #else
+        return getpid();
+    #endif
+    }
+
+    std::string FrontendCache::getEntryPath(std::uint64_t key) const {
+        return (fs::path(m_dir) / std::format("{:016x}{}", key, ENTRY_EXTENSION)).string();
+    }
+
+    std::optional<FrontendCache::Entry> FrontendCache::Load(std::string_view src) const {
+        std::string path = getEntryPath(computeKey(src));
+
+        MappedFile file;
+        if(!file.Open(path))
+            return {};
+        std::span<const std::uint8_t> bytes = file.GetBytes();
+
+        if(bytes.size() < sizeof(Header))
+            return {};
+        auto header = ASTBinary::Read<Header>(bytes.data());
+        if(header.magic != MAGIC || header.version != VERSION)
+            return {};
+        // the key is derived from the same hash, so a collision of the source hash goes unnoticed
+        if(header.sourceHash != Hash::Compute(src) || header.sourceSize != src.size())
+            return {};
+        if(sizeof(Header) + std::uint64_t(header.infosSize) > header.astOffset
+            || std::uint64_t(header.astOffset) + header.astSize > bytes.size())
+            return {};
+        // the binary AST is read without bounds checks, a truncated or corrupted file must not reach it
+        if(header.payloadHash != Hash::Compute(bytes.data() + sizeof(Header), bytes.size() - sizeof(Header)))
+            return {};
+
+        std::vector<Info> infos;
+        infos.reserve(header.numInfos);
+        const std::uint8_t * ptr = bytes.data() + sizeof(Header);
+        const std::uint8_t * end = ptr + header.infosSize;
+        for(std::uint32_t i = 0; i < header.numInfos; i++) {
+            if(end - ptr < std::ptrdiff_t(INFO_FIELDS * sizeof(std::uint32_t)))
+                return {};
+            std::uint32_t fields[INFO_FIELDS];
+            for(std::size_t j = 0; j < INFO_FIELDS; j++, ptr += sizeof(std::uint32_t))
+                fields[j] = ASTBinary::Read<std::uint32_t>(ptr);
+            if(std::size_t(end - ptr) < fields[5])
+                return {};
+            std::string_view msg(reinterpret_cast<const char *>(ptr), fields[5]);
+            ptr += fields[5];
+            infos.push_back(Info(Info::Level(fields[0]), msg, fields[1], fields[2], fields[3], fields[4]));
+        }
+
+        std::optional<ASTView> ast;
+        if(header.astSize != 0) {
+            ast = ASTView::Open(bytes.subspan(header.astOffset, header.astSize));
+            if(!ast)
+                return {};
+        }
+
+        // LRU bookkeeping, the modification time doubles as the last access time
+        std::error_code ec;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+        return Entry(std::move(file), std::move(infos), ast);
+    }
+
+    bool FrontendCache::Store(std::string_view src, const Infos& infos, const std::optional<ASTNode>& ast) const {
+        std::vector<std::uint8_t> bytes(sizeof(Header));
+        auto append = [&bytes](const void * data, std::size_t size) {
+            auto ptr = static_cast<const std::uint8_t *>(data);
+            bytes.insert(bytes.end(), ptr, ptr + size);
+        };
+
+        for(const Info& info : infos.Get()) {
+            const SourcePosition& srcPos = info.GetSourcePosition();
+            std::uint32_t fields[INFO_FIELDS] = {
+                std::uint32_t(info.GetLevel()),
+                std::uint32_t(srcPos.startLine), std::uint32_t(srcPos.startColumn),
+                std::uint32_t(srcPos.endLine), std::uint32_t(srcPos.endColumn),
+                std::uint32_t(info.GetMessage().size())
+            };
+            append(fields, sizeof(fields));
+            append(info.GetMessage().data(), info.GetMessage().size());
+        }
+
+        Header header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = Hash::Compute(src);
+        header.sourceSize = src.size();
+        header.numInfos = infos.Get().size();
+        header.infosSize = bytes.size() - sizeof(Header);
+
+        bytes.resize((bytes.size() + 7) & ~std::size_t(7), 0);
+        header.astOffset = bytes.size();
+        header.astSize = 0;
+        if(ast) {
+            std::vector<std::uint8_t> astBytes = ASTWriter().Write(ast.value());
+            header.astSize = astBytes.size();
+            append(astBytes.data(), astBytes.size());
+        }
+        header.payloadHash = Hash::Compute(bytes.data() + sizeof(Header), bytes.size() - sizeof(Header));
+        ASTBinary::Write(bytes.data(), header);
+
+        // unique per process and call, the rename below is the only step other compilers can observe
+        static std::atomic<std::uint64_t> counter = 0;
+        std::string path = getEntryPath(computeKey(src));
+        std::string tmpPath = std::format("{}.{:x}.{:x}.tmp", path, getProcessId(), counter++);
+
+        std::FILE * file = std::fopen(tmpPath.c_str(), "wb");
+        if(!file)
+            return false;
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        ok = (std::fclose(file) == 0) && ok;
+
+        std::error_code ec;
+        if(ok)
+            fs::rename(tmpPath, path, ec);
+        if(!ok || ec) {
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    void FrontendCache::Trim() const {
+        struct CachedFile {
+            fs::path path;
+            fs::file_time_type lastUse;
+            std::uintmax_t size;
+        };
+
+        std::error_code ec;
+        std::vector<CachedFile> files;
+        std::uint64_t totalSize = 0;
+        for(const fs::directory_entry& dirEntry : fs::directory_iterator(m_dir, ec)) {
+            if(dirEntry.path().extension() != ENTRY_EXTENSION)
+                continue;
+            CachedFile file{dirEntry.path(), dirEntry.last_write_time(ec), dirEntry.file_size(ec)};
+            if(ec)
+                continue;
+            totalSize += file.size;
+            files.push_back(std::move(file));
+        }
+
+        std::sort(files.begin(), files.end(), [](const CachedFile& a, const CachedFile& b) {
+            return a.lastUse < b.lastUse;
+        });
+        // another compiler may evict or replace the same files concurrently, failures are fine
+        for(const CachedFile& file : files) {
+            if(totalSize <= m_maxSize)
+                break;
+            fs::remove(file.path, ec);
+            totalSize -= file.size;
+        }
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "ASTView.hpp"
+#include "Infos.hpp"
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ry {
+
+    //
+    // On-disk cache of front-end results (diagnostics + binary AST), keyed by a content hash
+    // of the source combined with the compiler and format versions.
+    //
+    // Layout of an entry (<dir>/<16 hex digit key>.ryc):
+    //        <header> <infos...> <padding> <binary AST>
+    //
+    //        <info> :: <u32 level> <u32 startLn> <u32 startCol> <u32 endLn> <u32 endCol> <u32 length> <chars...>
+    //
+    // Entries are written to a temporary file unique to the process and renamed into place, so
+    // concurrent compilers never observe a partial entry. An entry whose payload does not match the
+    // hash in its header is ignored. Loading an entry bumps its modification time, Trim() evicts
+    // the least recently used entries.
+    //
+    class FrontendCache {
+    public:
+        static constexpr std::uint32_t MAGIC = 0x43465952; // "RYFC"
+        static constexpr std::uint32_t VERSION = 5;
+
+        struct Header {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t sourceHash;
+            std::uint64_t sourceSize;
+            std::uint64_t payloadHash; // of everything after the header
+            std::uint32_t numInfos;
+            std::uint32_t infosSize;
+            std::uint32_t astOffset;
+            std::uint32_t astSize; // 0 if parsing failed
+        };
+
+        // A loaded entry, keeps the file mapped for as long as the AST is in use
+        class Entry {
+        public:
+            Entry(MappedFile&& file, std::vector<Infos::Info>&& infos, std::optional<ASTView> ast);
+
+            const std::vector<Infos::Info>& GetInfos() const;
+            const std::optional<ASTView>& GetAST() const;
+
+        private:
+            MappedFile m_file;
+            std::vector<Infos::Info> m_infos;
+            std::optional<ASTView> m_ast;
+        };
+
+        FrontendCache(std::string_view dir, std::uint64_t maxSize);
+
+        std::optional<Entry> Load(std::string_view src) const;
+        bool Store(std::string_view src, const Infos& infos, const std::optional<ASTNode>& ast) const;
+
+        // Evicts least recently used entries until the cache fits into maxSize
+        void Trim() const;
+
+    private:
+        static std::uint64_t computeKey(std::string_view src);
+        std::string getEntryPath(std::uint64_t key) const;
+
+        std::string m_dir;
+        std::uint64_t m_maxSize;
+    };
+
+}
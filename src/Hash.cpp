@@ -0,0 +1,97 @@
+#include "Hash.hpp"
+
+#include <cstring>
+
+namespace ry {
+
+    static constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    static constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static std::uint64_t read64(const std::uint8_t * ptr) {
+        std::uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    static std::uint32_t read32(const std::uint8_t * ptr) {
+        std::uint32_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value) {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    std::uint64_t Hash::Compute(const void * data, std::size_t size, std::uint64_t seed) {
+        const std::uint8_t * ptr = static_cast<const std::uint8_t *>(data);
+        const std::uint8_t * end = ptr + size;
+        std::uint64_t hash;
+
+        if(size >= 32) {
+            std::uint64_t v1 = seed + PRIME1 + PRIME2;
+            std::uint64_t v2 = seed + PRIME2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - PRIME1;
+            for(; ptr + 32 <= end; ptr += 32) {
+                v1 = round(v1, read64(ptr));
+                v2 = round(v2, read64(ptr + 8));
+                v3 = round(v3, read64(ptr + 16));
+                v4 = round(v4, read64(ptr + 24));
+            }
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        }
+        else
+            hash = seed + PRIME5;
+
+        hash += size;
+
+        for(; ptr + 8 <= end; ptr += 8) {
+            hash ^= round(0, read64(ptr));
+            hash = rotl(hash, 27) * PRIME1 + PRIME4;
+        }
+        if(ptr + 4 <= end) {
+            hash ^= std::uint64_t(read32(ptr)) * PRIME1;
+            hash = rotl(hash, 23) * PRIME2 + PRIME3;
+            ptr += 4;
+        }
+        for(; ptr < end; ptr++) {
+            hash ^= (*ptr) * PRIME5;
+            hash = rotl(hash, 11) * PRIME1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    std::uint64_t Hash::Compute(std::string_view str, std::uint64_t seed) {
+        return Compute(str.data(), str.size(), seed);
+    }
+
+    std::uint64_t Hash::Combine(std::uint64_t hash1, std::uint64_t hash2) {
+        return mergeRound(hash1, hash2);
+    }
+
+}
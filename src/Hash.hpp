@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ry {
+
+    class Hash {
+    public:
+        // XXH64, fast non-cryptographic 64-bit hash
+        static std::uint64_t Compute(const void * data, std::size_t size, std::uint64_t seed = 0);
+        static std::uint64_t Compute(std::string_view str, std::uint64_t seed = 0);
+
+        static std::uint64_t Combine(std::uint64_t hash1, std::uint64_t hash2);
+    };
+
+}
@@ -0,0 +1,276 @@
+#include "IR.hpp"
+
+#include <cctype>
+#include <format>
+#include <unordered_map>
+
+namespace ry {
+
+    using Value = IR::Value;
+    using BlockId = IR::BlockId;
+    using Op = IR::Op;
+
+    std::string_view IR::StringifyOp(Op op) {
+    #define RY_IR__OPS_E_NAME(NAME) case Op::NAME: return #NAME;
+        switch(op) {
+            RY_IR__OPS(RY_IR__OPS_E_NAME)
+        }
+    #undef RY_IR__OPS_E_NAME
+        return "?";
+    }
+
+    std::string IR::StringifyScalar(const Scalar& scalar) {
+        if(scalar.width == 0)
+            return "-";
+        if(scalar.width == 1)
+            return "bool";
+        return std::format("{}{}", scalar.isFloat ? 'f' : scalar.isSigned ? 'i' : 'u', unsigned(scalar.width));
+    }
+
+    // %value scalar = op operands, blocks are named b<id>, names of declarations follow their id
+    std::string IR::Stringify(const Function& function, const Analyzer& analyzer) {
+        auto stringifyConst = [&](const Instruction& instruction) -> std::string {
+            if(instruction.scalar.isFloat)
+                return TokenLiteral::StringifyValue(Bytecode::ToFloat(instruction.imm));
+            if(instruction.scalar.width == 1)
+                return instruction.imm ? "true" : "false";
+            if(instruction.scalar.isSigned)
+                return std::to_string(std::int64_t(instruction.imm));
+            return std::to_string(instruction.imm);
+        };
+        auto stringifyName = [&](Bytecode::Slot id) -> std::string {
+            return id == NONE ? "*" : std::string(analyzer.GetDeclaration(std::uint32_t(id)).name);
+        };
+
+        std::string str = std::format("{}:\n", function.decl ? function.decl->name : std::string_view("(top level)"));
+        for(BlockId block = 0; block < function.blocks.size(); block++) {
+            if(IsRemoved(function, block))
+                continue;
+            str += std::format("b{}:", block);
+            const std::vector<BlockId>& preds = function.blocks[block].preds;
+            for(std::size_t i = 0; i < preds.size(); i++)
+                str += std::format("{}b{}", i == 0 ? " <- " : ", ", preds[i]);
+            str += '\n';
+
+            for(Value value : function.blocks[block].code) {
+                const Instruction& instruction = function.instructions[value];
+                str += "    ";
+                if(instruction.scalar.width != 0 || instruction.op == Op::Opaque || instruction.op == Op::Load || instruction.op == Op::Call)
+                    str += std::format("%{} {} = ", value, StringifyScalar(instruction.scalar));
+                for(char c : StringifyOp(instruction.op))
+                    str += char(std::tolower(c));
+                if(instruction.isSafe)
+                    str += " safe";
+                std::span<const Value> operands = GetOperands(function, value);
+                std::string args;
+                for(std::size_t i = 0; i < operands.size(); i++)
+                    args += std::format("{}%{}", i == 0 ? "" : ", ", operands[i]);
+                switch(instruction.op) {
+                    case Op::Const:
+                        str += ' ' + stringifyConst(instruction);
+                        break;
+                    case Op::Param:
+                    case Op::Load:
+                        str += ' ' + stringifyName(instruction.imm);
+                        break;
+                    case Op::Store:
+                        str += std::format(" {}, {}", stringifyName(instruction.imm), args);
+                        break;
+                    case Op::Call:
+                        str += std::format(" {}({})", stringifyName(instruction.imm), args);
+                        break;
+                    case Op::Jump:
+                        str += std::format(" b{}", instruction.imm);
+                        break;
+                    case Op::Branch:
+                        str += std::format(" {}, b{}, b{}", args, instruction.imm & 0xFFFFFFFF, instruction.imm >> 32);
+                        break;
+                    default:
+                        if(!args.empty())
+                            str += ' ' + args;
+                        break;
+                }
+                str += '\n';
+            }
+        }
+        return str;
+    }
+
+    std::span<const Value> IR::GetOperands(const Function& function, Value value) {
+        const Instruction& instruction = function.instructions[value];
+        return std::span<const Value>(function.operands).subspan(instruction.firstOperand, instruction.numOperands);
+    }
+
+    std::span<Value> IR::GetOperands(Function& function, Value value) {
+        const Instruction& instruction = function.instructions[value];
+        return std::span<Value>(function.operands).subspan(instruction.firstOperand, instruction.numOperands);
+    }
+
+    bool IR::IsTerminator(Op op) {
+        return op == Op::Jump || op == Op::Branch || op == Op::Return;
+    }
+
+    std::vector<BlockId> IR::GetSuccessors(const Function& function, BlockId block) {
+        const std::vector<Value>& code = function.blocks[block].code;
+        if(code.empty())
+            return {};
+        const Instruction& terminator = function.instructions[code.back()];
+        switch(terminator.op) {
+            case Op::Jump:   return {BlockId(terminator.imm)};
+            case Op::Branch: return {BlockId(terminator.imm & 0xFFFFFFFF), BlockId(terminator.imm >> 32)};
+            default:         return {};
+        }
+    }
+
+    bool IR::IsRemoved(const Function& function, BlockId block) {
+        return block != 0 && function.blocks[block].code.empty() && function.blocks[block].preds.empty();
+    }
+
+    Value IR::Resolve(const Function& function, Value value) {
+        while(function.instructions[value].op == Op::Copy)
+            value = function.operands[function.instructions[value].firstOperand];
+        return value;
+    }
+
+    // Integers wrap, narrower ones are promoted to int, signed division of the smallest value by -1 overflows
+    std::optional<Bytecode::Slot> IR::Evaluate(Op op, const Scalar& scalar, Bytecode::Slot a, Bytecode::Slot b) {
+        using Slot = Bytecode::Slot;
+        if(scalar.width == 0 || scalar.width > 64)
+            return {};
+        auto normalize = [&](Slot value) {
+            return Bytecode::Normalize(value, scalar.width, scalar.isSigned);
+        };
+        if(scalar.isFloat) {
+            double x = Bytecode::ToFloat(a);
+            double y = Bytecode::ToFloat(b);
+            bool isF32 = scalar.width == 32;
+            switch(op) {
+                case Op::Add: return Bytecode::FromFloat(isF32 ? double(float(x) + float(y)) : x + y, scalar.width);
+                case Op::Sub: return Bytecode::FromFloat(isF32 ? double(float(x) - float(y)) : x - y, scalar.width);
+                case Op::Mul: return Bytecode::FromFloat(isF32 ? double(float(x) * float(y)) : x * y, scalar.width);
+                case Op::Div: return Bytecode::FromFloat(isF32 ? double(float(x) / float(y)) : x / y, scalar.width);
+                case Op::Neg: return Bytecode::FromFloat(-x, scalar.width);
+                case Op::Eq:  return Slot(x == y);
+                case Op::Ne:  return Slot(x != y);
+                case Op::Lt:  return Slot(x < y);
+                case Op::Le:  return Slot(x <= y);
+                default:      return {};
+            }
+        }
+        if(scalar.width == 1) {
+            switch(op) {
+                case Op::And:        return a & b;
+                case Op::Or:         return a | b;
+                case Op::Xor:        return a ^ b;
+                case Op::LogicalNot: return Slot(!a);
+                case Op::Eq:         return Slot(a == b);
+                case Op::Ne:         return Slot(a != b);
+                case Op::Lt:         return Slot(a < b);
+                case Op::Le:         return Slot(a <= b);
+                default:             return {};
+            }
+        }
+
+        bool isOverflow = scalar.isSigned && scalar.width >= 32 && b == Slot(-1) && a == normalize(Slot(1) << (scalar.width - 1));
+        switch(op) {
+            case Op::Add: return normalize(a + b);
+            case Op::Sub: return normalize(a - b);
+            case Op::Mul: return normalize(a * b);
+            case Op::Div:
+                if(b == 0 || isOverflow)
+                    return {};
+                return normalize(scalar.isSigned ? Slot(std::int64_t(a) / std::int64_t(b)) : a / b);
+            case Op::Mod:
+                if(b == 0 || isOverflow)
+                    return {};
+                return normalize(scalar.isSigned ? Slot(std::int64_t(a) % std::int64_t(b)) : a % b);
+            case Op::And: return a & b;
+            case Op::Or:  return a | b;
+            case Op::Xor: return a ^ b;
+            // shifted at 64 bits, the amount is read unsigned so negative ones are out of range too
+            case Op::Shl:
+                if(b >= 64)
+                    return {};
+                return normalize(a << b);
+            case Op::Shr:
+                if(b >= 64)
+                    return {};
+                return normalize(scalar.isSigned ? Slot(std::int64_t(a) >> b) : a >> b);
+            case Op::Neg: return normalize(Slot(0) - a);
+            case Op::Not: return normalize(~a);
+            case Op::Eq:  return Slot(a == b);
+            case Op::Ne:  return Slot(a != b);
+            case Op::Lt:  return Slot(scalar.isSigned ? std::int64_t(a) < std::int64_t(b) : a < b);
+            case Op::Le:  return Slot(scalar.isSigned ? std::int64_t(a) <= std::int64_t(b) : a <= b);
+            default:      return {};
+        }
+    }
+
+    std::optional<std::string> IR::Verify(const Function& function) {
+        std::size_t numValues = function.instructions.size();
+        std::vector<bool> isListed(numValues, false);
+        std::unordered_map<std::uint64_t, std::size_t> numEdges; // by pred << 32 | succ
+
+        for(BlockId block = 0; block < function.blocks.size(); block++) {
+            const std::vector<Value>& code = function.blocks[block].code;
+            if(IsRemoved(function, block))
+                continue;
+            if(code.empty() || !IsTerminator(function.instructions[code.back()].op))
+                return std::format("b{} does not end with a terminator", block);
+            bool isPhiAllowed = true;
+            for(std::size_t i = 0; i < code.size(); i++) {
+                Value value = code[i];
+                if(value >= numValues || isListed[value])
+                    return std::format("%{} is listed twice or does not exist", value);
+                isListed[value] = true;
+                const Instruction& instruction = function.instructions[value];
+                if(instruction.block != block)
+                    return std::format("%{} is listed in b{} but belongs to b{}", value, block, instruction.block);
+                if(instruction.op == Op::Nop)
+                    return std::format("%{} is removed but listed in b{}", value, block);
+                if(IsTerminator(instruction.op) && i + 1 != code.size())
+                    return std::format("%{} terminates b{} before its end", value, block);
+                if(instruction.op == Op::Phi) {
+                    if(!isPhiAllowed)
+                        return std::format("%{} is a phi after other instructions of b{}", value, block);
+                    if(instruction.numOperands != function.blocks[block].preds.size())
+                        return std::format("%{} has {} operands for {} predecessors", value, instruction.numOperands, function.blocks[block].preds.size());
+                }
+                else if(instruction.op != Op::Copy)
+                    isPhiAllowed = false;
+                if(std::size_t(instruction.firstOperand) + instruction.numOperands > function.operands.size())
+                    return std::format("%{} has operands out of range", value);
+            }
+            for(BlockId succ : GetSuccessors(function, block)) {
+                if(succ >= function.blocks.size() || IsRemoved(function, succ))
+                    return std::format("b{} jumps to b{}, which does not exist", block, succ);
+                numEdges[std::uint64_t(block) << 32 | succ]++;
+            }
+        }
+
+        for(BlockId block = 0; block < function.blocks.size(); block++)
+            for(BlockId pred : function.blocks[block].preds) {
+                auto it = numEdges.find(std::uint64_t(pred) << 32 | block);
+                if(it == numEdges.end() || it->second == 0)
+                    return std::format("b{} lists b{} as a predecessor that does not jump to it", block, pred);
+                it->second--;
+            }
+        for(const auto& [edge, count] : numEdges)
+            if(count != 0)
+                return std::format("b{} jumps to b{}, which does not list it", edge >> 32, edge & 0xFFFFFFFF);
+
+        for(Value value = 0; value < numValues; value++) {
+            if(!isListed[value])
+                continue;
+            for(Value operand : GetOperands(function, value)) {
+                if(operand >= numValues || !isListed[operand])
+                    return std::format("%{} reads %{}, which is not defined", value, operand);
+                Op op = function.instructions[operand].op;
+                if(IsTerminator(op) || op == Op::Store)
+                    return std::format("%{} reads %{}, which has no value", value, operand);
+            }
+        }
+        return {};
+    }
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "Analyzer.hpp"
+#include "Bytecode.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Mid-level SSA intermediate representation of function bodies.
+    //
+    // A function is a control-flow graph of basic blocks. Instructions of all blocks are kept in
+    // one array and named by their index, which is also the value they define, so a value is a
+    // 32-bit integer and the instructions of a function are walked without chasing pointers.
+    // Their operands are ranges of one shared array. Each block lists its instructions, phis
+    // first and its terminator last, and its predecessors in the order of the operands of its phis.
+    //
+    // Only scalars (integers, floats, chars and bools) are values of their own: locals and
+    // parameters of scalar types whose address is never taken are SSA variables. Other names are
+    // loaded from and stored to memory by their declaration, and expressions of other types are
+    // opaque values computed from the values they read, so every read of a local is an operand.
+    //
+    // Passes rewrite instructions in place rather than replacing them, and removed ones become
+    // Nop, so the AST expressions mapped to values keep their value across passes. Removed
+    // blocks are left empty, so block ids do not change either.
+    //
+    class IR {
+    public:
+        using Value = std::uint32_t;   // index of the instruction that defines it
+        using BlockId = std::uint32_t;
+        using Declaration = Analyzer::Declaration;
+
+        static constexpr Value NONE = UINT32_MAX;
+
+    #define RY_IR__OPS_E_ENUM(NAME) NAME,
+    #define RY_IR__OPS(E) /* E - expand macro */ \
+        E(Nop)        /* removed                                          */ \
+        E(Const)      /* imm, normalized like a Bytecode slot             */ \
+        E(Undef)      /* a variable read where it is not defined          */ \
+        E(Param)      /* imm: declaration id                              */ \
+        E(Phi)        /* one operand per predecessor of its block         */ \
+        E(Copy)       /* a, a phi whose operands are all the same         */ \
+        E(Opaque)     /* not a scalar, or not modelled, read from its operands */ \
+        E(Load)       /* imm: declaration id of a name in memory          */ \
+        E(Store)      /* a to the declaration imm, or NONE and the place computed from the other operands */ \
+        E(Call)       /* the arguments in source order, imm: callee's declaration id, or NONE and the callee first */ \
+        \
+        E(Add) E(Sub) E(Mul) E(Div) E(Mod)  /* a op b                     */ \
+        E(And) E(Or) E(Xor) E(Shl) E(Shr) \
+        E(Neg) E(Not) E(LogicalNot)         /* op a                       */ \
+        E(Eq) E(Ne) E(Lt) E(Le)             /* a op b as the scalar of a, bool */ \
+        \
+        E(Jump)       /* to block imm                                     */ \
+        E(Branch)     /* if a to block imm & 0xFFFFFFFF, else imm >> 32   */ \
+        E(Return)     /* a, if any                                        */
+
+        enum class Op : std::uint8_t {
+            RY_IR__OPS(RY_IR__OPS_E_ENUM)
+        };
+
+    #undef RY_IR__OPS_E_ENUM
+
+        // Of a value, width 0 if it is not a scalar
+        struct Scalar {
+            std::uint8_t width;    // integers: 1 (bool) 8 16 32 64 128 bits, floats: 32 64
+            bool isSigned;
+            bool isFloat;
+
+            bool operator==(const Scalar&) const = default;
+        };
+
+        struct Instruction {
+            Op op;
+            Scalar scalar;
+            BlockId block;
+            std::uint32_t firstOperand = 0;
+            std::uint32_t numOperands = 0;
+            Bytecode::Slot imm = 0;
+            bool isSafe = false; // arithmetic: the plain C operation does not overflow a signed type nor shift past the width
+        };
+
+        struct Block {
+            std::vector<Value> code;     // phis first, the terminator last
+            std::vector<BlockId> preds;
+        };
+
+        // A local scalar of the function that is an SSA variable
+        struct Variable {
+            std::uint32_t decl;                             // declaration id
+            bool isAssigned = false;                        // after its definition
+            std::vector<const ASTNode::Expression *> reads; // names of it
+        };
+
+        struct Function {
+            const Declaration * decl = nullptr;
+            std::vector<Instruction> instructions; // by value
+            std::vector<Value> operands;
+            std::vector<Block> blocks;             // the entry first
+            std::unordered_map<const ASTNode::Expression *, Value> values; // of the expressions lowered
+            std::unordered_set<const ASTNode::Expression *> effects;       // lowered ones that call, store, break, continue or loop
+            std::vector<Variable> variables;       // in order of definition
+            std::unordered_map<const ASTNode::Statement *, Value> assignments; // results of the compound assignments to names
+            std::unordered_map<const ASTNode::ExpressionLoop *, BlockId> loops;  // header of each loop, where its condition is checked
+        };
+
+        static std::string_view StringifyOp(Op op);
+        // e.g. i32, u8, f64, bool, or - for values that are not scalars
+        static std::string StringifyScalar(const Scalar& scalar);
+        static std::string Stringify(const Function& function, const Analyzer& analyzer);
+
+        static std::span<const Value> GetOperands(const Function& function, Value value);
+        static std::span<Value> GetOperands(Function& function, Value value);
+        static bool IsTerminator(Op op);
+        // Of the terminator of the block
+        static std::vector<BlockId> GetSuccessors(const Function& function, BlockId block);
+        // Emptied by a pass, no block jumps to it
+        static bool IsRemoved(const Function& function, BlockId block);
+        // Follows copies to the value they stand for
+        static Value Resolve(const Function& function, Value value);
+        // Of an operation on constants of the scalar of its first operand as the C the backend writes computes
+        // it, none if it is not modelled or C leaves it undefined (division by zero, shifts past 63 bits)
+        static std::optional<Bytecode::Slot> Evaluate(Op op, const Scalar& scalar, Bytecode::Slot a, Bytecode::Slot b = 0);
+
+        // The first broken invariant, none if the function is well formed
+        static std::optional<std::string> Verify(const Function& function);
+    };
+
+}
@@ -0,0 +1,817 @@
+#include "IRBuilder.hpp"
+#include "ry.hpp"
+
+#include <algorithm>
+#include <variant>
+
+namespace ry {
+
+    using Value = IR::Value;
+    using BlockId = IR::BlockId;
+    using Op = IR::Op;
+    using Scalar = IR::Scalar;
+    using Slot = Bytecode::Slot;
+    using TypeKind = TypeInterner::Kind;
+    using Primitive = ASTNode::TypePrimitive;
+    using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+    using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+    using StmtBinOpKind = ASTNode::StatementBinaryOperation::Kind;
+
+    IRBuilder::IRBuilder(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types, const AliasAnalysis& aliases, const CompValues& compValues):
+        m_analyzer(analyzer),
+        m_typer(typer),
+        m_types(types),
+        m_aliases(aliases),
+        m_compValues(compValues)
+    {}
+
+    IR::Function IRBuilder::Build(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body) {
+        m_function = IR::Function();
+        m_function.decl = &decl;
+        m_numDeclarations = m_analyzer.GetDeclarationCount();
+        m_variableScalars.clear();
+        m_tracked.clear();
+        m_untracked.clear();
+        m_locals.clear();
+        m_parameters.clear();
+        m_variableIdxs.clear();
+        m_definitions.clear();
+        m_pendingPhis.clear();
+        m_isSealed.clear();
+        m_targets.clear();
+        m_scratch.clear();
+        m_numEffects = 0;
+        for(const ASTNode::TypeStruct::Field& field : function.GetArgumentsType().GetFields())
+            if(auto namedField = std::get_if<ASTNode::TypeStruct::NamedField>(&field))
+                m_parameters.insert(namedField);
+
+        m_block = newBlock(true);
+        Value value = lowerExpression(body);
+        if(value != NONE && hasValue(body))
+            emit(Op::Return, OPAQUE, std::span<const Value>(&value, 1));
+        else
+            emit(Op::Return, OPAQUE);
+        return std::move(m_function);
+    }
+
+    const ASTNode::TypeFunction * IRBuilder::getFunctionDefinition(const Declaration& decl) {
+        if(decl.kind != Declaration::Kind::Variable)
+            return nullptr;
+        auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get());
+        if(!varDef)
+            return nullptr;
+        auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef);
+        if(!typedVarDef || !typedVarDef->GetValue())
+            return nullptr;
+        return std::get_if<ASTNode::TypeFunction>(&typedVarDef->GetType().Get());
+    }
+
+    // Optionals are not scalars, nor are vectors
+    Scalar IRBuilder::getScalar(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(info.kind != TypeKind::Primitive || info.attribs.isOptional)
+            return OPAQUE;
+        switch(info.primitive) {
+            case Primitive::Char: return Scalar{8, false, false};
+            case Primitive::I8:   return Scalar{8, true, false};
+            case Primitive::I16:  return Scalar{16, true, false};
+            case Primitive::I32:  return Scalar{32, true, false};
+            case Primitive::I64:  return Scalar{64, true, false};
+            case Primitive::I128: return Scalar{128, true, false};
+            case Primitive::U8:   return Scalar{8, false, false};
+            case Primitive::U16:  return Scalar{16, false, false};
+            case Primitive::U32:  return Scalar{32, false, false};
+            case Primitive::U64:  return Scalar{64, false, false};
+            case Primitive::U128: return Scalar{128, false, false};
+            case Primitive::F32:  return Scalar{32, false, true};
+            case Primitive::F64:  return Scalar{64, false, true};
+            case Primitive::Bool: return BOOL;
+            default:              return OPAQUE;
+        }
+    }
+
+    Scalar IRBuilder::getScalar(const ASTNode::Expression& expr) const {
+        std::optional<TypeId> type = m_typer.GetType(expr);
+        return type ? getScalar(type.value()) : OPAQUE;
+    }
+
+    // Structs of nothing but void fields, e.g. []
+    bool IRBuilder::isVoid(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(info.kind != TypeKind::Struct || info.attribs.isOptional)
+            return false;
+        for(const TypeInterner::Field& field : m_types.GetFields(type))
+            if(field.reps != 0 && !isVoid(field.type))
+                return false;
+        return true;
+    }
+
+    bool IRBuilder::hasValue(const ASTNode::Expression& expr) const {
+        std::optional<TypeId> type = m_typer.GetType(expr);
+        return type && !isVoid(type.value());
+    }
+
+    bool IRBuilder::isTracked(const Declaration& decl) {
+        if(m_tracked.contains(decl.id))
+            return true;
+        if(m_untracked.contains(decl.id))
+            return false;
+        // a local is not the function's until its definition is lowered
+        bool isOwn = decl.kind == Declaration::Kind::Parameter ? m_parameters.contains(decl.parameter) : m_locals.contains(decl.id);
+        if(!isOwn)
+            return false;
+        std::optional<TypeId> type = m_typer.GetType(decl);
+        Scalar scalar = type ? getScalar(type.value()) : OPAQUE;
+        if(scalar.width == 0 || m_aliases.IsAddressed(decl)) {
+            m_untracked.insert(decl.id);
+            return false;
+        }
+        m_tracked[decl.id] = scalar;
+        return true;
+    }
+
+    Scalar IRBuilder::getValueScalar(Value value) const {
+        return value != NONE ? m_function.instructions[value].scalar : OPAQUE;
+    }
+
+    Scalar IRBuilder::getVariableScalar(std::uint32_t variable) const {
+        if(variable < m_numDeclarations)
+            return m_tracked.at(variable);
+        return m_variableScalars[variable - m_numDeclarations];
+    }
+
+    /*
+     *
+     * Blocks and instructions
+     *
+     */
+
+    IRBuilder::BlockId IRBuilder::newBlock(bool isSealed) {
+        BlockId block = BlockId(m_function.blocks.size());
+        m_function.blocks.emplace_back();
+        m_pendingPhis.emplace_back();
+        m_isSealed.push_back(isSealed);
+        return block;
+    }
+
+    IRBuilder::Value IRBuilder::emit(Op op, Scalar scalar, std::span<const Value> operands, Slot imm) {
+        if(op == Op::Call || op == Op::Store)
+            m_numEffects++;
+        Value value = Value(m_function.instructions.size());
+        m_function.instructions.push_back(IR::Instruction{
+            op, scalar, m_block, std::uint32_t(m_function.operands.size()), std::uint32_t(operands.size()), imm, false
+        });
+        m_function.operands.insert(m_function.operands.end(), operands.begin(), operands.end());
+        m_function.blocks[m_block].code.push_back(value);
+        return value;
+    }
+
+    IRBuilder::Value IRBuilder::emitGathered(std::size_t mark, Op op, Scalar scalar, Slot imm) {
+        Value value = emit(op, scalar, std::span<const Value>(m_scratch).subspan(mark), imm);
+        m_scratch.resize(mark);
+        return value;
+    }
+
+    IRBuilder::Value IRBuilder::emitConst(Scalar scalar, Slot imm) {
+        return emit(Op::Const, scalar, {}, imm);
+    }
+
+    // Both operands are of the scalar, the shift amount of any integer
+    IRBuilder::Value IRBuilder::emitOperation(Op op, Scalar scalar, Value first, Value second, Scalar secondScalar) {
+        bool isShift = op == Op::Shl || op == Op::Shr;
+        bool isModelled = scalar.width != 0 && first != NONE && second != NONE
+            && (isShift ? secondScalar.width > 1 && !secondScalar.isFloat && !scalar.isFloat : secondScalar == scalar);
+        std::size_t mark = m_scratch.size();
+        for(Value operand : {first, second})
+            if(operand != NONE)
+                m_scratch.push_back(operand);
+        return emitGathered(mark, isModelled ? op : Op::Opaque, scalar);
+    }
+
+    IRBuilder::Value IRBuilder::insert(BlockId block, Op op, Scalar scalar, Slot imm) {
+        Value value = Value(m_function.instructions.size());
+        m_function.instructions.push_back(IR::Instruction{op, scalar, block, std::uint32_t(m_function.operands.size()), 0, imm, false});
+        std::vector<Value>& code = m_function.blocks[block].code;
+        auto it = std::find_if(code.begin(), code.end(), [&](Value other) {
+            Op otherOp = m_function.instructions[other].op;
+            return otherOp != Op::Phi && otherOp != Op::Copy;
+        });
+        code.insert(it, value);
+        return value;
+    }
+
+    void IRBuilder::jump(BlockId target) {
+        emit(Op::Jump, OPAQUE, {}, target);
+        m_function.blocks[target].preds.push_back(m_block);
+    }
+
+    void IRBuilder::branch(Value condition, BlockId success, BlockId failure) {
+        emit(Op::Branch, OPAQUE, std::span<const Value>(&condition, 1), Slot(success) | Slot(failure) << 32);
+        m_function.blocks[success].preds.push_back(m_block);
+        m_function.blocks[failure].preds.push_back(m_block);
+    }
+
+    void IRBuilder::leave() {
+        m_block = newBlock(true);
+    }
+
+    // Reads of other variables may add pending phis while these are completed
+    void IRBuilder::seal(BlockId block) {
+        for(std::size_t i = 0; i < m_pendingPhis[block].size(); i++) {
+            PendingPhi pending = m_pendingPhis[block][i];
+            addPhiOperands(pending.variable, pending.phi);
+        }
+        m_pendingPhis[block].clear();
+        m_isSealed[block] = true;
+    }
+
+    IRBuilder::BlockId IRBuilder::getExit(Target& target) {
+        if(target.exit == NONE)
+            target.exit = newBlock();
+        return target.exit;
+    }
+
+    /*
+     *
+     * SSA construction
+     *
+     */
+
+    std::uint32_t IRBuilder::newVariable(Scalar scalar) {
+        m_variableScalars.push_back(scalar);
+        return std::uint32_t(m_numDeclarations + m_variableScalars.size() - 1);
+    }
+
+    void IRBuilder::writeVariable(std::uint32_t variable, BlockId block, Value value) {
+        m_definitions[std::uint64_t(block) << 32 | variable] = value;
+    }
+
+    IRBuilder::Value IRBuilder::readVariable(std::uint32_t variable, BlockId block) {
+        auto it = m_definitions.find(std::uint64_t(block) << 32 | variable);
+        if(it != m_definitions.end())
+            return it->second;
+        return readVariableRecursive(variable, block);
+    }
+
+    IRBuilder::Value IRBuilder::readVariableRecursive(std::uint32_t variable, BlockId block) {
+        Scalar scalar = getVariableScalar(variable);
+        Value value;
+        if(!m_isSealed[block]) {
+            value = insert(block, Op::Phi, scalar);
+            m_pendingPhis[block].push_back(PendingPhi{variable, value});
+        }
+        else if(m_function.blocks[block].preds.empty()) {
+            // parameters are defined on entry, blocks no jump reaches have nothing defined
+            bool isParameter = variable < m_numDeclarations && m_analyzer.GetDeclaration(variable).kind == Declaration::Kind::Parameter;
+            if(isParameter)
+                value = block == 0 ? insert(0, Op::Param, scalar, variable) : readVariable(variable, 0);
+            else
+                value = insert(block, Op::Undef, scalar);
+        }
+        else if(m_function.blocks[block].preds.size() == 1)
+            value = readVariable(variable, m_function.blocks[block].preds[0]);
+        else {
+            // defined before its operands are read, so that a loop back to the block ends there
+            value = insert(block, Op::Phi, scalar);
+            writeVariable(variable, block, value);
+            addPhiOperands(variable, value);
+        }
+        writeVariable(variable, block, value);
+        return value;
+    }
+
+    void IRBuilder::addPhiOperands(std::uint32_t variable, Value phi) {
+        BlockId block = m_function.instructions[phi].block;
+        std::size_t mark = m_scratch.size();
+        for(std::size_t i = 0; i < m_function.blocks[block].preds.size(); i++) {
+            Value operand = readVariable(variable, m_function.blocks[block].preds[i]);
+            m_scratch.push_back(operand);
+        }
+        IR::Instruction& instruction = m_function.instructions[phi];
+        instruction.firstOperand = std::uint32_t(m_function.operands.size());
+        instruction.numOperands = std::uint32_t(m_scratch.size() - mark);
+        m_function.operands.insert(m_function.operands.end(), m_scratch.begin() + std::ptrdiff_t(mark), m_scratch.end());
+        m_scratch.resize(mark);
+        tryRemoveTrivialPhi(phi);
+    }
+
+    // A phi of itself and one other value is that value, one of nothing but itself stays
+    void IRBuilder::tryRemoveTrivialPhi(Value phi) {
+        Value same = NONE;
+        for(Value operand : IR::GetOperands(m_function, phi)) {
+            operand = IR::Resolve(m_function, operand);
+            if(operand == same || operand == phi)
+                continue;
+            if(same != NONE)
+                return;
+            same = operand;
+        }
+        if(same == NONE)
+            return;
+        IR::Instruction& instruction = m_function.instructions[phi];
+        instruction.op = Op::Copy;
+        instruction.numOperands = 1;
+        m_function.operands[instruction.firstOperand] = same;
+    }
+
+    /*
+     *
+     * Expressions
+     *
+     */
+
+    IRBuilder::Value IRBuilder::lowerExpression(const ASTNode::Expression& expr) {
+        std::size_t numEffects = m_numEffects;
+        Value value = lowerExpressionData(expr);
+        if(value != NONE)
+            m_function.values[&expr] = value;
+        if(m_numEffects != numEffects)
+            m_function.effects.insert(&expr);
+        return value;
+    }
+
+    // Comp expressions are their value
+    IRBuilder::Value IRBuilder::lowerExpressionData(const ASTNode::Expression& expr) {
+        auto comp = m_compValues.find(&expr);
+        if(comp != m_compValues.end()) {
+            Scalar scalar = getScalar(expr);
+            if(scalar.width != 0 && comp->second->slots.size() == 1)
+                return emitConst(scalar, comp->second->slots[0]);
+            return emit(Op::Opaque, scalar);
+        }
+
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                return lowerLiteral(literal, expr);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                return lowerCall(funcCall, expr);
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                return lowerBlock(block, expr);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                return lowerIf(ifExpr, expr);
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                return lowerLoop(loop, expr);
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                return lowerUnary(unaryOp, expr);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                return lowerBinary(binOp, expr);
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                return lowerName(name, expr);
+            }
+        }, expr.Get());
+    }
+
+    // Number literals take the type they are used as
+    IRBuilder::Value IRBuilder::lowerLiteral(const ASTNode::ExpressionLiteral& literal, const ASTNode::Expression& expr) {
+        Scalar scalar = getScalar(expr);
+        if(!literal.Get())
+            return emit(Op::Opaque, scalar);
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral::Int& value) {
+                if(scalar.width == 0)
+                    return emit(Op::Opaque, scalar);
+                if(scalar.isFloat)
+                    return emitConst(scalar, Bytecode::FromFloat(double(value), scalar.width));
+                return emitConst(scalar, Bytecode::Normalize(value, scalar.width, scalar.isSigned));
+            },
+            [&](const ASTNode::ExpressionLiteral::Float& value) {
+                if(!scalar.isFloat)
+                    return emit(Op::Opaque, scalar);
+                return emitConst(scalar, Bytecode::FromFloat(value, scalar.width));
+            },
+            [&](const ASTNode::ExpressionLiteral::String&) {
+                return emit(Op::Opaque, scalar);
+            },
+            [&](const ASTNode::ExpressionLiteral::Char& value) {
+                if(scalar.width == 0 || scalar.isFloat)
+                    return emit(Op::Opaque, scalar);
+                return emitConst(scalar, Bytecode::Normalize(Slot(std::uint8_t(value)), scalar.width, scalar.isSigned));
+            },
+            [&](const ASTNode::ExpressionLiteral::Bool& value) {
+                if(scalar != BOOL)
+                    return emit(Op::Opaque, scalar);
+                return emitConst(scalar, value ? 1 : 0);
+            },
+            [&](const ASTNode::ExpressionLiteral::Struct& structLit) {
+                std::size_t mark = m_scratch.size();
+                for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields()) {
+                    Value value = lowerExpression(*field.GetValue());
+                    if(value != NONE)
+                        m_scratch.push_back(value);
+                }
+                return emitGathered(mark, Op::Opaque, scalar);
+            }
+        }, literal.Get().value());
+    }
+
+    IRBuilder::Value IRBuilder::lowerName(const ASTNode::ExpressionName& name, const ASTNode::Expression& expr) {
+        const Declaration * decl = m_analyzer.GetDeclaration(name);
+        if(!decl)
+            return emit(Op::Opaque, getScalar(expr));
+        if(isTracked(*decl)) {
+            auto it = m_variableIdxs.find(decl->id);
+            if(it != m_variableIdxs.end())
+                m_function.variables[it->second].reads.push_back(&expr);
+            return readVariable(decl->id, m_block);
+        }
+        if(getFunctionDefinition(*decl))
+            return emit(Op::Opaque, OPAQUE);
+        return emit(Op::Load, getScalar(expr), {}, decl->id);
+    }
+
+    // Arguments in source order, the defaults are not lowered
+    IRBuilder::Value IRBuilder::lowerCall(const ASTNode::ExpressionFunctionCall& funcCall, const ASTNode::Expression& expr) {
+        std::size_t mark = m_scratch.size();
+        Slot callee = NONE;
+        auto name = std::get_if<ASTNode::ExpressionName>(&funcCall.GetFunction()->Get());
+        const Declaration * decl = name ? m_analyzer.GetDeclaration(*name) : nullptr;
+        if(decl && getFunctionDefinition(*decl))
+            callee = decl->id;
+        else {
+            Value function = lowerExpression(*funcCall.GetFunction());
+            if(function != NONE)
+                m_scratch.push_back(function);
+        }
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields()) {
+            Value value = lowerExpression(*field.GetValue());
+            if(value != NONE)
+                m_scratch.push_back(value);
+        }
+        return emitGathered(mark, Op::Call, getScalar(expr), callee);
+    }
+
+    IRBuilder::Value IRBuilder::lowerUnary(const ASTNode::ExpressionUnaryOperation& unaryOp, const ASTNode::Expression& expr) {
+        Scalar scalar = getScalar(expr);
+        std::optional<Op> op;
+        switch(unaryOp.GetKind()) {
+            case UnOpKind::ArithmeticNegation: op = Op::Neg; break;
+            case UnOpKind::BitwiseNegation:    op = Op::Not; break;
+            case UnOpKind::LogicalNegation:    op = Op::LogicalNot; break;
+            case UnOpKind::Comp:               return emit(Op::Opaque, scalar); // reported by the CTEE
+            default:                           break;
+        }
+
+        const ASTNode::Expression& operandExpr = *unaryOp.GetOperand();
+        Value operand = lowerExpression(operandExpr);
+        if(operand == NONE)
+            return emit(Op::Opaque, scalar);
+        bool isModelled = op && scalar.width != 0 && getValueScalar(operand) == scalar
+            && (op != Op::LogicalNot || scalar == BOOL) && (op != Op::Not || !scalar.isFloat);
+        return emit(isModelled ? op.value() : Op::Opaque, scalar, std::span<const Value>(&operand, 1));
+    }
+
+    IRBuilder::Value IRBuilder::lowerBinary(const ASTNode::ExpressionBinaryOperation& binOp, const ASTNode::Expression& expr) {
+        const ASTNode::Expression& firstExpr = *binOp.GetOperands().first;
+        const ASTNode::Expression& secondExpr = *binOp.GetOperands().second;
+        Scalar scalar = getScalar(expr);
+        switch(binOp.GetKind()) {
+            case BinOpKind::StructMemberAccess: {
+                // the member is not a name
+                Value object = lowerExpression(firstExpr);
+                if(object == NONE)
+                    return emit(Op::Opaque, scalar);
+                return emit(Op::Opaque, scalar, std::span<const Value>(&object, 1));
+            }
+            case BinOpKind::TypeCast:
+                return emit(Op::Opaque, scalar); // reported by the typer
+            case BinOpKind::And:
+            case BinOpKind::Or:
+                return lowerLogical(binOp, expr);
+            default:
+                break;
+        }
+
+        Value first = lowerExpression(firstExpr);
+        Value second = lowerExpression(secondExpr);
+        Scalar firstScalar = getValueScalar(first);
+        Scalar secondScalar = getValueScalar(second);
+        bool isSwapped = false;
+        Op op = Op::Opaque;
+        switch(binOp.GetKind()) {
+            case BinOpKind::Add:        op = Op::Add; break;
+            case BinOpKind::Sub:        op = Op::Sub; break;
+            case BinOpKind::Mul:        op = Op::Mul; break;
+            case BinOpKind::Div:        op = Op::Div; break;
+            case BinOpKind::Mod:        op = Op::Mod; break;
+            case BinOpKind::BitOr:      op = Op::Or; break;
+            case BinOpKind::BitXor:     op = Op::Xor; break;
+            case BinOpKind::BitAnd:     op = Op::And; break;
+            case BinOpKind::BitLShift:  op = Op::Shl; break;
+            case BinOpKind::BitRShift:  op = Op::Shr; break;
+            case BinOpKind::Eq:         op = Op::Eq; break;
+            case BinOpKind::Uneq:       op = Op::Ne; break;
+            case BinOpKind::Less:       op = Op::Lt; break;
+            case BinOpKind::LessEqual:  op = Op::Le; break;
+            case BinOpKind::Great:      op = Op::Lt; isSwapped = true; break;
+            case BinOpKind::GreatEqual: op = Op::Le; isSwapped = true; break;
+            default: break;
+        }
+        if(isSwapped)
+            std::swap(first, second);
+
+        // comparisons are of the operands' scalar, optionals and structs are not
+        bool isComparison = op == Op::Eq || op == Op::Ne || op == Op::Lt || op == Op::Le;
+        if(isComparison) {
+            bool isModelled = scalar == BOOL && firstScalar.width != 0 && firstScalar == secondScalar && first != NONE && second != NONE;
+            std::size_t mark = m_scratch.size();
+            for(Value operand : {first, second})
+                if(operand != NONE)
+                    m_scratch.push_back(operand);
+            return emitGathered(mark, isModelled ? op : Op::Opaque, scalar);
+        }
+        if(firstScalar != scalar)
+            op = Op::Opaque;
+        return emitOperation(op, scalar, first, second, secondScalar);
+    }
+
+    // The second operand is only evaluated if the first does not decide the result
+    IRBuilder::Value IRBuilder::lowerLogical(const ASTNode::ExpressionBinaryOperation& binOp, const ASTNode::Expression& expr) {
+        std::uint32_t variable = newVariable(getScalar(expr));
+        Value first = lowerExpression(*binOp.GetOperands().first);
+        if(first == NONE)
+            first = emit(Op::Opaque, getScalar(expr));
+        writeVariable(variable, m_block, first);
+        BlockId second = newBlock();
+        BlockId join = newBlock();
+        if(binOp.GetKind() == BinOpKind::And)
+            branch(first, second, join);
+        else
+            branch(first, join, second);
+        seal(second);
+
+        m_block = second;
+        Value value = lowerExpression(*binOp.GetOperands().second);
+        if(value != NONE)
+            writeVariable(variable, m_block, value);
+        jump(join);
+        seal(join);
+        m_block = join;
+        return readVariable(variable, join);
+    }
+
+    IRBuilder::Value IRBuilder::lowerBlock(const ASTNode::ExpressionBlock& block, const ASTNode::Expression& expr) {
+        std::uint32_t variable = hasValue(expr) ? newVariable(getScalar(expr)) : NONE;
+        m_targets.push_back(Target{&block.GetLabel(), false, variable, NONE, NONE});
+        for(const ASTNode::Statement& stmt : block.GetStatements())
+            lowerStatement(stmt);
+        Target target = m_targets.back();
+        m_targets.pop_back();
+        if(target.exit != NONE) {
+            jump(target.exit);
+            seal(target.exit);
+            m_block = target.exit;
+        }
+        return variable != NONE ? readVariable(variable, m_block) : NONE;
+    }
+
+    IRBuilder::Value IRBuilder::lowerIf(const ASTNode::ExpressionIf& ifExpr, const ASTNode::Expression& expr) {
+        std::uint32_t variable = hasValue(expr) ? newVariable(getScalar(expr)) : NONE;
+        Value condition = lowerExpression(*ifExpr.GetCondition());
+        if(condition == NONE)
+            condition = emit(Op::Opaque, BOOL);
+        BlockId success = newBlock();
+        BlockId failure = ifExpr.GetFailStatement() ? newBlock() : NONE;
+        BlockId join = newBlock();
+        branch(condition, success, failure != NONE ? failure : join);
+        seal(success);
+
+        m_block = success;
+        Value value = lowerStatementValue(*ifExpr.GetSuccessStatement());
+        if(variable != NONE && value != NONE)
+            writeVariable(variable, m_block, value);
+        jump(join);
+        if(failure != NONE) {
+            seal(failure);
+            m_block = failure;
+            value = lowerStatementValue(*ifExpr.GetFailStatement().value());
+            if(variable != NONE && value != NONE)
+                writeVariable(variable, m_block, value);
+            jump(join);
+        }
+        seal(join);
+        m_block = join;
+        return variable != NONE ? readVariable(variable, join) : NONE;
+    }
+
+    // The header checks the condition, a continue jumps to the post statement, which goes back to the header
+    IRBuilder::Value IRBuilder::lowerLoop(const ASTNode::ExpressionLoop& loop, const ASTNode::Expression& expr) {
+        std::uint32_t variable = hasValue(expr) ? newVariable(getScalar(expr)) : NONE;
+        m_numEffects++; // it may not end
+        if(loop.GetInitStatement())
+            lowerStatement(*loop.GetInitStatement().value());
+        BlockId header = newBlock();
+        m_function.loops[&loop] = header;
+        jump(header);
+        m_block = header;
+
+        std::size_t targetIdx = m_targets.size();
+        m_targets.push_back(Target{nullptr, true, variable, NONE, newBlock()});
+        if(loop.GetCondition()) {
+            Value condition = lowerExpression(*loop.GetCondition().value());
+            if(condition == NONE)
+                condition = emit(Op::Opaque, BOOL);
+            BlockId body = newBlock();
+            branch(condition, body, getExit(m_targets[targetIdx]));
+            seal(body);
+            m_block = body;
+        }
+        lowerStatement(*loop.GetBodyStatement());
+        BlockId next = m_targets[targetIdx].next;
+        jump(next);
+        seal(next);
+        m_block = next;
+        if(loop.GetPostStatement())
+            lowerStatement(*loop.GetPostStatement().value());
+        jump(header);
+        seal(header);
+        Target target = m_targets.back();
+        m_targets.pop_back();
+
+        // an endless loop that is never broken out of is not left
+        if(target.exit == NONE)
+            leave();
+        else {
+            seal(target.exit);
+            m_block = target.exit;
+        }
+        return variable != NONE ? readVariable(variable, m_block) : NONE;
+    }
+
+    /*
+     *
+     * Statements
+     *
+     */
+
+    IRBuilder::Value IRBuilder::lowerStatementValue(const ASTNode::Statement& stmt) {
+        if(auto expr = std::get_if<ASTNode::StatementExpression>(&stmt.Get()))
+            return lowerExpression(*expr);
+        lowerStatement(stmt);
+        return NONE;
+    }
+
+    void IRBuilder::lowerStatement(const ASTNode::Statement& stmt) {
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                lowerExpression(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                Op op = Op::Opaque;
+                switch(binOp.GetKind()) {
+                    case StmtBinOpKind::AddEq:       op = Op::Add; break;
+                    case StmtBinOpKind::SubEq:       op = Op::Sub; break;
+                    case StmtBinOpKind::MulEq:       op = Op::Mul; break;
+                    case StmtBinOpKind::DivEq:       op = Op::Div; break;
+                    case StmtBinOpKind::ModEq:       op = Op::Mod; break;
+                    case StmtBinOpKind::BitOrEq:     op = Op::Or; break;
+                    case StmtBinOpKind::BitXorEq:    op = Op::Xor; break;
+                    case StmtBinOpKind::BitAndEq:    op = Op::And; break;
+                    case StmtBinOpKind::BitLShiftEq: op = Op::Shl; break;
+                    case StmtBinOpKind::BitRShiftEq: op = Op::Shr; break;
+                }
+                Value result = lowerAssignment(binOp.GetOperands().first, binOp.GetOperands().second, op);
+                if(result != NONE)
+                    m_function.assignments[&stmt] = result;
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                lowerDefinition(varDef, stmt);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                lowerAssignment(assign.GetLValue(), assign.GetRValue(), {});
+            },
+            [&](const ASTNode::StatementContinue&) {
+                lowerContinue();
+            },
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                lowerBreak(stmtBreak);
+            }
+        }, stmt.Get());
+    }
+
+    // Scalars defined without a value are zero
+    void IRBuilder::lowerDefinition(const ASTNode::StatementVariableDefinition& varDef, const ASTNode::Statement& stmt) {
+        const Declaration * decl = m_analyzer.GetDeclaration(stmt);
+        if(decl && getFunctionDefinition(*decl))
+            return; // lowered on its own
+        const ASTNode::Expression * valueExpr = std::visit(overloaded{
+            [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) -> const ASTNode::Expression * {
+                return typedVarDef.GetValue() ? &typedVarDef.GetValue().value() : nullptr;
+            },
+            [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) -> const ASTNode::Expression * {
+                return &untypedVarDef.GetValue();
+            }
+        }, varDef);
+        Value value = valueExpr ? lowerExpression(*valueExpr) : NONE;
+        if(!decl)
+            return;
+
+        m_locals.insert(decl->id);
+        if(isTracked(*decl)) {
+            m_variableIdxs[decl->id] = m_function.variables.size();
+            m_function.variables.push_back(IR::Variable{decl->id, false, {}});
+            writeVariable(decl->id, m_block, value != NONE ? value : emitConst(m_tracked.at(decl->id), 0));
+            return;
+        }
+        emit(Op::Store, OPAQUE, value != NONE ? std::span<const Value>(&value, 1) : std::span<const Value>(), decl->id);
+    }
+
+    // A name, or the place a pointer or a struct the field is of points to
+    IR::Value IRBuilder::lowerAssignment(const ASTNode::Expression::LValue& lvalue, const ASTNode::Expression& value, std::optional<Op> compound) {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                const Declaration * decl = m_analyzer.GetDeclaration(name);
+                if(decl && isTracked(*decl)) {
+                    m_numEffects++;
+                    auto it = m_variableIdxs.find(decl->id);
+                    if(it != m_variableIdxs.end())
+                        m_function.variables[it->second].isAssigned = true;
+                    Scalar scalar = m_tracked.at(decl->id);
+                    Value result = lowerExpression(value);
+                    if(compound)
+                        result = emitOperation(compound.value(), scalar, readVariable(decl->id, m_block), result, getValueScalar(result));
+                    if(result != NONE)
+                        writeVariable(decl->id, m_block, result);
+                    return result;
+                }
+                Slot id = decl ? decl->id : NONE;
+                std::optional<TypeId> type = decl ? m_typer.GetType(*decl) : std::nullopt;
+                Scalar scalar = type ? getScalar(type.value()) : OPAQUE;
+                Value result = lowerExpression(value);
+                if(compound)
+                    result = emitOperation(compound.value(), scalar, emit(Op::Load, scalar, {}, id), result, getValueScalar(result));
+                emit(Op::Store, OPAQUE, result != NONE ? std::span<const Value>(&result, 1) : std::span<const Value>(), id);
+                return result;
+            },
+            [&](const ASTNode::Expression::PointerDereference& pointer) {
+                lowerStore(lowerExpression(*pointer), value, compound);
+                return NONE;
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                lowerStore(lowerExpression(*operands.first), value, compound);
+                return NONE;
+            }
+        }, lvalue);
+    }
+
+    // The old value of the place is not modelled, so neither is the result of a compound assignment to it
+    void IRBuilder::lowerStore(Value place, const ASTNode::Expression& value, std::optional<Op> compound) {
+        Value result = lowerExpression(value);
+        if(compound) {
+            std::size_t mark = m_scratch.size();
+            for(Value operand : {place, result})
+                if(operand != NONE)
+                    m_scratch.push_back(operand);
+            result = emitGathered(mark, Op::Opaque, OPAQUE);
+        }
+        std::size_t mark = m_scratch.size();
+        for(Value operand : {result, place})
+            if(operand != NONE)
+                m_scratch.push_back(operand);
+        emitGathered(mark, Op::Store, OPAQUE, NONE);
+    }
+
+    // A labelled break leaves its block, otherwise the innermost loop, or block if there is none
+    void IRBuilder::lowerBreak(const ASTNode::StatementBreak& stmtBreak) {
+        std::size_t targetIdx = m_targets.size();
+        for(std::size_t idx = m_targets.size(); idx-- > 0;) {
+            const Target& target = m_targets[idx];
+            if(stmtBreak.GetLabel() ? target.label && *target.label == stmtBreak.GetLabel() : target.isLoop) {
+                targetIdx = idx;
+                break;
+            }
+        }
+        if(targetIdx == m_targets.size() && !stmtBreak.GetLabel() && !m_targets.empty())
+            targetIdx = m_targets.size() - 1;
+
+        Value value = stmtBreak.GetValue() ? lowerExpression(stmtBreak.GetValue().value()) : NONE;
+        m_numEffects++;
+        if(targetIdx == m_targets.size()) {
+            leave(); // reported by the analyzer and the typer
+            return;
+        }
+        std::uint32_t variable = m_targets[targetIdx].variable;
+        if(variable != NONE && value != NONE)
+            writeVariable(variable, m_block, value);
+        jump(getExit(m_targets[targetIdx]));
+        leave();
+    }
+
+    void IRBuilder::lowerContinue() {
+        m_numEffects++;
+        for(auto it = m_targets.rbegin(); it != m_targets.rend(); it++) {
+            if(it->isLoop) {
+                jump(it->next);
+                break;
+            }
+        }
+        leave();
+    }
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "AliasAnalysis.hpp"
+#include "Analyzer.hpp"
+#include "Ctee.hpp"
+#include "IR.hpp"
+#include "TypeInterner.hpp"
+#include "Typer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Lowers typed function bodies to SSA IR.
+    //
+    // SSA is built in the same walk that lowers the AST, without dominance frontiers: a variable
+    // read looks up its definition in the current block, then in its predecessors, and a phi
+    // is placed where they meet (Braun et al., "Simple and Efficient Construction of Static Single
+    // Assignment Form"). Blocks whose predecessors are not all known yet, loop headers and the
+    // ends of blocks that are broken out of, are sealed once they are, and their pending phis
+    // completed then. Phis that turn out to have a single value become copies of it.
+    //
+    // The values of blocks, ifs and loops and the results of and and or are variables of their
+    // own that their breaks and branches define, so they meet in a phi like any other.
+    //
+    // Expressions whose lowering calls, stores, assigns a variable, leaves a block or loops are
+    // recorded as having effects, so passes may drop or replace only the others.
+    //
+    class IRBuilder {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+        using CompValues = std::unordered_map<const ASTNode::Expression *, const Ctee::Value *>;
+
+        IRBuilder(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types, const AliasAnalysis& aliases, const CompValues& compValues);
+
+        // The buffers of the builder are reused by the next function
+        IR::Function Build(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body);
+
+    private:
+        using Value = IR::Value;
+        using BlockId = IR::BlockId;
+        using Op = IR::Op;
+        using Scalar = IR::Scalar;
+
+        static constexpr Value NONE = IR::NONE;
+        static constexpr Scalar OPAQUE = {0, false, false};
+        static constexpr Scalar BOOL = {1, false, false};
+
+        // A block or loop that can be broken out of
+        struct Target {
+            const ASTNode::ExpressionBlock::Label * label;
+            bool isLoop;
+            std::uint32_t variable; // of its value, NONE if it has none
+            BlockId exit;           // NONE until it is broken out of
+            BlockId next;           // loops: where a continue jumps to
+        };
+
+        // A phi of a block that is not sealed, completed when it is
+        struct PendingPhi {
+            std::uint32_t variable;
+            Value phi;
+        };
+
+        static const ASTNode::TypeFunction * getFunctionDefinition(const Declaration& decl);
+
+        Scalar getScalar(TypeId type) const;
+        Scalar getScalar(const ASTNode::Expression& expr) const;
+        bool isVoid(TypeId type) const;
+        // The expression has a value that is not void
+        bool hasValue(const ASTNode::Expression& expr) const;
+        // A local or parameter of the function that is a scalar and whose address is never taken
+        bool isTracked(const Declaration& decl);
+        Scalar getValueScalar(Value value) const;
+        Scalar getVariableScalar(std::uint32_t variable) const;
+
+        BlockId newBlock(bool isSealed = false);
+        Value emit(Op op, Scalar scalar, std::span<const Value> operands = {}, Bytecode::Slot imm = 0);
+        // With the operands gathered in the scratch past the mark, which are popped
+        Value emitGathered(std::size_t mark, Op op, Scalar scalar, Bytecode::Slot imm = 0);
+        Value emitConst(Scalar scalar, Bytecode::Slot imm);
+        // The operation if the IR models it for the operands, else an opaque value of them
+        Value emitOperation(Op op, Scalar scalar, Value first, Value second, Scalar secondScalar);
+        // Phis, parameters and undefined values are placed at the start of their block, it may be complete
+        Value insert(BlockId block, Op op, Scalar scalar, Bytecode::Slot imm = 0);
+        void jump(BlockId target);
+        void branch(Value condition, BlockId success, BlockId failure);
+        // Continues in a block no jump reaches, after a break or continue
+        void leave();
+        void seal(BlockId block);
+        BlockId getExit(Target& target);
+
+        std::uint32_t newVariable(Scalar scalar);
+        void writeVariable(std::uint32_t variable, BlockId block, Value value);
+        Value readVariable(std::uint32_t variable, BlockId block);
+        Value readVariableRecursive(std::uint32_t variable, BlockId block);
+        void addPhiOperands(std::uint32_t variable, Value phi);
+        void tryRemoveTrivialPhi(Value phi);
+
+        Value lowerExpression(const ASTNode::Expression& expr);
+        Value lowerExpressionData(const ASTNode::Expression& expr);
+        Value lowerLiteral(const ASTNode::ExpressionLiteral& literal, const ASTNode::Expression& expr);
+        Value lowerName(const ASTNode::ExpressionName& name, const ASTNode::Expression& expr);
+        Value lowerCall(const ASTNode::ExpressionFunctionCall& funcCall, const ASTNode::Expression& expr);
+        Value lowerUnary(const ASTNode::ExpressionUnaryOperation& unaryOp, const ASTNode::Expression& expr);
+        Value lowerBinary(const ASTNode::ExpressionBinaryOperation& binOp, const ASTNode::Expression& expr);
+        Value lowerLogical(const ASTNode::ExpressionBinaryOperation& binOp, const ASTNode::Expression& expr);
+        Value lowerBlock(const ASTNode::ExpressionBlock& block, const ASTNode::Expression& expr);
+        Value lowerIf(const ASTNode::ExpressionIf& ifExpr, const ASTNode::Expression& expr);
+        Value lowerLoop(const ASTNode::ExpressionLoop& loop, const ASTNode::Expression& expr);
+        // The value of an expression statement, NONE for other statements
+        Value lowerStatementValue(const ASTNode::Statement& stmt);
+        void lowerStatement(const ASTNode::Statement& stmt);
+        void lowerDefinition(const ASTNode::StatementVariableDefinition& varDef, const ASTNode::Statement& stmt);
+        // compound: the operation of a compound assignment, value is its right operand. The value
+        // assigned to a name, NONE for other places
+        Value lowerAssignment(const ASTNode::Expression::LValue& lvalue, const ASTNode::Expression& value, std::optional<Op> compound);
+        // Through a place computed from a pointer or struct
+        void lowerStore(Value place, const ASTNode::Expression& value, std::optional<Op> compound);
+        void lowerBreak(const ASTNode::StatementBreak& stmtBreak);
+        void lowerContinue();
+
+        const Analyzer& m_analyzer;
+        const Typer& m_typer;
+        const TypeInterner& m_types;
+        const AliasAnalysis& m_aliases;
+        const CompValues& m_compValues;
+
+        IR::Function m_function;
+        BlockId m_block = 0;                                     // being appended to
+        std::size_t m_numDeclarations = 0;                       // variables past them are values of expressions
+        std::vector<Scalar> m_variableScalars;                   // by variable past the declarations
+        std::unordered_map<std::uint32_t, Scalar> m_tracked;     // by declaration id, tracked ones
+        std::unordered_set<std::uint32_t> m_untracked;           // by declaration id
+        std::unordered_set<std::uint32_t> m_locals;              // by declaration id, defined in the function
+        std::unordered_set<const ASTNode::TypeStruct::NamedField *> m_parameters;
+        std::unordered_map<std::uint32_t, std::size_t> m_variableIdxs; // by declaration id, into the variables of the function
+        std::unordered_map<std::uint64_t, Value> m_definitions;  // by block << 32 | variable
+        std::vector<std::vector<PendingPhi>> m_pendingPhis;      // by block
+        std::vector<bool> m_isSealed;                            // by block
+        std::vector<Target> m_targets;
+        std::vector<Value> m_scratch;                            // operands being gathered, nested ones push on top
+        std::size_t m_numEffects = 0;                            // lowered so far
+    };
+
+}
@@ -81,6 +81,19 @@ namespace ry {
         m_infos.push_back(info);
     }
 
+    void Infos::Truncate(std::size_t size) {
+        if(size < m_infos.size())
+            m_infos.erase(m_infos.begin() + size, m_infos.end());
+    }
+
+    const std::vector<Info>& Infos::Get() const {
+        return m_infos;
+    }
+
+    std::string_view Infos::GetId() const {
+        return m_id;
+    }
+
     std::size_t Infos::GetLineStartIndex(std::size_t ln) const {
         return m_lineStartIndices.at(ln - 1);
     }
@@ -101,6 +114,10 @@ namespace ry {
             auto startPtr = m_src.data() + m_lineStartIndices[startLn - 1];
             auto endPtr = m_src.data() + m_lineEndIndices[startLn - 1];
             std::string_view line(startPtr, endPtr);
+
+            // only the first line is shown, multiline spans are underlined up to its end
+            if(endLn != startLn || endCol < startCol)
+                endCol = std::max(startCol, line.length());
             
             std::size_t lnLen = std::floor(std::log10(startLn)) + 1;
             std::size_t leftBarLen = std::max(lnLen, m_id.length());
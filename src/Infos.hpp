@@ -47,6 +47,10 @@ namespace ry {
         Infos(std::string_view id, std::string_view src);
 
         void Push(const Info& info);
+        // Drops the infos pushed after the first size ones
+        void Truncate(std::size_t size);
+        const std::vector<Info>& Get() const;
+        std::string_view GetId() const;
 
         std::size_t GetLineStartIndex(std::size_t ln) const;
         std::size_t GetLineEndIndex(std::size_t ln) const;
@@ -0,0 +1,367 @@
+#include "Inliner.hpp"
+#include "ry.hpp"
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+#include <variant>
+
+namespace ry {
+
+    using TypeKind = TypeInterner::Kind;
+    using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+
+    Inliner::Inliner(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types):
+        m_analyzer(analyzer),
+        m_typer(typer),
+        m_types(types)
+    {}
+
+    void Inliner::Analyze(const ASTNode& ast, const AliasAnalysis& aliases, std::uint32_t threshold, const Declaration * entry) {
+        std::size_t numDecls = m_analyzer.GetDeclarationCount();
+        m_function = GLOBAL;
+        m_loopDepth = 0;
+        m_isInDefault = false;
+        m_sites.clear();
+        m_siteIdxs.clear();
+        m_functions.clear();
+        m_definitions.clear();
+        m_order.clear();
+        m_owners.assign(numDecls, NONE);
+        m_parameterOwners.clear();
+
+        if(auto stmt = std::get_if<ASTNode::Statement>(&ast.Get()))
+            walkStatement(*stmt);
+        else if(auto expr = std::get_if<ASTNode::Expression>(&ast.Get()))
+            walkExpression(*expr);
+
+        for(const Site& site : m_sites)
+            m_functions[site.callee].numCalls++;
+
+        std::vector<std::uint32_t> stack;
+        std::uint32_t nextIndex = 0;
+        for(std::uint32_t id : m_definitions)
+            if(m_functions[id].index == UINT32_MAX)
+                connect(id, stack, nextIndex);
+
+        // the size of a callee is known before its callers are decided
+        for(std::uint32_t id : m_order) {
+            Function& function = m_functions[id];
+            function.size = function.nodes;
+            for(std::size_t siteIdx : function.sites) {
+                decide(m_sites[siteIdx], threshold, aliases);
+                if(m_sites[siteIdx].decision == Decision::Inlined)
+                    function.size += m_functions[m_sites[siteIdx].callee].size;
+            }
+        }
+        for(Site& site : m_sites)
+            if(site.caller == GLOBAL)
+                decide(site, threshold, aliases);
+
+        std::vector<std::size_t> numInlined(numDecls, 0);
+        for(const Site& site : m_sites)
+            if(site.decision == Decision::Inlined)
+                numInlined[site.callee]++;
+        m_isRemoved.assign(numDecls, false);
+        for(std::uint32_t id : m_definitions) {
+            const Declaration& decl = m_analyzer.GetDeclaration(id);
+            std::size_t numCalls = m_functions[id].numCalls;
+            m_isRemoved[id] = &decl != entry && numCalls > 0 && numInlined[id] == numCalls && aliases.IsCalledOnly(decl);
+        }
+    }
+
+    bool Inliner::IsInlined(const ASTNode::ExpressionFunctionCall& funcCall) const {
+        auto it = m_siteIdxs.find(&funcCall);
+        return it != m_siteIdxs.end() && m_sites[it->second].decision == Decision::Inlined;
+    }
+
+    bool Inliner::IsRemoved(const Declaration& function) const {
+        return m_isRemoved[function.id];
+    }
+
+    std::size_t Inliner::GetInlinedCount() const {
+        return std::size_t(std::count_if(m_sites.begin(), m_sites.end(), [](const Site& site) {
+            return site.decision == Decision::Inlined;
+        }));
+    }
+
+    std::string Inliner::StringifyDecisions() const {
+        static constexpr std::string_view DECISIONS[] = {
+            "inlined", "too costly", "recursive", "closure", "repeated or unnamed arguments", "in a default value"
+        };
+        std::string str = std::format("{:<10} {:<16} {:<16} {:>5} {:>5} {:>5}  {}\n", "site", "caller", "callee", "loops", "cost", "limit", "decision");
+        for(const Site& site : m_sites) {
+            std::string srcPos = site.srcPos ? std::format("{}:{}", site.srcPos->startLine, site.srcPos->startColumn) : "?";
+            std::string_view caller = site.caller == GLOBAL ? "(top level)" : m_analyzer.GetDeclaration(site.caller).name;
+            bool isCosted = site.decision == Decision::Inlined || site.decision == Decision::Costly;
+            str += std::format(
+                "{:<10} {:<16} {:<16} {:>5} {:>5} {:>5}  {}\n",
+                srcPos, caller, m_analyzer.GetDeclaration(site.callee).name, site.loopDepth,
+                isCosted ? std::to_string(site.cost) : "-", isCosted ? std::to_string(site.limit) : "-",
+                DECISIONS[std::size_t(site.decision)]
+            );
+        }
+        std::string removed;
+        for(std::uint32_t id : m_definitions) {
+            if(!m_isRemoved[id])
+                continue;
+            removed += removed.empty() ? "removed: " : ", ";
+            removed += m_analyzer.GetDeclaration(id).name;
+        }
+        if(!removed.empty())
+            str += removed + '\n';
+        return str;
+    }
+
+    const ASTNode::TypeFunction * Inliner::getFunctionDefinition(const Declaration& decl) {
+        if(decl.kind != Declaration::Kind::Variable)
+            return nullptr;
+        auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get());
+        if(!varDef)
+            return nullptr;
+        auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef);
+        if(!typedVarDef || !typedVarDef->GetValue())
+            return nullptr;
+        return std::get_if<ASTNode::TypeFunction>(&typedVarDef->GetType().Get());
+    }
+
+    /*
+     *
+     * Walk
+     *
+     */
+
+    // Every expression and statement of a body counts, those of the functions defined in it do not
+    void Inliner::walkExpression(const ASTNode::Expression& expr) {
+        if(m_function != GLOBAL)
+            m_functions[m_function].nodes++;
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get())
+                    return;
+                if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                    for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit->GetFields())
+                        walkExpression(*field.GetValue());
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                walkCall(funcCall, expr.GetSourcePosition());
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    walkStatement(stmt);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                walkExpression(*ifExpr.GetCondition());
+                walkStatement(*ifExpr.GetSuccessStatement());
+                if(ifExpr.GetFailStatement())
+                    walkStatement(*ifExpr.GetFailStatement().value());
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                if(loop.GetInitStatement())
+                    walkStatement(*loop.GetInitStatement().value());
+                m_loopDepth++;
+                if(loop.GetCondition())
+                    walkExpression(*loop.GetCondition().value());
+                if(loop.GetPostStatement())
+                    walkStatement(*loop.GetPostStatement().value());
+                walkStatement(*loop.GetBodyStatement());
+                m_loopDepth--;
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                walkExpression(*unaryOp.GetOperand());
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                // the member is not a name
+                walkExpression(*binOp.GetOperands().first);
+                if(binOp.GetKind() != BinOpKind::StructMemberAccess)
+                    walkExpression(*binOp.GetOperands().second);
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                walkName(name);
+            }
+        }, expr.Get());
+    }
+
+    void Inliner::walkStatement(const ASTNode::Statement& stmt) {
+        if(m_function != GLOBAL)
+            m_functions[m_function].nodes++;
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                walkExpression(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                walkLValue(binOp.GetOperands().first);
+                walkExpression(binOp.GetOperands().second);
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                if(const Declaration * decl = m_analyzer.GetDeclaration(stmt)) {
+                    if(const ASTNode::TypeFunction * function = getFunctionDefinition(*decl)) {
+                        walkFunction(*decl, *function, std::get<ASTNode::StatementTypedVariableDefinition>(varDef).GetValue().value());
+                        return;
+                    }
+                    m_owners[decl->id] = m_function;
+                }
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        if(typedVarDef.GetValue())
+                            walkExpression(typedVarDef.GetValue().value());
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        walkExpression(untypedVarDef.GetValue());
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                walkLValue(assign.GetLValue());
+                walkExpression(assign.GetRValue());
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& breakStmt) {
+                if(breakStmt.GetValue())
+                    walkExpression(breakStmt.GetValue().value());
+            }
+        }, stmt.Get());
+    }
+
+    void Inliner::walkLValue(const ASTNode::Expression::LValue& lvalue) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                walkName(name);
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                walkExpression(*operand);
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                walkExpression(*operands.first);
+            }
+        }, lvalue);
+    }
+
+    // Locals and parameters of another function make a closure
+    void Inliner::walkName(const ASTNode::ExpressionName& name) {
+        const Declaration * decl = m_analyzer.GetDeclaration(name);
+        if(!decl || m_function == GLOBAL)
+            return;
+        std::uint32_t owner = m_owners[decl->id];
+        if(decl->kind == Declaration::Kind::Parameter) {
+            auto it = m_parameterOwners.find(decl->parameter);
+            owner = it == m_parameterOwners.end() ? NONE : it->second;
+        }
+        if(owner != NONE && owner != GLOBAL && owner != m_function)
+            m_functions[m_function].isClosure = true;
+    }
+
+    void Inliner::walkCall(const ASTNode::ExpressionFunctionCall& funcCall, const std::optional<SourcePosition>& srcPos) {
+        auto name = std::get_if<ASTNode::ExpressionName>(&funcCall.GetFunction()->Get());
+        const Declaration * decl = name ? m_analyzer.GetDeclaration(*name) : nullptr;
+        std::optional<TypeId> type = decl ? m_typer.GetType(*decl) : std::nullopt;
+        if(!decl || !getFunctionDefinition(*decl) || !type || m_types.Get(type.value()).kind != TypeKind::Function)
+            walkExpression(*funcCall.GetFunction());
+        else {
+            std::size_t siteIdx = m_sites.size();
+            m_sites.push_back(Site{&funcCall, decl->id, m_function, m_loopDepth, m_isInDefault, srcPos});
+            m_siteIdxs[&funcCall] = siteIdx;
+            if(m_function != GLOBAL)
+                m_functions[m_function].sites.push_back(siteIdx);
+        }
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields())
+            walkExpression(*field.GetValue());
+    }
+
+    void Inliner::walkFunction(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body) {
+        // defaults are evaluated by the caller
+        bool isInDefault = m_isInDefault;
+        m_isInDefault = true;
+        for(const ASTNode::TypeStruct::Field& field : function.GetArgumentsType().GetFields()) {
+            std::visit([&](const auto& typeField) {
+                if(typeField.GetDefaultValue())
+                    walkExpression(*typeField.GetDefaultValue().value());
+            }, field);
+            if(auto namedField = std::get_if<ASTNode::TypeStruct::NamedField>(&field))
+                m_parameterOwners[namedField] = decl.id;
+        }
+        m_isInDefault = isInDefault;
+
+        Function& entry = m_functions[decl.id];
+        m_definitions.push_back(decl.id);
+        std::optional<TypeId> type = m_typer.GetType(decl);
+        if(!type || m_types.Get(type.value()).kind != TypeKind::Function)
+            entry.hasArguments = false;
+        else
+            for(const TypeInterner::Field& argument : m_types.GetFields(m_types.Get(type.value()).arguments))
+                if(argument.reps != 1 || argument.name.empty())
+                    entry.hasArguments = false;
+
+        std::uint32_t enclosing = m_function;
+        std::uint32_t loopDepth = m_loopDepth;
+        m_function = decl.id;
+        m_loopDepth = 0;
+        walkExpression(body);
+        m_function = enclosing;
+        m_loopDepth = loopDepth;
+    }
+
+    /*
+     *
+     * Decisions
+     *
+     */
+
+    // Components are completed callees first, a function is recursive if its component has a cycle
+    void Inliner::connect(std::uint32_t id, std::vector<std::uint32_t>& stack, std::uint32_t& nextIndex) {
+        Function& function = m_functions[id];
+        function.index = nextIndex;
+        function.lowLink = nextIndex;
+        nextIndex++;
+        stack.push_back(id);
+        function.isOnStack = true;
+
+        bool isSelfCalling = false;
+        for(std::size_t siteIdx : m_functions[id].sites) {
+            std::uint32_t callee = m_sites[siteIdx].callee;
+            isSelfCalling = isSelfCalling || callee == id;
+            if(m_functions[callee].index == UINT32_MAX) {
+                connect(callee, stack, nextIndex);
+                m_functions[id].lowLink = std::min(m_functions[id].lowLink, m_functions[callee].lowLink);
+            }
+            else if(m_functions[callee].isOnStack)
+                m_functions[id].lowLink = std::min(m_functions[id].lowLink, m_functions[callee].index);
+        }
+
+        if(m_functions[id].lowLink != m_functions[id].index)
+            return;
+        std::size_t begin = stack.size();
+        do
+            begin--;
+        while(stack[begin] != id);
+        bool isRecursive = isSelfCalling || stack.size() - begin > 1;
+        for(std::size_t i = begin; i < stack.size(); i++) {
+            Function& member = m_functions[stack[i]];
+            member.isOnStack = false;
+            member.isRecursive = isRecursive;
+            m_order.push_back(stack[i]);
+        }
+        stack.resize(begin);
+    }
+
+    void Inliner::decide(Site& site, std::uint32_t threshold, const AliasAnalysis& aliases) {
+        const Function& callee = m_functions[site.callee];
+        if(site.isInDefault)
+            site.decision = Decision::Default;
+        else if(callee.isRecursive)
+            site.decision = Decision::Recursive;
+        else if(callee.isClosure)
+            site.decision = Decision::Closure;
+        else if(!callee.hasArguments)
+            site.decision = Decision::Arguments;
+        else {
+            site.cost = callee.size;
+            site.limit = threshold << std::min(site.loopDepth, MAX_LOOP_DEPTH);
+            // inlining the only call of a function removes it
+            if(callee.numCalls == 1 && aliases.IsCalledOnly(m_analyzer.GetDeclaration(site.callee)))
+                site.limit *= ONLY_CALL_FACTOR;
+            site.decision = site.cost <= site.limit ? Decision::Inlined : Decision::Costly;
+        }
+    }
+
+}
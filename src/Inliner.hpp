@@ -0,0 +1,120 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "AliasAnalysis.hpp"
+#include "Analyzer.hpp"
+#include "TypeInterner.hpp"
+#include "Typer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Which calls are replaced by the body of their callee.
+    //
+    // Calls of function definitions by name are sites. The cost of inlining one is the number of
+    // AST nodes of the callee's body, once the calls in it are themselves inlined, so callees are
+    // decided before their callers, bottom up the call graph. A site is inlined if its cost is
+    // within the threshold, doubled for each loop the call is in: calls in loops run more often.
+    // The only call of a function gets a larger limit, the function is then not written at all.
+    //
+    // Functions in a cycle of the call graph are never inlined, nor closures, nor functions with
+    // repeated or unnamed arguments. Calls in default values are written at each call that takes
+    // them, they are not inlined either.
+    //
+    class Inliner {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+
+        static constexpr std::uint32_t DEFAULT_THRESHOLD = 24; // AST nodes
+
+        Inliner(const Analyzer& analyzer, const Typer& typer, const TypeInterner& types);
+
+        // A threshold of 0 inlines nothing, the entry function is always written
+        void Analyze(const ASTNode& ast, const AliasAnalysis& aliases, std::uint32_t threshold, const Declaration * entry);
+
+        bool IsInlined(const ASTNode::ExpressionFunctionCall& funcCall) const;
+        // Every call of it is inlined and it is not used as a value
+        bool IsRemoved(const Declaration& function) const;
+
+        std::size_t GetInlinedCount() const;
+        std::string StringifyDecisions() const;
+
+    private:
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+        static constexpr std::uint32_t GLOBAL = UINT32_MAX - 1; // owner of top-level declarations, caller of top-level calls
+        static constexpr std::uint32_t MAX_LOOP_DEPTH = 3;      // the limit stops doubling past it
+        static constexpr std::uint32_t ONLY_CALL_FACTOR = 8;    // of the limit of the only call of a function
+
+        enum class Decision : std::uint8_t {
+            Inlined,
+            Costly,
+            Recursive,
+            Closure,
+            Arguments, // repeated or unnamed
+            Default    // in a default value
+        };
+
+        struct Site {
+            const ASTNode::ExpressionFunctionCall * call;
+            std::uint32_t callee;    // declaration id
+            std::uint32_t caller;    // declaration id, GLOBAL at the top level
+            std::uint32_t loopDepth;
+            bool isInDefault;
+            std::optional<SourcePosition> srcPos;
+            Decision decision = Decision::Costly;
+            std::uint32_t cost = 0;
+            std::uint32_t limit = 0;
+        };
+
+        struct Function {
+            std::uint32_t nodes = 0;        // of its body
+            std::uint32_t size = 0;         // of its body with the calls inlined in it
+            std::vector<std::size_t> sites; // in its body, in m_sites
+            std::size_t numCalls = 0;       // sites that call it
+            bool isClosure = false;         // uses locals of an enclosing function
+            bool hasArguments = true;       // all named and not repeated
+            bool isRecursive = false;
+            // Tarjan's strongly connected components
+            std::uint32_t index = UINT32_MAX;
+            std::uint32_t lowLink = 0;
+            bool isOnStack = false;
+        };
+
+        static const ASTNode::TypeFunction * getFunctionDefinition(const Declaration& decl);
+
+        void walkExpression(const ASTNode::Expression& expr);
+        void walkStatement(const ASTNode::Statement& stmt);
+        void walkLValue(const ASTNode::Expression::LValue& lvalue);
+        void walkName(const ASTNode::ExpressionName& name);
+        void walkCall(const ASTNode::ExpressionFunctionCall& funcCall, const std::optional<SourcePosition>& srcPos);
+        void walkFunction(const Declaration& decl, const ASTNode::TypeFunction& function, const ASTNode::Expression& body);
+
+        void connect(std::uint32_t id, std::vector<std::uint32_t>& stack, std::uint32_t& nextIndex);
+        void decide(Site& site, std::uint32_t threshold, const AliasAnalysis& aliases);
+
+        const Analyzer& m_analyzer;
+        const Typer& m_typer;
+        const TypeInterner& m_types;
+
+        std::uint32_t m_function = GLOBAL; // being walked
+        std::uint32_t m_loopDepth = 0;
+        bool m_isInDefault = false;
+        std::vector<Site> m_sites;                                 // in source order
+        std::unordered_map<const ASTNode::ExpressionFunctionCall *, std::size_t> m_siteIdxs;
+        std::unordered_map<std::uint32_t, Function> m_functions;   // by declaration id
+        std::vector<std::uint32_t> m_definitions;                  // declaration ids, in source order
+        std::vector<std::uint32_t> m_order;                        // declaration ids, callees before their callers
+        std::vector<std::uint32_t> m_owners;                       // by declaration id, function it is local to
+        std::unordered_map<const ASTNode::TypeStruct::NamedField *, std::uint32_t> m_parameterOwners;
+        std::vector<bool> m_isRemoved;                             // by declaration id
+    };
+
+}
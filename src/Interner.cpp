@@ -0,0 +1,51 @@
+#include "Interner.hpp"
+#include "Hash.hpp"
+
+namespace ry {
+
+    static constexpr std::size_t INITIAL_SLOTS = 64;
+
+    Interner::Interner():
+        m_slots(INITIAL_SLOTS, Slot{0, EMPTY_SLOT})
+    {}
+
+    Interner::Id Interner::Intern(std::string_view str) {
+        std::uint64_t hash = Hash::Compute(str);
+        std::size_t mask = m_slots.size() - 1;
+        for(std::size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+            Slot& slot = m_slots[idx];
+            if(slot.id == EMPTY_SLOT) {
+                slot = Slot{hash, Id(m_strings.size())};
+                m_strings.push_back(str);
+                if(m_strings.size() * 2 > m_slots.size())
+                    grow();
+                return Id(m_strings.size() - 1);
+            }
+            if(slot.hash == hash && m_strings[slot.id] == str)
+                return slot.id;
+        }
+    }
+
+    std::string_view Interner::Get(Id id) const {
+        return m_strings[id];
+    }
+
+    std::size_t Interner::Size() const {
+        return m_strings.size();
+    }
+
+    void Interner::grow() {
+        std::vector<Slot> slots(m_slots.size() * 2, Slot{0, EMPTY_SLOT});
+        std::size_t mask = slots.size() - 1;
+        for(const Slot& slot : m_slots) {
+            if(slot.id == EMPTY_SLOT)
+                continue;
+            std::size_t idx = slot.hash & mask;
+            while(slots[idx].id != EMPTY_SLOT)
+                idx = (idx + 1) & mask;
+            slots[idx] = slot;
+        }
+        m_slots = std::move(slots);
+    }
+
+}
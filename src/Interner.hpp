@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Maps names to dense ids with an open-addressing (linear probing) hash table,
+    // so later passes can index flat arrays by name instead of hashing strings again.
+    // Strings are not copied, they must outlive the interner.
+    //
+    class Interner {
+    public:
+        using Id = std::uint32_t;
+
+        Interner();
+
+        Id Intern(std::string_view str);
+        std::string_view Get(Id id) const;
+        std::size_t Size() const;
+
+    private:
+        static constexpr Id EMPTY_SLOT = 0xFFFFFFFF;
+
+        struct Slot {
+            std::uint64_t hash;
+            Id id;
+        };
+
+        void grow();
+
+        std::vector<Slot> m_slots; // power of two size, at most half full
+        std::vector<std::string_view> m_strings;
+    };
+
+}
@@ -0,0 +1,767 @@
+#include "JIT.hpp"
+#include "VM.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace ry {
+
+    using Slot = JIT::Slot;
+    using Op = Bytecode::Op;
+    using Instruction = Bytecode::Instruction;
+
+    static constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    static constexpr bool SUPPORTED = true;
+#else
+    static constexpr bool SUPPORTED = false;
+#endif
+
+    static std::uint8_t * allocateExecutable(std::size_t size) {
+#ifdef _WIN32
+        return static_cast<std::uint8_t *>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READONLY));
+#else
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return data == MAP_FAILED ? nullptr : static_cast<std::uint8_t *>(data);
+#endif
+    }
+
+    static void freeExecutable(std::uint8_t * data, std::size_t size) {
+#ifdef _WIN32
+        (void) size;
+        VirtualFree(data, 0, MEM_RELEASE);
+#else
+        munmap(data, size);
+#endif
+    }
+
+    // pages are never writable and executable at the same time
+    static bool protectExecutable(std::uint8_t * data, std::size_t size, bool writable) {
+#ifdef _WIN32
+        DWORD old;
+        if(!VirtualProtect(data, size, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old))
+            return false;
+        if(!writable)
+            FlushInstructionCache(GetCurrentProcess(), data, size);
+        return true;
+#else
+        return mprotect(data, size, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#endif
+    }
+
+    static double fmodHelper(double x, double y) {
+        return std::fmod(x, y);
+    }
+
+    /*
+     *
+     * Assembler
+     *
+     */
+
+    class JIT::Assembler {
+    public:
+        enum Register : std::uint8_t {
+            RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+        };
+
+        enum Condition : std::uint8_t {
+            O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G
+        };
+
+        // native frame registers
+        static constexpr Register FRAME = RBX;
+        static constexpr Register CONTEXT = R12;
+        static constexpr std::int32_t FRAME_OFFSET = 32; // stack slot above the shadow space
+
+#ifdef _WIN32
+        static constexpr Register ARGUMENTS[] = {RCX, RDX, R8, R9};
+#else
+        static constexpr Register ARGUMENTS[] = {RDI, RSI, RDX, RCX};
+#endif
+
+        // native code is entered at its setup, with the entry in rdx
+        static constexpr std::size_t SETUP_SIZE = 25;
+
+        Assembler(const std::vector<Bytecode::Function>& functions, std::uint32_t functionIdx):
+            m_functions(functions),
+            m_function(functions[functionIdx]),
+            m_functionIdx(functionIdx)
+        {}
+
+        // uint32_t(Slot * frame, Context * context, const void * start, const void * entry)
+        std::vector<std::uint8_t> AssembleTrampoline() {
+            byte(0x53);             // push rbx
+            bytes({0x41, 0x54});    // push r12
+            bytes({0x48, 0x83, 0xEC, 0x08}); // sub rsp, 8
+            move(FRAME, ARGUMENTS[0]);
+            move(CONTEXT, ARGUMENTS[1]);
+            move(RAX, ARGUMENTS[2]);
+            move(RDX, ARGUMENTS[3]);
+            bytes({0xFF, 0xD0});    // call rax
+            bytes({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+            bytes({0x41, 0x5C});    // pop r12
+            byte(0x5B);             // pop rbx
+            byte(0xC3);             // ret
+            return std::move(m_bytes);
+        }
+
+        std::vector<std::uint8_t> Assemble(std::vector<std::size_t>& offsets) {
+            findLeaders();
+            setup();
+            assert(m_bytes.size() == SETUP_SIZE);
+
+            const std::vector<Instruction>& code = m_function.code;
+            offsets.resize(code.size());
+            for(std::uint32_t pc = 0; pc < code.size(); pc++) {
+                offsets[pc] = m_bytes.size();
+                if(m_leaders[pc])
+                    countSteps(pc);
+                instruction(code[pc], pc);
+            }
+
+            // jumps are patched once every target has an offset
+            for(const auto& [at, pc] : m_jumps)
+                patch(at, offsets[pc]);
+            for(const auto& [at, pc, status] : m_exits) {
+                patch(at, m_bytes.size());
+                exit(pc, status);
+            }
+            for(std::size_t at : m_stepExits)
+                patch(at, m_bytes.size());
+            storeImm(CONTEXT, offsetof(Context, numStepsLeft), 0);
+            exit(std::nullopt, VM::Status::StepLimit);
+            return std::move(m_bytes);
+        }
+
+    private:
+        struct Exit {
+            std::size_t at;
+            std::uint32_t pc;
+            VM::Status status;
+        };
+
+        static std::int32_t disp(Bytecode::Reg reg) {
+            return std::int32_t(reg * sizeof(Slot));
+        }
+
+        void byte(std::uint8_t value) {
+            m_bytes.push_back(value);
+        }
+
+        void bytes(std::initializer_list<std::uint8_t> values) {
+            m_bytes.insert(m_bytes.end(), values);
+        }
+
+        void u32(std::uint32_t value) {
+            for(int i = 0; i < 4; i++)
+                byte(std::uint8_t(value >> i * 8));
+        }
+
+        void u64(std::uint64_t value) {
+            for(int i = 0; i < 8; i++)
+                byte(std::uint8_t(value >> i * 8));
+        }
+
+        void rex(bool wide, std::uint8_t reg, std::uint8_t base) {
+            std::uint8_t prefix = 0x40 | wide << 3 | (reg >> 3) << 2 | base >> 3;
+            if(prefix != 0x40)
+                byte(prefix);
+        }
+
+        void modRM(std::uint8_t reg, std::uint8_t rm) {
+            byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+        }
+
+        // [base + disp32]
+        void memory(std::uint8_t reg, Register base, std::int32_t offset) {
+            byte(0x80 | (reg & 7) << 3 | (base & 7));
+            if((base & 7) == RSP)
+                byte(0x24);
+            u32(std::uint32_t(offset));
+        }
+
+        void load(Register reg, Register base, std::int32_t offset) {
+            rex(true, reg, base);
+            byte(0x8B);
+            memory(reg, base, offset);
+        }
+
+        void store(Register base, std::int32_t offset, Register reg) {
+            rex(true, reg, base);
+            byte(0x89);
+            memory(reg, base, offset);
+        }
+
+        // sign extended
+        void storeImm(Register base, std::int32_t offset, std::int32_t value) {
+            rex(true, 0, base);
+            byte(0xC7);
+            memory(0, base, offset);
+            u32(std::uint32_t(value));
+        }
+
+        void storeImm32(Register base, std::int32_t offset, std::uint32_t value) {
+            rex(false, 0, base);
+            byte(0xC7);
+            memory(0, base, offset);
+            u32(value);
+        }
+
+        void moveImm(Register reg, std::uint64_t value) {
+            if(value <= UINT32_MAX) {
+                rex(false, 0, reg);
+                byte(0xB8 + (reg & 7));
+                u32(std::uint32_t(value));
+                return;
+            }
+            rex(true, 0, reg);
+            byte(0xB8 + (reg & 7));
+            u64(value);
+        }
+
+        void move(Register dst, Register src) {
+            rex(true, src, dst);
+            byte(0x89);
+            modRM(src, dst);
+        }
+
+        // add 01, or 09, and 21, sub 29, xor 31, cmp 39, test 85
+        void arithmetic(std::uint8_t opcode, Register dst, Register src) {
+            rex(true, src, dst);
+            byte(opcode);
+            modRM(src, dst);
+        }
+
+        // not 2, neg 3, div 6, idiv 7
+        void unary(std::uint8_t extension, Register reg) {
+            rex(true, 0, reg);
+            byte(0xF7);
+            modRM(extension, reg);
+        }
+
+        // shl 4, shr 5, sar 7
+        void shift(std::uint8_t extension, Register reg) {
+            rex(true, 0, reg);
+            byte(0xD3);
+            modRM(extension, reg);
+        }
+
+        void multiply(Register dst, Register src) {
+            rex(true, dst, src);
+            bytes({0x0F, 0xAF});
+            modRM(dst, src);
+        }
+
+        // al or cl
+        void set(Condition condition, Register reg = RAX) {
+            bytes({0x0F, std::uint8_t(0x90 | condition)});
+            modRM(0, reg);
+        }
+
+        void loadFloat(std::uint8_t xmm, Bytecode::Reg reg) {
+            bytes({0xF3, 0x0F, 0x7E});
+            memory(xmm, FRAME, disp(reg));
+        }
+
+        void storeFloat(Bytecode::Reg reg, std::uint8_t xmm) {
+            bytes({0x66, 0x0F, 0xD6});
+            memory(xmm, FRAME, disp(reg));
+        }
+
+        void sse(std::uint8_t prefix, std::uint8_t opcode, std::uint8_t dst, std::uint8_t src) {
+            bytes({prefix, 0x0F, opcode});
+            modRM(dst, src);
+        }
+
+        void callAbsolute(const void * function) {
+            moveImm(RAX, std::uint64_t(reinterpret_cast<std::uintptr_t>(function)));
+            bytes({0xFF, 0xD0});
+        }
+
+        std::size_t jump() {
+            byte(0xE9);
+            u32(0);
+            return m_bytes.size() - 4;
+        }
+
+        std::size_t jump(Condition condition) {
+            bytes({0x0F, std::uint8_t(0x80 | condition)});
+            u32(0);
+            return m_bytes.size() - 4;
+        }
+
+        void patch(std::size_t at, std::size_t target) {
+            std::uint32_t rel = std::uint32_t(std::int64_t(target) - std::int64_t(at + 4));
+            std::memcpy(m_bytes.data() + at, &rel, 4);
+        }
+
+        void jumpTo(std::uint32_t pc) {
+            m_jumps.emplace_back(jump(), pc);
+        }
+
+        void jumpTo(Condition condition, std::uint32_t pc) {
+            m_jumps.emplace_back(jump(condition), pc);
+        }
+
+        void fail(Condition condition, std::uint32_t pc, VM::Status status) {
+            m_exits.push_back(Exit{jump(condition), pc, status});
+        }
+
+        /*
+         *
+         * Templates
+         *
+         */
+
+        // basic blocks start at jump targets and after jumps, calls and returns
+        void findLeaders() {
+            const std::vector<Instruction>& code = m_function.code;
+            m_leaders.assign(code.size(), false);
+            if(!code.empty())
+                m_leaders[0] = true;
+            for(std::uint32_t pc = 0; pc < code.size(); pc++) {
+                Op op = code[pc].op;
+                if(op == Op::Jump || op == Op::JumpIf || op == Op::JumpIfNot)
+                    m_leaders[code[pc].a] = true;
+                if(op == Op::Jump || op == Op::JumpIf || op == Op::JumpIfNot || op == Op::Call || op == Op::Return)
+                    if(pc + 1 < code.size())
+                        m_leaders[pc + 1] = true;
+            }
+        }
+
+        // called with the frame in rbx, the context in r12 and the entry in rdx
+        void setup() {
+            bytes({0x48, 0x83, 0xEC, 0x28}); // sub rsp, 40, aligned with shadow space for calls
+            // the frame is kept as an offset into the register stack over calls
+            move(RCX, FRAME);
+            rex(true, RCX, CONTEXT);
+            byte(0x2B);
+            memory(RCX, CONTEXT, offsetof(Context, registers)); // sub rcx, registers
+            store(RSP, FRAME_OFFSET, RCX);
+            bytes({0xFF, 0xE2});    // jmp rdx
+        }
+
+        void epilogue() {
+            bytes({0x48, 0x83, 0xC4, 0x28}); // add rsp, 40
+            byte(0xC3);             // ret
+        }
+
+        void reloadFrame() {
+            load(FRAME, RSP, FRAME_OFFSET);
+            rex(true, FRAME, CONTEXT);
+            byte(0x03);
+            memory(FRAME, CONTEXT, offsetof(Context, registers)); // add rbx, registers
+        }
+
+        // inc 0, dec 1
+        void count(std::uint8_t extension, std::int32_t offset) {
+            rex(true, 0, CONTEXT);
+            byte(0xFF);
+            memory(extension, CONTEXT, offset);
+        }
+
+        void compare(Register reg, std::int32_t offset) {
+            rex(true, reg, CONTEXT);
+            byte(0x3B);
+            memory(reg, CONTEXT, offset);
+        }
+
+        void address(Register reg, Register base, std::int32_t offset) {
+            rex(true, reg, base);
+            byte(0x8D);
+            memory(reg, base, offset);
+        }
+
+        void exit(std::optional<std::uint32_t> pc, VM::Status status) {
+            if(pc)
+                failAt(pc.value());
+            moveImm(RAX, std::uint32_t(status));
+            epilogue();
+        }
+
+        // the instructions of a block are paid for on entry
+        void countSteps(std::uint32_t pc) {
+            std::uint32_t numSteps = 1;
+            while(pc + numSteps < m_leaders.size() && !m_leaders[pc + numSteps])
+                numSteps++;
+            rex(true, 0, CONTEXT);
+            byte(0x81);
+            memory(5, CONTEXT, offsetof(Context, numStepsLeft)); // sub
+            u32(numSteps);
+            // unlike the interpreter, a block without enough steps stops before its first instruction
+            std::size_t enough = jump(AE);
+            failAt(pc);
+            m_stepExits.push_back(jump());
+            patch(enough, m_bytes.size());
+        }
+
+        void failAt(std::uint32_t pc) {
+            storeImm32(CONTEXT, offsetof(Context, errorFunction), m_functionIdx);
+            storeImm32(CONTEXT, offsetof(Context, errorPc), pc);
+        }
+
+        // as Bytecode::Normalize, on rax
+        void normalize(const Instruction& ins) {
+            switch(ins.width) {
+                case 8:  ins.isSigned ? bytes({0x48, 0x0F, 0xBE, 0xC0}) : bytes({0x0F, 0xB6, 0xC0}); break; // movsx/movzx
+                case 16: ins.isSigned ? bytes({0x48, 0x0F, 0xBF, 0xC0}) : bytes({0x0F, 0xB7, 0xC0}); break;
+                case 32: ins.isSigned ? bytes({0x48, 0x63, 0xC0}) : bytes({0x89, 0xC0}); break;          // movsxd/mov eax, eax
+                default:
+                    if(ins.width >= 64)
+                        break;
+                    bytes({0x48, 0xC1, 0xE0, std::uint8_t(64 - ins.width)}); // shl rax, 64 - width
+                    bytes({0x48, 0xC1, std::uint8_t(ins.isSigned ? 0xF8 : 0xE8), std::uint8_t(64 - ins.width)}); // sar/shr
+                    break;
+            }
+        }
+
+        void binary(const Instruction& ins) {
+            load(RAX, FRAME, disp(ins.b));
+            load(RCX, FRAME, disp(ins.c));
+        }
+
+        void result(const Instruction& ins) {
+            store(FRAME, disp(ins.a), RAX);
+        }
+
+        void integer(const Instruction& ins, std::uint8_t opcode, bool normalized) {
+            binary(ins);
+            arithmetic(opcode, RAX, RCX);
+            if(normalized)
+                normalize(ins);
+            result(ins);
+        }
+
+        void division(const Instruction& ins, std::uint32_t pc, bool isSigned, bool remainder) {
+            binary(ins);
+            arithmetic(0x85, RCX, RCX);
+            fail(E, pc, VM::Status::DivisionByZero);
+            std::size_t done = 0;
+            if(isSigned) {
+                // i64 min / -1 overflows, the quotient is negated and the remainder is 0
+                rex(true, 0, RCX);
+                bytes({0x83, 0xF9, 0xFF}); // cmp rcx, -1
+                std::size_t divide = jump(NE);
+                if(remainder)
+                    arithmetic(0x31, RAX, RAX);
+                else
+                    unary(3, RAX);
+                done = jump();
+                patch(divide, m_bytes.size());
+                bytes({0x48, 0x99}); // cqo
+                unary(7, RCX);
+            } else {
+                arithmetic(0x31, RDX, RDX);
+                unary(6, RCX);
+            }
+            if(remainder)
+                move(RAX, RDX);
+            if(isSigned)
+                patch(done, m_bytes.size());
+            if(isSigned && !remainder)
+                normalize(ins);
+            result(ins);
+        }
+
+        void shifted(const Instruction& ins, std::uint32_t pc, std::uint8_t extension, bool normalized) {
+            binary(ins);
+            bytes({0x48, 0x83, 0xF9, 0x40}); // cmp rcx, 64
+            fail(AE, pc, VM::Status::ShiftOutOfRange);
+            shift(extension, RAX);
+            if(normalized)
+                normalize(ins);
+            result(ins);
+        }
+
+        void compare(const Instruction& ins, Condition condition) {
+            binary(ins);
+            arithmetic(0x39, RAX, RCX);
+            set(condition);
+            bytes({0x0F, 0xB6, 0xC0}); // movzx eax, al
+            result(ins);
+        }
+
+        void floating(const Instruction& ins, std::uint8_t opcode) {
+            loadFloat(0, ins.b);
+            loadFloat(1, ins.c);
+            if(opcode)
+                sse(0xF2, opcode, 0, 1);
+            else
+                callAbsolute(reinterpret_cast<const void *>(&fmodHelper));
+            if(ins.width == 32) {
+                sse(0xF2, 0x5A, 0, 0); // cvtsd2ss
+                sse(0xF3, 0x5A, 0, 0); // cvtss2sd
+            }
+            storeFloat(ins.a, 0);
+        }
+
+        // unordered operands are only not equal
+        void compareFloat(const Instruction& ins, Op op) {
+            loadFloat(0, ins.b);
+            loadFloat(1, ins.c);
+            switch(op) {
+                case Op::FEq:
+                    bytes({0x66, 0x0F, 0x2E, 0xC1}); // ucomisd xmm0, xmm1
+                    set(E);
+                    set(NP, RCX);
+                    bytes({0x20, 0xC8}); // and al, cl
+                    break;
+                case Op::FNe:
+                    bytes({0x66, 0x0F, 0x2E, 0xC1});
+                    set(NE);
+                    set(P, RCX);
+                    bytes({0x08, 0xC8}); // or al, cl
+                    break;
+                case Op::FLt:
+                    bytes({0x66, 0x0F, 0x2E, 0xC8}); // ucomisd xmm1, xmm0
+                    set(A);
+                    break;
+                default:
+                    bytes({0x66, 0x0F, 0x2E, 0xC8});
+                    set(AE);
+                    break;
+            }
+            bytes({0x0F, 0xB6, 0xC0});
+            result(ins);
+        }
+
+        // memmove of slots known at compile time
+        void moveSlots(Bytecode::Reg dst, Bytecode::Reg src, std::uint32_t numSlots) {
+            for(std::uint32_t i = 0; i < numSlots; i++) {
+                std::uint32_t idx = dst <= src ? i : numSlots - 1 - i;
+                load(RAX, FRAME, disp(src + idx));
+                store(FRAME, disp(dst + idx), RAX);
+            }
+        }
+
+        // returns to the caller on failure, the frame may have moved otherwise
+        void checkStatus() {
+            bytes({0x85, 0xC0}); // test eax, eax
+            std::size_t ok = jump(E);
+            epilogue();
+            patch(ok, m_bytes.size());
+            reloadFrame();
+        }
+
+        void call(const Instruction& ins, std::uint32_t pc) {
+            const Bytecode::Function& callee = m_functions[ins.b];
+            std::vector<std::size_t> slow;
+
+            // compiled callees are called directly while their frame fits in the register stack
+            load(RAX, CONTEXT, offsetof(Context, functions));
+            load(RAX, RAX, disp(ins.b));
+            arithmetic(0x85, RAX, RAX);
+            slow.push_back(jump(E));
+            load(RCX, CONTEXT, offsetof(Context, numNativeFrames));
+            compare(RCX, offsetof(Context, maxNativeFrames));
+            slow.push_back(jump(AE));
+            address(RCX, FRAME, disp(ins.c + callee.numRegisters));
+            compare(RCX, offsetof(Context, registersEnd));
+            slow.push_back(jump(A));
+
+            count(0, offsetof(Context, numNativeFrames));
+            address(FRAME, FRAME, disp(ins.c));
+            address(RDX, RAX, SETUP_SIZE);
+            bytes({0xFF, 0xD0}); // call rax
+            count(1, offsetof(Context, numNativeFrames));
+            checkStatus();
+            moveSlots(ins.a, ins.c, callee.numReturnSlots);
+            std::size_t done = jump();
+
+            // the VM runs other callees in whichever tier, the error location is already set on failure
+            for(std::size_t at : slow)
+                patch(at, m_bytes.size());
+            move(ARGUMENTS[0], CONTEXT);
+            move(ARGUMENTS[1], FRAME);
+            moveImm(ARGUMENTS[2], m_functionIdx);
+            moveImm(ARGUMENTS[3], pc);
+            load(RAX, CONTEXT, offsetof(Context, call));
+            bytes({0xFF, 0xD0}); // call rax
+            checkStatus();
+            patch(done, m_bytes.size());
+        }
+
+        void instruction(const Instruction& ins, std::uint32_t pc) {
+            switch(ins.op) {
+                case Op::LoadImm: {
+                    Slot value = Slot(ins.b) | Slot(ins.c) << 32;
+                    if(std::int64_t(value) == std::int32_t(value)) {
+                        storeImm(FRAME, disp(ins.a), std::int32_t(value));
+                    } else {
+                        moveImm(RAX, value);
+                        result(ins);
+                    }
+                    break;
+                }
+                case Op::Move:  moveSlots(ins.a, ins.b, 1); break;
+                case Op::MoveN: moveSlots(ins.a, ins.b, ins.c); break;
+
+                case Op::Add: integer(ins, 0x01, true); break;
+                case Op::Sub: integer(ins, 0x29, true); break;
+                case Op::Mul:
+                    binary(ins);
+                    multiply(RAX, RCX);
+                    normalize(ins);
+                    result(ins);
+                    break;
+                case Op::DivS: division(ins, pc, true, false); break;
+                case Op::DivU: division(ins, pc, false, false); break;
+                case Op::ModS: division(ins, pc, true, true); break;
+                case Op::ModU: division(ins, pc, false, true); break;
+
+                case Op::And: integer(ins, 0x21, false); break;
+                case Op::Or:  integer(ins, 0x09, false); break;
+                case Op::Xor: integer(ins, 0x31, false); break;
+                case Op::Shl:  shifted(ins, pc, 4, true); break;
+                case Op::ShrS: shifted(ins, pc, 7, false); break;
+                case Op::ShrU: shifted(ins, pc, 5, false); break;
+                case Op::Neg:
+                case Op::Not:
+                    load(RAX, FRAME, disp(ins.b));
+                    unary(ins.op == Op::Neg ? 3 : 2, RAX);
+                    normalize(ins);
+                    result(ins);
+                    break;
+
+                case Op::FAdd: floating(ins, 0x58); break;
+                case Op::FSub: floating(ins, 0x5C); break;
+                case Op::FMul: floating(ins, 0x59); break;
+                case Op::FDiv: floating(ins, 0x5E); break;
+                case Op::FMod: floating(ins, 0); break;
+                case Op::FNeg:
+                    // rounding the negation of a rounded value is exact
+                    load(RAX, FRAME, disp(ins.b));
+                    bytes({0x48, 0x0F, 0xBA, 0xF8, 0x3F}); // btc rax, 63
+                    result(ins);
+                    break;
+
+                case Op::Eq:  compare(ins, E); break;
+                case Op::Ne:  compare(ins, NE); break;
+                case Op::LtS: compare(ins, L); break;
+                case Op::LeS: compare(ins, LE); break;
+                case Op::LtU: compare(ins, B); break;
+                case Op::LeU: compare(ins, BE); break;
+                case Op::FEq:
+                case Op::FNe:
+                case Op::FLt:
+                case Op::FLe: compareFloat(ins, ins.op); break;
+                case Op::LogicalNot:
+                    load(RAX, FRAME, disp(ins.b));
+                    bytes({0x48, 0x83, 0xF0, 0x01}); // xor rax, 1
+                    result(ins);
+                    break;
+
+                case Op::Jump: jumpTo(ins.a); break;
+                case Op::JumpIf:
+                case Op::JumpIfNot:
+                    rex(true, 0, FRAME);
+                    byte(0x83);
+                    memory(7, FRAME, disp(ins.b)); // cmp qword, 0
+                    byte(0);
+                    jumpTo(ins.op == Op::JumpIf ? NE : E, ins.a);
+                    break;
+
+                case Op::Call: call(ins, pc); break;
+                case Op::Return:
+                    moveSlots(0, ins.a, ins.b);
+                    bytes({0x31, 0xC0}); // xor eax, eax
+                    epilogue();
+                    break;
+            }
+        }
+
+        const std::vector<Bytecode::Function>& m_functions;
+        const Bytecode::Function& m_function;
+        std::uint32_t m_functionIdx;
+
+        std::vector<std::uint8_t> m_bytes;
+        std::vector<bool> m_leaders;
+        std::vector<std::pair<std::size_t, std::uint32_t>> m_jumps; // patch offset, target pc
+        std::vector<Exit> m_exits;
+        std::vector<std::size_t> m_stepExits;
+    };
+
+    /*
+     *
+     * JIT
+     *
+     */
+
+    bool JIT::IsSupported() {
+        return SUPPORTED;
+    }
+
+    JIT::JIT() {}
+
+    JIT::~JIT() {
+        for(const Chunk& chunk : m_chunks)
+            freeExecutable(chunk.data, chunk.size);
+    }
+
+    std::optional<JIT::Code> JIT::Compile(const std::vector<Bytecode::Function>& functions, std::uint32_t function) {
+        if(!SUPPORTED || functions[function].code.empty())
+            return {};
+        if(!m_trampoline) {
+            auto trampoline = write(Assembler(functions, function).AssembleTrampoline());
+            if(!trampoline)
+                return {};
+            m_trampoline = reinterpret_cast<Trampoline>(const_cast<std::uint8_t *>(trampoline));
+        }
+
+        std::vector<std::size_t> offsets;
+        std::vector<std::uint8_t> bytes = Assembler(functions, function).Assemble(offsets);
+        const std::uint8_t * start = write(bytes);
+        if(!start)
+            return {};
+
+        Code code{start, {}};
+        code.entries.reserve(offsets.size());
+        for(std::size_t offset : offsets)
+            code.entries.push_back(start + offset);
+        return code;
+    }
+
+    std::uint32_t JIT::Run(const Code& code, std::uint32_t pc, Slot * frame, Context& context) const {
+        return m_trampoline(frame, &context, code.start, code.entries[pc]);
+    }
+
+    std::size_t JIT::GetCodeSize() const {
+        return m_codeSize;
+    }
+
+    const std::uint8_t * JIT::write(const std::vector<std::uint8_t>& bytes) {
+        // code is 16 byte aligned, functions larger than a chunk get their own
+        std::size_t size = (bytes.size() + 15) & ~std::size_t(15);
+        if(m_chunks.empty() || m_chunks.back().size - m_chunks.back().used < size) {
+            std::size_t chunkSize = std::max(CHUNK_SIZE, (size + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE);
+            std::uint8_t * data = allocateExecutable(chunkSize);
+            if(!data)
+                return nullptr;
+            m_chunks.push_back(Chunk{data, chunkSize, 0});
+        }
+
+        Chunk& chunk = m_chunks.back();
+        if(!protectExecutable(chunk.data, chunk.size, true))
+            return nullptr;
+        std::uint8_t * start = chunk.data + chunk.used;
+        std::memcpy(start, bytes.data(), bytes.size());
+        if(!protectExecutable(chunk.data, chunk.size, false))
+            return nullptr;
+        chunk.used += size;
+        m_codeSize += bytes.size();
+        return start;
+    }
+
+}
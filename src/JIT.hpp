@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Bytecode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Template JIT of the CTEE bytecode to x86-64.
+    //
+    // Every instruction expands to a fixed machine code sequence that works on the VM's register
+    // frame in memory, so native and interpreted frames have the same layout and a function can
+    // switch to native code in the middle of a loop. Native callees are called directly, other
+    // calls go back through the VM, which picks the tier of the callee and checks the limits.
+    // Steps are counted once per basic block.
+    //
+    // Code is written to mmap'd (VirtualAlloc'd on Windows) pages that are only writable while
+    // code is added. Nothing is compiled on other architectures.
+    //
+    class JIT {
+    public:
+        using Slot = Bytecode::Slot;
+
+        // Shared with the generated code, which addresses its fields by offset
+        struct Context {
+            std::uint64_t numStepsLeft;
+            Slot * registers;                   // moves when the VM's register stack grows during a call
+            Slot * registersEnd;
+            const void * const * functions;     // Code::start by function, null if not compiled
+            std::uint64_t numNativeFrames;
+            std::uint64_t maxNativeFrames;      // native callees are called directly below it
+            std::uint32_t errorFunction;        // and pc of the instruction a failed run stopped at
+            std::uint32_t errorPc;
+            void * vm;
+            // Runs the call instruction at pc of the function, from its frame, returns a VM status
+            std::uint32_t (* call)(Context * context, Slot * frame, std::uint32_t function, std::uint32_t pc);
+        };
+
+        struct Code {
+            const void * start;
+            std::vector<const void *> entries; // by pc
+        };
+
+        static bool IsSupported();
+
+        JIT();
+        JIT(const JIT&) = delete;
+        ~JIT();
+
+        JIT& operator=(const JIT&) = delete;
+
+        // none if the code does not fit in executable memory
+        std::optional<Code> Compile(const std::vector<Bytecode::Function>& functions, std::uint32_t function);
+        // Runs the frame from pc, returns a VM status, the returned value is left at the start of the frame
+        std::uint32_t Run(const Code& code, std::uint32_t pc, Slot * frame, Context& context) const;
+
+        std::size_t GetCodeSize() const;
+
+    private:
+        class Assembler;
+
+        struct Chunk {
+            std::uint8_t * data;
+            std::size_t size;
+            std::size_t used;
+        };
+
+        using Trampoline = std::uint32_t (*)(Slot * frame, Context * context, const void * start, const void * entry);
+
+        const std::uint8_t * write(const std::vector<std::uint8_t>& bytes);
+
+        Trampoline m_trampoline = nullptr;
+        std::vector<Chunk> m_chunks;
+        std::size_t m_codeSize = 0;
+    };
+
+}
@@ -11,15 +11,19 @@
 namespace ry {
 
     Lexer::Lexer(std::string_view id, std::string_view src):
-        m_src(src),
-        m_id(id),
-        m_srcIdx(0),
+        m_infos(id, src),
         m_col(1),
         m_ln(1),
-        m_infos(id, src)
+        m_tokenCol(1),
+        m_tokenLn(1),
+        m_srcIdx(0),
+        m_id(id),
+        m_src(src)
     {}
 
     std::vector<Token> Lexer::Lex() {
+        Trace::Scope traceScope("lex", m_id);
+
         std::vector<Token> tokens;
 
         auto tryPushToken = [&](std::optional<Token> token) -> bool {
@@ -34,6 +38,9 @@ namespace ry {
             if(getChar() == CHAR_EOF)
                 break;
 
+            m_tokenLn = m_ln;
+            m_tokenCol = m_col;
+
             if(tryPushToken(tryLexNameOrKeyword())) continue;
             if(             tryLexComment      () ) continue;
             if(tryPushToken(tryLexNumber       ())) continue;
@@ -66,8 +73,12 @@ namespace ry {
 
     template<typename ...Args>
     Token Lexer::createToken(Args&&... args) const {
+        // Tokens that are created after being eaten span up to their last char
+        bool isEaten = m_ln != m_tokenLn || m_col != m_tokenCol;
         return Token(
-            SourcePosition(m_ln, m_col),
+            isEaten && m_col > 1
+                ? SourcePosition(m_tokenLn, m_tokenCol, m_ln, m_col - 1)
+                : SourcePosition(m_tokenLn, m_tokenCol),
             std::forward<Args>(args)...
         );
     }
@@ -2,6 +2,7 @@
 
 #include "Token.hpp"
 #include "Infos.hpp"
+#include "Trace.hpp"
 
 #include <string_view>
 #include <vector>
@@ -45,6 +46,8 @@ namespace ry {
         Infos m_infos;
         std::size_t m_col;
         std::size_t m_ln;
+        std::size_t m_tokenCol; // start of the token being lexed
+        std::size_t m_tokenLn;
         int m_srcIdx;
         std::string_view m_id;
         std::string_view m_src;
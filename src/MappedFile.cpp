@@ -0,0 +1,119 @@
+#include "MappedFile.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace ry {
+
+    MappedFile::MappedFile():
+        m_data(nullptr),
+        m_size(0)
+    #ifdef _WIN32
+        , m_fileHandle(nullptr)
+        , m_mappingHandle(nullptr)
+    #endif
+    {}
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept:
+        MappedFile()
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if(this != &other) {
+            Close();
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+        #ifdef _WIN32
+            std::swap(m_fileHandle, other.m_fileHandle);
+            std::swap(m_mappingHandle, other.m_mappingHandle);
+        #endif
+        }
+        return *this;
+    }
+
+    bool MappedFile::Open(const std::string& path) {
+        Close();
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+        void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        m_data = static_cast<const std::uint8_t *>(data);
+        m_size = std::size_t(size.QuadPart);
+    #else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void * data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps its own reference
+        if(data == MAP_FAILED)
+            return false;
+        m_data = static_cast<const std::uint8_t *>(data);
+        m_size = std::size_t(st.st_size);
+    #endif
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if(!m_data)
+            return;
+    #ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mappingHandle);
+        CloseHandle(m_fileHandle);
+        m_fileHandle = nullptr;
+        m_mappingHandle = nullptr;
+    #else
+        ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+    #endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool MappedFile::IsOpen() const {
+        return m_data != nullptr;
+    }
+
+    std::span<const std::uint8_t> MappedFile::GetBytes() const {
+        return {m_data, m_size};
+    }
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace ry {
+
+    // Read-only memory mapping of a whole file
+    class MappedFile {
+    public:
+        MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool Open(const std::string& path);
+        void Close();
+
+        bool IsOpen() const;
+        std::span<const std::uint8_t> GetBytes() const;
+
+    private:
+        const std::uint8_t * m_data;
+        std::size_t m_size;
+    #ifdef _WIN32
+        void * m_fileHandle;
+        void * m_mappingHandle;
+    #endif
+    };
+
+}
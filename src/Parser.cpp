@@ -4,6 +4,7 @@
 #include "src/ASTNode.hpp"
 #include "src/Token.hpp"
 
+#include <algorithm>
 #include <format>
 #include <memory>
 #include <iostream>
@@ -14,8 +15,11 @@
 
 namespace ry {
 
+#define RY_PARSER__TRACE(WHAT) TraceScope trace_scope(*this, (WHAT))
+
 #define RY_PARSER__WRAP_PARSE_FUNC(WHAT, RET_TYPE, FUNC_BLOCK) \
     { \
+        RY_PARSER__TRACE((WHAT)); \
         auto start_token_idx = m_tokenIdx; \
         auto parse_func = [&]() -> RET_TYPE { \
             {FUNC_BLOCK} \
@@ -41,6 +45,35 @@ namespace ry {
         m_tokenIdx(0)
     {}
 
+    Parser::TraceScope::TraceScope(Parser& parser, const char * what):
+        m_parser(parser),
+        m_startTokenIdx(parser.m_tokenIdx),
+        m_scope(what, parser.m_infos.GetId())
+    {}
+
+    Parser::TraceScope::~TraceScope() {
+        if(m_scope.IsActive())
+            m_scope.SetSpan(m_parser.getTokenSpan(m_startTokenIdx, m_parser.m_tokenIdx));
+    }
+
+    SourcePosition Parser::getTokenSpan(int startTokenIdx, int endTokenIdx) const {
+        if(m_tokens.empty())
+            return SourcePosition(1, 1);
+        auto clampIdx = [&](int idx) {
+            return std::clamp(idx, 0, int(m_tokens.size()) - 1);
+        };
+        const SourcePosition& start = m_tokens[clampIdx(startTokenIdx)].GetSourcePosition();
+        const SourcePosition& end = m_tokens[clampIdx(std::max(endTokenIdx - 1, startTokenIdx))].GetSourcePosition();
+        return SourcePosition(start.startLine, start.startColumn, end.endLine, end.endColumn);
+    }
+
+    std::optional<SourcePosition> Parser::getSpanFrom(const std::optional<SourcePosition>& start) const {
+        if(!start)
+            return {};
+        SourcePosition end = getTokenSpan(m_tokenIdx - 1, m_tokenIdx);
+        return SourcePosition(start->startLine, start->startColumn, end.endLine, end.endColumn);
+    }
+
     const Infos& Parser::GetInfos() const {
         return m_infos;
     }
@@ -142,7 +175,7 @@ namespace ry {
 
     // 
     // Syntax:
-    //        <type>              :: ['('] [~] [?] (<type_primitive> | <type_func> | <type_struct> | <type_ptr>) [')']
+    //        <type>              :: ['('] [~] [?] [!] [^] (<type_primitive> | <type_func> | <type_struct> | <type_ptr>) [')']
     //        <type_primitive>    :: (* see ASTNode::TypePrimitive *)
     //        <type_func>         :: <type_struct> => <type>
     //        <type_struct>       :: '[' [{<type_struct_field> ,|;} <type_struct_field>] ']'
@@ -152,6 +185,12 @@ namespace ry {
     //        "Duplicate optional type attribute "??""
     //        "Duplicate mutable type attribute "~~""
     //        "Cannot have an optional mutable type "?~", did you mean "~?" ?" 
+    //        "Duplicate ordered type attribute "!!""
+    //        "Ordered type attribute "!" must come last"
+    //        "Ordered type attribute "!" only applies to struct types"
+    //        "Duplicate struct-of-arrays type attribute "^^""
+    //        "Struct-of-arrays type attribute "^" must come last"
+    //        "Struct-of-arrays type attribute "^" only applies to struct types"
     //        "Function type arguments expected to be of type struct, got ..."
     //        "Expected struct type field separator"
     //        "Unterminated grouped type"
@@ -190,6 +229,32 @@ namespace ry {
                     eatToken();
                 }
             }
+            if(isToken('!')) {
+                eatToken();
+                attribs.isOrdered = true;
+
+                if(isToken('!')) {
+                    error("Duplicate ordered type attribute \"!!\"");
+                    eatToken();
+                }
+                else if(isToken('~') || isToken('?')) {
+                    error("Ordered type attribute \"!\" must come last");
+                    eatToken();
+                }
+            }
+            if(isToken('^')) {
+                eatToken();
+                attribs.isSoA = true;
+
+                if(isToken('^')) {
+                    error("Duplicate struct-of-arrays type attribute \"^^\"");
+                    eatToken();
+                }
+                else if(isToken('~') || isToken('?') || isToken('!')) {
+                    error("Struct-of-arrays type attribute \"^\" must come last");
+                    eatToken();
+                }
+            }
 
             // type
 
@@ -262,6 +327,10 @@ namespace ry {
             RY_PARSER__ASSERT(optType);
             auto type = optType.value();
             auto retType = parseFunctionType(type).value_or(type);
+            if(attribs.isOrdered && !std::holds_alternative<ASTNode::TypeStruct>(retType.Get()))
+                error("Ordered type attribute \"!\" only applies to struct types");
+            if(attribs.isSoA && !std::holds_alternative<ASTNode::TypeStruct>(retType.Get()))
+                error("Struct-of-arrays type attribute \"^\" only applies to struct types");
 
             if(isGrouped) {
                 if(isToken(')'))
@@ -285,6 +354,8 @@ namespace ry {
     //        TODO
     // 
     std::optional<ASTNode::TypeStruct::Field> Parser::parseStructTypeField() {
+        RY_PARSER__TRACE("struct type field");
+
         using TypeStruct = ASTNode::TypeStruct;
         using Field = TypeStruct::Field;
         using NamedField = TypeStruct::NamedField;
@@ -300,6 +371,8 @@ namespace ry {
                     return {};
             }
 
+            // the field may start with a type instead, e.g. [[x i32] * 2], what the attempt reports does not apply
+            std::size_t numInfos = m_infos.Get().size();
             auto optExpr = parseExpression(false);
             if(optExpr.has_value()) {
                 if(pos == TypeRepsPos::Pre) {
@@ -309,6 +382,8 @@ namespace ry {
                 return std::make_shared<ASTNode::Expression>(optExpr.value());
             }
 
+            if(pos == TypeRepsPos::Pre)
+                m_infos.Truncate(numInfos);
             return {};
         };
 
@@ -409,7 +484,7 @@ namespace ry {
     std::optional<ASTNode::Expression> Parser::parseExpression(bool mustParse, std::optional<ASTNode::ExpressionBinaryOperation::Kind> currentBinOpKind) {
     #define TRY_RETURN(OPT) { \
         if(auto opt = OPT) \
-            return ASTNode::Expression(opt.value(), isGrouped); \
+            return ASTNode::Expression(opt.value(), isGrouped, getTokenSpan(exprStartTokenIdx, m_tokenIdx)); \
     }
         RY_PARSER__WRAP_PARSE_FUNC("expression", std::optional<ASTNode::Expression>, {
             bool isGrouped = false;
@@ -418,11 +493,12 @@ namespace ry {
                 isGrouped = true;
                 currentBinOpKind = {};
             }
+            int exprStartTokenIdx = m_tokenIdx; // spans exclude the parentheses
 
             auto tryParse = [&]() -> std::optional<ASTNode::Expression> {
                 TRY_RETURN(parseNameExpression          (false));
+                TRY_RETURN(parseBlockExpression         (false)); // before literals, labels are string literals
                 TRY_RETURN(parseLiteralExpression       (false));
-                TRY_RETURN(parseBlockExpression         (false));
                 TRY_RETURN(parseIfExpression            (false));
                 TRY_RETURN(parseLoopExpression          (false));
                 TRY_RETURN(parseUnaryOperationExpression(false));
@@ -431,9 +507,9 @@ namespace ry {
             auto optExpr = tryParse();
             if(optExpr.has_value()) {
                 if(auto optFuncCall = parseFunctionCallExpression(false, optExpr.value()))
-                    optExpr = ASTNode::Expression(optFuncCall.value(), isGrouped);
+                    optExpr = ASTNode::Expression(optFuncCall.value(), isGrouped, getTokenSpan(exprStartTokenIdx, m_tokenIdx));
                 else if(auto optBinOp = parseBinaryOperationExpression(false, optExpr.value(), currentBinOpKind))
-                    optExpr = ASTNode::Expression(optBinOp.value(), isGrouped);
+                    optExpr = ASTNode::Expression(optBinOp.value(), isGrouped, getTokenSpan(exprStartTokenIdx, m_tokenIdx));
             }
 
             if(isGrouped) {
@@ -494,6 +570,8 @@ namespace ry {
     }
 
     std::optional<ASTNode::ExpressionLiteral> Parser::parseLiteralExpression(bool mustParse) {
+        RY_PARSER__TRACE("literal");
+
         using Literal = ASTNode::ExpressionLiteral;
 
         auto optStructLiteral = parseStructLiteralExpression(false);
@@ -535,8 +613,11 @@ namespace ry {
     }
 
     std::optional<ASTNode::ExpressionBlock> Parser::parseBlockExpression(bool mustParse) {
+        RY_PARSER__TRACE("block");
+
         using Block = ASTNode::ExpressionBlock;
 
+        int startTokenIdx = m_tokenIdx;
         Block::Label label;
         if(auto token = getToken())
             if(auto string = token->GetLiteralValue<TokenLiteral::String>()) {
@@ -567,12 +648,15 @@ namespace ry {
             return Block(label, statements);
         }
 
+        m_tokenIdx = startTokenIdx;
         if(mustParse)
             errorExpected("block");
         return {};
     }
 
     std::optional<ASTNode::ExpressionIf> Parser::parseIfExpression(bool mustParse) {
+        RY_PARSER__TRACE("if");
+
         if(isToken(Token::Code::KeywordIf)) {
             eatToken();
 
@@ -605,41 +689,60 @@ namespace ry {
     }
 
     std::optional<ASTNode::ExpressionLoop> Parser::parseLoopExpression(bool mustParse) {
-    #define ASSERT(cond) if(cond) goto error;
+        RY_PARSER__TRACE("loop");
+
+    #define ASSERT(cond) if(!(cond)) goto error;
 
         using Loop = ASTNode::ExpressionLoop;
 
         if(isToken(Token::Code::KeywordLoop)) {
             eatToken();
 
-            Loop::InitStatement initStatement; {
-                auto optInitStatement = parseStatement(false);
-                if(optInitStatement.has_value())
-                    initStatement = std::make_shared<ASTNode::Statement>(optInitStatement.value());
-            }
+            auto optFirstStatement = parseStatement(false);
+            ASSERT(optFirstStatement.has_value());
+            auto firstStatement = std::make_shared<ASTNode::Statement>(optFirstStatement.value());
+
+            // loop body
+            if(!isToken(';') && !isToken(',') && !isToken(Token::Code::KeywordDo))
+                return ASTNode::ExpressionLoop({}, {}, {}, firstStatement);
 
+            Loop::InitStatement initStatement;
             Loop::Condition condition;
-            if(initStatement.has_value())
-                if(isToken(';') || isToken(',')) {
-                    eatToken();
-                    auto optCondition = parseExpression();
-                    ASSERT(optCondition.has_value());
-                    condition = std::make_shared<ASTNode::Expression>(optCondition.value());
+            Loop::PostStatement postStatement;
+            if(isToken(';') || isToken(',')) {
+                // loop body; where the separator ends the statement of the loop rather than an init statement
+                auto bodyEndIdx = m_tokenIdx;
+                auto bodyLoop = ASTNode::ExpressionLoop({}, {}, {}, firstStatement);
+
+                initStatement = firstStatement;
+                eatToken();
+                auto optCondition = parseExpression(false);
+                if(!optCondition.has_value()) {
+                    m_tokenIdx = bodyEndIdx;
+                    return bodyLoop;
                 }
+                condition = std::make_shared<ASTNode::Expression>(optCondition.value());
 
-            Loop::PostStatement postStatement;
-            if(condition.has_value())
                 if(isToken(';') || isToken(',')) {
                     eatToken();
-                    auto optPostStatement = parseExpression();
+                    auto optPostStatement = parseStatement(false);
                     ASSERT(optPostStatement.has_value());
                     postStatement = std::make_shared<ASTNode::Statement>(optPostStatement.value());
                 }
 
-            if(initStatement.has_value()) {
-                ASSERT(expectToken(Token::Code::KeywordDo))
-                eatToken();
+                if(!isToken(Token::Code::KeywordDo)) {
+                    m_tokenIdx = bodyEndIdx;
+                    return bodyLoop;
+                }
             }
+            // loop condition do body
+            else if(auto expr = std::get_if<ASTNode::StatementExpression>(&firstStatement->Get()))
+                condition = std::make_shared<ASTNode::Expression>(*expr);
+            else
+                initStatement = firstStatement;
+
+            ASSERT(expectToken(Token::Code::KeywordDo))
+            eatToken();
 
             auto optBodyStatement = parseExpression();
             ASSERT(optBodyStatement.has_value());
@@ -656,6 +759,8 @@ namespace ry {
     }
 
     std::optional<ASTNode::ExpressionName> Parser::parseNameExpression(bool mustParse) {
+        RY_PARSER__TRACE("name");
+
         if(auto token = getToken())
             if(auto name = token->GetName()) {
                 eatToken();
@@ -710,7 +815,7 @@ namespace ry {
             auto operand1 = std::make_shared<ASTNode::Expression>(expr1);
             auto operand2 = std::make_shared<ASTNode::Expression>(optExpr2.value());
             auto binOp = BinOp(kind, operand1, operand2);
-            auto expr = ASTNode::Expression(binOp);
+            auto expr = ASTNode::Expression(binOp, false, getSpanFrom(expr1.GetSourcePosition()));
 
             auto optBinOp2 = parseBinaryOperationExpression(false, expr);
             if(optBinOp2)
@@ -729,7 +834,7 @@ namespace ry {
     std::optional<ASTNode::Statement> Parser::parseStatement(bool mustParse) {
     #define TRY_RETURN(OPT) { \
         if(auto opt = OPT) \
-            return ASTNode::Statement(opt.value()); \
+            return ASTNode::Statement(opt.value(), getTokenSpan(start_token_idx, m_tokenIdx)); \
     }
 
         RY_PARSER__WRAP_PARSE_FUNC("statement", std::optional<ASTNode::Statement>, {
@@ -823,8 +928,10 @@ namespace ry {
 
     std::optional<ASTNode::StatementContinue> Parser::parseContinueStatement(bool mustParse) {
         RY_PARSER__WRAP_PARSE_FUNC("continue", std::optional<ASTNode::StatementContinue>, {
-            if(isToken(Token::Code::KeywordContinue))
+            if(isToken(Token::Code::KeywordContinue)) {
+                eatToken();
                 return ASTNode::StatementContinue();
+            }
         });
     }
 
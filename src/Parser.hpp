@@ -3,6 +3,7 @@
 #include "Infos.hpp"
 #include "Token.hpp"
 #include "ASTNode.hpp"
+#include "Trace.hpp"
 #include "src/ASTNode.hpp"
 
 #include <variant>
@@ -20,6 +21,21 @@ namespace ry {
         std::optional<ASTNode> Parse();
 
     private:
+        // Trace event spanning the tokens consumed by a parse function
+        class TraceScope {
+        public:
+            TraceScope(Parser& parser, const char * what);
+            ~TraceScope();
+
+        private:
+            Parser& m_parser;
+            int m_startTokenIdx;
+            Trace::Scope m_scope;
+        };
+
+        SourcePosition getTokenSpan(int startTokenIdx, int endTokenIdx) const;
+        std::optional<SourcePosition> getSpanFrom(const std::optional<SourcePosition>& start) const;
+
         template<typename T>
         bool isToken(const std::optional<T>& kind = {});
         bool isToken(const std::optional<Token::Kind>& kind);
@@ -35,6 +35,22 @@
     E("f32", KeywordF32) \
     E("f64", KeywordF64) \
     E("bool", KeywordBool) \
+    E("i8x16", KeywordI8x16) \
+    E("i16x8", KeywordI16x8) \
+    E("i32x4", KeywordI32x4) \
+    E("i32x8", KeywordI32x8) \
+    E("i64x2", KeywordI64x2) \
+    E("i64x4", KeywordI64x4) \
+    E("u8x16", KeywordU8x16) \
+    E("u16x8", KeywordU16x8) \
+    E("u32x4", KeywordU32x4) \
+    E("u32x8", KeywordU32x8) \
+    E("u64x2", KeywordU64x2) \
+    E("u64x4", KeywordU64x4) \
+    E("f32x4", KeywordF32x4) \
+    E("f32x8", KeywordF32x8) \
+    E("f64x2", KeywordF64x2) \
+    E("f64x4", KeywordF64x4) \
     \
     E("", _LastTypeKeyword) \
     E("", _LastKeyword) 
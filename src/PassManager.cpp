@@ -0,0 +1,574 @@
+#include "PassManager.hpp"
+
+#include "RangeAnalysis.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <utility>
+
+namespace ry {
+
+    using Value = IR::Value;
+    using BlockId = IR::BlockId;
+    using Op = IR::Op;
+
+    using Slot = Bytecode::Slot;
+
+    const PassManager::Entry PassManager::PASSES[] = {
+        {"copies", &PassManager::propagateCopies, "propagate copies and remove trivial phis"},
+        {"dce", &PassManager::removeDeadCode, "remove values nothing with an effect reads"},
+        {"ranges", &RangeAnalysis::Run, "prove which operations do not overflow"},
+        {"sccp", &PassManager::propagateConstants, "propagate constants along the branches taken"},
+        {"simplify", &PassManager::simplify, "apply algebraic identities and reduce strength"},
+        {"unreachable", &PassManager::removeUnreachable, "remove blocks the entry does not reach"}
+    };
+
+    PassManager::PassManager() {
+        SetPipeline(DEFAULT_PIPELINE);
+    }
+
+    bool PassManager::SetPipeline(std::string_view names) {
+        std::vector<const Entry *> pipeline;
+        while(!names.empty()) {
+            std::size_t comma = names.find(',');
+            std::string_view name = names.substr(0, comma);
+            names = comma == std::string_view::npos ? std::string_view() : names.substr(comma + 1);
+            if(name.empty())
+                continue;
+            auto it = std::find_if(std::begin(PASSES), std::end(PASSES), [&](const Entry& entry) {
+                return entry.name == name;
+            });
+            if(it == std::end(PASSES))
+                return false;
+            pipeline.push_back(&*it);
+        }
+        m_pipeline = std::move(pipeline);
+        return true;
+    }
+
+    void PassManager::SetVerifying(bool isVerifying) {
+        m_isVerifying = isVerifying;
+    }
+
+    std::optional<std::string> PassManager::Run(IR::Function& function) const {
+        if(m_isVerifying)
+            if(std::optional<std::string> error = IR::Verify(function))
+                return std::format("after lowering: {}", error.value());
+        for(const Entry * entry : m_pipeline) {
+            entry->pass(function);
+            if(m_isVerifying)
+                if(std::optional<std::string> error = IR::Verify(function))
+                    return std::format("after {}: {}", entry->name, error.value());
+        }
+        return {};
+    }
+
+    std::span<const PassManager::Entry> PassManager::GetPasses() {
+        return PASSES;
+    }
+
+    std::string PassManager::StringifyPipeline() const {
+        std::string str;
+        for(const Entry * entry : m_pipeline)
+            str += std::format("{}{}", str.empty() ? "" : ",", entry->name);
+        return str;
+    }
+
+    /*
+     *
+     * Passes
+     *
+     */
+
+    bool PassManager::propagateCopies(IR::Function& function) {
+        bool isChanged = false;
+        // a phi made a copy can make the phis that read it trivial
+        for(bool isPhiChanged = true; isPhiChanged;) {
+            isPhiChanged = false;
+            for(const IR::Block& block : function.blocks) {
+                for(Value value : block.code) {
+                    IR::Instruction& instruction = function.instructions[value];
+                    if(instruction.op != Op::Phi)
+                        continue;
+                    Value same = IR::NONE;
+                    bool isTrivial = true;
+                    for(Value operand : IR::GetOperands(function, value)) {
+                        operand = IR::Resolve(function, operand);
+                        if(operand == same || operand == value)
+                            continue;
+                        if(same != IR::NONE) {
+                            isTrivial = false;
+                            break;
+                        }
+                        same = operand;
+                    }
+                    if(!isTrivial || same == IR::NONE)
+                        continue;
+                    instruction.op = Op::Copy;
+                    instruction.numOperands = 1;
+                    function.operands[instruction.firstOperand] = same;
+                    isPhiChanged = true;
+                }
+            }
+        }
+
+        for(IR::Block& block : function.blocks)
+            for(Value value : block.code)
+                for(Value& operand : IR::GetOperands(function, value))
+                    operand = IR::Resolve(function, operand);
+        for(auto& [expr, value] : function.values)
+            value = IR::Resolve(function, value);
+        for(IR::Block& block : function.blocks) {
+            std::erase_if(block.code, [&](Value value) {
+                IR::Instruction& instruction = function.instructions[value];
+                if(instruction.op != Op::Copy)
+                    return false;
+                instruction.op = Op::Nop;
+                instruction.numOperands = 0;
+                isChanged = true;
+                return true;
+            });
+        }
+        return isChanged;
+    }
+
+    bool PassManager::removeUnreachable(IR::Function& function) {
+        std::vector<bool> isReached(function.blocks.size(), false);
+        std::vector<BlockId> stack = {0};
+        isReached[0] = true;
+        while(!stack.empty()) {
+            BlockId block = stack.back();
+            stack.pop_back();
+            for(BlockId succ : IR::GetSuccessors(function, block)) {
+                if(!isReached[succ]) {
+                    isReached[succ] = true;
+                    stack.push_back(succ);
+                }
+            }
+        }
+
+        bool isChanged = false;
+        for(BlockId block = 0; block < function.blocks.size(); block++) {
+            IR::Block& data = function.blocks[block];
+            if(!isReached[block]) {
+                isChanged = isChanged || !data.code.empty();
+                for(Value value : data.code) {
+                    function.instructions[value].op = Op::Nop;
+                    function.instructions[value].numOperands = 0;
+                }
+                data.code.clear();
+                data.preds.clear();
+                continue;
+            }
+
+            // the phis drop the operands of the edges removed, in the order of the predecessors
+            std::size_t numPreds = 0;
+            for(std::size_t i = 0; i < data.preds.size(); i++) {
+                if(!isReached[data.preds[i]])
+                    continue;
+                for(Value value : data.code) {
+                    IR::Instruction& instruction = function.instructions[value];
+                    if(instruction.op == Op::Phi)
+                        function.operands[instruction.firstOperand + numPreds] = function.operands[instruction.firstOperand + i];
+                }
+                data.preds[numPreds++] = data.preds[i];
+            }
+            if(numPreds == data.preds.size())
+                continue;
+            isChanged = true;
+            data.preds.resize(numPreds);
+            for(Value value : data.code)
+                if(function.instructions[value].op == Op::Phi)
+                    function.instructions[value].numOperands = std::uint32_t(numPreds);
+        }
+        return isChanged;
+    }
+
+    bool PassManager::propagateConstants(IR::Function& function) {
+        std::size_t numValues = function.instructions.size();
+        std::size_t numBlocks = function.blocks.size();
+
+        // the users of each value, and the edges into each block in the order of its predecessors
+        std::vector<std::uint32_t> userStarts(numValues + 1, 0);
+        std::vector<std::uint32_t> edgeStarts(numBlocks + 1, 0);
+        for(BlockId block = 0; block < numBlocks; block++) {
+            edgeStarts[block + 1] = edgeStarts[block] + std::uint32_t(function.blocks[block].preds.size());
+            for(Value value : function.blocks[block].code)
+                for(Value operand : IR::GetOperands(function, value))
+                    userStarts[operand + 1]++;
+        }
+        for(std::size_t i = 0; i < numValues; i++)
+            userStarts[i + 1] += userStarts[i];
+        std::vector<Value> users(userStarts[numValues]);
+        std::vector<std::uint32_t> numUsers(numValues, 0);
+        for(const IR::Block& data : function.blocks)
+            for(Value value : data.code)
+                for(Value operand : IR::GetOperands(function, value))
+                    users[userStarts[operand] + numUsers[operand]++] = value;
+
+        std::vector<Lattice> lattice(numValues, Lattice::Top);
+        std::vector<Slot> constants(numValues, 0);
+        std::vector<bool> isExecutable(numBlocks, false);
+        std::vector<bool> isEdgeExecutable(edgeStarts[numBlocks], false);
+        std::vector<std::pair<BlockId, BlockId>> flowWork = {{IR::NONE, 0}};
+        std::vector<Value> valueWork;
+
+        auto evaluate = [&](Value value) -> std::pair<Lattice, Slot> {
+            const IR::Instruction& instruction = function.instructions[value];
+            std::span<const Value> operands = IR::GetOperands(function, value);
+            switch(instruction.op) {
+                case Op::Const:
+                    return {Lattice::Const, instruction.imm};
+                case Op::Copy:
+                    return {lattice[operands[0]], constants[operands[0]]};
+                case Op::Phi: {
+                    std::pair<Lattice, Slot> meet = {Lattice::Top, 0};
+                    for(std::size_t i = 0; i < operands.size(); i++) {
+                        Value operand = operands[i];
+                        if(!isEdgeExecutable[edgeStarts[instruction.block] + i] || lattice[operand] == Lattice::Top)
+                            continue;
+                        if(lattice[operand] == Lattice::Bottom || (meet.first == Lattice::Const && meet.second != constants[operand]))
+                            return {Lattice::Bottom, 0};
+                        meet = {Lattice::Const, constants[operand]};
+                    }
+                    return meet;
+                }
+                case Op::Nop: case Op::Undef: case Op::Param: case Op::Opaque: case Op::Load: case Op::Call:
+                    return {Lattice::Bottom, 0};
+                default:
+                    break;
+            }
+            if(operands.empty())
+                return {Lattice::Bottom, 0};
+            for(Value operand : operands)
+                if(lattice[operand] == Lattice::Bottom)
+                    return {Lattice::Bottom, 0};
+            for(Value operand : operands)
+                if(lattice[operand] == Lattice::Top)
+                    return {Lattice::Top, 0};
+            std::optional<Slot> result = IR::Evaluate(instruction.op, function.instructions[operands[0]].scalar,
+                constants[operands[0]], operands.size() > 1 ? constants[operands[1]] : 0);
+            if(!result)
+                return {Lattice::Bottom, 0};
+            return {Lattice::Const, result.value()};
+        };
+
+        auto visit = [&](Value value) {
+            const IR::Instruction& instruction = function.instructions[value];
+            if(instruction.op == Op::Jump)
+                flowWork.emplace_back(instruction.block, BlockId(instruction.imm));
+            else if(instruction.op == Op::Branch) {
+                Value condition = function.operands[instruction.firstOperand];
+                if(lattice[condition] == Lattice::Top)
+                    return;
+                if(lattice[condition] == Lattice::Bottom || constants[condition] != 0)
+                    flowWork.emplace_back(instruction.block, BlockId(instruction.imm & 0xFFFFFFFF));
+                if(lattice[condition] == Lattice::Bottom || constants[condition] == 0)
+                    flowWork.emplace_back(instruction.block, BlockId(instruction.imm >> 32));
+            }
+            else if(!IR::IsTerminator(instruction.op) && instruction.op != Op::Store && lattice[value] != Lattice::Bottom) {
+                std::pair<Lattice, Slot> state = evaluate(value);
+                if(state.first != lattice[value]) {
+                    lattice[value] = state.first;
+                    constants[value] = state.second;
+                    valueWork.push_back(value);
+                }
+            }
+        };
+
+        while(!flowWork.empty() || !valueWork.empty()) {
+            if(!flowWork.empty()) {
+                auto [pred, block] = flowWork.back();
+                flowWork.pop_back();
+                bool isNew = pred == IR::NONE;
+                const std::vector<BlockId>& preds = function.blocks[block].preds;
+                for(std::size_t i = 0; i < preds.size(); i++) {
+                    if(preds[i] == pred && !isEdgeExecutable[edgeStarts[block] + i]) {
+                        isEdgeExecutable[edgeStarts[block] + i] = true;
+                        isNew = true;
+                    }
+                }
+                if(!isNew)
+                    continue;
+                // a new edge into a block that already runs only changes its phis
+                bool isFirst = !isExecutable[block];
+                isExecutable[block] = true;
+                for(Value value : function.blocks[block].code)
+                    if(isFirst || function.instructions[value].op == Op::Phi)
+                        visit(value);
+                continue;
+            }
+            Value value = valueWork.back();
+            valueWork.pop_back();
+            for(std::uint32_t i = userStarts[value]; i < userStarts[value + 1]; i++)
+                if(isExecutable[function.instructions[users[i]].block])
+                    visit(users[i]);
+        }
+
+        bool isChanged = false;
+        for(BlockId block = 0; block < numBlocks; block++) {
+            if(!isExecutable[block])
+                continue;
+            std::vector<Value>& code = function.blocks[block].code;
+            for(Value value : code) {
+                IR::Instruction& instruction = function.instructions[value];
+                if(lattice[value] == Lattice::Const && instruction.op != Op::Const) {
+                    setConst(function, value, constants[value]);
+                    isChanged = true;
+                }
+            }
+            // former phis become constants, the remaining ones stay first
+            std::stable_partition(code.begin(), code.end(), [&](Value value) {
+                Op op = function.instructions[value].op;
+                return op == Op::Phi || op == Op::Copy;
+            });
+
+            IR::Instruction& terminator = function.instructions[code.back()];
+            if(terminator.op != Op::Branch)
+                continue;
+            Value condition = function.operands[terminator.firstOperand];
+            BlockId success = BlockId(terminator.imm & 0xFFFFFFFF);
+            BlockId failure = BlockId(terminator.imm >> 32);
+            if(function.instructions[condition].op != Op::Const || success == failure)
+                continue;
+            BlockId taken = function.instructions[condition].imm != 0 ? success : failure;
+            BlockId dropped = taken == success ? failure : success;
+            terminator.op = Op::Jump;
+            terminator.numOperands = 0;
+            terminator.imm = taken;
+            const std::vector<BlockId>& preds = function.blocks[dropped].preds;
+            removeEdge(function, dropped, std::size_t(std::find(preds.begin(), preds.end(), block) - preds.begin()));
+            isChanged = true;
+        }
+        return isChanged;
+    }
+
+    bool PassManager::simplify(IR::Function& function) {
+        bool isChanged = false;
+        for(BlockId block = 0; block < function.blocks.size(); block++) {
+            std::vector<Value>& code = function.blocks[block].code;
+            for(std::size_t i = 0; i < code.size(); i++) {
+                Value value = code[i];
+                IR::Instruction& instruction = function.instructions[value];
+                std::span<Value> operands = IR::GetOperands(function, value);
+                if(instruction.op < Op::Add || instruction.op > Op::Le || operands.empty())
+                    continue;
+                Value a = operands[0];
+                Value b = operands.size() > 1 ? operands[1] : IR::NONE;
+                IR::Scalar scalar = function.instructions[a].scalar;
+                auto isConst = [&](Value operand, Slot imm) {
+                    return operand != IR::NONE && function.instructions[operand].op == Op::Const && function.instructions[operand].imm == imm;
+                };
+                auto isSameOp = [&](Value operand) {
+                    return function.instructions[operand].op == instruction.op && function.instructions[operand].numOperands == 1;
+                };
+
+                // op op x is x
+                if(instruction.op == Op::Neg || instruction.op == Op::Not || instruction.op == Op::LogicalNot) {
+                    if(isSameOp(a)) {
+                        setCopy(function, value, function.operands[function.instructions[a].firstOperand]);
+                        isChanged = true;
+                    }
+                    continue;
+                }
+                if(b == IR::NONE || scalar.width == 0 || scalar.width > 64)
+                    continue;
+
+                // x + -0.0 and x - 0.0 are x, but x + 0.0 is not for x = -0.0, nor x * 0.0 zero for infinities and NaNs
+                if(scalar.isFloat) {
+                    Slot one = Bytecode::FromFloat(1.0, scalar.width);
+                    bool isIdentity = (instruction.op == Op::Add && isConst(b, Bytecode::FromFloat(-0.0, scalar.width)))
+                        || (instruction.op == Op::Sub && isConst(b, Bytecode::FromFloat(0.0, scalar.width)))
+                        || ((instruction.op == Op::Mul || instruction.op == Op::Div) && isConst(b, one));
+                    if(isIdentity) {
+                        setCopy(function, value, a);
+                        isChanged = true;
+                    }
+                    else if(instruction.op == Op::Mul && isConst(a, one)) {
+                        setCopy(function, value, b);
+                        isChanged = true;
+                    }
+                    continue;
+                }
+
+                Slot ones = Bytecode::Normalize(~Slot(0), scalar.width, scalar.isSigned);
+                std::optional<Value> copied;
+                std::optional<Slot> folded;
+                // the power of two b is for the unsigned value of its width
+                Slot bits = function.instructions[b].op == Op::Const ? function.instructions[b].imm : 0;
+                if(scalar.width < 64)
+                    bits &= (Slot(1) << scalar.width) - 1;
+                bool isPowerOfTwo = scalar.width > 1 && function.instructions[b].op == Op::Const && std::has_single_bit(bits) && bits > 1;
+                switch(instruction.op) {
+                    case Op::Add:
+                    case Op::Or:
+                    case Op::Xor:
+                        if(isConst(b, 0))
+                            copied = a;
+                        else if(isConst(a, 0))
+                            copied = b;
+                        else if(instruction.op == Op::Or && (isConst(a, ones) || isConst(b, ones)))
+                            folded = ones;
+                        else if(instruction.op == Op::Or && a == b)
+                            copied = a;
+                        else if(instruction.op == Op::Xor && a == b)
+                            folded = 0;
+                        break;
+                    case Op::Sub:
+                        if(isConst(b, 0))
+                            copied = a;
+                        else if(a == b)
+                            folded = 0;
+                        break;
+                    case Op::Mul:
+                        if(isConst(b, 1))
+                            copied = a;
+                        else if(isConst(a, 1))
+                            copied = b;
+                        else if(isConst(a, 0) || isConst(b, 0))
+                            folded = 0;
+                        else if(isPowerOfTwo) {
+                            // wraps the same, as C shifts of the unsigned value
+                            code.insert(code.begin() + i, Value(function.instructions.size()));
+                            function.instructions.push_back(IR::Instruction{Op::Const, scalar, block, 0, 0, Slot(std::countr_zero(bits)), false});
+                            i++;
+                            function.instructions[value].op = Op::Shl;
+                            function.operands[function.instructions[value].firstOperand + 1] = code[i - 1];
+                            isChanged = true;
+                        }
+                        break;
+                    case Op::Div:
+                        if(isConst(b, 1))
+                            copied = a;
+                        else if(isPowerOfTwo && !scalar.isSigned) {
+                            code.insert(code.begin() + i, Value(function.instructions.size()));
+                            function.instructions.push_back(IR::Instruction{Op::Const, scalar, block, 0, 0, Slot(std::countr_zero(bits)), false});
+                            i++;
+                            function.instructions[value].op = Op::Shr;
+                            function.operands[function.instructions[value].firstOperand + 1] = code[i - 1];
+                            isChanged = true;
+                        }
+                        break;
+                    case Op::Mod:
+                        if(isConst(b, 1))
+                            folded = 0;
+                        else if(isPowerOfTwo && !scalar.isSigned) {
+                            code.insert(code.begin() + i, Value(function.instructions.size()));
+                            function.instructions.push_back(IR::Instruction{Op::Const, scalar, block, 0, 0, bits - 1, false});
+                            i++;
+                            function.instructions[value].op = Op::And;
+                            function.operands[function.instructions[value].firstOperand + 1] = code[i - 1];
+                            isChanged = true;
+                        }
+                        break;
+                    case Op::And:
+                        if(isConst(a, 0) || isConst(b, 0))
+                            folded = 0;
+                        else if(isConst(b, ones) || a == b)
+                            copied = a;
+                        else if(isConst(a, ones))
+                            copied = b;
+                        break;
+                    case Op::Shl:
+                    case Op::Shr:
+                        if(isConst(b, 0))
+                            copied = a;
+                        else if(isConst(a, 0))
+                            folded = 0;
+                        break;
+                    case Op::Eq:
+                    case Op::Le:
+                        if(a == b)
+                            folded = 1;
+                        break;
+                    case Op::Ne:
+                    case Op::Lt:
+                        if(a == b)
+                            folded = 0;
+                        break;
+                    default:
+                        break;
+                }
+                if(copied)
+                    setCopy(function, value, copied.value());
+                else if(folded)
+                    setConst(function, value, folded.value());
+                isChanged = isChanged || copied || folded;
+            }
+        }
+        return isChanged;
+    }
+
+    bool PassManager::removeDeadCode(IR::Function& function) {
+        std::vector<bool> isLive(function.instructions.size(), false);
+        std::vector<Value> stack;
+        for(const IR::Block& data : function.blocks) {
+            for(Value value : data.code) {
+                Op op = function.instructions[value].op;
+                if(op == Op::Store || op == Op::Call || IR::IsTerminator(op)) {
+                    isLive[value] = true;
+                    stack.push_back(value);
+                }
+            }
+        }
+        while(!stack.empty()) {
+            Value value = stack.back();
+            stack.pop_back();
+            for(Value operand : IR::GetOperands(function, value)) {
+                if(!isLive[operand]) {
+                    isLive[operand] = true;
+                    stack.push_back(operand);
+                }
+            }
+        }
+
+        bool isChanged = false;
+        for(IR::Block& data : function.blocks) {
+            std::erase_if(data.code, [&](Value value) {
+                IR::Instruction& instruction = function.instructions[value];
+                if(isLive[value] || instruction.op == Op::Const)
+                    return false;
+                instruction.op = Op::Nop;
+                instruction.numOperands = 0;
+                isChanged = true;
+                return true;
+            });
+        }
+        return isChanged;
+    }
+
+    /*
+     *
+     * Rewriting
+     *
+     */
+
+    void PassManager::removeEdge(IR::Function& function, BlockId block, std::size_t predIdx) {
+        IR::Block& data = function.blocks[block];
+        for(Value value : data.code) {
+            IR::Instruction& instruction = function.instructions[value];
+            if(instruction.op != Op::Phi)
+                continue;
+            auto first = function.operands.begin() + instruction.firstOperand;
+            std::copy(first + predIdx + 1, first + instruction.numOperands, first + predIdx);
+            instruction.numOperands--;
+        }
+        data.preds.erase(data.preds.begin() + predIdx);
+    }
+
+    void PassManager::setCopy(IR::Function& function, Value value, Value copied) {
+        IR::Instruction& instruction = function.instructions[value];
+        instruction.op = Op::Copy;
+        instruction.numOperands = 1;
+        function.operands[instruction.firstOperand] = copied;
+    }
+
+    void PassManager::setConst(IR::Function& function, Value value, Slot imm) {
+        IR::Instruction& instruction = function.instructions[value];
+        instruction.op = Op::Const;
+        instruction.numOperands = 0;
+        instruction.imm = imm;
+    }
+
+}
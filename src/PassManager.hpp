@@ -0,0 +1,79 @@
+#pragma once
+
+#include "IR.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Runs passes over the IR of a function.
+    //
+    // A pass rewrites one function in place and tells if it changed anything. Passes are
+    // registered by name, and the pipeline is a comma-separated list of them, run in order; a
+    // name may repeat. With verification on, the IR is checked after it is built and after each
+    // pass, and the first broken invariant is reported with the pass that broke it.
+    //
+    class PassManager {
+    public:
+        using Pass = bool (*)(IR::Function& function);
+
+        struct Entry {
+            std::string_view name;
+            Pass pass;
+            std::string_view description;
+        };
+
+        static constexpr std::string_view DEFAULT_PIPELINE = "sccp,simplify,sccp,simplify,unreachable,copies,dce,ranges";
+
+        PassManager();
+
+        // false if a name is not a pass, the pipeline is then unchanged
+        bool SetPipeline(std::string_view names);
+        void SetVerifying(bool isVerifying);
+
+        // The first broken invariant, none if the function stays well formed or is not verified
+        std::optional<std::string> Run(IR::Function& function) const;
+
+        static std::span<const Entry> GetPasses();
+        std::string StringifyPipeline() const;
+
+    private:
+        // Of a value during constant propagation, it only goes down
+        enum class Lattice : std::uint8_t {
+            Top,    // not known to run yet
+            Const,
+            Bottom  // varies
+        };
+
+        // Values computed from constants, and phis whose executable edges agree, become constants, and branches
+        // on constants become jumps, so the blocks they no longer reach are unreachable (Wegman and Zadeck,
+        // "Constant Propagation with Conditional Branches")
+        static bool propagateConstants(IR::Function& function);
+        // Algebraic identities of the integer and float semantics, and multiplications, unsigned divisions
+        // and remainders by powers of two become shifts and masks
+        static bool simplify(IR::Function& function);
+        // Values no store, call or terminator reads, constants are kept for the expressions folded to them
+        static bool removeDeadCode(IR::Function& function);
+        // Operands read the value copies stand for, phis of a single value become copies of it, then copies are removed
+        static bool propagateCopies(IR::Function& function);
+        // Blocks no path from the entry reaches are emptied, their edges and phi operands removed
+        static bool removeUnreachable(IR::Function& function);
+
+        // Of the edge from the predecessor at the index, the block then has one less
+        static void removeEdge(IR::Function& function, IR::BlockId block, std::size_t predIdx);
+        static void setCopy(IR::Function& function, IR::Value value, IR::Value copied);
+        static void setConst(IR::Function& function, IR::Value value, Bytecode::Slot imm);
+
+        static const Entry PASSES[];
+
+        std::vector<const Entry *> m_pipeline;
+        bool m_isVerifying = false;
+    };
+
+}
@@ -0,0 +1,80 @@
+#include "PhaseReport.hpp"
+
+#include <format>
+
+namespace ry {
+
+    PhaseReport::Scope::Scope(PhaseReport& report, const char * phase):
+        m_report(report),
+        m_phase(phase),
+        m_start(Profiling::Sample::Take()),
+        m_traceScope(phase)
+    {}
+
+    PhaseReport::Scope::~Scope() {
+        Profiling::Sample sample = Profiling::Sample::Take() - m_start;
+        Phase& phase = m_report.getPhase(m_phase);
+        phase.runs++;
+        phase.total += sample;
+    }
+
+    //
+
+    PhaseReport::PhaseReport() {}
+
+    PhaseReport::Phase& PhaseReport::getPhase(std::string_view name) {
+        for(Phase& phase : m_phases)
+            if(phase.name == name)
+                return phase;
+        m_phases.push_back(Phase{std::string(name), 0, {}, {}});
+        return m_phases.back();
+    }
+
+    void PhaseReport::AddItems(std::string_view phase, std::string_view item, std::size_t count) {
+        getPhase(phase).items[std::string(item)] += count;
+    }
+
+    void PhaseReport::AddASTStats(std::string_view phase, const ASTStats& stats) {
+        AddItems(phase, "nodes", stats.GetNodeCount());
+        for(const auto& [kind, count] : stats.GetKindCounts())
+            AddItems(phase, std::format("nodes.{}", kind), count);
+    }
+
+    std::string PhaseReport::StringifyTime() const {
+        std::string str = std::format("{:<12} {:>6} {:>12} {:>12}\n", "phase", "runs", "wall (ms)", "cpu (ms)");
+        Profiling::Sample total;
+        for(const Phase& phase : m_phases) {
+            str += std::format(
+                "{:<12} {:>6} {:>12.3f} {:>12.3f}\n",
+                phase.name, phase.runs, phase.total.wallTime * 1e3, phase.total.cpuTime * 1e3
+            );
+            total += phase.total;
+        }
+        str += std::format("{:<12} {:>6} {:>12.3f} {:>12.3f}\n", "total", "", total.wallTime * 1e3, total.cpuTime * 1e3);
+        return str;
+    }
+
+    std::string PhaseReport::StringifyMem() const {
+        std::string str = std::format("{:<12} {:>12} {:>16}\n", "phase", "allocations", "allocated (KiB)");
+        Profiling::Sample total;
+        for(const Phase& phase : m_phases) {
+            str += std::format(
+                "{:<12} {:>12} {:>16.1f}\n",
+                phase.name, phase.total.allocations, phase.total.allocatedBytes / 1024.0
+            );
+            total += phase.total;
+        }
+        str += std::format("{:<12} {:>12} {:>16.1f}\n", "total", total.allocations, total.allocatedBytes / 1024.0);
+        str += std::format("peak RSS: {:.1f} KiB\n", Profiling::GetPeakRSS() / 1024.0);
+        return str;
+    }
+
+    std::string PhaseReport::StringifyItems() const {
+        std::string str;
+        for(const Phase& phase : m_phases)
+            for(const auto& [item, count] : phase.items)
+                str += std::format("{:<32} {:>12}\n", phase.name + '.' + item, count);
+        return str;
+    }
+
+}
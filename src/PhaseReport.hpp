@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ASTStats.hpp"
+#include "Profiling.hpp"
+#include "Trace.hpp"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Per-phase time, memory and item counts of a compilation, aggregated across files.
+    // Phases are reported in the order they first ran, so new phases (analysis, codegen, ...)
+    // only need a Scope around them.
+    //
+    class PhaseReport {
+    public:
+        // Measures the enclosing scope as one run of a phase, and traces it when tracing is enabled
+        class Scope {
+        public:
+            // phase must be a string literal
+            Scope(PhaseReport& report, const char * phase);
+            Scope(const Scope&) = delete;
+            ~Scope();
+
+        private:
+            PhaseReport& m_report;
+            const char * m_phase;
+            Profiling::Sample m_start;
+            Trace::Scope m_traceScope;
+        };
+
+        PhaseReport();
+
+        void AddItems(std::string_view phase, std::string_view item, std::size_t count);
+        void AddASTStats(std::string_view phase, const ASTStats& stats);
+
+        std::string StringifyTime() const;
+        std::string StringifyMem() const;
+        std::string StringifyItems() const;
+
+    private:
+        struct Phase {
+            std::string name;
+            std::size_t runs = 0;
+            Profiling::Sample total;
+            std::map<std::string, std::size_t> items;
+        };
+
+        Phase& getPhase(std::string_view name);
+
+        std::vector<Phase> m_phases;
+    };
+
+}
@@ -0,0 +1,126 @@
+#include "Profiling.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+/*
+ *
+ * Allocation counting
+ *
+ */
+
+static std::atomic<std::uint64_t> s_allocations = 0;
+static std::atomic<std::uint64_t> s_allocatedBytes = 0;
+
+static void * countedAlloc(std::size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void * operator new(std::size_t size) {
+    if(void * ptr = countedAlloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void * ptr) noexcept                           { std::free(ptr); }
+void operator delete[](void * ptr) noexcept                         { std::free(ptr); }
+void operator delete(void * ptr, std::size_t) noexcept              { std::free(ptr); }
+void operator delete[](void * ptr, std::size_t) noexcept            { std::free(ptr); }
+void operator delete(void * ptr, const std::nothrow_t&) noexcept    { std::free(ptr); }
+void operator delete[](void * ptr, const std::nothrow_t&) noexcept  { std::free(ptr); }
+
+namespace ry {
+
+    using Sample = Profiling::Sample;
+
+    static double getCPUTime() {
+    #ifdef _WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if(!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+            return 0;
+        auto toSeconds = [](const FILETIME& time) {
+            return double((std::uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+        };
+        return toSeconds(kernelTime) + toSeconds(userTime);
+    #else
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+        auto toSeconds = [](const timeval& time) {
+            return double(time.tv_sec) + double(time.tv_usec) * 1e-6;
+        };
+        return toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+    #endif
+    }
+
+    Sample Sample::Take() {
+        using Clock = std::chrono::steady_clock;
+        Sample sample;
+        sample.wallTime = std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+        sample.cpuTime = getCPUTime();
+        sample.allocations = s_allocations.load(std::memory_order_relaxed);
+        sample.allocatedBytes = s_allocatedBytes.load(std::memory_order_relaxed);
+        return sample;
+    }
+
+    Sample Sample::operator-(const Sample& other) const {
+        Sample diff;
+        diff.wallTime = wallTime - other.wallTime;
+        diff.cpuTime = cpuTime - other.cpuTime;
+        diff.allocations = allocations - other.allocations;
+        diff.allocatedBytes = allocatedBytes - other.allocatedBytes;
+        return diff;
+    }
+
+    Sample& Sample::operator+=(const Sample& other) {
+        wallTime += other.wallTime;
+        cpuTime += other.cpuTime;
+        allocations += other.allocations;
+        allocatedBytes += other.allocatedBytes;
+        return *this;
+    }
+
+    std::uint64_t Profiling::GetPeakRSS() {
+    #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+    #else
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+    #ifdef __APPLE__
+        return usage.ru_maxrss;
+    #else
+        return std::uint64_t(usage.ru_maxrss) * 1024;
+    #endif
+    #endif
+    }
+
+}
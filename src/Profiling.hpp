@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ry {
+
+    //
+    // Process-wide measurements for benchmarks and driver reports.
+    //
+    // Allocations are counted by replacing the global operator new, so the counters
+    // cover every allocation made through new (including std containers) in the process.
+    //
+    class Profiling {
+    public:
+        struct Sample {
+            double wallTime = 0;  // seconds
+            double cpuTime = 0;   // seconds, user + system
+            std::uint64_t allocations = 0;
+            std::uint64_t allocatedBytes = 0;
+
+            static Sample Take();
+
+            Sample operator-(const Sample& other) const;
+            Sample& operator+=(const Sample& other);
+        };
+
+        // Peak resident set size of the process in bytes, 0 if unavailable
+        static std::uint64_t GetPeakRSS();
+    };
+
+}
@@ -0,0 +1,400 @@
+#include "RangeAnalysis.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace ry {
+
+    RangeAnalysis::RangeAnalysis(IR::Function& function):
+        m_function(function),
+        m_ranges(function.instructions.size(), EMPTY),
+        m_growths(function.instructions.size(), 0)
+    {}
+
+    bool RangeAnalysis::Run(IR::Function& function) {
+        RangeAnalysis analysis(function);
+        analysis.computeOrder();
+        analysis.computeDominators();
+        bool isConverged = true;
+        for(std::size_t numSweeps = 0; analysis.sweep(false); numSweeps++) {
+            if(numSweeps == MAX_SWEEPS) {
+                isConverged = false;
+                break;
+            }
+        }
+        for(std::size_t i = 0; i < NUM_NARROWINGS && isConverged; i++)
+            analysis.sweep(true);
+
+        bool isChanged = false;
+        for(BlockId block : analysis.m_order) {
+            for(Value value : function.blocks[block].code) {
+                IR::Instruction& instruction = function.instructions[value];
+                if(instruction.op < Op::Add || instruction.op > Op::Not)
+                    continue;
+                bool isSafe = isConverged && analysis.evaluate(value).second;
+                isChanged = isChanged || instruction.isSafe != isSafe;
+                instruction.isSafe = isSafe;
+            }
+        }
+        return isChanged;
+    }
+
+    /*
+     *
+     * Intervals
+     *
+     */
+
+    // u64 does not fit the interval, nor do floats and 128-bit integers
+    std::optional<RangeAnalysis::Range> RangeAnalysis::getTypeRange(const IR::Scalar& scalar) {
+        if(scalar.width == 0 || scalar.isFloat || scalar.width > 64 || (scalar.width == 64 && !scalar.isSigned))
+            return {};
+        if(scalar.width == 1)
+            return Range{0, 1};
+        if(!scalar.isSigned)
+            return Range{0, std::int64_t((std::uint64_t(1) << scalar.width) - 1)};
+        std::int64_t max = std::int64_t((std::uint64_t(1) << (scalar.width - 1)) - 1);
+        return Range{-max - 1, max};
+    }
+
+    bool RangeAnalysis::isEmpty(const Range& range) {
+        return range.min > range.max;
+    }
+
+    RangeAnalysis::Range RangeAnalysis::join(const Range& a, const Range& b) {
+        if(isEmpty(a))
+            return b;
+        if(isEmpty(b))
+            return a;
+        return Range{std::min(a.min, b.min), std::max(a.max, b.max)};
+    }
+
+    std::optional<std::int64_t> RangeAnalysis::add(std::int64_t a, std::int64_t b) {
+        if((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+            return {};
+        return a + b;
+    }
+
+    std::optional<std::int64_t> RangeAnalysis::subtract(std::int64_t a, std::int64_t b) {
+        if((b > 0 && a < INT64_MIN + b) || (b < 0 && a > INT64_MAX + b))
+            return {};
+        return a - b;
+    }
+
+    std::optional<std::int64_t> RangeAnalysis::multiply(std::int64_t a, std::int64_t b) {
+        if(a == 0 || b == 0)
+            return 0;
+        bool isNegative = (a < 0) != (b < 0);
+        std::uint64_t x = a < 0 ? std::uint64_t(0) - std::uint64_t(a) : std::uint64_t(a);
+        std::uint64_t y = b < 0 ? std::uint64_t(0) - std::uint64_t(b) : std::uint64_t(b);
+        std::uint64_t limit = isNegative ? std::uint64_t(INT64_MAX) + 1 : std::uint64_t(INT64_MAX);
+        if(x > limit / y)
+            return {};
+        std::uint64_t product = x * y;
+        return isNegative ? std::int64_t(std::uint64_t(0) - product) : std::int64_t(product);
+    }
+
+    // Shifts are by amounts below the width, divisions by ranges without zero
+    std::optional<RangeAnalysis::Range> RangeAnalysis::compute(Op op, const Range& a, const Range& b, std::uint8_t width) {
+        // the extremes of a monotonic operation are at the corners
+        auto corners = [&](auto operation) -> std::optional<Range> {
+            std::optional<std::int64_t> values[] = {
+                operation(a.min, b.min), operation(a.min, b.max), operation(a.max, b.min), operation(a.max, b.max)
+            };
+            Range range = EMPTY;
+            for(const std::optional<std::int64_t>& value : values) {
+                if(!value)
+                    return {};
+                range = join(range, Range{value.value(), value.value()});
+            }
+            return range;
+        };
+        switch(op) {
+            case Op::Add: {
+                std::optional<std::int64_t> min = add(a.min, b.min);
+                std::optional<std::int64_t> max = add(a.max, b.max);
+                if(!min || !max)
+                    return {};
+                return Range{min.value(), max.value()};
+            }
+            case Op::Sub: {
+                std::optional<std::int64_t> min = subtract(a.min, b.max);
+                std::optional<std::int64_t> max = subtract(a.max, b.min);
+                if(!min || !max)
+                    return {};
+                return Range{min.value(), max.value()};
+            }
+            case Op::Mul:
+                return corners(&RangeAnalysis::multiply);
+            case Op::Div:
+                if((b.min <= 0 && b.max >= 0) || (a.min == INT64_MIN && b.min <= -1 && b.max >= -1))
+                    return {};
+                return corners([](std::int64_t x, std::int64_t y) -> std::optional<std::int64_t> { return x / y; });
+            case Op::Mod: {
+                if((b.min <= 0 && b.max >= 0) || b.min == INT64_MIN)
+                    return {};
+                std::int64_t max = std::max(b.min < 0 ? -b.min : b.min, b.max < 0 ? -b.max : b.max) - 1;
+                if(a.min >= 0)
+                    return Range{0, std::min(a.max, max)};
+                if(a.max <= 0)
+                    return Range{std::max(a.min, -max), 0};
+                return Range{-max, max};
+            }
+            case Op::And:
+                if(a.min >= 0 || b.min >= 0)
+                    return Range{0, a.min >= 0 && b.min >= 0 ? std::min(a.max, b.max) : a.min >= 0 ? a.max : b.max};
+                return {};
+            case Op::Or:
+            case Op::Xor:
+                if(a.min < 0 || b.min < 0)
+                    return {};
+                return Range{0, std::int64_t((std::uint64_t(1) << std::bit_width(std::uint64_t(std::max(a.max, b.max)))) - 1)};
+            case Op::Shl:
+                if(b.min < 0 || b.max >= std::min(int(width), 63))
+                    return {};
+                return corners([](std::int64_t x, std::int64_t y) { return multiply(x, std::int64_t(1) << y); });
+            case Op::Shr:
+                if(b.min < 0 || b.max >= width)
+                    return {};
+                return Range{a.min >> (a.min >= 0 ? b.max : b.min), a.max >> (a.max >= 0 ? b.min : b.max)};
+            case Op::Neg: {
+                std::optional<std::int64_t> min = subtract(0, a.max);
+                std::optional<std::int64_t> max = subtract(0, a.min);
+                if(!min || !max)
+                    return {};
+                return Range{min.value(), max.value()};
+            }
+            case Op::Not:
+                return Range{~a.max, ~a.min};
+            default:
+                return {};
+        }
+    }
+
+    /*
+     *
+     * Control flow
+     *
+     */
+
+    void RangeAnalysis::computeOrder() {
+        std::size_t numBlocks = m_function.blocks.size();
+        std::vector<std::vector<BlockId>> succs(numBlocks);
+        std::vector<bool> isVisited(numBlocks, false);
+        std::vector<std::pair<BlockId, std::size_t>> stack = {{0, 0}}; // block, next successor
+        succs[0] = IR::GetSuccessors(m_function, 0);
+        isVisited[0] = true;
+        while(!stack.empty()) {
+            auto [block, next] = stack.back();
+            if(next == succs[block].size()) {
+                m_order.push_back(block);
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second++;
+            BlockId succ = succs[block][next];
+            if(isVisited[succ])
+                continue;
+            isVisited[succ] = true;
+            succs[succ] = IR::GetSuccessors(m_function, succ);
+            stack.emplace_back(succ, 0);
+        }
+        std::reverse(m_order.begin(), m_order.end());
+        m_orderIdxs.assign(numBlocks, IR::NONE);
+        for(std::size_t i = 0; i < m_order.size(); i++)
+            m_orderIdxs[m_order[i]] = std::uint32_t(i);
+    }
+
+    // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+    void RangeAnalysis::computeDominators() {
+        m_idoms.assign(m_function.blocks.size(), IR::NONE);
+        m_idoms[0] = 0;
+        for(bool isChanged = true; isChanged;) {
+            isChanged = false;
+            for(std::size_t i = 1; i < m_order.size(); i++) {
+                BlockId block = m_order[i];
+                BlockId idom = IR::NONE;
+                for(BlockId pred : m_function.blocks[block].preds) {
+                    if(m_idoms[pred] == IR::NONE)
+                        continue;
+                    if(idom == IR::NONE) {
+                        idom = pred;
+                        continue;
+                    }
+                    BlockId other = pred;
+                    while(other != idom) {
+                        while(m_orderIdxs[other] > m_orderIdxs[idom])
+                            other = m_idoms[other];
+                        while(m_orderIdxs[idom] > m_orderIdxs[other])
+                            idom = m_idoms[idom];
+                    }
+                }
+                if(idom != m_idoms[block]) {
+                    m_idoms[block] = idom;
+                    isChanged = true;
+                }
+            }
+        }
+    }
+
+    /*
+     *
+     * Ranges
+     *
+     */
+
+    RangeAnalysis::Range RangeAnalysis::getRange(Value value, BlockId block) const {
+        Range range = m_ranges[value];
+        for(std::size_t depth = 0; block != 0 && depth < MAX_CONDITIONS && !isEmpty(range); depth++) {
+            const std::vector<BlockId>& preds = m_function.blocks[block].preds;
+            if(preds.size() == 1)
+                range = refineByEdge(value, range, preds[0], block);
+            block = m_idoms[block];
+        }
+        return range;
+    }
+
+    // Operands of comparisons are of the same scalar
+    RangeAnalysis::Range RangeAnalysis::refine(Value value, Range range, Value condition, bool isTaken) const {
+        const IR::Instruction& instruction = m_function.instructions[condition];
+        std::span<const Value> operands = IR::GetOperands(m_function, condition);
+        if(instruction.op == Op::LogicalNot && operands.size() == 1)
+            return refine(value, range, operands[0], !isTaken);
+        bool isEq = instruction.op == Op::Eq || instruction.op == Op::Ne;
+        if((!isEq && instruction.op != Op::Lt && instruction.op != Op::Le) || operands.size() != 2)
+            return range;
+        if((value != operands[0] && value != operands[1]) || !getTypeRange(m_function.instructions[operands[0]].scalar))
+            return range;
+        bool isFirst = value == operands[0];
+        const Range& other = m_ranges[operands[isFirst ? 1 : 0]];
+        if(isEmpty(other))
+            return range;
+
+        if(isEq) {
+            // a value not equal to a constant at an end of the range is not at that end
+            if(isTaken == (instruction.op == Op::Eq))
+                return Range{std::max(range.min, other.min), std::min(range.max, other.max)};
+            if(other.min == other.max && range.min == other.min && range.min != INT64_MAX)
+                range.min++;
+            else if(other.min == other.max && range.max == other.max && range.max != INT64_MIN)
+                range.max--;
+            return range;
+        }
+        // not (x < y) is x >= y, and not (x <= y) is x > y
+        bool isBelow = isFirst == isTaken;
+        bool isStrict = (instruction.op == Op::Lt) == isTaken;
+        if(isBelow) {
+            if(isStrict && other.max == INT64_MIN)
+                return EMPTY;
+            range.max = std::min(range.max, isStrict ? other.max - 1 : other.max);
+        }
+        else {
+            if(isStrict && other.min == INT64_MAX)
+                return EMPTY;
+            range.min = std::max(range.min, isStrict ? other.min + 1 : other.min);
+        }
+        return range;
+    }
+
+    RangeAnalysis::Range RangeAnalysis::refineByEdge(Value value, const Range& range, BlockId pred, BlockId block) const {
+        const std::vector<Value>& code = m_function.blocks[pred].code;
+        if(code.empty())
+            return range;
+        const IR::Instruction& terminator = m_function.instructions[code.back()];
+        if(terminator.op != Op::Branch)
+            return range;
+        BlockId success = BlockId(terminator.imm & 0xFFFFFFFF);
+        BlockId failure = BlockId(terminator.imm >> 32);
+        if(success == failure)
+            return range;
+        return refine(value, range, m_function.operands[terminator.firstOperand], block == success);
+    }
+
+    // Results that fit their type do not overflow, nor do shifts of unsigned int and wider types,
+    // which wrap like the type does
+    std::pair<RangeAnalysis::Range, bool> RangeAnalysis::evaluate(Value value) const {
+        const IR::Instruction& instruction = m_function.instructions[value];
+        std::span<const Value> operands = IR::GetOperands(m_function, value);
+        switch(instruction.op) {
+            case Op::LogicalNot:
+            case Op::Eq:
+            case Op::Ne:
+            case Op::Lt:
+            case Op::Le:
+                return {Range{0, 1}, false};
+            default:
+                break;
+        }
+        std::optional<Range> typeRange = getTypeRange(instruction.scalar);
+        if(!typeRange)
+            return {FULL, false};
+
+        switch(instruction.op) {
+            case Op::Const:
+                return {Range{std::int64_t(instruction.imm), std::int64_t(instruction.imm)}, false};
+            case Op::Copy:
+                return {getRange(operands[0], instruction.block), false};
+            case Op::Phi: {
+                const std::vector<BlockId>& preds = m_function.blocks[instruction.block].preds;
+                Range range = EMPTY;
+                for(std::size_t i = 0; i < operands.size() && i < preds.size(); i++)
+                    if(m_orderIdxs[preds[i]] != IR::NONE)
+                        range = join(range, refineByEdge(operands[i], getRange(operands[i], preds[i]), preds[i], instruction.block));
+                return {range, false};
+            }
+            default:
+                break;
+        }
+        if(instruction.op < Op::Add || instruction.op > Op::Not || operands.empty())
+            return {typeRange.value(), false};
+
+        Range a = getRange(operands[0], instruction.block);
+        Range b = operands.size() > 1 ? getRange(operands[1], instruction.block) : Range{0, 0};
+        if(isEmpty(a) || isEmpty(b))
+            return {EMPTY, false};
+        std::optional<Range> range = compute(instruction.op, a, b, instruction.scalar.width);
+        bool isShift = instruction.op == Op::Shl || instruction.op == Op::Shr;
+        bool isAmountInRange = isShift && b.min >= 0 && b.max < instruction.scalar.width;
+        if(!range || range->min < typeRange->min || range->max > typeRange->max)
+            return {typeRange.value(), isAmountInRange && !instruction.scalar.isSigned && instruction.scalar.width >= 32};
+        // the remainder of the minimum by -1 is 0, but C computes it by a division that overflows
+        if(instruction.op == Op::Mod && a.min == typeRange->min && b.min <= -1 && b.max >= -1)
+            return {range.value(), false};
+        // a shift is only safe by an amount below the width, a left one of a signed value only of one that is not negative
+        if(isShift)
+            return {range.value(), isAmountInRange && (instruction.op == Op::Shr || !instruction.scalar.isSigned || a.min >= 0)};
+        return {range.value(), true};
+    }
+
+    bool RangeAnalysis::sweep(bool isNarrowing) {
+        bool isChanged = false;
+        for(BlockId block : m_order) {
+            for(Value value : m_function.blocks[block].code) {
+                const IR::Instruction& instruction = m_function.instructions[value];
+                if(IR::IsTerminator(instruction.op) || instruction.op == Op::Store || instruction.op == Op::Nop)
+                    continue;
+                Range range = evaluate(value).first;
+                Range& current = m_ranges[value];
+                // narrowing keeps what held, growing phis reach the ends of their type
+                if(isNarrowing)
+                    range = Range{std::max(range.min, current.min), std::min(range.max, current.max)};
+                else if(instruction.op == Op::Phi && !isEmpty(current)) {
+                    range = join(current, range);
+                    if(range != current && m_growths[value]++ >= MAX_GROWTHS) {
+                        Range typeRange = getTypeRange(instruction.scalar).value_or(FULL);
+                        if(range.min < current.min)
+                            range.min = typeRange.min;
+                        if(range.max > current.max)
+                            range.max = typeRange.max;
+                    }
+                }
+                if(range != current) {
+                    current = range;
+                    isChanged = true;
+                }
+            }
+        }
+        return isChanged;
+    }
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "IR.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Value ranges of the integers of a function, to tell which operations C can compute plainly.
+    //
+    // Each integer value of at most 64 bits, other than u64, gets the interval of the values it can
+    // have, from its constants, its operations computed on the intervals of its operands, and the
+    // conditions of the branches taken to where it is read: in the body of "loop i < n", i is below
+    // the largest n. Intervals are iterated to a fixed point in reverse postorder, phis that keep
+    // growing are widened to their type, then narrowed again by a few more iterations.
+    //
+    // An addition, subtraction, multiplication or negation whose interval fits its type does not
+    // wrap, a shift by an amount below the width of its type needs no widening, and a division or
+    // remainder by a divisor that is neither zero nor -1 of the minimum can not fail, so the backend
+    // writes them without the casts and checks that make C wrap and fail like the compile time does.
+    //
+    class RangeAnalysis {
+    public:
+        // Marks the operations proven safe, true if that changed any
+        static bool Run(IR::Function& function);
+
+    private:
+        using Value = IR::Value;
+        using BlockId = IR::BlockId;
+        using Op = IR::Op;
+
+        static constexpr std::uint8_t MAX_GROWTHS = 2;  // of a phi before it is widened
+        static constexpr std::size_t MAX_SWEEPS = 64;   // nothing is marked past them
+        static constexpr std::size_t NUM_NARROWINGS = 2;
+        static constexpr std::size_t MAX_CONDITIONS = 16; // dominators whose branches refine a read
+
+        // Empty while min > max
+        struct Range {
+            std::int64_t min;
+            std::int64_t max;
+
+            bool operator==(const Range&) const = default;
+        };
+
+        static constexpr Range EMPTY = {1, 0};
+        static constexpr Range FULL = {INT64_MIN, INT64_MAX}; // of values whose range is not tracked
+
+        RangeAnalysis(IR::Function& function);
+
+        // Of the values of the scalar, none if they are not tracked
+        static std::optional<Range> getTypeRange(const IR::Scalar& scalar);
+        static bool isEmpty(const Range& range);
+        static Range join(const Range& a, const Range& b);
+        static std::optional<std::int64_t> add(std::int64_t a, std::int64_t b);
+        static std::optional<std::int64_t> subtract(std::int64_t a, std::int64_t b);
+        static std::optional<std::int64_t> multiply(std::int64_t a, std::int64_t b);
+        // Of the operation on all values of the ranges, none if it overflows 64 bits or is not modelled
+        static std::optional<Range> compute(Op op, const Range& a, const Range& b, std::uint8_t width);
+
+        void computeOrder();
+        void computeDominators();
+
+        // Where it is read in the block, refined by the branches into its dominators
+        Range getRange(Value value, BlockId block) const;
+        // By the branch of the edge, if its condition compares the value
+        Range refine(Value value, Range range, Value condition, bool isTaken) const;
+        Range refineByEdge(Value value, const Range& range, BlockId pred, BlockId block) const;
+        // The range of the value, and whether C computes its operation plainly
+        std::pair<Range, bool> evaluate(Value value) const;
+        // true if a range changed
+        bool sweep(bool isNarrowing);
+
+        IR::Function& m_function;
+        std::vector<BlockId> m_order;           // reverse postorder of the blocks the entry reaches
+        std::vector<std::uint32_t> m_orderIdxs; // by block, NONE if it is not reached
+        std::vector<BlockId> m_idoms;           // by block
+        std::vector<Range> m_ranges;            // by value
+        std::vector<std::uint8_t> m_growths;    // by value
+    };
+
+}
@@ -0,0 +1,201 @@
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace ry {
+
+    struct Event {
+        const char * name;
+        const char * file;
+        std::uint64_t start; // ns since Trace::Start
+        std::uint64_t duration;
+        std::uint32_t startLine, startColumn, endLine, endColumn; // startLine == 0 if no span
+    };
+
+    struct ThreadBuffer {
+        std::uint32_t threadId;
+        std::vector<Event> events;
+        std::size_t next = 0;
+        std::uint64_t recorded = 0;
+
+        // Interning cache, consecutive events almost always come from the same file
+        std::string_view lastFile;
+        const char * lastFileInterned = nullptr;
+    };
+
+    static std::atomic<bool> s_enabled = false;
+    static std::uint64_t s_granularityNs = 0;
+    static std::size_t s_bufferSize = 0;
+    static std::chrono::steady_clock::time_point s_startTime;
+    static std::atomic<std::uint64_t> s_generation = 0; // bumped by Start, invalidates thread buffers
+
+    static std::mutex s_mutex; // guards everything below
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+    static std::set<std::string, std::less<>> s_files;
+
+    static std::uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_startTime).count();
+    }
+
+    static ThreadBuffer& getThreadBuffer() {
+        thread_local ThreadBuffer * buffer = nullptr;
+        thread_local std::uint64_t generation = 0;
+        if(!buffer || generation != s_generation.load(std::memory_order_relaxed)) {
+            std::lock_guard lock(s_mutex);
+            auto newBuffer = std::make_unique<ThreadBuffer>();
+            newBuffer->threadId = s_buffers.size() + 1;
+            newBuffer->events.resize(s_bufferSize);
+            buffer = newBuffer.get();
+            generation = s_generation;
+            s_buffers.push_back(std::move(newBuffer));
+        }
+        return *buffer;
+    }
+
+    static const char * internFile(ThreadBuffer& buffer, std::string_view file) {
+        if(file.empty())
+            return nullptr;
+        if(buffer.lastFileInterned && buffer.lastFile == file)
+            return buffer.lastFileInterned;
+        std::lock_guard lock(s_mutex);
+        auto it = s_files.find(file);
+        if(it == s_files.end())
+            it = s_files.emplace(file).first;
+        buffer.lastFileInterned = it->c_str();
+        buffer.lastFile = *it;
+        return buffer.lastFileInterned;
+    }
+
+    /*
+     *
+     * Scope
+     *
+     */
+
+    Trace::Scope::Scope(const char * name, std::string_view file):
+        m_name(s_enabled.load(std::memory_order_relaxed) ? name : nullptr),
+        m_file(file),
+        m_start(m_name ? now() : 0)
+    {}
+
+    Trace::Scope::~Scope() {
+        if(!m_name || !s_enabled.load(std::memory_order_relaxed))
+            return;
+        std::uint64_t duration = now() - m_start;
+        if(duration < s_granularityNs)
+            return;
+
+        ThreadBuffer& buffer = getThreadBuffer();
+        Event& event = buffer.events[buffer.next];
+        event.name = m_name;
+        event.file = internFile(buffer, m_file);
+        event.start = m_start;
+        event.duration = duration;
+        event.startLine = m_span ? m_span->startLine : 0;
+        event.startColumn = m_span ? m_span->startColumn : 0;
+        event.endLine = m_span ? m_span->endLine : 0;
+        event.endColumn = m_span ? m_span->endColumn : 0;
+        buffer.next = (buffer.next + 1) % buffer.events.size();
+        buffer.recorded++;
+    }
+
+    bool Trace::Scope::IsActive() const {
+        return m_name != nullptr;
+    }
+
+    void Trace::Scope::SetSpan(const SourcePosition& span) {
+        m_span = span;
+    }
+
+    /*
+     *
+     * Trace
+     *
+     */
+
+    void Trace::Start(std::uint64_t granularityUs, std::size_t bufferSize) {
+        std::lock_guard lock(s_mutex);
+        s_buffers.clear();
+        s_generation++;
+        s_granularityNs = granularityUs * 1000;
+        s_bufferSize = std::max<std::size_t>(bufferSize, 1);
+        s_startTime = std::chrono::steady_clock::now();
+        s_enabled = true;
+    }
+
+    bool Trace::Stop(const std::string& path) {
+        s_enabled = false;
+        std::lock_guard lock(s_mutex);
+
+        auto escape = [](std::string_view str) {
+            std::string escaped;
+            for(char c : str) {
+                if(c == '"' || c == '\\')
+                    escaped += '\\';
+                if(static_cast<unsigned char>(c) < 0x20)
+                    escaped += std::format("\\u{:04x}", int(c));
+                else
+                    escaped += c;
+            }
+            return escaped;
+        };
+
+        std::FILE * file = std::fopen(path.c_str(), "wb");
+        if(!file)
+            return false;
+
+        std::string str = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for(const std::unique_ptr<ThreadBuffer>& buffer : s_buffers) {
+            std::size_t size = std::min<std::uint64_t>(buffer->recorded, buffer->events.size());
+            std::size_t dropped = buffer->recorded - size;
+            str += std::format(
+                "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"thread {} ({} events dropped)\"}}}}",
+                first ? "" : ",\n", buffer->threadId, buffer->threadId, dropped
+            );
+            first = false;
+
+            std::size_t oldest = (buffer->next + buffer->events.size() - size) % buffer->events.size();
+            for(std::size_t i = 0; i < size; i++) {
+                const Event& event = buffer->events[(oldest + i) % buffer->events.size()];
+                std::string args;
+                if(event.file)
+                    args += std::format("\"file\":\"{}\"", escape(event.file));
+                if(event.startLine != 0)
+                    args += std::format(
+                        "{}\"span\":\"{}:{}-{}:{}\"",
+                        args.empty() ? "" : ",",
+                        event.startLine, event.startColumn, event.endLine, event.endColumn
+                    );
+                str += std::format(
+                    ",\n{{\"name\":\"{}\",\"cat\":\"ry\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{{}}}}}",
+                    escape(event.name), buffer->threadId, event.start / 1000.0, event.duration / 1000.0, args
+                );
+            }
+
+            if(str.size() > (1 << 20)) {
+                std::fwrite(str.data(), 1, str.size(), file);
+                str.clear();
+            }
+        }
+        str += "\n]}\n";
+
+        bool ok = std::fwrite(str.data(), 1, str.size(), file) == str.size();
+        s_buffers.clear();
+        s_files.clear();
+        return (std::fclose(file) == 0) && ok;
+    }
+
+    bool Trace::IsEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+}
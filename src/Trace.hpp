@@ -0,0 +1,49 @@
+#pragma once
+
+#include "SourcePosition.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ry {
+
+    //
+    // Scoped trace events written as a Chrome trace (chrome://tracing, Perfetto) JSON file.
+    //
+    // Every thread records into its own fixed-size ring buffer, so recording takes no lock.
+    // When a buffer is full the oldest events are overwritten; enclosing scopes end (and are
+    // recorded) after the scopes they contain, so the outermost events survive the longest.
+    // Events shorter than the granularity are dropped when their scope ends.
+    //
+    class Trace {
+    public:
+        static constexpr std::size_t DEFAULT_BUFFER_SIZE = 1 << 16; // events per thread
+
+        class Scope {
+        public:
+            // name must be a string literal (or otherwise outlive Trace::Stop)
+            Scope(const char * name, std::string_view file = {});
+            Scope(const Scope&) = delete;
+            ~Scope();
+
+            bool IsActive() const;
+            void SetSpan(const SourcePosition& span);
+
+        private:
+            const char * m_name;
+            std::string_view m_file;
+            std::uint64_t m_start;
+            std::optional<SourcePosition> m_span;
+        };
+
+        static void Start(std::uint64_t granularityUs = 0, std::size_t bufferSize = DEFAULT_BUFFER_SIZE);
+        // Stops recording and writes every thread's events, the recording threads must be idle
+        static bool Stop(const std::string& path);
+
+        static bool IsEnabled();
+    };
+
+}
@@ -0,0 +1,4202 @@
+#include "Transpiler.hpp"
+#include "Bytecode.hpp"
+#include "IRBuilder.hpp"
+#include "Trace.hpp"
+#include "ry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <format>
+#include <span>
+#include <thread>
+#include <variant>
+
+namespace ry {
+
+    using TypeId = Transpiler::TypeId;
+    using Declaration = Transpiler::Declaration;
+    using TypeKind = TypeInterner::Kind;
+    using Attribs = TypeInterner::Attribs;
+    using Primitive = ASTNode::TypePrimitive;
+    using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+    using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+
+    // C keywords and macros of the included headers, field names that are one get a '_' appended
+    static constexpr std::string_view RESERVED_NAMES[] = {
+        "auto", "bool", "break", "case", "char", "const", "continue", "default", "do", "double",
+        "else", "enum", "extern", "false", "float", "for", "goto", "if", "inline", "int", "long",
+        "register", "restrict", "return", "short", "signed", "sizeof", "static", "struct", "switch",
+        "true", "typedef", "union", "unsigned", "void", "volatile", "while",
+        "HUGE_VAL", "HUGE_VALF", "INFINITY", "NAN", "NULL", "errno", "offsetof",
+        "fpclassify", "isfinite", "isgreater", "isgreaterequal", "isinf", "isless", "islessequal",
+        "islessgreater", "isnan", "isnormal", "isunordered", "signbit"
+    };
+
+    static constexpr std::uint32_t NO_VALUE = UINT32_MAX; // temporary of something without a value
+
+    /*
+     *
+     * Emitter
+     *
+     */
+
+    // Writes the statements of one unit, the top level or a function
+    class Transpiler::Emitter {
+    public:
+        Emitter(const Transpiler& transpiler, CodeWriter& out);
+
+        void EmitInit(const ASTNode& ast);
+        void EmitFunction(std::size_t functionIdx);
+
+        const std::vector<Infos::Info>& GetInfos() const;
+        // Integer types divided through the checked helpers of the prelude
+        const std::vector<TypeId>& GetDivisions() const;
+        // Integer types shifted through the checked helpers of the prelude
+        const std::vector<TypeId>& GetShifts() const;
+
+    private:
+        // Where the value of a block, if or loop is written by its breaks, so it is not copied
+        struct Destination {
+            enum class Kind : std::uint8_t {
+                None,      // no value, or discarded
+                Temporary,
+                Variable,  // being defined
+                Place,     // assigned to, a name or a field of one
+                Return     // of the function
+            };
+
+            Kind kind = Kind::None;
+            std::uint32_t temp = 0;
+            const Declaration * decl = nullptr;
+            const ASTNode::Expression::LValue * lvalue = nullptr;
+            std::optional<SourcePosition> srcPos;
+        };
+
+        // A block or loop that can be broken out of, breaks and continues are gotos to its labels
+        struct Target {
+            const ASTNode::ExpressionBlock::Label * label;
+            bool isLoop;
+            TypeId type;
+            Destination value;
+            std::uint32_t id;       // of its labels
+            bool isBroken = false;
+            bool isContinued = false;
+            const ASTNode::Statement * last = nullptr; // of a block, a break there falls through to its end
+        };
+
+        // Expression computed before the statement that uses it
+        struct Hoisted {
+            const ASTNode::Expression * expr;
+            std::uint32_t temp;
+        };
+
+        // A call whose callee's body is being written in place of it
+        struct Inlined {
+            const Function * function;
+            std::uint32_t unit;
+            std::uint32_t id; // of its parameters
+        };
+
+        // Operand being prepared, repeated ones are written more than once
+        struct Operand {
+            const ASTNode::Expression * expr;
+            bool isRepeated;
+        };
+
+        // A struct field, repetitions expanded, and the expression it is initialized with
+        struct FieldValue {
+            std::uint32_t field;
+            std::uint32_t rep;
+            const ASTNode::Expression * value;
+            bool isDefault;
+        };
+
+        enum class Part {
+            Begin, Middle, End
+        };
+
+        static BinOpKind getCompoundKind(ASTNode::StatementBinaryOperation::Kind kind);
+
+        void error(std::string_view msg, const std::optional<SourcePosition>& srcPos);
+
+        void line();
+        void writeType(TypeId type);
+        void writeTemporary(std::uint32_t temp);
+        void writeDestination(const Destination& dest);
+        void writeLabel(char kind, std::uint32_t id);
+        void writeDeclarationName(const Declaration& decl, const std::optional<SourcePosition>& srcPos);
+
+        std::optional<TypeId> getType(const ASTNode::Expression& expr) const;
+        std::optional<TypeId> getLValueType(const ASTNode::Expression::LValue& lvalue) const;
+        std::optional<std::size_t> getFieldIdx(TypeId type, const ASTNode::Expression& member) const;
+        // Lanes of a vector type named by the member, e.g. "wzyx"
+        std::optional<std::vector<std::uint32_t>> getLanes(TypeId type, const ASTNode::Expression& member) const;
+        const ASTNode::TypeStruct * getCallDefaults(const ASTNode::ExpressionFunctionCall& funcCall) const;
+        // The function definition called by name, nullptr if it is called as a value
+        const Function * getCallee(const ASTNode::ExpressionFunctionCall& funcCall) const;
+        // The callee of a call written in place, nullptr if it is called
+        const Function * getInlined(const ASTNode::ExpressionFunctionCall& funcCall) const;
+        // Pushes the field values of the struct type, returns where they start
+        std::size_t matchFields(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults);
+
+        bool isLValue(const ASTNode::Expression& expr) const;
+        bool isConstant(const ASTNode::Expression& expr) const;
+        // Of a condition that is a comp expression, folded or a bool constant, none if it varies
+        std::optional<bool> getConstantCondition(const ASTNode::Expression& condition) const;
+        bool isNull(const ASTNode::Expression& expr) const;
+        bool isSimple(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults = nullptr) const;
+        bool isSimpleOperand(const ASTNode::Expression& expr) const;
+        bool isSimpleIf(const ASTNode::ExpressionIf& ifExpr, TypeId type) const;
+        // An assignment or compound assignment to a scalar name that needs no statements, written as an expression
+        bool isStep(const ASTNode::Statement& stmt) const;
+        // A block, loop or if that is written as statements, its breaks write the destination
+        bool isEmittedInto(const ASTNode::Expression& expr) const;
+        // A name or a field of one, that can be written before the value assigned to it is complete
+        bool isDirectPlace(const ASTNode::Expression::LValue& lvalue) const;
+        // Every path through it writes the destination: blocks end by breaking out of themselves, ifs have an else
+        bool isExhaustive(const ASTNode::Expression& expr) const;
+        // A shuffle of a vector that is not a name, which __builtin_shufflevector takes twice
+        bool isShuffled(const ASTNode::ExpressionBinaryOperation& binOp) const;
+        // A value of a transposed field that is written once per array
+        bool isRepeatedValue(const ASTNode::Expression& expr) const;
+        bool areSimpleDefaults(const ASTNode::TypeStruct * defaults) const;
+        // A name or a field of one, whose fields are read again for each parameter
+        bool isNamePath(const ASTNode::Expression& expr) const;
+        // An argument whose address can be passed for its value, nothing can change it during the call
+        bool isAddressable(const ASTNode::Expression& expr) const;
+        // The function being written or one inlined in it
+        bool isOwnUnit(std::uint32_t unit) const;
+
+        const Hoisted * findHoisted(const ASTNode::Expression& expr) const;
+        void prepare(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults = nullptr);
+        // Struct fields and arguments in source order, then the defaults
+        void pushFieldOperands(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults, const Function * callee = nullptr);
+        void prepareArguments(const ASTNode::ExpressionFunctionCall& funcCall);
+        void prepareOperands(std::size_t mark);
+        void prepareLValue(const ASTNode::Expression::LValue& lvalue);
+        void hoist(const ASTNode::Expression& expr);
+
+        void writeInt(Bytecode::Slot value, const Scalar& scalar);
+        void writeFloat(double value, const Scalar& scalar);
+        void writeChar(char c);
+        void writeString(std::string_view str);
+        void writeScalar(Bytecode::Slot value, TypeId type);
+        void writeValue(TypeId type, std::span<const Bytecode::Slot> slots, std::size_t& slotIdx);
+        // isSafe: the operation is proven not to overflow
+        void writeUnaryPart(UnOpKind kind, TypeId type, Part part, bool isSafe = false);
+        // An optional from its value, its value, and whether it has one
+        void writeWrapPart(TypeId type, Part part);
+        void writeUnwrapPart(TypeId type, Part part);
+        void writeSetPart(TypeId type, Part part);
+        void writeBinaryPart(BinOpKind kind, TypeId type, Part part, bool isSafe = false);
+        // .field[rep] = , or the array of a field of a transposed element
+        void writeDesignator(TypeId type, std::size_t fieldIdx, std::uint64_t rep, std::optional<std::size_t> elementFieldIdx = {}, std::uint64_t elementRep = 0);
+        void writeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults);
+        void writeVectorLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type);
+        void writeTransposed(TypeId type, const FieldValue& fieldValue, bool& isFirst);
+        // A result written through a pointer goes to the destination
+        void writeCall(const ASTNode::ExpressionFunctionCall& funcCall, const Destination * dest = nullptr);
+        // isValue writes optional results of operations and literals without wrapping them
+        void writeExpression(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults = nullptr, bool isValue = false);
+        void writeConverted(const ASTNode::Expression& expr, TypeId type, const ASTNode::TypeStruct * defaults = nullptr);
+        void writeLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos);
+        void writeStep(const ASTNode::Statement& stmt);
+        // Of a local, a counter narrower than int as an int
+        void writeDefinedType(const Declaration& decl, TypeId type);
+
+        void emitAssignment(const Destination& dest, const ASTNode::Expression& value, TypeId type);
+        void emitValue(const ASTNode::Expression& expr, const Destination& dest, TypeId type);
+        void emitDiscarded(const ASTNode::Expression& expr);
+        void emitBlock(const ASTNode::ExpressionBlock& block, const Destination& dest, TypeId type);
+        void emitIf(const ASTNode::ExpressionIf& ifExpr, const Destination& dest, TypeId type, bool isElseIf);
+        void emitLoop(const ASTNode::ExpressionLoop& loop, const Destination& dest, TypeId type);
+        void emitInlined(const ASTNode::ExpressionFunctionCall& funcCall, const Destination& dest, TypeId type);
+        void emitStatementValue(const ASTNode::Statement& stmt, const Destination& dest, TypeId type);
+        void emitStatement(const ASTNode::Statement& stmt);
+
+        const Transpiler& m_transpiler;
+        CodeWriter& m_out;
+        std::vector<Infos::Info> m_infos;
+        std::vector<TypeId> m_divisions;
+        std::vector<TypeId> m_shifts;
+
+        std::uint32_t m_unit = 0;
+        const Function * m_function = nullptr;
+        const ASTNode::TypeStruct * m_parameters = nullptr;
+        std::size_t m_indent = 0;
+        std::uint32_t m_nextTemp = 0;
+        std::uint32_t m_nextLabel = 0;
+        std::uint32_t m_nextInlined = 0;
+
+        std::vector<Target> m_targets;
+        std::vector<Inlined> m_inlined;                      // innermost last
+        std::vector<Hoisted> m_hoisted;                      // of the statements being written
+        std::vector<Operand> m_operands;                     // being prepared, nested ones push on top
+        std::vector<FieldValue> m_fieldValues;               // of struct literals being written, nested ones push on top
+    };
+
+    Transpiler::Emitter::Emitter(const Transpiler& transpiler, CodeWriter& out):
+        m_transpiler(transpiler),
+        m_out(out)
+    {}
+
+    void Transpiler::Emitter::EmitInit(const ASTNode& ast) {
+        m_unit = 0;
+        m_function = nullptr;
+        m_parameters = nullptr;
+        m_nextTemp = 0;
+        m_nextLabel = 0;
+        m_nextInlined = 0;
+
+        m_out.Write("static void ry_init(void) {\n");
+        m_indent = 1;
+        // the statements of the top-level block are those of ry_init
+        if(const ASTNode::ExpressionBlock * block = getTopLevelBlock(ast)) {
+            std::uint32_t id = m_nextLabel++;
+            m_targets.push_back(Target{&block->GetLabel(), false, 0, {}, id});
+            for(const ASTNode::Statement& stmt : block->GetStatements())
+                emitStatement(stmt);
+            if(m_targets.back().isBroken) {
+                line();
+                writeLabel('l', id);
+                m_out.Write(":;\n");
+            }
+            m_targets.pop_back();
+        }
+        else if(auto stmt = std::get_if<ASTNode::Statement>(&ast.Get()))
+            emitStatement(*stmt);
+        else if(auto expr = std::get_if<ASTNode::Expression>(&ast.Get())) {
+            emitDiscarded(*expr);
+            m_hoisted.clear();
+        }
+        m_indent = 0;
+        m_out.Write("}\n\n");
+    }
+
+    void Transpiler::Emitter::EmitFunction(std::size_t functionIdx) {
+        const Function& function = m_transpiler.m_functions[functionIdx];
+        if(function.isRemoved)
+            return;
+        m_unit = std::uint32_t(functionIdx + 1);
+        m_function = &function;
+        m_parameters = &function.type->GetArgumentsType();
+        m_nextTemp = 0;
+        m_nextLabel = 0;
+        m_nextInlined = 0;
+
+        auto type = m_transpiler.m_typer.GetType(*function.decl);
+        if(!type)
+            return;
+        if(!m_transpiler.isSupported(type.value())) {
+            error(std::format("Type {} is not supported in C, its repetitions are not constant", m_transpiler.m_types.StringifyPretty(type.value())), function.decl->srcPos);
+            return;
+        }
+        TypeId returnType = m_transpiler.m_types.Get(m_transpiler.getValueType(type.value())).pointee;
+
+        m_transpiler.writeSignature(m_out, function);
+        m_out.Write(" {\n");
+        m_indent = 1;
+        // structs passed as their fields are put back together
+        std::span<const TypeInterner::Field> arguments = m_transpiler.m_types.GetFields(m_transpiler.m_types.Get(m_transpiler.getValueType(type.value())).arguments);
+        for(std::size_t i = 0; i < function.passings.size(); i++) {
+            if(function.passings[i] != Passing::Fields)
+                continue;
+            TypeId argumentType = m_transpiler.getCType(arguments[i].type);
+            const std::vector<std::uint32_t>& order = m_transpiler.m_fieldOrders[argumentType];
+            line();
+            writeType(argumentType);
+            m_out.Write(' ');
+            m_out.Write(arguments[i].name);
+            m_out.Write("_a = { ");
+            for(std::size_t k = 0; k < order.size(); k++) {
+                if(k > 0)
+                    m_out.Write(", ");
+                m_out.Write('.');
+                m_transpiler.writeFieldName(m_out, argumentType, order[k]);
+                m_out.Write(" = ");
+                m_out.Write(arguments[i].name);
+                m_out.Write("_a_f");
+                m_out.WriteUInt(k);
+            }
+            m_out.Write(" };\n");
+        }
+
+        const ASTNode::Expression& body = *function.body;
+        if(m_transpiler.isVoid(returnType))
+            emitDiscarded(body);
+        // a body that ends in a break returns from each of its breaks
+        else if(isEmittedInto(body) && isExhaustive(body))
+            emitValue(body, Destination{Destination::Kind::Return, 0, nullptr, nullptr, {}}, returnType);
+        else if(function.isReturnedThrough) {
+            prepare(body);
+            line();
+            m_out.Write("*_r = ");
+            writeConverted(body, returnType);
+            m_out.Write(";\n");
+        }
+        else {
+            prepare(body);
+            line();
+            m_out.Write("return ");
+            writeConverted(body, returnType);
+            m_out.Write(";\n");
+        }
+        m_hoisted.clear();
+        m_indent = 0;
+        m_out.Write("}\n\n");
+    }
+
+    const std::vector<Infos::Info>& Transpiler::Emitter::GetInfos() const {
+        return m_infos;
+    }
+
+    const std::vector<Transpiler::TypeId>& Transpiler::Emitter::GetDivisions() const {
+        return m_divisions;
+    }
+
+    const std::vector<Transpiler::TypeId>& Transpiler::Emitter::GetShifts() const {
+        return m_shifts;
+    }
+
+    BinOpKind Transpiler::Emitter::getCompoundKind(ASTNode::StatementBinaryOperation::Kind kind) {
+        using StmtBinOpKind = ASTNode::StatementBinaryOperation::Kind;
+        switch(kind) {
+            case StmtBinOpKind::AddEq:       return BinOpKind::Add;
+            case StmtBinOpKind::SubEq:       return BinOpKind::Sub;
+            case StmtBinOpKind::MulEq:       return BinOpKind::Mul;
+            case StmtBinOpKind::DivEq:       return BinOpKind::Div;
+            case StmtBinOpKind::ModEq:       return BinOpKind::Mod;
+            case StmtBinOpKind::BitOrEq:     return BinOpKind::BitOr;
+            case StmtBinOpKind::BitXorEq:    return BinOpKind::BitXor;
+            case StmtBinOpKind::BitAndEq:    return BinOpKind::BitAnd;
+            case StmtBinOpKind::BitLShiftEq: return BinOpKind::BitLShift;
+            case StmtBinOpKind::BitRShiftEq: return BinOpKind::BitRShift;
+        }
+        return BinOpKind::Add;
+    }
+
+    void Transpiler::Emitter::error(std::string_view msg, const std::optional<SourcePosition>& srcPos) {
+        if(srcPos)
+            m_infos.push_back(Infos::Info(Infos::Info::Level::ERROR, msg, srcPos.value()));
+        else
+            m_infos.push_back(Infos::Info(Infos::Info::Level::ERROR, msg));
+    }
+
+    // The counter is a phi of the header stepped by a constant on each way back to it
+    void Transpiler::collectCountedLoops(std::size_t functionIdx) {
+        const IR::Function& function = m_irs[functionIdx];
+        Simplified& simplified = m_simplified[functionIdx];
+        auto getValue = [&](const ASTNode::Expression& expr) {
+            auto it = function.values.find(&expr);
+            return it == function.values.end() ? IR::NONE : IR::Resolve(function, it->second);
+        };
+
+        for(const auto& [loop, header] : function.loops) {
+            if(!loop->GetCondition() || IR::IsRemoved(function, header))
+                continue;
+            auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&loop->GetCondition().value()->Get());
+            if(!binOp)
+                continue;
+            switch(binOp->GetKind()) {
+                case BinOpKind::Less:
+                case BinOpKind::LessEqual:
+                case BinOpKind::Great:
+                case BinOpKind::GreatEqual:
+                case BinOpKind::Uneq:
+                    break;
+                default:
+                    continue;
+            }
+            const std::vector<IR::BlockId>& preds = function.blocks[header].preds;
+            for(bool isFirst : {true, false}) {
+                const ASTNode::Expression& counter = isFirst ? *binOp->GetOperands().first : *binOp->GetOperands().second;
+                const ASTNode::Expression& bound = isFirst ? *binOp->GetOperands().second : *binOp->GetOperands().first;
+                auto name = std::get_if<ASTNode::ExpressionName>(&counter.Get());
+                const Declaration * decl = name ? m_analyzer.GetDeclaration(*name) : nullptr;
+                IR::Value phi = getValue(counter);
+                IR::Value boundValue = getValue(bound);
+                if(!decl || phi == IR::NONE || boundValue == IR::NONE || !isInvariant(function, boundValue, header))
+                    continue;
+                if(function.instructions[phi].op != IR::Op::Phi || function.instructions[phi].block != header)
+                    continue;
+
+                // the other predecessors of the header are the ends of the iterations
+                std::span<const IR::Value> operands = IR::GetOperands(function, phi);
+                bool isStepped = true;
+                bool isLooped = false;
+                for(std::size_t i = 0; i < preds.size() && i < operands.size(); i++) {
+                    if(preds[i] < header)
+                        continue;
+                    IR::Value next = IR::Resolve(function, operands[i]);
+                    const IR::Instruction& step = function.instructions[next];
+                    std::span<const IR::Value> stepOperands = IR::GetOperands(function, next);
+                    isStepped = isStepped && (step.op == IR::Op::Add || step.op == IR::Op::Sub) && stepOperands.size() == 2
+                        && IR::Resolve(function, stepOperands[0]) == phi && function.instructions[IR::Resolve(function, stepOperands[1])].op == IR::Op::Const;
+                    isLooped = true;
+                }
+                if(!isStepped || !isLooped)
+                    continue;
+                simplified.loops.emplace_back(loop, CountedLoop{&bound, decl->id});
+                break;
+            }
+        }
+    }
+
+    // Values of blocks created before the header are computed before the loop is entered
+    bool Transpiler::isInvariant(const IR::Function& function, IR::Value value, IR::BlockId header) {
+        value = IR::Resolve(function, value);
+        const IR::Instruction& instruction = function.instructions[value];
+        if(instruction.op == IR::Op::Const || instruction.block < header)
+            return true;
+        if(instruction.op < IR::Op::Add || instruction.op > IR::Op::Le)
+            return false;
+        for(IR::Value operand : IR::GetOperands(function, value))
+            if(!isInvariant(function, operand, header))
+                return false;
+        return true;
+    }
+
+    /*
+     *
+     * Output
+     *
+     */
+
+    void Transpiler::Emitter::line() {
+        static constexpr std::string_view INDENT = "                                ";
+        for(std::size_t indent = m_indent * 4; indent > 0;) {
+            std::size_t size = std::min(indent, INDENT.size());
+            m_out.Write(INDENT.substr(0, size));
+            indent -= size;
+        }
+    }
+
+    void Transpiler::Emitter::writeType(TypeId type) {
+        m_out.Write(m_transpiler.getTypeName(type));
+    }
+
+    void Transpiler::Emitter::writeTemporary(std::uint32_t temp) {
+        m_out.Write("_t");
+        m_out.WriteUInt(temp);
+    }
+
+    void Transpiler::Emitter::writeDestination(const Destination& dest) {
+        switch(dest.kind) {
+            case Destination::Kind::Temporary:
+                writeTemporary(dest.temp);
+                return;
+            case Destination::Kind::Variable:
+                writeDeclarationName(*dest.decl, dest.srcPos);
+                return;
+            case Destination::Kind::Place:
+                writeLValue(*dest.lvalue, dest.srcPos);
+                return;
+            case Destination::Kind::None:
+            case Destination::Kind::Return:
+                return;
+        }
+    }
+
+    void Transpiler::Emitter::writeLabel(char kind, std::uint32_t id) {
+        m_out.Write('_');
+        m_out.Write(kind);
+        m_out.WriteUInt(id);
+    }
+
+    // Variables are suffixed by their declaration id, parameters by _a, so no name is reserved in C
+    void Transpiler::Emitter::writeDeclarationName(const Declaration& decl, const std::optional<SourcePosition>& srcPos) {
+        if(decl.kind == Declaration::Kind::Parameter) {
+            auto isParameterOf = [&](const ASTNode::TypeStruct& parameters) {
+                return std::any_of(parameters.GetFields().begin(), parameters.GetFields().end(), [&](const ASTNode::TypeStruct::Field& field) {
+                    auto namedField = std::get_if<ASTNode::TypeStruct::NamedField>(&field);
+                    return namedField == decl.parameter;
+                });
+            };
+            // parameters of inlined functions are suffixed by the call, which may be in the scope of another one
+            for(auto it = m_inlined.rbegin(); it != m_inlined.rend(); it++) {
+                if(isParameterOf(it->function->type->GetArgumentsType())) {
+                    m_out.Write(decl.name);
+                    m_out.Write("_i");
+                    m_out.WriteUInt(it->id);
+                    return;
+                }
+            }
+            bool isOwn = m_parameters && isParameterOf(*m_parameters);
+            if(!isOwn)
+                error(std::format("\"{}\" is a parameter of an enclosing function, closures are not supported in C", decl.name), srcPos);
+            // structs passed by a pointer are read through it
+            bool isPointer = false;
+            if(m_function && isOwn) {
+                auto type = m_transpiler.m_typer.GetType(*m_function->decl);
+                std::span<const TypeInterner::Field> arguments = m_transpiler.m_types.GetFields(m_transpiler.m_types.Get(m_transpiler.getValueType(type.value())).arguments);
+                for(std::size_t i = 0; i < m_function->passings.size(); i++)
+                    if(m_function->passings[i] == Passing::Pointer && arguments[i].name == decl.name)
+                        isPointer = true;
+            }
+            if(isPointer)
+                m_out.Write("(*");
+            m_out.Write(decl.name);
+            m_out.Write("_a");
+            if(isPointer)
+                m_out.Write(')');
+            return;
+        }
+        std::uint32_t owner = m_transpiler.m_owners[decl.id];
+        if(owner != GLOBAL && owner != FUNCTION && !isOwnUnit(owner))
+            error(std::format("\"{}\" is a local of an enclosing function, closures are not supported in C", decl.name), srcPos);
+        m_out.Write(decl.name);
+        m_out.Write('_');
+        m_out.WriteUInt(decl.id);
+    }
+
+    /*
+     *
+     * Types
+     *
+     */
+
+    // Expressions without a type failed to type, that is reported by the typer
+    std::optional<TypeId> Transpiler::Emitter::getType(const ASTNode::Expression& expr) const {
+        return m_transpiler.m_typer.GetType(expr);
+    }
+
+    std::optional<TypeId> Transpiler::Emitter::getLValueType(const ASTNode::Expression::LValue& lvalue) const {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) -> std::optional<TypeId> {
+                const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(name);
+                if(!decl)
+                    return {};
+                return m_transpiler.m_typer.GetType(*decl);
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) -> std::optional<TypeId> {
+                return getType(*operand).transform([&](TypeId type) {
+                    return m_transpiler.m_types.Get(m_transpiler.getValueType(type)).pointee;
+                });
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) -> std::optional<TypeId> {
+                auto type = getType(*operands.first);
+                if(!type)
+                    return {};
+                TypeId object = m_transpiler.getValueType(type.value());
+                if(getLanes(object, *operands.second))
+                    return m_transpiler.m_elementTypes[object];
+                return getFieldIdx(object, *operands.second).transform([&](std::size_t fieldIdx) {
+                    return m_transpiler.m_types.GetFields(object)[fieldIdx].type;
+                });
+            }
+        }, lvalue);
+    }
+
+    // Member access takes the first field with the name
+    std::optional<std::size_t> Transpiler::Emitter::getFieldIdx(TypeId type, const ASTNode::Expression& member) const {
+        auto name = std::get_if<ASTNode::ExpressionName>(&member.Get());
+        if(!name || m_transpiler.m_types.Get(type).kind != TypeKind::Struct)
+            return {};
+        std::span<const TypeInterner::Field> fields = m_transpiler.m_types.GetFields(type);
+        for(std::size_t i = 0; i < fields.size(); i++)
+            if(fields[i].name == *name)
+                return i;
+        return {};
+    }
+
+    std::optional<std::vector<std::uint32_t>> Transpiler::Emitter::getLanes(TypeId type, const ASTNode::Expression& member) const {
+        auto name = std::get_if<ASTNode::ExpressionName>(&member.Get());
+        auto shape = m_transpiler.getVectorShape(type);
+        if(!name || !shape)
+            return {};
+        return ASTNode::GetLanes(*name, shape->numLanes);
+    }
+
+    // Functions called by name take the defaults of their definition
+    const ASTNode::TypeStruct * Transpiler::Emitter::getCallDefaults(const ASTNode::ExpressionFunctionCall& funcCall) const {
+        auto name = std::get_if<ASTNode::ExpressionName>(&funcCall.GetFunction()->Get());
+        if(!name)
+            return nullptr;
+        const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(*name);
+        const ASTNode::StatementTypedVariableDefinition * definition = decl ? getFunctionDefinition(*decl) : nullptr;
+        if(!definition)
+            return nullptr;
+        return &std::get<ASTNode::TypeFunction>(definition->GetType().Get()).GetArgumentsType();
+    }
+
+    const Transpiler::Function * Transpiler::Emitter::getCallee(const ASTNode::ExpressionFunctionCall& funcCall) const {
+        auto name = std::get_if<ASTNode::ExpressionName>(&funcCall.GetFunction()->Get());
+        const Declaration * decl = name ? m_transpiler.m_analyzer.GetDeclaration(*name) : nullptr;
+        return decl ? m_transpiler.getFunction(*decl) : nullptr;
+    }
+
+    const Transpiler::Function * Transpiler::Emitter::getInlined(const ASTNode::ExpressionFunctionCall& funcCall) const {
+        return m_transpiler.m_inliner.IsInlined(funcCall) ? getCallee(funcCall) : nullptr;
+    }
+
+    // Fields are matched by name or position like the typer does, the missing ones take their default if there is one
+    std::size_t Transpiler::Emitter::matchFields(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults) {
+        std::size_t mark = m_fieldValues.size();
+        std::span<const TypeInterner::Field> typeFields = m_transpiler.m_types.GetFields(type);
+        for(std::size_t i = 0; i < typeFields.size(); i++)
+            for(std::uint64_t rep = 0; rep < typeFields[i].reps; rep++)
+                m_fieldValues.push_back(FieldValue{std::uint32_t(i), std::uint32_t(rep), nullptr, false});
+        std::size_t numFields = m_fieldValues.size() - mark;
+
+        // the AST fields are those of the interned type, whose repetitions are expanded
+        if(defaults) {
+            std::size_t typeFieldIdx = 0;
+            std::size_t fieldIdx = 0;
+            auto setDefault = [&](const ASTNode::TypeStruct::FieldDefaultValue& defaultValue) {
+                if(typeFieldIdx >= typeFields.size())
+                    return;
+                for(std::uint64_t rep = 0; rep < typeFields[typeFieldIdx].reps && fieldIdx < numFields; rep++) {
+                    FieldValue& fieldValue = m_fieldValues[mark + fieldIdx++];
+                    fieldValue.value = defaultValue ? defaultValue.value().get() : nullptr;
+                    fieldValue.isDefault = true;
+                }
+                typeFieldIdx++;
+            };
+            for(const ASTNode::TypeStruct::Field& field : defaults->GetFields()) {
+                std::visit(overloaded{
+                    [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                        for(std::size_t i = 0; i < namedField.GetNames().size(); i++)
+                            setDefault(namedField.GetDefaultValue());
+                    },
+                    [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                        setDefault(unnamedField.GetDefaultValue());
+                    }
+                }, field);
+            }
+        }
+
+        std::size_t fieldIdx = 0;
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields()) {
+            if(field.GetName()) {
+                fieldIdx = numFields;
+                for(std::size_t i = 0; i < numFields; i++) {
+                    if(typeFields[m_fieldValues[mark + i].field].name == field.GetName().value()) {
+                        fieldIdx = i;
+                        break;
+                    }
+                }
+            }
+            if(fieldIdx >= numFields)
+                break; // reported by the typer
+            FieldValue& fieldValue = m_fieldValues[mark + fieldIdx++];
+            fieldValue.value = field.GetValue().get();
+            fieldValue.isDefault = false;
+        }
+        return mark;
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    bool Transpiler::Emitter::isLValue(const ASTNode::Expression& expr) const {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(name);
+                return decl && m_transpiler.m_owners[decl->id] != FUNCTION;
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                return unaryOp.GetKind() == UnOpKind::PointerDereference;
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                return binOp.GetKind() == BinOpKind::StructMemberAccess && isLValue(*binOp.GetOperands().first);
+            },
+            [&](const auto&) {
+                return false;
+            }
+        }, expr.Get());
+    }
+
+    // Values that other operands can not change
+    bool Transpiler::Emitter::isConstant(const ASTNode::Expression& expr) const {
+        if(expr.GetConstant() || m_transpiler.m_compValues.contains(&expr))
+            return true;
+        auto literal = std::get_if<ASTNode::ExpressionLiteral>(&expr.Get());
+        return literal && (!literal->Get() || !std::holds_alternative<ASTNode::ExpressionLiteral::Struct>(literal->Get().value()));
+    }
+
+    std::optional<bool> Transpiler::Emitter::getConstantCondition(const ASTNode::Expression& condition) const {
+        if(auto it = m_transpiler.m_compValues.find(&condition); it != m_transpiler.m_compValues.end())
+            return it->second->slots.size() == 1 ? std::optional<bool>(it->second->slots[0] != 0) : std::nullopt;
+        if(const auto& constant = condition.GetConstant())
+            if(auto value = std::get_if<ASTNode::Constant::Bool>(&constant->Get()))
+                return bool(*value);
+        return {};
+    }
+
+    bool Transpiler::Emitter::isNull(const ASTNode::Expression& expr) const {
+        auto literal = std::get_if<ASTNode::ExpressionLiteral>(&expr.Get());
+        return literal && !literal->Get();
+    }
+
+    // C can write it as an expression
+    bool Transpiler::Emitter::isSimple(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults) const {
+        if(m_transpiler.m_compValues.contains(&expr))
+            return true;
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get())
+                    return true;
+                auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value());
+                if(!structLit)
+                    return true;
+                // any value may be one of a transposed field
+                auto type = getType(expr);
+                bool isSoA = type && m_transpiler.m_isSoA[m_transpiler.getValueType(type.value())];
+                for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit->GetFields())
+                    if(!isSimpleOperand(*field.GetValue()) || (isSoA && isRepeatedValue(*field.GetValue())))
+                        return false;
+                return areSimpleDefaults(defaults) && (!isSoA || !defaults);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                if(!isSimple(*funcCall.GetFunction()) || getInlined(funcCall))
+                    return false;
+                // the arguments may need temporaries, the result does
+                if(const Function * callee = getCallee(funcCall)) {
+                    if(callee->isReturnedThrough)
+                        return false;
+                    for(Passing passing : callee->passings)
+                        if(passing != Passing::Value)
+                            return false;
+                }
+                for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields())
+                    if(!isSimpleOperand(*field.GetValue()))
+                        return false;
+                return areSimpleDefaults(getCallDefaults(funcCall));
+            },
+            [&](const ASTNode::ExpressionBlock&) {
+                return false;
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                auto type = getType(expr);
+                return type && isSimpleIf(ifExpr, type.value());
+            },
+            [&](const ASTNode::ExpressionLoop&) {
+                return false;
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                const ASTNode::Expression& operand = *unaryOp.GetOperand();
+                if(unaryOp.GetKind() == UnOpKind::AddressOf && !isLValue(operand))
+                    return false;
+                return isSimple(operand);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                if(binOp.GetKind() == BinOpKind::StructMemberAccess)
+                    return isSimple(*binOp.GetOperands().first) && !isShuffled(binOp);
+                return isSimple(*binOp.GetOperands().first) && isSimple(*binOp.GetOperands().second);
+            },
+            [&](const ASTNode::ExpressionName&) {
+                return true;
+            }
+        }, expr.Get());
+    }
+
+    // Fields and arguments without a value have no C counterpart, they are evaluated on their own
+    bool Transpiler::Emitter::isSimpleOperand(const ASTNode::Expression& expr) const {
+        if(!isSimple(expr))
+            return false;
+        auto type = getType(expr);
+        return !type || !m_transpiler.isVoid(type.value()) || std::holds_alternative<ASTNode::ExpressionLiteral>(expr.Get());
+    }
+
+    // An if with a value whose branches are expressions is a conditional expression
+    bool Transpiler::Emitter::isSimpleIf(const ASTNode::ExpressionIf& ifExpr, TypeId type) const {
+        if(m_transpiler.isVoid(type) || !ifExpr.GetFailStatement() || !isSimple(*ifExpr.GetCondition()))
+            return false;
+        auto success = std::get_if<ASTNode::StatementExpression>(&ifExpr.GetSuccessStatement()->Get());
+        auto fail = std::get_if<ASTNode::StatementExpression>(&ifExpr.GetFailStatement().value()->Get());
+        return success && fail && isSimple(*success) && isSimple(*fail);
+    }
+
+    bool Transpiler::Emitter::isStep(const ASTNode::Statement& stmt) const {
+        auto isScalarName = [&](const ASTNode::Expression::LValue& lvalue) {
+            auto type = getLValueType(lvalue);
+            return std::holds_alternative<ASTNode::ExpressionName>(lvalue) && type && !m_transpiler.isWrapped(type.value())
+                && m_transpiler.getScalar(type.value());
+        };
+        return std::visit(overloaded{
+            [&](const ASTNode::StatementAssignment& assign) {
+                return isScalarName(assign.GetLValue()) && isSimple(assign.GetRValue());
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                return isScalarName(binOp.GetOperands().first) && isSimple(binOp.GetOperands().second);
+            },
+            [&](const auto&) { return false; }
+        }, stmt.Get());
+    }
+
+    bool Transpiler::Emitter::isEmittedInto(const ASTNode::Expression& expr) const {
+        if(m_transpiler.m_compValues.contains(&expr))
+            return false;
+        auto type = getType(expr);
+        if(!type || m_transpiler.isVoid(type.value()))
+            return false;
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionBlock&) { return true; },
+            [&](const ASTNode::ExpressionLoop&) { return true; },
+            [&](const ASTNode::ExpressionIf& ifExpr) { return !isSimpleIf(ifExpr, type.value()); },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                const Function * callee = getCallee(funcCall);
+                return getInlined(funcCall) || (callee && callee->isReturnedThrough);
+            },
+            [&](const auto&) { return false; }
+        }, expr.Get());
+    }
+
+    bool Transpiler::Emitter::isDirectPlace(const ASTNode::Expression::LValue& lvalue) const {
+        auto operands = std::get_if<ASTNode::Expression::StructMemberAccess>(&lvalue);
+        if(!operands)
+            return std::holds_alternative<ASTNode::ExpressionName>(lvalue);
+        // lanes are written through their vector, fields of optionals through their value
+        const ASTNode::Expression * object = operands->first.get();
+        const ASTNode::Expression * member = operands->second.get();
+        for(;;) {
+            auto objectType = getType(*object);
+            if(!objectType || m_transpiler.isWrapped(objectType.value()) || getLanes(m_transpiler.getValueType(objectType.value()), *member))
+                return false;
+            if(std::holds_alternative<ASTNode::ExpressionName>(object->Get()))
+                return isLValue(*object);
+            auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&object->Get());
+            if(!binOp || binOp->GetKind() != BinOpKind::StructMemberAccess)
+                return false;
+            object = binOp->GetOperands().first.get();
+            member = binOp->GetOperands().second.get();
+        }
+    }
+
+    bool Transpiler::Emitter::isExhaustive(const ASTNode::Expression& expr) const {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionBlock& block) {
+                if(block.GetStatements().empty())
+                    return false;
+                auto stmtBreak = std::get_if<ASTNode::StatementBreak>(&block.GetStatements().back().Get());
+                return stmtBreak && stmtBreak->GetValue() && (!stmtBreak->GetLabel() || stmtBreak->GetLabel() == block.GetLabel());
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                if(!ifExpr.GetFailStatement())
+                    return false;
+                auto success = std::get_if<ASTNode::StatementExpression>(&ifExpr.GetSuccessStatement()->Get());
+                auto fail = std::get_if<ASTNode::StatementExpression>(&ifExpr.GetFailStatement().value()->Get());
+                return success && fail && isExhaustive(*success) && isExhaustive(*fail);
+            },
+            [&](const ASTNode::ExpressionLoop&) { return false; },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                const Function * callee = getInlined(funcCall);
+                return !callee || !isEmittedInto(*callee->body) || isExhaustive(*callee->body);
+            },
+            [&](const auto&) { return true; }
+        }, expr.Get());
+    }
+
+    bool Transpiler::Emitter::isShuffled(const ASTNode::ExpressionBinaryOperation& binOp) const {
+        const ASTNode::Expression& object = *binOp.GetOperands().first;
+        auto type = getType(object);
+        if(!type || std::holds_alternative<ASTNode::ExpressionName>(object.Get()) || m_transpiler.m_compValues.contains(&object))
+            return false;
+        auto lanes = getLanes(m_transpiler.getValueType(type.value()), *binOp.GetOperands().second);
+        return lanes && lanes->size() > 1;
+    }
+
+    // Struct literals are written field by field, other values that can not change are read again
+    bool Transpiler::Emitter::isRepeatedValue(const ASTNode::Expression& expr) const {
+        if(m_transpiler.m_compValues.contains(&expr) || std::holds_alternative<ASTNode::ExpressionName>(expr.Get()))
+            return false;
+        auto literal = std::get_if<ASTNode::ExpressionLiteral>(&expr.Get());
+        return !literal;
+    }
+
+    bool Transpiler::Emitter::areSimpleDefaults(const ASTNode::TypeStruct * defaults) const {
+        if(!defaults)
+            return true;
+        for(const ASTNode::TypeStruct::Field& field : defaults->GetFields()) {
+            const ASTNode::TypeStruct::FieldDefaultValue& defaultValue = std::visit([](const auto& field) -> const auto& {
+                return field.GetDefaultValue();
+            }, field);
+            if(defaultValue && !isSimpleOperand(*defaultValue.value()))
+                return false;
+        }
+        return true;
+    }
+
+    bool Transpiler::Emitter::isNamePath(const ASTNode::Expression& expr) const {
+        if(m_transpiler.m_compValues.contains(&expr))
+            return true;
+        const ASTNode::Expression * object = &expr;
+        while(auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&object->Get())) {
+            if(binOp->GetKind() != BinOpKind::StructMemberAccess || m_transpiler.m_compValues.contains(object))
+                return false;
+            object = binOp->GetOperands().first.get();
+        }
+        return std::holds_alternative<ASTNode::ExpressionName>(object->Get()) && !m_transpiler.m_compValues.contains(object);
+    }
+
+    // Literals, and locals or parameters whose address is never taken, the callee can not reach them otherwise
+    bool Transpiler::Emitter::isAddressable(const ASTNode::Expression& expr) const {
+        if(m_transpiler.m_compValues.contains(&expr))
+            return true;
+        if(auto literal = std::get_if<ASTNode::ExpressionLiteral>(&expr.Get()))
+            return literal->Get() && std::holds_alternative<ASTNode::ExpressionLiteral::Struct>(literal->Get().value());
+        if(!isNamePath(expr))
+            return false;
+        const ASTNode::Expression * object = &expr;
+        while(auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&object->Get()))
+            object = binOp->GetOperands().first.get();
+        const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(std::get<ASTNode::ExpressionName>(object->Get()));
+        if(!decl || m_transpiler.m_aliases.IsAddressed(*decl))
+            return false;
+        return decl->kind == Declaration::Kind::Parameter || isOwnUnit(m_transpiler.m_owners[decl->id]);
+    }
+
+    bool Transpiler::Emitter::isOwnUnit(std::uint32_t unit) const {
+        return unit == m_unit || std::any_of(m_inlined.begin(), m_inlined.end(), [&](const Inlined& inlined) {
+            return inlined.unit == unit;
+        });
+    }
+
+    // The innermost one, default values are written once per use
+    const Transpiler::Emitter::Hoisted * Transpiler::Emitter::findHoisted(const ASTNode::Expression& expr) const {
+        for(auto it = m_hoisted.rbegin(); it != m_hoisted.rend(); it++)
+            if(it->expr == &expr)
+                return &*it;
+        return nullptr;
+    }
+
+    // Emits the parts of the expression that C can not write inline, into temporaries
+    void Transpiler::Emitter::prepare(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults) {
+        if(isSimple(expr, defaults))
+            return;
+
+        std::size_t mark = m_operands.size();
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                auto type = getType(expr);
+                if(!type)
+                    return;
+                const auto& structLit = std::get<ASTNode::ExpressionLiteral::Struct>(literal.Get().value());
+                pushFieldOperands(structLit, m_transpiler.getValueType(type.value()), defaults);
+                prepareOperands(mark);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                const Function * callee = getCallee(funcCall);
+                if(getInlined(funcCall) || (callee && callee->isReturnedThrough))
+                    hoist(expr);
+                else
+                    prepareArguments(funcCall);
+            },
+            [&](const ASTNode::ExpressionBlock&) {
+                hoist(expr);
+            },
+            [&](const ASTNode::ExpressionIf&) {
+                hoist(expr);
+            },
+            [&](const ASTNode::ExpressionLoop&) {
+                hoist(expr);
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                const ASTNode::Expression& operand = *unaryOp.GetOperand();
+                if(unaryOp.GetKind() == UnOpKind::AddressOf && !isLValue(operand))
+                    hoist(operand);
+                else
+                    prepare(operand);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                const ASTNode::Expression& first = *binOp.GetOperands().first;
+                const ASTNode::Expression& second = *binOp.GetOperands().second;
+                switch(binOp.GetKind()) {
+                    case BinOpKind::StructMemberAccess:
+                        if(isShuffled(binOp))
+                            hoist(first);
+                        else
+                            prepare(first);
+                        return;
+                    case BinOpKind::And:
+                    case BinOpKind::Or:
+                        // the second operand is only evaluated if needed
+                        if(!isSimple(second))
+                            hoist(expr);
+                        else
+                            prepare(first);
+                        return;
+                    default:
+                        m_operands.push_back(Operand{&first, false});
+                        m_operands.push_back(Operand{&second, false});
+                        prepareOperands(mark);
+                        return;
+                }
+            },
+            [&](const ASTNode::ExpressionName&) {}
+        }, expr.Get());
+    }
+
+    // A value of a transposed field is written once per array, an argument passed as its fields once per field
+    void Transpiler::Emitter::pushFieldOperands(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults, const Function * callee) {
+        std::size_t fieldMark = matchFields(structLit, type, defaults);
+        std::vector<const ASTNode::Expression *> repeated;
+        for(std::size_t i = fieldMark; i < m_fieldValues.size(); i++) {
+            const ASTNode::Expression * value = m_fieldValues[i].value;
+            if(!value)
+                continue;
+            Passing passing = callee ? callee->passings[m_fieldValues[i].field] : Passing::Value;
+            bool isRepeated = false;
+            switch(passing) {
+                case Passing::Value:   isRepeated = m_transpiler.isTransposed(type, m_fieldValues[i].field) && isRepeatedValue(*value); break;
+                case Passing::Fields:  isRepeated = !isNamePath(*value); break;
+                case Passing::Pointer: isRepeated = !isAddressable(*value); break;
+            }
+            if(isRepeated)
+                repeated.push_back(value);
+        }
+        auto isRepeated = [&](const ASTNode::Expression * expr) {
+            return std::find(repeated.begin(), repeated.end(), expr) != repeated.end();
+        };
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields())
+            m_operands.push_back(Operand{field.GetValue().get(), isRepeated(field.GetValue().get())});
+        for(std::size_t i = fieldMark; i < m_fieldValues.size(); i++)
+            if(m_fieldValues[i].isDefault && m_fieldValues[i].value)
+                m_operands.push_back(Operand{m_fieldValues[i].value, isRepeated(m_fieldValues[i].value)});
+        m_fieldValues.resize(fieldMark);
+    }
+
+    void Transpiler::Emitter::prepareArguments(const ASTNode::ExpressionFunctionCall& funcCall) {
+        auto functionType = getType(*funcCall.GetFunction());
+        if(!functionType)
+            return;
+        TypeId arguments = m_transpiler.m_types.Get(m_transpiler.getValueType(functionType.value())).arguments;
+        const Function * callee = getCallee(funcCall);
+        std::size_t mark = m_operands.size();
+        if(!callee) // a function called by name does not change
+            m_operands.push_back(Operand{funcCall.GetFunction().get(), false});
+        pushFieldOperands(funcCall.GetParameters(), arguments, getCallDefaults(funcCall), callee);
+        prepareOperands(mark);
+    }
+
+    // Operands before the last one that is not simple are computed first, to keep the evaluation order
+    void Transpiler::Emitter::prepareOperands(std::size_t mark) {
+        std::size_t last = m_operands.size();
+        for(std::size_t i = mark; i < m_operands.size(); i++)
+            if(m_operands[i].isRepeated || !isSimpleOperand(*m_operands[i].expr))
+                last = i;
+        if(last < m_operands.size()) {
+            for(std::size_t i = mark; i < last; i++)
+                if(!isConstant(*m_operands[i].expr))
+                    hoist(*m_operands[i].expr);
+            const ASTNode::Expression& operand = *m_operands[last].expr;
+            auto type = getType(operand);
+            if(m_operands[last].isRepeated || (type && m_transpiler.isVoid(type.value())))
+                hoist(operand);
+            else
+                prepare(operand);
+        }
+        m_operands.resize(mark);
+    }
+
+    void Transpiler::Emitter::prepareLValue(const ASTNode::Expression::LValue& lvalue) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName&) {},
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                prepare(*operand);
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                prepare(*operands.first);
+            }
+        }, lvalue);
+    }
+
+    void Transpiler::Emitter::hoist(const ASTNode::Expression& expr) {
+        auto type = getType(expr);
+        if(!type)
+            return;
+        // the temporaries of its parts are only needed to compute it
+        std::size_t mark = m_hoisted.size();
+        if(m_transpiler.isVoid(type.value())) {
+            emitDiscarded(expr);
+            m_hoisted.resize(mark);
+            m_hoisted.push_back(Hoisted{&expr, NO_VALUE});
+            return;
+        }
+
+        std::uint32_t temp = m_nextTemp++;
+        bool isInline = std::visit(overloaded{
+            [&](const ASTNode::ExpressionBlock&) { return false; },
+            [&](const ASTNode::ExpressionLoop&) { return false; },
+            [&](const ASTNode::ExpressionIf& ifExpr) { return isSimpleIf(ifExpr, type.value()); },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                const Function * callee = getCallee(funcCall);
+                return !getInlined(funcCall) && (!callee || !callee->isReturnedThrough);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                return (binOp.GetKind() != BinOpKind::And && binOp.GetKind() != BinOpKind::Or) || isSimple(*binOp.GetOperands().second);
+            },
+            [&](const auto&) { return true; }
+        }, expr.Get());
+        if(isInline) {
+            prepare(expr);
+            line();
+            writeType(type.value());
+            m_out.Write(' ');
+            writeTemporary(temp);
+            m_out.Write(" = ");
+            writeExpression(expr);
+            m_out.Write(";\n");
+        }
+        else {
+            line();
+            writeType(type.value());
+            m_out.Write(' ');
+            writeTemporary(temp);
+            m_out.Write(";\n");
+            emitValue(expr, Destination{Destination::Kind::Temporary, temp, nullptr, nullptr, {}}, type.value());
+        }
+        m_hoisted.resize(mark);
+        m_hoisted.push_back(Hoisted{&expr, temp});
+    }
+
+    void Transpiler::Emitter::writeInt(Bytecode::Slot value, const Scalar& scalar) {
+        if(scalar.width == 1) {
+            m_out.Write(value ? "true" : "false");
+            return;
+        }
+        if(scalar.width < 64)
+            value = Bytecode::Normalize(value, scalar.width, scalar.isSigned);
+        if(scalar.width == 128)
+            m_out.Write(scalar.isSigned ? "((__int128)" : "((unsigned __int128)");
+
+        std::int64_t signedValue = std::int64_t(value);
+        if(scalar.isSigned && signedValue < 0) {
+            // the smallest value is not a literal, its negation overflows
+            m_out.Write('(');
+            if(scalar.width == 32 && signedValue == INT32_MIN)
+                m_out.Write("-2147483647 - 1");
+            else if(signedValue == INT64_MIN)
+                m_out.Write("-9223372036854775807LL - 1");
+            else {
+                m_out.WriteInt(signedValue);
+                if(scalar.width >= 64)
+                    m_out.Write("LL");
+            }
+            m_out.Write(')');
+        }
+        else {
+            m_out.WriteUInt(value);
+            if(scalar.width >= 64)
+                m_out.Write(scalar.isSigned ? "LL" : "ULL");
+            else if(scalar.width == 32 && !scalar.isSigned)
+                m_out.Write('U');
+        }
+
+        if(scalar.width == 128)
+            m_out.Write(')');
+    }
+
+    void Transpiler::Emitter::writeFloat(double value, const Scalar& scalar) {
+        bool isF32 = scalar.width == 32;
+        if(std::isnan(value)) {
+            m_out.Write(isF32 ? "NAN" : "((double)NAN)");
+            return;
+        }
+        if(std::isinf(value)) {
+            m_out.Write(value < 0 ? "(-" : "(");
+            m_out.Write(isF32 ? "HUGE_VALF)" : "HUGE_VAL)");
+            return;
+        }
+        bool isNegative = std::signbit(value);
+        if(isNegative)
+            m_out.Write("(-");
+        if(isF32) {
+            m_out.WriteFloat(float(std::fabs(value)));
+            m_out.Write('f');
+        }
+        else
+            m_out.WriteFloat(std::fabs(value));
+        if(isNegative)
+            m_out.Write(')');
+    }
+
+    void Transpiler::Emitter::writeChar(char c) {
+        if(c >= ' ' && c <= '~' && c != '\'' && c != '\\') {
+            m_out.Write('\'');
+            m_out.Write(c);
+            m_out.Write('\'');
+            return;
+        }
+        m_out.Write("((unsigned char)");
+        m_out.WriteUInt(std::uint8_t(c));
+        m_out.Write(')');
+    }
+
+    // Octal escapes have at most 3 digits, so they can not take the following characters
+    void Transpiler::Emitter::writeString(std::string_view str) {
+        m_out.Write("((unsigned char *)\"");
+        for(char c : str) {
+            switch(c) {
+                case '"':  m_out.Write("\\\""); break;
+                case '\\': m_out.Write("\\\\"); break;
+                case '?':  m_out.Write("\\?"); break; // trigraphs
+                case '\n': m_out.Write("\\n"); break;
+                case '\t': m_out.Write("\\t"); break;
+                case '\r': m_out.Write("\\r"); break;
+                default:
+                    if(c >= ' ' && c <= '~')
+                        m_out.Write(c);
+                    else {
+                        std::uint8_t byte = std::uint8_t(c);
+                        m_out.Write('\\');
+                        m_out.Write(char('0' + (byte >> 6)));
+                        m_out.Write(char('0' + ((byte >> 3) & 7)));
+                        m_out.Write(char('0' + (byte & 7)));
+                    }
+                    break;
+            }
+        }
+        m_out.Write("\")");
+    }
+
+    void Transpiler::Emitter::writeScalar(Bytecode::Slot value, TypeId type) {
+        auto scalar = m_transpiler.getScalar(type);
+        if(!scalar) {
+            m_out.Write('0');
+            return;
+        }
+        if(m_transpiler.m_types.Get(m_transpiler.getValueType(type)).primitive == Primitive::Char)
+            writeChar(char(value));
+        else if(scalar->isFloat)
+            writeFloat(Bytecode::ToFloat(value), scalar.value());
+        else
+            writeInt(value, scalar.value());
+    }
+
+    // A compile-time value, whose struct fields are flattened
+    void Transpiler::Emitter::writeValue(TypeId type, std::span<const Bytecode::Slot> slots, std::size_t& slotIdx) {
+        TypeId valueType = m_transpiler.getValueType(type);
+        if(m_transpiler.m_types.Get(valueType).kind != TypeKind::Struct) {
+            writeScalar(slotIdx < slots.size() ? slots[slotIdx] : 0, type);
+            slotIdx++;
+            return;
+        }
+        if(m_transpiler.isVoid(valueType)) {
+            m_out.Write("((void)0)");
+            return;
+        }
+
+        m_out.Write("((");
+        writeType(valueType);
+        m_out.Write("){ ");
+        std::span<const TypeInterner::Field> fields = m_transpiler.m_types.GetFields(valueType);
+        bool isFirst = true;
+        for(std::size_t i = 0; i < fields.size(); i++) {
+            if(m_transpiler.isVoid(fields[i].type))
+                continue;
+            for(std::uint64_t rep = 0; rep < fields[i].reps; rep++) {
+                if(!m_transpiler.isTransposed(valueType, i)) {
+                    if(!isFirst)
+                        m_out.Write(", ");
+                    isFirst = false;
+                    writeDesignator(valueType, i, rep);
+                    writeValue(fields[i].type, slots, slotIdx);
+                    continue;
+                }
+                // the fields of an element go to their arrays
+                std::span<const TypeInterner::Field> elementFields = m_transpiler.m_types.GetFields(fields[i].type);
+                for(std::size_t j = 0; j < elementFields.size(); j++) {
+                    if(m_transpiler.isVoid(elementFields[j].type))
+                        continue;
+                    for(std::uint64_t elementRep = 0; elementRep < elementFields[j].reps; elementRep++) {
+                        if(!isFirst)
+                            m_out.Write(", ");
+                        isFirst = false;
+                        writeDesignator(valueType, i, rep, j, elementRep);
+                        writeValue(elementFields[j].type, slots, slotIdx);
+                    }
+                }
+            }
+        }
+        m_out.Write(" })");
+    }
+
+    // Optionals in a niche are their value, bools as a byte
+    void Transpiler::Emitter::writeWrapPart(TypeId type, Part part) {
+        const Niche& niche = m_transpiler.getNiche(type);
+        if(m_transpiler.isFlagged(type)) {
+            if(part == Part::Begin) {
+                m_out.Write("((");
+                writeType(type);
+                m_out.Write("){ .value = ");
+            }
+            else
+                m_out.Write(", .isSet = true })");
+        }
+        else if(niche.kind == Niche::Kind::Byte && niche.path.empty()) {
+            if(part == Part::Begin) {
+                m_out.Write("((");
+                writeType(type);
+                m_out.Write(")(");
+            }
+            else
+                m_out.Write("))");
+        }
+        else
+            m_out.Write(part == Part::Begin ? "(" : ")");
+    }
+
+    void Transpiler::Emitter::writeUnwrapPart(TypeId type, Part part) {
+        const Niche& niche = m_transpiler.getNiche(type);
+        if(m_transpiler.isFlagged(type))
+            m_out.Write(part == Part::Begin ? "" : ".value");
+        else if(niche.kind == Niche::Kind::Byte && niche.path.empty())
+            m_out.Write(part == Part::Begin ? "((bool)(" : "))");
+        else
+            m_out.Write(part == Part::Begin ? "(" : ")");
+    }
+
+    void Transpiler::Emitter::writeSetPart(TypeId type, Part part) {
+        if(m_transpiler.isFlagged(type)) {
+            m_out.Write(part == Part::Begin ? "(" : ").isSet");
+            return;
+        }
+        if(part == Part::Begin) {
+            m_out.Write("ry_set_");
+            m_out.Write(std::string_view(m_transpiler.getTypeName(type)).substr(3));
+            m_out.Write('(');
+        }
+        else
+            m_out.Write(')');
+    }
+
+    // Integers are computed unsigned and converted back, so they wrap like at compile time
+    void Transpiler::Emitter::writeUnaryPart(UnOpKind kind, TypeId type, Part part, bool isSafe) {
+        auto scalar = m_transpiler.getScalar(type);
+        bool isWrapping = scalar && !scalar->isFloat && (scalar->isSigned || scalar->width < 32) && !(isSafe && scalar->width >= 32);
+        // signed vector lanes are negated as the unsigned vector of the same size, like they are added
+        if(auto shape = m_transpiler.getVectorShape(type); shape && kind == UnOpKind::ArithmeticNegation) {
+            auto element = getPrimitiveScalar(shape->element);
+            if(!element->isFloat && element->isSigned) {
+                if(part == Part::Begin) {
+                    m_out.Write("((");
+                    writeType(type);
+                    m_out.Write(std::format(
+                        ")(-(uint{}_t __attribute__((vector_size({}))))", unsigned(element->width), element->width / 8 * shape->numLanes
+                    ));
+                }
+                else
+                    m_out.Write("))");
+                return;
+            }
+        }
+        if(part == Part::End) {
+            m_out.Write(')');
+            return;
+        }
+        switch(kind) {
+            case UnOpKind::ArithmeticNegation:
+            case UnOpKind::BitwiseNegation:
+                if(!isWrapping) {
+                    m_out.Write(kind == UnOpKind::ArithmeticNegation ? "(-" : "(~");
+                    return;
+                }
+                m_out.Write("((");
+                writeType(type);
+                m_out.Write(')');
+                if(kind == UnOpKind::BitwiseNegation) {
+                    m_out.Write('~');
+                    return;
+                }
+                m_out.Write('-');
+                m_out.Write(scalar->width <= 32 ? "(uint32_t)" : scalar->width <= 64 ? "(uint64_t)" : "(unsigned __int128)");
+                return;
+            case UnOpKind::LogicalNegation:
+                m_out.Write("(!");
+                return;
+            default:
+                m_out.Write('(');
+                return;
+        }
+    }
+
+    void Transpiler::Emitter::writeBinaryPart(BinOpKind kind, TypeId type, Part part, bool isSafe) {
+        auto scalar = m_transpiler.getScalar(type);
+        const char * op = "";
+        switch(kind) {
+            case BinOpKind::Add:        op = " + "; break;
+            case BinOpKind::Sub:        op = " - "; break;
+            case BinOpKind::Mul:        op = " * "; break;
+            case BinOpKind::Div:        op = " / "; break;
+            case BinOpKind::Mod:        op = " % "; break;
+            case BinOpKind::BitOr:      op = " | "; break;
+            case BinOpKind::BitXor:     op = " ^ "; break;
+            case BinOpKind::BitAnd:     op = " & "; break;
+            case BinOpKind::BitLShift:  op = " << "; break;
+            case BinOpKind::BitRShift:  op = " >> "; break;
+            case BinOpKind::Eq:         op = " == "; break;
+            case BinOpKind::Uneq:       op = " != "; break;
+            case BinOpKind::Less:       op = " < "; break;
+            case BinOpKind::LessEqual:  op = " <= "; break;
+            case BinOpKind::Great:      op = " > "; break;
+            case BinOpKind::GreatEqual: op = " >= "; break;
+            case BinOpKind::Or:         op = " || "; break;
+            case BinOpKind::And:        op = " && "; break;
+            default: break;
+        }
+        auto writePlain = [&]() {
+            m_out.Write(part == Part::Begin ? "(" : part == Part::Middle ? op : ")");
+        };
+        // narrower types are promoted to int
+        auto writeNarrowed = [&]() {
+            if(part == Part::Begin) {
+                m_out.Write("((");
+                writeType(type);
+                m_out.Write(")(");
+            }
+            else
+                m_out.Write(part == Part::Middle ? op : "))");
+        };
+        const char * unsignedType = !scalar ? "" : scalar->width <= 32 ? "(uint32_t)" : scalar->width <= 64 ? "(uint64_t)" : "(unsigned __int128)";
+
+        switch(kind) {
+            case BinOpKind::Eq:
+            case BinOpKind::Uneq: {
+                bool isEq = kind == BinOpKind::Eq;
+                if(m_transpiler.isVoid(type)) {
+                    m_out.Write(part == Part::Begin ? "((void)(" : part == Part::Middle ? "), (void)(" : isEq ? "), true)" : "), false)");
+                    return;
+                }
+                TypeId cType = m_transpiler.getCType(type);
+                if(!m_transpiler.isWrapped(cType) && m_transpiler.m_types.Get(cType).kind != TypeKind::Struct && !m_transpiler.getVectorShape(cType)) {
+                    writePlain();
+                    return;
+                }
+                // structs are compared by field, vectors by lane
+                if(part == Part::Begin) {
+                    m_out.Write(isEq ? "ry_eq_" : "(!ry_eq_");
+                    m_out.Write(std::string_view(m_transpiler.getTypeName(cType)).substr(3));
+                    m_out.Write('(');
+                }
+                else
+                    m_out.Write(part == Part::Middle ? ", " : isEq ? ")" : "))");
+                return;
+            }
+            case BinOpKind::Add:
+            case BinOpKind::Sub:
+            case BinOpKind::Mul:
+                // vector lanes are not promoted, signed ones are computed as the unsigned vector of the same size
+                if(auto shape = m_transpiler.getVectorShape(type)) {
+                    auto element = getPrimitiveScalar(shape->element);
+                    if(element->isFloat || !element->isSigned) {
+                        writePlain();
+                        return;
+                    }
+                    std::string vectorType = std::format(
+                        "(uint{}_t __attribute__((vector_size({}))))", unsigned(element->width), element->width / 8 * shape->numLanes
+                    );
+                    if(part == Part::Begin) {
+                        m_out.Write("((");
+                        writeType(type);
+                        m_out.Write(")(");
+                        m_out.Write(vectorType);
+                    }
+                    else if(part == Part::Middle) {
+                        m_out.Write(op);
+                        m_out.Write(vectorType);
+                    }
+                    else
+                        m_out.Write("))");
+                    return;
+                }
+                if(!scalar || scalar->isFloat || ((!scalar->isSigned || isSafe) && scalar->width >= 32)) {
+                    writePlain();
+                    return;
+                }
+                if(isSafe) {
+                    writeNarrowed();
+                    return;
+                }
+                if(part == Part::Begin) {
+                    m_out.Write("((");
+                    writeType(type);
+                    m_out.Write(")(");
+                    m_out.Write(unsignedType);
+                }
+                else if(part == Part::Middle) {
+                    m_out.Write(op);
+                    m_out.Write(unsignedType);
+                }
+                else
+                    m_out.Write("))");
+                return;
+            case BinOpKind::Div:
+            case BinOpKind::Mod:
+                // unless the ranges prove the divisor is not zero, nor -1 with the minimum, the helper fails and wraps like at compile time
+                if(scalar && !scalar->isFloat && scalar->width > 1 && !isSafe) {
+                    if(part == Part::Begin) {
+                        m_out.Write(kind == BinOpKind::Div ? "ry_div_" : "ry_mod_");
+                        m_out.Write(getIntegerSuffix(scalar.value()));
+                        m_out.Write('(');
+                        m_divisions.push_back(type);
+                    }
+                    else
+                        m_out.Write(part == Part::Middle ? ", " : ")");
+                    return;
+                }
+                if(!scalar || scalar->isFloat || scalar->width >= 32)
+                    writePlain();
+                else
+                    writeNarrowed();
+                return;
+            case BinOpKind::BitOr:
+            case BinOpKind::BitXor:
+            case BinOpKind::BitAnd:
+                if(!scalar || scalar->isFloat || scalar->width >= 32)
+                    writePlain();
+                else
+                    writeNarrowed();
+                return;
+            case BinOpKind::BitLShift:
+            case BinOpKind::BitRShift:
+                // the ranges of safe ones prove the amount is below the width, the helper fails on others like at compile time
+                if(!scalar || (isSafe && scalar->width >= 32)) {
+                    writePlain();
+                    return;
+                }
+                if(isSafe) {
+                    writeNarrowed();
+                    return;
+                }
+                if(part == Part::Begin) {
+                    m_out.Write(kind == BinOpKind::BitLShift ? "ry_shl_" : "ry_shr_");
+                    m_out.Write(getIntegerSuffix(scalar.value()));
+                    m_out.Write('(');
+                    m_shifts.push_back(type);
+                }
+                else
+                    m_out.Write(part == Part::Middle ? ", " : ")");
+                return;
+            default:
+                writePlain();
+                return;
+        }
+    }
+
+    void Transpiler::Emitter::writeDesignator(TypeId type, std::size_t fieldIdx, std::uint64_t rep, std::optional<std::size_t> elementFieldIdx, std::uint64_t elementRep) {
+        const TypeInterner::Field& field = m_transpiler.m_types.GetFields(type)[fieldIdx];
+        m_out.Write('.');
+        if(!elementFieldIdx)
+            m_transpiler.writeFieldName(m_out, type, fieldIdx);
+        else
+            m_transpiler.writeColumnName(m_out, type, fieldIdx, elementFieldIdx.value());
+        if(field.reps > 1) {
+            m_out.Write('[');
+            m_out.WriteUInt(rep);
+            m_out.Write(']');
+        }
+        if(elementFieldIdx && m_transpiler.m_types.GetFields(field.type)[elementFieldIdx.value()].reps > 1) {
+            m_out.Write('[');
+            m_out.WriteUInt(elementRep);
+            m_out.Write(']');
+        }
+        m_out.Write(" = ");
+    }
+
+    void Transpiler::Emitter::writeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type, const ASTNode::TypeStruct * defaults) {
+        if(m_transpiler.isVoid(type)) {
+            m_out.Write("((void)0)");
+            return;
+        }
+
+        std::size_t mark = matchFields(structLit, type, defaults);
+        std::span<const TypeInterner::Field> fields = m_transpiler.m_types.GetFields(type);
+        m_out.Write("((");
+        writeType(type);
+        m_out.Write("){ ");
+        bool isFirst = true;
+        for(std::size_t i = mark; i < m_fieldValues.size(); i++) {
+            FieldValue fieldValue = m_fieldValues[i];
+            const TypeInterner::Field& field = fields[fieldValue.field];
+            if(!fieldValue.value || m_transpiler.isVoid(field.type))
+                continue;
+            if(m_transpiler.isTransposed(type, fieldValue.field)) {
+                writeTransposed(type, fieldValue, isFirst);
+                continue;
+            }
+            if(!isFirst)
+                m_out.Write(", ");
+            isFirst = false;
+            writeDesignator(type, fieldValue.field, fieldValue.rep);
+            writeConverted(*fieldValue.value, field.type);
+        }
+        // fields without a value are zero
+        m_out.Write(isFirst ? "0 })" : " })");
+        m_fieldValues.resize(mark);
+    }
+
+    // Lanes are matched by position, the missing ones are zero
+    void Transpiler::Emitter::writeVectorLiteral(const ASTNode::ExpressionLiteral::Struct& structLit, TypeId type) {
+        m_out.Write("((");
+        writeType(type);
+        m_out.Write("){ ");
+        bool isFirst = true;
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields()) {
+            if(!isFirst)
+                m_out.Write(", ");
+            isFirst = false;
+            writeConverted(*field.GetValue(), m_transpiler.m_elementTypes[type]);
+        }
+        m_out.Write(isFirst ? "0 })" : " })");
+    }
+
+    // A literal element is written field by field, other values once per field
+    void Transpiler::Emitter::writeTransposed(TypeId type, const FieldValue& fieldValue, bool& isFirst) {
+        const ASTNode::Expression& value = *fieldValue.value;
+        TypeId elementType = m_transpiler.m_types.GetFields(type)[fieldValue.field].type;
+        std::span<const TypeInterner::Field> elementFields = m_transpiler.m_types.GetFields(elementType);
+        auto literal = std::get_if<ASTNode::ExpressionLiteral>(&value.Get());
+        if(literal && literal->Get() && !findHoisted(value) && !m_transpiler.m_compValues.contains(&value)) {
+            const auto& structLit = std::get<ASTNode::ExpressionLiteral::Struct>(literal->Get().value());
+            std::size_t mark = matchFields(structLit, elementType, nullptr);
+            for(std::size_t i = mark; i < m_fieldValues.size(); i++) {
+                FieldValue elementValue = m_fieldValues[i];
+                if(!elementValue.value || m_transpiler.isVoid(elementFields[elementValue.field].type))
+                    continue;
+                if(!isFirst)
+                    m_out.Write(", ");
+                isFirst = false;
+                writeDesignator(type, fieldValue.field, fieldValue.rep, elementValue.field, elementValue.rep);
+                writeConverted(*elementValue.value, elementFields[elementValue.field].type);
+            }
+            m_fieldValues.resize(mark);
+            return;
+        }
+        for(std::size_t j = 0; j < elementFields.size(); j++) {
+            if(m_transpiler.isVoid(elementFields[j].type))
+                continue;
+            for(std::uint64_t elementRep = 0; elementRep < elementFields[j].reps; elementRep++) {
+                if(!isFirst)
+                    m_out.Write(", ");
+                isFirst = false;
+                writeDesignator(type, fieldValue.field, fieldValue.rep, j, elementRep);
+                m_out.Write('(');
+                writeConverted(value, elementType);
+                m_out.Write(").");
+                m_transpiler.writeFieldName(m_out, elementType, j);
+                if(elementFields[j].reps > 1) {
+                    m_out.Write('[');
+                    m_out.WriteUInt(elementRep);
+                    m_out.Write(']');
+                }
+            }
+        }
+    }
+
+    void Transpiler::Emitter::writeCall(const ASTNode::ExpressionFunctionCall& funcCall, const Destination * dest) {
+        const ASTNode::Expression& functionExpr = *funcCall.GetFunction();
+        auto functionType = getType(functionExpr);
+        if(!functionType) {
+            m_out.Write('0');
+            return;
+        }
+        TypeId arguments = m_transpiler.m_types.Get(m_transpiler.getValueType(functionType.value())).arguments;
+        const Function * callee = getCallee(funcCall);
+
+        writeExpression(functionExpr);
+        m_out.Write('(');
+        bool isFirst = true;
+        if(callee && callee->isReturnedThrough && dest) {
+            if(dest->kind == Destination::Kind::Return)
+                m_out.Write("_r");
+            else {
+                m_out.Write('&');
+                writeDestination(*dest);
+            }
+            isFirst = false;
+        }
+        std::size_t mark = matchFields(funcCall.GetParameters(), arguments, getCallDefaults(funcCall));
+        std::span<const TypeInterner::Field> fields = m_transpiler.m_types.GetFields(arguments);
+        for(std::size_t i = mark; i < m_fieldValues.size(); i++) {
+            FieldValue fieldValue = m_fieldValues[i];
+            TypeId type = fields[fieldValue.field].type;
+            if(m_transpiler.isVoid(type))
+                continue;
+            if(!isFirst)
+                m_out.Write(", ");
+            isFirst = false;
+            auto writeArgument = [&]() {
+                if(fieldValue.value)
+                    writeConverted(*fieldValue.value, type);
+                else
+                    m_transpiler.writeZero(m_out, type);
+            };
+            switch(callee ? callee->passings[fieldValue.field] : Passing::Value) {
+                case Passing::Value:
+                    writeArgument();
+                    break;
+                case Passing::Fields: {
+                    TypeId cType = m_transpiler.getCType(type);
+                    const std::vector<std::uint32_t>& order = m_transpiler.m_fieldOrders[cType];
+                    for(std::size_t k = 0; k < order.size(); k++) {
+                        if(k > 0)
+                            m_out.Write(", ");
+                        writeArgument();
+                        m_out.Write('.');
+                        m_transpiler.writeFieldName(m_out, cType, order[k]);
+                    }
+                    break;
+                }
+                case Passing::Pointer:
+                    m_out.Write('&');
+                    writeArgument();
+                    break;
+            }
+        }
+        m_out.Write(')');
+        m_fieldValues.resize(mark);
+    }
+
+    // Writes the C value of the expression's type, its parts that are not simple must be prepared
+    void Transpiler::Emitter::writeExpression(const ASTNode::Expression& expr, const ASTNode::TypeStruct * defaults, bool isValue) {
+        if(const Hoisted * hoisted = findHoisted(expr)) {
+            if(hoisted->temp == NO_VALUE)
+                m_out.Write("((void)0)");
+            else
+                writeTemporary(hoisted->temp);
+            return;
+        }
+        if(auto it = m_transpiler.m_compValues.find(&expr); it != m_transpiler.m_compValues.end()) {
+            std::size_t slotIdx = 0;
+            writeValue(it->second->type, it->second->slots, slotIdx);
+            return;
+        }
+        auto type = getType(expr);
+        if(!type) {
+            m_out.Write('0');
+            return;
+        }
+        if(auto it = m_transpiler.m_forwards.find(&expr); it != m_transpiler.m_forwards.end()) {
+            writeConverted(*it->second, type.value());
+            return;
+        }
+
+        // operations compute the value of the type without attributes, optionals wrap it
+        TypeId valueType = m_transpiler.getValueType(type.value());
+        bool isWrapped = m_transpiler.isWrapped(type.value()) && !isValue;
+        auto wrapBegin = [&]() {
+            if(isWrapped)
+                writeWrapPart(type.value(), Part::Begin);
+        };
+        auto wrapEnd = [&]() {
+            if(isWrapped)
+                writeWrapPart(type.value(), Part::End);
+        };
+
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get()) {
+                    if(isWrapped)
+                        m_transpiler.writeNull(m_out, m_transpiler.getCType(type.value()));
+                    else
+                        m_out.Write("NULL");
+                    return;
+                }
+                wrapBegin();
+                // number literals typed as vectors are broadcast to every lane
+                auto shape = m_transpiler.getVectorShape(valueType);
+                auto scalar = shape ? getPrimitiveScalar(shape->element) : m_transpiler.getScalar(valueType);
+                auto writeLanes = [&](auto writeLane) {
+                    if(!shape) {
+                        writeLane();
+                        return;
+                    }
+                    m_out.Write("((");
+                    writeType(valueType);
+                    m_out.Write("){ ");
+                    for(std::uint32_t lane = 0; lane < shape->numLanes; lane++) {
+                        if(lane > 0)
+                            m_out.Write(", ");
+                        writeLane();
+                    }
+                    m_out.Write(" })");
+                };
+                std::visit(overloaded{
+                    [&](ASTNode::ExpressionLiteral::Int value) {
+                        writeLanes([&]() {
+                            if(scalar && scalar->isFloat)
+                                writeFloat(double(value), scalar.value());
+                            else if(scalar)
+                                writeInt(value, scalar.value());
+                            else
+                                m_out.WriteUInt(value);
+                        });
+                    },
+                    [&](ASTNode::ExpressionLiteral::Float value) {
+                        writeLanes([&]() {
+                            writeFloat(value, scalar.value_or(Scalar{64, true, true}));
+                        });
+                    },
+                    [&](const ASTNode::ExpressionLiteral::String& value) {
+                        writeString(value);
+                    },
+                    [&](ASTNode::ExpressionLiteral::Char value) {
+                        writeChar(value);
+                    },
+                    [&](ASTNode::ExpressionLiteral::Bool value) {
+                        m_out.Write(value ? "true" : "false");
+                    },
+                    [&](const ASTNode::ExpressionLiteral::Struct& structLit) {
+                        if(shape)
+                            writeVectorLiteral(structLit, valueType);
+                        else
+                            writeStructLiteral(structLit, valueType, defaults);
+                    }
+                }, literal.Get().value());
+                wrapEnd();
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                writeCall(funcCall);
+            },
+            [&](const ASTNode::ExpressionBlock&) {
+                m_out.Write('0'); // hoisted
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                const ASTNode::Statement& failStmt = *ifExpr.GetFailStatement().value();
+                m_out.Write('(');
+                if(std::optional<bool> isTaken = getConstantCondition(*ifExpr.GetCondition())) {
+                    const ASTNode::Statement& stmt = isTaken.value() ? *ifExpr.GetSuccessStatement() : failStmt;
+                    writeConverted(std::get<ASTNode::StatementExpression>(stmt.Get()), type.value());
+                    m_out.Write(')');
+                    return;
+                }
+                writeExpression(*ifExpr.GetCondition());
+                m_out.Write(" ? ");
+                writeConverted(std::get<ASTNode::StatementExpression>(ifExpr.GetSuccessStatement()->Get()), type.value());
+                m_out.Write(" : ");
+                writeConverted(std::get<ASTNode::StatementExpression>(failStmt.Get()), type.value());
+                m_out.Write(')');
+            },
+            [&](const ASTNode::ExpressionLoop&) {
+                m_out.Write('0'); // hoisted
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                const ASTNode::Expression& operand = *unaryOp.GetOperand();
+                switch(unaryOp.GetKind()) {
+                    case UnOpKind::Comp:
+                        // not evaluated, which is reported
+                        writeExpression(operand);
+                        return;
+                    case UnOpKind::AddressOf:
+                        m_out.Write("(&");
+                        writeExpression(operand);
+                        m_out.Write(')');
+                        return;
+                    case UnOpKind::PointerDereference:
+                        m_out.Write("(*");
+                        writeExpression(operand);
+                        m_out.Write(')');
+                        return;
+                    default:
+                        break;
+                }
+                wrapBegin();
+                writeUnaryPart(unaryOp.GetKind(), valueType, Part::Begin, m_transpiler.m_safe.contains(&expr));
+                writeConverted(operand, valueType);
+                writeUnaryPart(unaryOp.GetKind(), valueType, Part::End);
+                wrapEnd();
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                const ASTNode::Expression& first = *binOp.GetOperands().first;
+                const ASTNode::Expression& second = *binOp.GetOperands().second;
+                // member names have no type
+                auto firstType = getType(first);
+                auto secondType = binOp.GetKind() == BinOpKind::StructMemberAccess ? firstType : getType(second);
+                if(!firstType || !secondType) {
+                    m_out.Write('0');
+                    return;
+                }
+                switch(binOp.GetKind()) {
+                    case BinOpKind::StructMemberAccess: {
+                        TypeId object = m_transpiler.getValueType(firstType.value());
+                        if(auto lanes = getLanes(object, second)) {
+                            if(lanes->size() == 1) {
+                                m_out.Write('(');
+                                writeConverted(first, object);
+                                m_out.Write(")[");
+                                m_out.WriteUInt(lanes->front());
+                                m_out.Write(']');
+                                return;
+                            }
+                            m_out.Write("__builtin_shufflevector(");
+                            writeConverted(first, object);
+                            m_out.Write(", ");
+                            writeConverted(first, object);
+                            for(std::uint32_t lane : lanes.value()) {
+                                m_out.Write(", ");
+                                m_out.WriteUInt(lane);
+                            }
+                            m_out.Write(')');
+                            return;
+                        }
+                        auto fieldIdx = getFieldIdx(object, second);
+                        if(!fieldIdx || m_transpiler.isVoid(type.value())) {
+                            m_out.Write("((void)0)");
+                            return;
+                        }
+                        writeConverted(first, object);
+                        m_out.Write('.');
+                        m_transpiler.writeFieldName(m_out, object, fieldIdx.value());
+                        return;
+                    }
+                    case BinOpKind::TypeCast:
+                        m_out.Write('0'); // reported by the typer
+                        return;
+                    case BinOpKind::Eq:
+                    case BinOpKind::Uneq: {
+                        // compared as optionals if one of them is, to null by whether it has a value
+                        TypeId operandType = !m_transpiler.isWrapped(firstType.value()) && m_transpiler.isWrapped(secondType.value())
+                            ? secondType.value()
+                            : firstType.value();
+                        if(m_transpiler.isWrapped(operandType) && (isNull(first) || isNull(second))) {
+                            const ASTNode::Expression& optional = isNull(first) ? second : first;
+                            m_out.Write(binOp.GetKind() == BinOpKind::Eq ? "(!" : "(");
+                            writeSetPart(operandType, Part::Begin);
+                            writeConverted(optional, operandType);
+                            writeSetPart(operandType, Part::End);
+                            m_out.Write(')');
+                            return;
+                        }
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::Begin);
+                        writeConverted(first, operandType);
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::Middle);
+                        writeConverted(second, operandType);
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::End);
+                        return;
+                    }
+                    case BinOpKind::Less:
+                    case BinOpKind::LessEqual:
+                    case BinOpKind::Great:
+                    case BinOpKind::GreatEqual:
+                    case BinOpKind::And:
+                    case BinOpKind::Or: {
+                        TypeId operandType = m_transpiler.getValueType(firstType.value());
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::Begin);
+                        writeConverted(first, operandType);
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::Middle);
+                        writeConverted(second, operandType);
+                        writeBinaryPart(binOp.GetKind(), operandType, Part::End);
+                        return;
+                    }
+                    default:
+                        break;
+                }
+                bool isShift = binOp.GetKind() == BinOpKind::BitLShift || binOp.GetKind() == BinOpKind::BitRShift;
+                bool isSafe = m_transpiler.m_safe.contains(&expr);
+                wrapBegin();
+                writeBinaryPart(binOp.GetKind(), valueType, Part::Begin, isSafe);
+                writeConverted(first, valueType);
+                writeBinaryPart(binOp.GetKind(), valueType, Part::Middle, isSafe);
+                writeConverted(second, isShift ? m_transpiler.getValueType(secondType.value()) : valueType);
+                writeBinaryPart(binOp.GetKind(), valueType, Part::End, isSafe);
+                wrapEnd();
+            },
+            [&](const ASTNode::ExpressionName& name) {
+                const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(name);
+                if(!decl) {
+                    m_out.Write('0'); // reported by the analyzer
+                    return;
+                }
+                // variables without a value are not defined
+                if(m_transpiler.isVoid(type.value()) && decl->kind == Declaration::Kind::Variable && !getFunctionDefinition(*decl)) {
+                    m_out.Write("((void)0)");
+                    return;
+                }
+                writeDeclarationName(*decl, expr.GetSourcePosition());
+            }
+        }, expr.Get());
+    }
+
+    // Optionals are wrapped and unwrapped where a value of the other is expected
+    void Transpiler::Emitter::writeConverted(const ASTNode::Expression& expr, TypeId type, const ASTNode::TypeStruct * defaults) {
+        // null is the optional without a value, whatever type was recorded for the literal
+        if(isNull(expr) && m_transpiler.isWrapped(type)) {
+            m_transpiler.writeNull(m_out, m_transpiler.getCType(type));
+            return;
+        }
+        auto exprType = getType(expr);
+        if(!exprType || m_transpiler.getCType(exprType.value()) == m_transpiler.getCType(type)) {
+            writeExpression(expr, defaults);
+            return;
+        }
+        bool isWrapped = m_transpiler.isWrapped(type);
+        bool isExprWrapped = m_transpiler.isWrapped(exprType.value());
+        if(isWrapped && !isExprWrapped) {
+            writeWrapPart(type, Part::Begin);
+            writeExpression(expr, defaults);
+            writeWrapPart(type, Part::End);
+        }
+        else if(isExprWrapped && !isWrapped) {
+            // operations and literals compute the value before wrapping it
+            bool isComputed = !findHoisted(expr) && !m_transpiler.m_compValues.contains(&expr) && std::visit(overloaded{
+                [&](const ASTNode::ExpressionLiteral& literal) {
+                    return literal.Get().has_value();
+                },
+                [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                    UnOpKind kind = unaryOp.GetKind();
+                    return kind == UnOpKind::ArithmeticNegation || kind == UnOpKind::BitwiseNegation || kind == UnOpKind::LogicalNegation;
+                },
+                [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                    switch(binOp.GetKind()) {
+                        case BinOpKind::Add: case BinOpKind::Sub: case BinOpKind::Mul: case BinOpKind::Div: case BinOpKind::Mod:
+                        case BinOpKind::BitOr: case BinOpKind::BitXor: case BinOpKind::BitAnd:
+                        case BinOpKind::BitLShift: case BinOpKind::BitRShift:
+                            return true;
+                        default:
+                            return false;
+                    }
+                },
+                [&](const auto&) {
+                    return false;
+                }
+            }, expr.Get());
+            if(!isComputed)
+                writeUnwrapPart(exprType.value(), Part::Begin);
+            writeExpression(expr, defaults, isComputed);
+            if(!isComputed)
+                writeUnwrapPart(exprType.value(), Part::End);
+        }
+        else
+            writeExpression(expr, defaults);
+    }
+
+    void Transpiler::Emitter::writeLValue(const ASTNode::Expression::LValue& lvalue, const std::optional<SourcePosition>& srcPos) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) {
+                if(const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(name))
+                    writeDeclarationName(*decl, srcPos);
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) {
+                m_out.Write("(*");
+                writeExpression(*operand);
+                m_out.Write(')');
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                const ASTNode::Expression& object = *operands.first;
+                auto objectType = getType(object);
+                if(!objectType)
+                    return;
+                if(!isLValue(object))
+                    error("Only members of variables and dereferenced pointers can be assigned in C", object.GetSourcePosition());
+                TypeId valueType = m_transpiler.getValueType(objectType.value());
+                if(auto lanes = getLanes(valueType, *operands.second)) {
+                    m_out.Write('(');
+                    writeConverted(object, valueType);
+                    m_out.Write(")[");
+                    m_out.WriteUInt(lanes->front());
+                    m_out.Write(']');
+                    return;
+                }
+                auto fieldIdx = getFieldIdx(valueType, *operands.second);
+                if(!fieldIdx)
+                    return;
+                writeConverted(object, valueType);
+                m_out.Write('.');
+                m_transpiler.writeFieldName(m_out, valueType, fieldIdx.value());
+            }
+        }, lvalue);
+    }
+
+    void Transpiler::Emitter::writeDefinedType(const Declaration& decl, TypeId type) {
+        if(!m_transpiler.m_isWidened[decl.id]) {
+            writeType(type);
+            return;
+        }
+        m_out.Write(m_transpiler.getScalar(type)->isSigned ? "int32_t" : "uint32_t");
+    }
+
+    void Transpiler::Emitter::writeStep(const ASTNode::Statement& stmt) {
+        std::visit(overloaded{
+            [&](const ASTNode::StatementAssignment& assign) {
+                writeLValue(assign.GetLValue(), stmt.GetSourcePosition());
+                m_out.Write(" = ");
+                writeConverted(assign.GetRValue(), getLValueType(assign.GetLValue()).value());
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                const ASTNode::Expression::LValue& lvalue = binOp.GetOperands().first;
+                const ASTNode::Expression& value = binOp.GetOperands().second;
+                TypeId type = m_transpiler.getValueType(getLValueType(lvalue).value());
+                auto valueType = getType(value);
+                BinOpKind kind = getCompoundKind(binOp.GetKind());
+                bool isShift = kind == BinOpKind::BitLShift || kind == BinOpKind::BitRShift;
+                bool isSafe = m_transpiler.m_safeAssignments.contains(&stmt);
+                writeLValue(lvalue, stmt.GetSourcePosition());
+                m_out.Write(" = ");
+                writeBinaryPart(kind, type, Part::Begin, isSafe);
+                writeLValue(lvalue, stmt.GetSourcePosition());
+                writeBinaryPart(kind, type, Part::Middle, isSafe);
+                writeConverted(value, isShift && valueType ? m_transpiler.getValueType(valueType.value()) : type);
+                writeBinaryPart(kind, type, Part::End, isSafe);
+            },
+            [&](const auto&) {}
+        }, stmt.Get());
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    void Transpiler::Emitter::emitAssignment(const Destination& dest, const ASTNode::Expression& value, TypeId type) {
+        bool isReturnedThrough = dest.kind == Destination::Kind::Return && m_function->isReturnedThrough;
+        line();
+        if(isReturnedThrough)
+            m_out.Write("*_r = ");
+        else if(dest.kind == Destination::Kind::Return)
+            m_out.Write("return ");
+        else {
+            writeDestination(dest);
+            m_out.Write(" = ");
+        }
+        writeConverted(value, type);
+        m_out.Write(";\n");
+        if(isReturnedThrough) {
+            line();
+            m_out.Write("return;\n");
+        }
+    }
+
+    // Computes the expression into the destination, whose type may differ in its attributes
+    void Transpiler::Emitter::emitValue(const ASTNode::Expression& expr, const Destination& dest, TypeId type) {
+        auto assign = [&](const ASTNode::Expression& value) {
+            emitAssignment(dest, value, type);
+        };
+        if(m_transpiler.m_compValues.contains(&expr)) {
+            assign(expr);
+            return;
+        }
+
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionBlock& block) {
+                emitBlock(block, dest, type);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                if(isSimpleIf(ifExpr, type)) {
+                    prepare(expr);
+                    assign(expr);
+                }
+                else
+                    emitIf(ifExpr, dest, type, false);
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                emitLoop(loop, dest, type);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                if(getInlined(funcCall)) {
+                    emitInlined(funcCall, dest, type);
+                    return;
+                }
+                // a result returned through a pointer is written to a destination nothing reads during the call
+                const Function * callee = getCallee(funcCall);
+                auto callType = getType(expr);
+                bool isWrittenThrough = false;
+                switch(dest.kind) {
+                    case Destination::Kind::Temporary: isWrittenThrough = true; break;
+                    case Destination::Kind::Variable:  isWrittenThrough = m_transpiler.m_owners[dest.decl->id] != GLOBAL; break;
+                    case Destination::Kind::Return:    isWrittenThrough = m_function->isReturnedThrough; break;
+                    default: break;
+                }
+                if(!callee || !callee->isReturnedThrough || !callType || m_transpiler.getCType(callType.value()) != m_transpiler.getCType(type) || !isWrittenThrough) {
+                    prepare(expr);
+                    assign(expr);
+                    return;
+                }
+                prepareArguments(funcCall);
+                line();
+                writeCall(funcCall, &dest);
+                m_out.Write(";\n");
+                if(dest.kind == Destination::Kind::Return) {
+                    line();
+                    m_out.Write("return;\n");
+                }
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                const ASTNode::Expression& second = *binOp.GetOperands().second;
+                // a return can not be read back, the first operand is then a temporary
+                bool isShortCircuit = (binOp.GetKind() == BinOpKind::And || binOp.GetKind() == BinOpKind::Or) && !isSimple(second);
+                if(!isShortCircuit || dest.kind == Destination::Kind::Return) {
+                    prepare(expr);
+                    assign(expr);
+                    return;
+                }
+                const ASTNode::Expression& first = *binOp.GetOperands().first;
+                prepare(first);
+                assign(first);
+                line();
+                m_out.Write(binOp.GetKind() == BinOpKind::And ? "if(" : "if(!");
+                writeDestination(dest);
+                m_out.Write(") {\n");
+                m_indent++;
+                std::size_t mark = m_hoisted.size();
+                if(isEmittedInto(second))
+                    emitValue(second, dest, type);
+                else {
+                    prepare(second);
+                    assign(second);
+                }
+                m_hoisted.resize(mark);
+                m_indent--;
+                line();
+                m_out.Write("}\n");
+            },
+            [&](const auto&) {
+                prepare(expr);
+                assign(expr);
+            }
+        }, expr.Get());
+    }
+
+    // Expression statements only have side effects
+    void Transpiler::Emitter::emitDiscarded(const ASTNode::Expression& expr) {
+        auto type = getType(expr);
+        if(!type || m_transpiler.m_compValues.contains(&expr))
+            return;
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionBlock& block) {
+                emitBlock(block, {}, type.value());
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                emitIf(ifExpr, {}, type.value(), false);
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                emitLoop(loop, {}, type.value());
+            },
+            [&](const auto& data) {
+                using Data = std::decay_t<decltype(data)>;
+                if constexpr(std::is_same_v<Data, ASTNode::ExpressionFunctionCall>) {
+                    if(getInlined(data)) {
+                        emitInlined(data, {}, type.value());
+                        return;
+                    }
+                }
+                if constexpr(std::is_same_v<Data, ASTNode::ExpressionBinaryOperation>) {
+                    const ASTNode::Expression& second = *data.GetOperands().second;
+                    if((data.GetKind() == BinOpKind::And || data.GetKind() == BinOpKind::Or) && !isSimple(second)) {
+                        const ASTNode::Expression& first = *data.GetOperands().first;
+                        prepare(first);
+                        line();
+                        m_out.Write(data.GetKind() == BinOpKind::And ? "if(" : "if(!");
+                        writeExpression(first);
+                        m_out.Write(") {\n");
+                        m_indent++;
+                        std::size_t mark = m_hoisted.size();
+                        emitDiscarded(second);
+                        m_hoisted.resize(mark);
+                        m_indent--;
+                        line();
+                        m_out.Write("}\n");
+                        return;
+                    }
+                }
+                prepare(expr);
+                // nothing to evaluate
+                if constexpr(std::is_same_v<Data, ASTNode::ExpressionName> || std::is_same_v<Data, ASTNode::ExpressionLiteral>)
+                    return;
+                if(findHoisted(expr) || m_transpiler.m_compValues.contains(&expr))
+                    return;
+                line();
+                if constexpr(!std::is_same_v<Data, ASTNode::ExpressionFunctionCall>)
+                    m_out.Write("(void)");
+                writeExpression(expr);
+                m_out.Write(";\n");
+            }
+        }, expr.Get());
+    }
+
+    void Transpiler::Emitter::emitBlock(const ASTNode::ExpressionBlock& block, const Destination& dest, TypeId type) {
+        std::uint32_t id = m_nextLabel++;
+        line();
+        m_out.Write("{\n");
+        m_indent++;
+        m_targets.push_back(Target{&block.GetLabel(), false, type, dest, id});
+        // statements after a break or continue are never run
+        std::span<const ASTNode::Statement> statements = block.GetStatements();
+        auto end = std::find_if(statements.begin(), statements.end(), [](const ASTNode::Statement& stmt) {
+            return std::holds_alternative<ASTNode::StatementBreak>(stmt.Get()) || std::holds_alternative<ASTNode::StatementContinue>(stmt.Get());
+        });
+        if(end != statements.end())
+            statements = statements.first(std::size_t(end - statements.begin()) + 1);
+        if(!statements.empty())
+            m_targets.back().last = &statements.back();
+        for(const ASTNode::Statement& stmt : statements)
+            emitStatement(stmt);
+        bool isBroken = m_targets.back().isBroken;
+        m_targets.pop_back();
+        m_indent--;
+        line();
+        m_out.Write("}\n");
+        if(isBroken) {
+            line();
+            writeLabel('l', id);
+            m_out.Write(":;\n");
+        }
+    }
+
+    // An else if is written on the line of its else, its condition is simple. Only the branch a constant condition takes is written
+    void Transpiler::Emitter::emitIf(const ASTNode::ExpressionIf& ifExpr, const Destination& dest, TypeId type, bool isElseIf) {
+        const ASTNode::Expression& condition = *ifExpr.GetCondition();
+        if(std::optional<bool> isTaken = getConstantCondition(condition)) {
+            const ASTNode::Statement * stmt = isTaken.value() ? ifExpr.GetSuccessStatement().get()
+                : ifExpr.GetFailStatement() ? ifExpr.GetFailStatement().value().get() : nullptr;
+            if(!stmt && !isElseIf)
+                return;
+            // a block has braces of its own
+            auto stmtExpr = stmt ? std::get_if<ASTNode::StatementExpression>(&stmt->Get()) : nullptr;
+            if(!isElseIf && stmtExpr && std::holds_alternative<ASTNode::ExpressionBlock>(stmtExpr->Get())) {
+                emitStatementValue(*stmt, dest, type);
+                return;
+            }
+            if(!isElseIf)
+                line();
+            m_out.Write("{\n");
+            m_indent++;
+            if(stmt)
+                emitStatementValue(*stmt, dest, type);
+            m_indent--;
+            line();
+            m_out.Write("}\n");
+            return;
+        }
+        if(!isElseIf) {
+            prepare(condition);
+            line();
+        }
+        m_out.Write("if(");
+        writeExpression(condition);
+        m_out.Write(") {\n");
+        m_indent++;
+        emitStatementValue(*ifExpr.GetSuccessStatement(), dest, type);
+        m_indent--;
+
+        if(ifExpr.GetFailStatement()) {
+            const ASTNode::Statement& failStmt = *ifExpr.GetFailStatement().value();
+            auto failExpr = std::get_if<ASTNode::StatementExpression>(&failStmt.Get());
+            auto failIf = failExpr ? std::get_if<ASTNode::ExpressionIf>(&failExpr->Get()) : nullptr;
+            if(failIf && isSimple(*failIf->GetCondition()) && (dest.kind == Destination::Kind::None || !isSimpleIf(*failIf, type))) {
+                line();
+                m_out.Write("} else ");
+                emitIf(*failIf, dest, type, true);
+                return;
+            }
+            line();
+            m_out.Write("} else {\n");
+            m_indent++;
+            emitStatementValue(failStmt, dest, type);
+            m_indent--;
+        }
+        line();
+        m_out.Write("}\n");
+    }
+
+    // The condition is checked at the top of an endless loop, a continue jumps to the post statement.
+    // A constant condition is not checked, a loop whose condition is false only runs its init statement
+    // A condition and a step that need no statements of their own are written in the for, the
+    // bound of a counted loop that is an operation is computed once before it
+    void Transpiler::Emitter::emitLoop(const ASTNode::ExpressionLoop& loop, const Destination& dest, TypeId type) {
+        std::uint32_t id = m_nextLabel++;
+        const ASTNode::Expression * condition = loop.GetCondition() ? loop.GetCondition().value().get() : nullptr;
+        const ASTNode::Statement * post = loop.GetPostStatement() ? loop.GetPostStatement().value().get() : nullptr;
+        std::optional<bool> isRun = condition ? getConstantCondition(*condition) : std::nullopt;
+        bool isInFor = condition && !isRun && isSimple(*condition);
+        bool isStepInFor = post && isStep(*post);
+        auto it = m_transpiler.m_countedLoops.find(&loop);
+        const CountedLoop * counted = it != m_transpiler.m_countedLoops.end() && isInFor ? &it->second : nullptr;
+        bool isHoisted = counted && !m_transpiler.m_compValues.contains(counted->bound) && !m_transpiler.m_forwards.contains(counted->bound) && (
+            std::holds_alternative<ASTNode::ExpressionBinaryOperation>(counted->bound->Get()) ||
+            std::holds_alternative<ASTNode::ExpressionUnaryOperation>(counted->bound->Get())
+        );
+        auto boundType = counted ? getType(*counted->bound) : std::nullopt;
+        isHoisted = isHoisted && boundType && !m_transpiler.isVoid(boundType.value());
+
+        bool hasScope = loop.GetInitStatement().has_value() || isHoisted;
+        if(hasScope) {
+            line();
+            m_out.Write("{\n");
+            m_indent++;
+            if(loop.GetInitStatement())
+                emitStatement(*loop.GetInitStatement().value());
+        }
+        if(isRun == false) {
+            if(hasScope) {
+                m_indent--;
+                line();
+                m_out.Write("}\n");
+            }
+            return;
+        }
+        std::size_t mark = m_hoisted.size();
+        if(isHoisted) {
+            std::uint32_t temp = m_nextTemp++;
+            line();
+            writeType(boundType.value());
+            m_out.Write(' ');
+            writeTemporary(temp);
+            m_out.Write(" = ");
+            writeExpression(*counted->bound);
+            m_out.Write(";\n");
+            m_hoisted.push_back(Hoisted{counted->bound, temp});
+        }
+        line();
+        m_out.Write("for(;");
+        if(isInFor) {
+            m_out.Write(' ');
+            writeExpression(*condition);
+        }
+        m_out.Write(';');
+        if(isStepInFor) {
+            m_out.Write(' ');
+            writeStep(*post);
+        }
+        m_out.Write(") {\n");
+        m_hoisted.resize(mark);
+        m_indent++;
+        if(condition && !isRun && !isInFor) {
+            prepare(*condition);
+            line();
+            m_out.Write("if(!");
+            writeExpression(*condition);
+            m_out.Write(") break;\n");
+            m_hoisted.resize(mark);
+        }
+
+        m_targets.push_back(Target{nullptr, true, type, dest, id});
+        emitStatement(*loop.GetBodyStatement());
+        if(m_targets.back().isContinued) {
+            line();
+            writeLabel('c', id);
+            m_out.Write(":;\n");
+        }
+        if(post && !isStepInFor)
+            emitStatement(*post);
+        bool isBroken = m_targets.back().isBroken;
+        m_targets.pop_back();
+
+        m_indent--;
+        line();
+        m_out.Write("}\n");
+        if(hasScope) {
+            m_indent--;
+            line();
+            m_out.Write("}\n");
+        }
+        if(isBroken) {
+            line();
+            writeLabel('l', id);
+            m_out.Write(":;\n");
+        }
+    }
+
+    // Arguments are computed in source order into the parameters, then the defaults
+    void Transpiler::Emitter::emitInlined(const ASTNode::ExpressionFunctionCall& funcCall, const Destination& dest, TypeId type) {
+        const Function& callee = *getInlined(funcCall);
+        std::uint32_t unit = std::uint32_t(m_transpiler.m_functionIdxs.at(callee.decl->id) + 1);
+        const TypeInterner::TypeInfo& info = m_transpiler.m_types.Get(m_transpiler.getValueType(m_transpiler.m_typer.GetType(*callee.decl).value()));
+        std::span<const TypeInterner::Field> arguments = m_transpiler.m_types.GetFields(info.arguments);
+        std::uint32_t id = m_nextInlined++;
+
+        std::size_t fieldMark = matchFields(funcCall.GetParameters(), info.arguments, getCallDefaults(funcCall));
+        std::vector<FieldValue> fieldValues(m_fieldValues.begin() + std::ptrdiff_t(fieldMark), m_fieldValues.end());
+        m_fieldValues.resize(fieldMark);
+        std::vector<const FieldValue *> order;
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields())
+            for(const FieldValue& fieldValue : fieldValues)
+                if(!fieldValue.isDefault && fieldValue.value == field.GetValue().get())
+                    order.push_back(&fieldValue);
+        for(const FieldValue& fieldValue : fieldValues)
+            if(fieldValue.isDefault || !fieldValue.value)
+                order.push_back(&fieldValue);
+
+        std::size_t mark = m_hoisted.size();
+        line();
+        m_out.Write("{\n");
+        m_indent++;
+        for(const FieldValue * fieldValue : order) {
+            const TypeInterner::Field& argument = arguments[fieldValue->field];
+            if(m_transpiler.isVoid(argument.type)) {
+                if(fieldValue->value)
+                    emitDiscarded(*fieldValue->value);
+                continue;
+            }
+            if(fieldValue->value)
+                prepare(*fieldValue->value);
+            line();
+            if(m_transpiler.m_aliases.IsConst(*callee.decl, fieldValue->field)) {
+                writeType(m_transpiler.m_types.Get(m_transpiler.getValueType(argument.type)).pointee);
+                m_out.Write(" const *");
+            }
+            else
+                writeType(argument.type);
+            m_out.Write(' ');
+            m_out.Write(argument.name);
+            m_out.Write("_i");
+            m_out.WriteUInt(id);
+            m_out.Write(" = ");
+            if(fieldValue->value)
+                writeConverted(*fieldValue->value, argument.type);
+            else
+                m_transpiler.writeZero(m_out, argument.type);
+            m_out.Write(";\n");
+        }
+
+        // breaks and continues in the body do not leave it
+        std::vector<Target> targets;
+        std::swap(targets, m_targets);
+        m_inlined.push_back(Inlined{&callee, unit, id});
+        if(dest.kind == Destination::Kind::None || m_transpiler.isVoid(info.pointee))
+            emitDiscarded(*callee.body);
+        else
+            emitValue(*callee.body, dest, type);
+        m_inlined.pop_back();
+        std::swap(targets, m_targets);
+        m_hoisted.resize(mark);
+        m_indent--;
+        line();
+        m_out.Write("}\n");
+    }
+
+    // Only expression statements have a value
+    void Transpiler::Emitter::emitStatementValue(const ASTNode::Statement& stmt, const Destination& dest, TypeId type) {
+        auto expr = std::get_if<ASTNode::StatementExpression>(&stmt.Get());
+        if(!expr || dest.kind == Destination::Kind::None) {
+            emitStatement(stmt);
+            return;
+        }
+        std::size_t mark = m_hoisted.size();
+        emitValue(*expr, dest, type);
+        m_hoisted.resize(mark);
+    }
+
+    void Transpiler::Emitter::emitStatement(const ASTNode::Statement& stmt) {
+        const std::optional<SourcePosition>& srcPos = stmt.GetSourcePosition();
+        std::size_t mark = m_hoisted.size();
+
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                emitDiscarded(expr);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                const ASTNode::Expression::LValue& lvalue = binOp.GetOperands().first;
+                const ASTNode::Expression& value = binOp.GetOperands().second;
+                auto type = getLValueType(lvalue);
+                auto valueType = getType(value);
+                if(!type || !valueType)
+                    return;
+
+                BinOpKind kind = getCompoundKind(binOp.GetKind());
+                bool isShift = kind == BinOpKind::BitLShift || kind == BinOpKind::BitRShift;
+                // optionals in a niche are computed on in place
+                TypeId operandType = m_transpiler.getValueType(type.value());
+                bool isFlagged = m_transpiler.isFlagged(type.value());
+                TypeId placeType = m_transpiler.isWrapped(type.value()) && !isFlagged ? type.value() : operandType;
+
+                prepareLValue(lvalue);
+                prepare(value);
+                // other places are written once, through a pointer, lanes through one to their vector
+                bool isName = std::holds_alternative<ASTNode::ExpressionName>(lvalue);
+                const ASTNode::Expression * vector = nullptr;
+                std::optional<TypeId> vectorType;
+                std::uint32_t lane = 0;
+                if(auto operands = std::get_if<ASTNode::Expression::StructMemberAccess>(&lvalue)) {
+                    if(auto objectType = getType(*operands->first)) {
+                        if(auto lanes = getLanes(m_transpiler.getValueType(objectType.value()), *operands->second)) {
+                            vector = operands->first.get();
+                            vectorType = m_transpiler.getValueType(objectType.value());
+                            lane = lanes->front();
+                        }
+                    }
+                }
+                std::uint32_t temp = m_nextTemp++;
+                auto writePlace = [&]() {
+                    if(!isName) {
+                        m_out.Write("(*");
+                        writeTemporary(temp);
+                        m_out.Write(')');
+                        if(vector) {
+                            m_out.Write('[');
+                            m_out.WriteUInt(lane);
+                            m_out.Write(']');
+                        }
+                        return;
+                    }
+                    writeLValue(lvalue, srcPos);
+                    if(isFlagged)
+                        m_out.Write(".value");
+                };
+                if(vector) {
+                    line();
+                    writeType(vectorType.value());
+                    m_out.Write(" * ");
+                    writeTemporary(temp);
+                    m_out.Write(" = &");
+                    writeConverted(*vector, vectorType.value());
+                    m_out.Write(";\n");
+                }
+                else if(!isName) {
+                    line();
+                    writeType(placeType);
+                    m_out.Write(" * ");
+                    writeTemporary(temp);
+                    m_out.Write(" = &");
+                    writeLValue(lvalue, srcPos);
+                    if(isFlagged)
+                        m_out.Write(".value");
+                    m_out.Write(";\n");
+                }
+                bool isSafe = m_transpiler.m_safeAssignments.contains(&stmt);
+                line();
+                writePlace();
+                m_out.Write(" = ");
+                writeBinaryPart(kind, operandType, Part::Begin, isSafe);
+                writePlace();
+                writeBinaryPart(kind, operandType, Part::Middle, isSafe);
+                writeConverted(value, isShift ? m_transpiler.getValueType(valueType.value()) : operandType);
+                writeBinaryPart(kind, operandType, Part::End, isSafe);
+                m_out.Write(";\n");
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                const Declaration * decl = m_transpiler.m_analyzer.GetDeclaration(stmt);
+                // functions are hoisted
+                if(!decl || getFunctionDefinition(*decl))
+                    return;
+                auto type = m_transpiler.m_typer.GetType(*decl);
+                if(!type)
+                    return;
+                if(!m_transpiler.isSupported(type.value())) {
+                    error(std::format("Type {} is not supported in C, its repetitions are not constant", m_transpiler.m_types.StringifyPretty(type.value())), srcPos);
+                    return;
+                }
+
+                // struct literals take the defaults of the declared type
+                const ASTNode::Expression * value = nullptr;
+                const ASTNode::TypeStruct * defaults = nullptr;
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        if(!typedVarDef.GetValue())
+                            return;
+                        value = &typedVarDef.GetValue().value();
+                        defaults = std::get_if<ASTNode::TypeStruct>(&typedVarDef.GetType().Get());
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        value = &untypedVarDef.GetValue();
+                    }
+                }, varDef);
+
+                bool isGlobal = m_transpiler.m_owners[decl->id] == GLOBAL;
+                // locals only read as constants are not defined
+                if(m_transpiler.isVoid(type.value()) || m_transpiler.m_isElided[decl->id]) {
+                    if(value)
+                        emitDiscarded(*value);
+                    return;
+                }
+                // globals are zero until their definition runs
+                if(isGlobal && !value)
+                    return;
+                // blocks, loops and ifs write the variable from their breaks
+                if(value && isEmittedInto(*value)) {
+                    if(!isGlobal) {
+                        line();
+                        writeDefinedType(*decl, type.value());
+                        m_out.Write(' ');
+                        writeDeclarationName(*decl, srcPos);
+                        m_out.Write(";\n");
+                    }
+                    emitValue(*value, Destination{Destination::Kind::Variable, 0, decl, nullptr, srcPos}, type.value());
+                    return;
+                }
+                if(value)
+                    prepare(*value, defaults);
+                line();
+                if(!isGlobal) {
+                    writeDefinedType(*decl, type.value());
+                    m_out.Write(' ');
+                }
+                writeDeclarationName(*decl, srcPos);
+                m_out.Write(" = ");
+                if(value)
+                    writeConverted(*value, type.value(), defaults);
+                else
+                    m_transpiler.writeZero(m_out, type.value());
+                m_out.Write(";\n");
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                const ASTNode::Expression& value = assign.GetRValue();
+                auto type = getLValueType(assign.GetLValue());
+                if(!type)
+                    return;
+                if(m_transpiler.isVoid(type.value())) {
+                    emitDiscarded(value);
+                    return;
+                }
+                // the place is only written by the breaks, once the value is complete
+                if(isDirectPlace(assign.GetLValue()) && isEmittedInto(value)) {
+                    emitValue(value, Destination{Destination::Kind::Place, 0, nullptr, &assign.GetLValue(), srcPos}, type.value());
+                    return;
+                }
+                prepareLValue(assign.GetLValue());
+                prepare(value);
+                line();
+                writeLValue(assign.GetLValue(), srcPos);
+                m_out.Write(" = ");
+                writeConverted(value, type.value());
+                m_out.Write(";\n");
+            },
+            [&](const ASTNode::StatementContinue&) {
+                for(auto it = m_targets.rbegin(); it != m_targets.rend(); it++) {
+                    if(it->isLoop) {
+                        it->isContinued = true;
+                        line();
+                        m_out.Write("goto ");
+                        writeLabel('c', it->id);
+                        m_out.Write(";\n");
+                        return;
+                    }
+                }
+                error("Continue outside of a loop", srcPos);
+            },
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                // a labelled break leaves its block, otherwise the innermost loop, or block if there is none
+                std::size_t targetIdx = m_targets.size();
+                for(std::size_t idx = m_targets.size(); idx-- > 0;) {
+                    const Target& target = m_targets[idx];
+                    if(stmtBreak.GetLabel() ? target.label && *target.label == stmtBreak.GetLabel() : target.isLoop) {
+                        targetIdx = idx;
+                        break;
+                    }
+                }
+                if(targetIdx == m_targets.size() && !stmtBreak.GetLabel() && !m_targets.empty())
+                    targetIdx = m_targets.size() - 1;
+                if(targetIdx == m_targets.size())
+                    return; // reported by the analyzer and the typer
+
+                Target target = m_targets[targetIdx];
+                if(stmtBreak.GetValue()) {
+                    const ASTNode::Expression& value = stmtBreak.GetValue().value();
+                    if(target.value.kind != Destination::Kind::None) {
+                        prepare(value);
+                        emitAssignment(target.value, value, target.type);
+                        if(target.value.kind == Destination::Kind::Return)
+                            return;
+                    }
+                    else
+                        emitDiscarded(value);
+                }
+                if(targetIdx == m_targets.size() - 1 && target.last == &stmt)
+                    return;
+                m_targets[targetIdx].isBroken = true;
+                line();
+                m_out.Write("goto ");
+                writeLabel('l', target.id);
+                m_out.Write(";\n");
+            }
+        }, stmt.Get());
+
+        m_hoisted.resize(mark);
+    }
+
+    /*
+     *
+     * Transpiler
+     *
+     */
+
+    Transpiler::Transpiler(
+        const Infos& infos, const Analyzer& analyzer, const Typer& typer, TypeInterner& types, const Ctee& ctee,
+        bool isNaNBoxing, std::uint32_t inlineThreshold, const PassManager& passes
+    ):
+        m_infos(infos),
+        m_analyzer(analyzer),
+        m_typer(typer),
+        m_types(types),
+        m_ctee(ctee),
+        m_aliases(analyzer, typer, types),
+        m_inliner(analyzer, typer, types),
+        m_passes(passes),
+        m_isNaNBoxing(isNaNBoxing),
+        m_inlineThreshold(inlineThreshold)
+    {}
+
+    const Infos& Transpiler::GetInfos() const {
+        return m_infos;
+    }
+
+    bool Transpiler::Transpile(const ASTNode& ast, CodeWriter& out, std::size_t numThreads) {
+        std::size_t numInfos = m_infos.Get().size();
+
+        nameTypes();
+        m_aliases.Analyze(ast);
+        m_functions.clear();
+        m_globals.clear();
+        m_main.reset();
+        m_owners.assign(m_analyzer.GetDeclarationCount(), 0);
+        if(const ASTNode::ExpressionBlock * block = getTopLevelBlock(ast)) {
+            for(const ASTNode::Statement& stmt : block->GetStatements())
+                collectStatement(stmt, 0, true);
+        }
+        else if(auto stmt = std::get_if<ASTNode::Statement>(&ast.Get()))
+            collectStatement(*stmt, 0, true);
+        else if(auto expr = std::get_if<ASTNode::Expression>(&ast.Get()))
+            collectExpression(*expr, 0);
+        m_functionIdxs.clear();
+        for(std::size_t idx = 0; idx < m_functions.size(); idx++) {
+            m_functionIdxs[m_functions[idx].decl->id] = idx;
+            chooseConvention(m_functions[idx]);
+        }
+        m_inliner.Analyze(ast, m_aliases, m_inlineThreshold, m_main ? m_functions[m_main.value()].decl : nullptr);
+        for(Function& function : m_functions)
+            function.isRemoved = m_inliner.IsRemoved(*function.decl);
+        m_compValues.clear();
+        for(const Ctee::Result& result : m_ctee.GetResults())
+            if(result.value)
+                m_compValues[result.expr] = &result.value.value();
+
+        // the IR of each function, and the error of the pass that breaks it
+        m_irs.assign(m_functions.size(), {});
+        m_simplified.assign(m_functions.size(), {});
+        std::vector<std::optional<std::string>> irErrors(m_functions.size());
+        runParallel(numThreads, m_functions.size(), [&](std::size_t idx) {
+            Trace::Scope traceScope("lower-ir", m_infos.GetId());
+            const Function& function = m_functions[idx];
+            IRBuilder builder(m_analyzer, m_typer, m_types, m_aliases, m_compValues);
+            m_irs[idx] = builder.Build(*function.decl, *function.type, *function.body);
+            irErrors[idx] = m_passes.Run(m_irs[idx]);
+            if(!irErrors[idx]) {
+                collectSimplified(idx);
+                collectCountedLoops(idx);
+            }
+        });
+        for(std::size_t idx = 0; idx < m_functions.size(); idx++)
+            if(irErrors[idx])
+                m_infos.Push(Infos::Info(Infos::Info::Level::ERROR, std::format("Invalid IR of {} {}", m_functions[idx].decl->name, irErrors[idx].value())));
+
+        // what the passes fold is written like comp expressions
+        m_forwards.clear();
+        m_safe.clear();
+        m_safeAssignments.clear();
+        m_countedLoops.clear();
+        for(const Simplified& simplified : m_simplified) {
+            for(const auto& [expr, value] : simplified.constants)
+                m_compValues[expr] = &value;
+            for(const auto& [expr, operand] : simplified.forwards)
+                m_forwards[expr] = operand;
+            m_safe.insert(simplified.safe.begin(), simplified.safe.end());
+            m_safeAssignments.insert(simplified.safeAssignments.begin(), simplified.safeAssignments.end());
+            m_countedLoops.insert(simplified.loops.begin(), simplified.loops.end());
+        }
+        m_isElided.assign(m_analyzer.GetDeclarationCount(), false);
+        for(const IR::Function& function : m_irs)
+            for(const IR::Variable& variable : function.variables)
+                m_isElided[variable.decl] = !variable.isAssigned && std::all_of(variable.reads.begin(), variable.reads.end(), [&](const ASTNode::Expression * read) {
+                    return m_compValues.contains(read);
+                });
+        // counters defined by the loop, whose values all fit the int they are widened to
+        m_isWidened.assign(m_analyzer.GetDeclarationCount(), false);
+        for(const auto& [loop, counted] : m_countedLoops) {
+            const Declaration * decl = loop->GetInitStatement() ? m_analyzer.GetDeclaration(*loop->GetInitStatement().value()) : nullptr;
+            std::optional<TypeId> type = decl && decl->id == counted.counter ? m_typer.GetType(*decl) : std::nullopt;
+            if(!type)
+                continue;
+            const TypeInterner::TypeInfo& info = m_types.Get(getValueType(type.value()));
+            std::optional<Scalar> scalar = getScalar(type.value());
+            m_isWidened[decl->id] = scalar && info.primitive != Primitive::Char && !scalar->isFloat && scalar->width > 1 && scalar->width < 32;
+        }
+
+        // the top level, then the functions, each written on its own
+        std::size_t numUnits = m_functions.size() + 1;
+        std::vector<CodeWriter> units(numUnits);
+        std::vector<std::vector<Infos::Info>> infos(numUnits);
+        std::vector<std::vector<TypeId>> divisions(numUnits);
+        std::vector<std::vector<TypeId>> shifts(numUnits);
+        auto run = [&](std::size_t idx) {
+            Trace::Scope traceScope("transpile-unit", m_infos.GetId());
+            Emitter emitter(*this, units[idx]);
+            if(idx == 0)
+                emitter.EmitInit(ast);
+            else
+                emitter.EmitFunction(idx - 1);
+            infos[idx] = emitter.GetInfos();
+            divisions[idx] = emitter.GetDivisions();
+            shifts[idx] = emitter.GetShifts();
+        };
+
+        runParallel(numThreads, numUnits, run);
+
+        // the prelude follows the units, it defines the helpers they use
+        m_divisions.clear();
+        std::unordered_set<std::string> suffixes;
+        for(const std::vector<TypeId>& types : divisions)
+            for(TypeId type : types)
+                if(suffixes.insert(getIntegerSuffix(getScalar(type).value())).second)
+                    m_divisions.push_back(type);
+        m_shifts.clear();
+        suffixes.clear();
+        for(const std::vector<TypeId>& types : shifts)
+            for(TypeId type : types)
+                if(suffixes.insert(getIntegerSuffix(getScalar(type).value())).second)
+                    m_shifts.push_back(type);
+        writePrelude(out);
+
+        // concatenated in source order, so the output does not depend on the scheduling
+        for(std::size_t idx = 0; idx < numUnits; idx++) {
+            out.Write(units[idx].GetText());
+            for(const Infos::Info& info : infos[idx])
+                m_infos.Push(info);
+        }
+        writeMain(out);
+        return m_infos.Get().size() == numInfos;
+    }
+
+    std::size_t Transpiler::GetFunctionCount() const {
+        return m_functions.size();
+    }
+
+    std::size_t Transpiler::GetInlinedCount() const {
+        return m_inliner.GetInlinedCount();
+    }
+
+    std::size_t Transpiler::GetIRInstructionCount() const {
+        std::size_t count = 0;
+        for(const IR::Function& function : m_irs)
+            for(const IR::Block& block : function.blocks)
+                count += block.code.size();
+        return count;
+    }
+
+    std::size_t Transpiler::GetIRBlockCount() const {
+        std::size_t count = 0;
+        for(const IR::Function& function : m_irs)
+            for(IR::BlockId block = 0; block < function.blocks.size(); block++)
+                count += !IR::IsRemoved(function, block);
+        return count;
+    }
+
+    std::string Transpiler::StringifyLayouts() const {
+        // C types have no attributes, they are written as the first source type laid out like them, whose fields keep theirs
+        std::vector<std::optional<TypeId>> sourceTypes(m_isDefined.size());
+        for(TypeId type = 0; type < m_cTypes.size(); type++) {
+            TypeId cType = m_cTypes[type];
+            const TypeInterner::Attribs& attribs = m_types.Get(type).attribs;
+            if(!sourceTypes[cType] && !attribs.isMutable
+                && attribs.isOrdered == m_isOrdered[m_valueTypes[cType]] && attribs.isSoA == m_isSoA[m_valueTypes[cType]])
+                sourceTypes[cType] = type;
+        }
+
+        std::string str = std::format("{:<12} {:>8} {:>8} {:>8} {:>9}  {}\n", "struct", "size", "align", "padding", "declared", "type");
+        for(TypeId type = 0; type < m_isDefined.size(); type++) {
+            if(!m_isDefined[type] || (!isWrapped(type) && m_types.Get(type).kind != TypeKind::Struct) || isVoid(type))
+                continue;
+            const Layout& layout = m_layouts[type];
+            str += std::format(
+                "{:<12} {:>8} {:>8} {:>8} {:>9}  {}\n",
+                m_typeNames[type], layout.size, layout.align, layout.padding, layout.declaredSize,
+                m_types.StringifyPretty(sourceTypes[type].value_or(type))
+            );
+        }
+        return str;
+    }
+
+    std::string Transpiler::StringifyInlining() const {
+        return m_inliner.StringifyDecisions();
+    }
+
+    std::string Transpiler::StringifyIR() const {
+        std::string str;
+        for(const IR::Function& function : m_irs)
+            str += IR::Stringify(function, m_analyzer);
+        return str;
+    }
+
+    // The program is a block, as an expression or an expression statement
+    const ASTNode::ExpressionBlock * Transpiler::getTopLevelBlock(const ASTNode& ast) {
+        const ASTNode::Expression * expr = std::get_if<ASTNode::Expression>(&ast.Get());
+        if(auto stmt = std::get_if<ASTNode::Statement>(&ast.Get()))
+            expr = std::get_if<ASTNode::StatementExpression>(&stmt->Get());
+        return expr ? std::get_if<ASTNode::ExpressionBlock>(&expr->Get()) : nullptr;
+    }
+
+    const ASTNode::StatementTypedVariableDefinition * Transpiler::getFunctionDefinition(const Declaration& decl) {
+        if(decl.kind != Declaration::Kind::Variable)
+            return nullptr;
+        auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get());
+        if(!varDef)
+            return nullptr;
+        auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef);
+        if(!typedVarDef || !typedVarDef->GetValue() || !std::holds_alternative<ASTNode::TypeFunction>(typedVarDef->GetType().Get()))
+            return nullptr;
+        return typedVarDef;
+    }
+
+    /*
+     *
+     * C types
+     *
+     */
+
+    // Canonical types, and the value types of optionals, are named after the types they are made of
+    void Transpiler::nameTypes() {
+        m_cTypes.clear();
+        // the lanes of a vector are values of its element type, which is named too
+        for(TypeId type = 0; type < m_types.Size(); type++) {
+            const TypeInterner::TypeInfo& info = m_types.Get(type);
+            if(info.kind == TypeKind::Primitive)
+                if(auto shape = ASTNode::GetVectorShape(info.primitive))
+                    m_types.InternPrimitive(shape->element, {});
+        }
+        // the value of an optional is its C type without the optional attribute
+        auto unwrap = [this](TypeId cType) {
+            Attribs attribs = m_types.Get(cType).attribs;
+            attribs.isOptional = false;
+            return m_types.WithAttribs(cType, attribs);
+        };
+        for(TypeId type = 0; type < m_types.Size(); type++)
+            unwrap(canonicalize(type));
+        m_cTypes.resize(m_types.Size());
+        m_valueTypes.resize(m_types.Size());
+        for(TypeId type = 0; type < m_types.Size(); type++)
+            m_valueTypes[type] = unwrap(m_cTypes[type]);
+        m_elementTypes.assign(m_types.Size(), 0);
+        for(TypeId type = 0; type < m_types.Size(); type++) {
+            const TypeInterner::TypeInfo& info = m_types.Get(type);
+            if(info.kind == TypeKind::Primitive)
+                if(auto shape = ASTNode::GetVectorShape(info.primitive))
+                    m_elementTypes[type] = m_types.InternPrimitive(shape->element, {});
+        }
+
+        m_typeNames.assign(m_types.Size(), {});
+        m_isVoid.assign(m_types.Size(), false);
+        m_isSupported.assign(m_types.Size(), true);
+        m_isOrdered.assign(m_types.Size(), false);
+        m_isSoA.assign(m_types.Size(), false);
+        m_isDefined.assign(m_types.Size(), false);
+        m_layouts.assign(m_types.Size(), {});
+        m_niches.assign(m_types.Size(), {});
+        m_fieldOrders.assign(m_types.Size(), {});
+        // a struct is laid out in declaration order, or transposed, if any of its source types asks for it
+        for(TypeId type = 0; type < m_types.Size(); type++) {
+            const TypeInterner::TypeInfo& info = m_types.Get(type);
+            if(info.kind == TypeKind::Struct && info.attribs.isOrdered)
+                m_isOrdered[m_valueTypes[type]] = true;
+            if(info.kind == TypeKind::Struct && info.attribs.isSoA)
+                m_isSoA[m_valueTypes[type]] = true;
+        }
+        for(TypeId type = 0; type < m_types.Size(); type++)
+            if(m_cTypes[type] == type)
+                nameType(type);
+    }
+
+    // Names the C type and lays it out like the C compiler does on LP64 targets
+    void Transpiler::nameType(TypeId type) {
+        if(!m_typeNames[type].empty())
+            return;
+        TypeInterner::TypeInfo info = m_types.Get(type);
+
+        // the value in a niche of it, or followed by its flag
+        if(isWrapped(type)) {
+            TypeId valueType = m_valueTypes[type];
+            nameType(valueType);
+            m_typeNames[type] = std::format("ry_o{}", type);
+            m_isSupported[type] = m_isSupported[valueType];
+            const TypeInterner::TypeInfo& valueInfo = m_types.Get(valueType);
+            if(valueInfo.kind == TypeKind::Primitive && valueInfo.primitive == Primitive::Bool) {
+                m_niches[type] = Niche{Niche::Kind::Byte, "", 2};
+                m_layouts[type] = Layout{1, 1, 0, 1};
+                return;
+            }
+            bool isFloat = valueInfo.kind == TypeKind::Primitive && (valueInfo.primitive == Primitive::F32 || valueInfo.primitive == Primitive::F64);
+            if(isFloat && m_isNaNBoxing) {
+                m_niches[type] = Niche{Niche::Kind::NaN, "", 0};
+                m_layouts[type] = m_layouts[valueType];
+                return;
+            }
+            if(valueInfo.kind == TypeKind::Struct && !m_isVoid[valueType]) {
+                if(auto niche = findNiche(valueType)) {
+                    m_niches[type] = niche.value();
+                    m_layouts[type] = m_layouts[valueType];
+                    return;
+                }
+            }
+            Layout value = m_isVoid[valueType] ? Layout{} : m_layouts[valueType];
+            std::uint64_t size = (value.size + 1 + value.align - 1) / value.align * value.align;
+            m_layouts[type] = Layout{size, value.align, size - value.size - 1, size};
+            return;
+        }
+
+        switch(info.kind) {
+            case TypeKind::Primitive: {
+                // vectors are aligned to their size, like GCC does
+                if(auto shape = ASTNode::GetVectorShape(info.primitive)) {
+                    Scalar element = getPrimitiveScalar(shape->element).value();
+                    std::uint64_t size = element.width / 8 * shape->numLanes;
+                    m_typeNames[type] = std::format("ry_{}{}x{}", element.isFloat ? 'f' : element.isSigned ? 'i' : 'u', unsigned(element.width), shape->numLanes);
+                    m_layouts[type] = Layout{size, size, 0, size};
+                    return;
+                }
+                std::uint64_t size = 1;
+                switch(info.primitive) {
+                    case Primitive::Char: m_typeNames[type] = "unsigned char"; break;
+                    case Primitive::I8:   m_typeNames[type] = "int8_t"; break;
+                    case Primitive::I16:  m_typeNames[type] = "int16_t"; size = 2; break;
+                    case Primitive::I32:  m_typeNames[type] = "int32_t"; size = 4; break;
+                    case Primitive::I64:  m_typeNames[type] = "int64_t"; size = 8; break;
+                    case Primitive::I128: m_typeNames[type] = "__int128"; size = 16; break;
+                    case Primitive::U8:   m_typeNames[type] = "uint8_t"; break;
+                    case Primitive::U16:  m_typeNames[type] = "uint16_t"; size = 2; break;
+                    case Primitive::U32:  m_typeNames[type] = "uint32_t"; size = 4; break;
+                    case Primitive::U64:  m_typeNames[type] = "uint64_t"; size = 8; break;
+                    case Primitive::U128: m_typeNames[type] = "unsigned __int128"; size = 16; break;
+                    case Primitive::F32:  m_typeNames[type] = "float"; size = 4; break;
+                    case Primitive::F64:  m_typeNames[type] = "double"; size = 8; break;
+                    case Primitive::Bool: m_typeNames[type] = "bool"; break;
+                    default: break;
+                }
+                m_layouts[type] = Layout{size, size, 0, size};
+                return;
+            }
+            case TypeKind::Pointer:
+                nameType(info.pointee);
+                m_typeNames[type] = m_typeNames[info.pointee] + " *";
+                m_isSupported[type] = m_isSupported[info.pointee];
+                m_layouts[type] = Layout{8, 8, 0, 8};
+                return;
+            case TypeKind::Struct: {
+                std::span<const TypeInterner::Field> fields = m_types.GetFields(type);
+                std::vector<std::uint32_t>& order = m_fieldOrders[type];
+                for(std::uint32_t i = 0; i < fields.size(); i++) {
+                    nameType(fields[i].type);
+                    m_isSupported[type] = m_isSupported[type] && m_isSupported[fields[i].type] && fields[i].reps != TypeInterner::Field::UNKNOWN_REPS;
+                    if(!m_isVoid[fields[i].type] && fields[i].reps != TypeInterner::Field::UNKNOWN_REPS)
+                        order.push_back(i);
+                }
+                m_isVoid[type] = order.empty();
+                m_typeNames[type] = order.empty() ? "void" : std::format("ry_s{}", type);
+
+                // a transposed field is its arrays, in the order of the fields of its struct
+                std::vector<Layout> fieldLayouts(fields.size());
+                for(std::uint32_t i : order) {
+                    const Layout& field = m_layouts[fields[i].type];
+                    if(!isTransposed(type, i)) {
+                        fieldLayouts[i] = Layout{field.size * fields[i].reps, field.align, 0, 0};
+                        continue;
+                    }
+                    std::span<const TypeInterner::Field> elementFields = m_types.GetFields(fields[i].type);
+                    Layout& columns = fieldLayouts[i];
+                    for(std::uint32_t j : m_fieldOrders[fields[i].type]) {
+                        const Layout& column = m_layouts[elementFields[j].type];
+                        std::uint64_t start = (columns.size + column.align - 1) / column.align * column.align;
+                        columns.padding += start - columns.size;
+                        columns.size = start + column.size * elementFields[j].reps * fields[i].reps;
+                        columns.align = std::max(columns.align, column.align);
+                    }
+                }
+
+                // fields placed by decreasing alignment leave no gaps between them, only at the end
+                auto layOut = [&](std::span<const std::uint32_t> order) {
+                    Layout layout;
+                    std::uint64_t fieldsSize = 0;
+                    for(std::uint32_t fieldIdx : order) {
+                        const Layout& field = fieldLayouts[fieldIdx];
+                        layout.size = (layout.size + field.align - 1) / field.align * field.align + field.size;
+                        layout.align = std::max(layout.align, field.align);
+                        fieldsSize += field.size - field.padding;
+                    }
+                    layout.size = (layout.size + layout.align - 1) / layout.align * layout.align;
+                    layout.padding = layout.size - fieldsSize;
+                    return layout;
+                };
+                Layout declared = layOut(order);
+                if(!m_isOrdered[type])
+                    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+                        return fieldLayouts[a].align > fieldLayouts[b].align;
+                    });
+                m_layouts[type] = layOut(order);
+                m_layouts[type].declaredSize = declared.size;
+                return;
+            }
+            case TypeKind::Function:
+                nameType(info.arguments);
+                nameType(info.pointee);
+                m_typeNames[type] = std::format("ry_f{}", type);
+                m_isSupported[type] = m_isSupported[info.arguments] && m_isSupported[info.pointee];
+                m_layouts[type] = Layout{8, 8, 0, 8};
+                return;
+        }
+    }
+
+    // Same type with mutability removed everywhere, pointers and functions are never wrapped.
+    // The layout attributes stay, an ordered or transposed struct is a C type of its own.
+    TypeId Transpiler::canonicalize(TypeId type) {
+        if(type < m_cTypes.size() && m_cTypes[type] != TypeId(-1))
+            return m_cTypes[type];
+
+        TypeInterner::TypeInfo info = m_types.Get(type);
+        Attribs attribs = {false, info.attribs.isOptional, info.attribs.isOrdered, info.attribs.isSoA};
+        TypeId cType = type;
+        switch(info.kind) {
+            case TypeKind::Primitive:
+                cType = m_types.InternPrimitive(info.primitive, attribs);
+                break;
+            case TypeKind::Pointer:
+                cType = m_types.InternPointer(canonicalize(info.pointee));
+                break;
+            case TypeKind::Function: {
+                TypeId arguments = canonicalize(info.arguments);
+                cType = m_types.InternFunction(arguments, canonicalize(info.pointee));
+                break;
+            }
+            case TypeKind::Struct: {
+                std::span<const TypeInterner::Field> typeFields = m_types.GetFields(type);
+                std::vector<TypeInterner::Field> fields(typeFields.begin(), typeFields.end());
+                for(TypeInterner::Field& field : fields)
+                    field.type = canonicalize(field.type);
+                cType = m_types.InternStruct(fields, attribs);
+                break;
+            }
+        }
+        if(m_cTypes.size() < m_types.Size())
+            m_cTypes.resize(m_types.Size(), TypeId(-1));
+        m_cTypes[type] = cType;
+        m_cTypes[cType] = cType;
+        return cType;
+    }
+
+    TypeId Transpiler::getCType(TypeId type) const {
+        return m_cTypes[type];
+    }
+
+    TypeId Transpiler::getValueType(TypeId type) const {
+        return m_valueTypes[type];
+    }
+
+    const std::string& Transpiler::getTypeName(TypeId type) const {
+        return m_typeNames[m_cTypes[type]];
+    }
+
+    bool Transpiler::isVoid(TypeId type) const {
+        return m_isVoid[m_cTypes[type]];
+    }
+
+    bool Transpiler::isWrapped(TypeId type) const {
+        return m_cTypes[type] != m_valueTypes[type];
+    }
+
+    bool Transpiler::isFlagged(TypeId type) const {
+        return isWrapped(type) && getNiche(type).kind == Niche::Kind::Flag;
+    }
+
+    const Transpiler::Niche& Transpiler::getNiche(TypeId type) const {
+        return m_niches[m_cTypes[type]];
+    }
+
+    // The flags of optionals only hold 0 and 1, and niches of optionals the values below theirs. Both are
+    // uint8_t, a bool field is no niche: C assumes it holds 0 or 1 and may read it as such.
+    std::optional<Transpiler::Niche> Transpiler::findNiche(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        if(isWrapped(type)) {
+            const Niche& niche = getNiche(type);
+            switch(niche.kind) {
+                case Niche::Kind::Flag:
+                    return Niche{Niche::Kind::Byte, ".isSet", 2};
+                case Niche::Kind::Byte:
+                    if(niche.value == UINT8_MAX)
+                        return {};
+                    return Niche{Niche::Kind::Byte, niche.path, std::uint8_t(niche.value + 1)};
+                case Niche::Kind::NaN:
+                    return {};
+            }
+        }
+        if(info.kind != TypeKind::Struct)
+            return {};
+        for(std::uint32_t i : m_fieldOrders[type]) {
+            const TypeInterner::Field& field = m_types.GetFields(type)[i];
+            if(isTransposed(type, i))
+                continue;
+            if(auto niche = findNiche(field.type)) {
+                CodeWriter path;
+                path.Write('.');
+                writeFieldName(path, type, i);
+                if(field.reps > 1)
+                    path.Write("[0]");
+                path.Write(niche->path);
+                niche->path = path.GetText();
+                return niche;
+            }
+        }
+        return {};
+    }
+
+    bool Transpiler::isSupported(TypeId type) const {
+        return m_isSupported[m_cTypes[type]];
+    }
+
+    bool Transpiler::isTransposed(TypeId type, std::size_t fieldIdx) const {
+        const TypeInterner::Field& field = m_types.GetFields(type)[fieldIdx];
+        return m_isSoA[type] && field.reps > 1 && field.reps != TypeInterner::Field::UNKNOWN_REPS
+            && !isWrapped(field.type) && m_types.Get(field.type).kind == TypeKind::Struct && !isVoid(field.type);
+    }
+
+    std::optional<Transpiler::Scalar> Transpiler::getScalar(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(m_valueTypes[type]);
+        if(info.kind != TypeKind::Primitive)
+            return {};
+        return getPrimitiveScalar(info.primitive);
+    }
+
+    std::optional<ASTNode::VectorShape> Transpiler::getVectorShape(TypeId type) const {
+        const TypeInterner::TypeInfo& info = m_types.Get(m_valueTypes[type]);
+        if(info.kind != TypeKind::Primitive)
+            return {};
+        return ASTNode::GetVectorShape(info.primitive);
+    }
+
+    // Vectors are not scalars
+    std::optional<Transpiler::Scalar> Transpiler::getPrimitiveScalar(Primitive primitive) {
+        switch(primitive) {
+            case Primitive::Char: return Scalar{8, false, false};
+            case Primitive::I8:   return Scalar{8, true, false};
+            case Primitive::I16:  return Scalar{16, true, false};
+            case Primitive::I32:  return Scalar{32, true, false};
+            case Primitive::I64:  return Scalar{64, true, false};
+            case Primitive::I128: return Scalar{128, true, false};
+            case Primitive::U8:   return Scalar{8, false, false};
+            case Primitive::U16:  return Scalar{16, false, false};
+            case Primitive::U32:  return Scalar{32, false, false};
+            case Primitive::U64:  return Scalar{64, false, false};
+            case Primitive::U128: return Scalar{128, false, false};
+            case Primitive::F32:  return Scalar{32, false, true};
+            case Primitive::F64:  return Scalar{64, false, true};
+            case Primitive::Bool: return Scalar{1, false, false};
+            default:              return {};
+        }
+    }
+
+    std::string Transpiler::getIntegerSuffix(const Scalar& scalar) {
+        return std::format("{}{}", scalar.isSigned ? 'i' : 'u', unsigned(scalar.width));
+    }
+
+    /*
+     *
+     * AST walk
+     *
+     */
+
+    void Transpiler::collectExpression(const ASTNode::Expression& expr, std::uint32_t unit) {
+        std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) {
+                if(!literal.Get())
+                    return;
+                if(auto structLit = std::get_if<ASTNode::ExpressionLiteral::Struct>(&literal.Get().value()))
+                    for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit->GetFields())
+                        collectExpression(*field.GetValue(), unit);
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) {
+                collectExpression(*funcCall.GetFunction(), unit);
+                for(const ASTNode::ExpressionLiteral::Struct::Field& field : funcCall.GetParameters().GetFields())
+                    collectExpression(*field.GetValue(), unit);
+            },
+            [&](const ASTNode::ExpressionBlock& block) {
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    collectStatement(stmt, unit, false);
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) {
+                collectExpression(*ifExpr.GetCondition(), unit);
+                collectStatement(*ifExpr.GetSuccessStatement(), unit, false);
+                if(ifExpr.GetFailStatement())
+                    collectStatement(*ifExpr.GetFailStatement().value(), unit, false);
+            },
+            [&](const ASTNode::ExpressionLoop& loop) {
+                if(loop.GetInitStatement())
+                    collectStatement(*loop.GetInitStatement().value(), unit, false);
+                if(loop.GetCondition())
+                    collectExpression(*loop.GetCondition().value(), unit);
+                if(loop.GetPostStatement())
+                    collectStatement(*loop.GetPostStatement().value(), unit, false);
+                collectStatement(*loop.GetBodyStatement(), unit, false);
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) {
+                collectExpression(*unaryOp.GetOperand(), unit);
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) {
+                collectExpression(*binOp.GetOperands().first, unit);
+                collectExpression(*binOp.GetOperands().second, unit);
+            },
+            [&](const ASTNode::ExpressionName&) {}
+        }, expr.Get());
+    }
+
+    void Transpiler::collectStatement(const ASTNode::Statement& stmt, std::uint32_t unit, bool isTopLevel) {
+        auto collectLValue = [&](const ASTNode::Expression::LValue& lvalue) {
+            std::visit(overloaded{
+                [&](const ASTNode::ExpressionName&) {},
+                [&](const ASTNode::Expression::PointerDereference& operand) {
+                    collectExpression(*operand, unit);
+                },
+                [&](const ASTNode::Expression::StructMemberAccess& operands) {
+                    collectExpression(*operands.first, unit);
+                }
+            }, lvalue);
+        };
+
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                collectExpression(expr, unit);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                collectLValue(binOp.GetOperands().first);
+                collectExpression(binOp.GetOperands().second, unit);
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                const Declaration * decl = m_analyzer.GetDeclaration(stmt);
+                if(decl) {
+                    // a function's body is its own unit
+                    if(const ASTNode::StatementTypedVariableDefinition * definition = getFunctionDefinition(*decl)) {
+                        if(isTopLevel && decl->name == "main")
+                            m_main = m_functions.size();
+                        m_owners[decl->id] = FUNCTION;
+                        m_functions.push_back(Function{
+                            decl, &std::get<ASTNode::TypeFunction>(definition->GetType().Get()), &definition->GetValue().value()
+                        });
+                        collectExpression(definition->GetValue().value(), std::uint32_t(m_functions.size()));
+                        return;
+                    }
+                    m_owners[decl->id] = isTopLevel ? GLOBAL : unit;
+                    if(isTopLevel)
+                        m_globals.push_back(decl);
+                }
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        if(typedVarDef.GetValue())
+                            collectExpression(typedVarDef.GetValue().value(), unit);
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        collectExpression(untypedVarDef.GetValue(), unit);
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                collectLValue(assign.GetLValue());
+                collectExpression(assign.GetRValue(), unit);
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                if(stmtBreak.GetValue())
+                    collectExpression(stmtBreak.GetValue().value(), unit);
+            }
+        }, stmt.Get());
+    }
+
+    /*
+     *
+     * Calling convention
+     *
+     */
+
+    // Functions used as values, and main, keep the signature of their type
+    void Transpiler::chooseConvention(Function& function) {
+        auto type = m_typer.GetType(*function.decl);
+        if(!type || !isSupported(type.value()))
+            return;
+        const TypeInterner::TypeInfo& info = m_types.Get(getValueType(type.value()));
+        std::span<const TypeInterner::Field> fields = m_types.GetFields(info.arguments);
+        function.passings.assign(fields.size(), Passing::Value);
+        if(!m_aliases.IsCalledOnly(*function.decl) || (m_main && function.decl == m_functions[m_main.value()].decl))
+            return;
+
+        auto isLarge = [&](TypeId type) {
+            TypeId cType = getCType(type);
+            bool isStruct = m_types.Get(cType).kind == TypeKind::Struct || isFlagged(cType);
+            return isStruct && !isVoid(cType) && m_layouts[cType].size > MAX_REGISTERS_SIZE;
+        };
+        std::size_t argumentIdx = 0;
+        for(std::size_t i = 0; i < fields.size(); argumentIdx += fields[i].reps, i++) {
+            if(fields[i].reps != 1 || fields[i].name.empty())
+                continue;
+            if(isSplit(getCType(fields[i].type)))
+                function.passings[i] = Passing::Fields;
+            else if(isLarge(fields[i].type) && m_aliases.IsReadOnly(*function.decl, argumentIdx))
+                function.passings[i] = Passing::Pointer;
+        }
+        function.isReturnedThrough = isLarge(info.pointee);
+    }
+
+    // A struct of a few scalars, that fit in registers one each
+    bool Transpiler::isSplit(TypeId type) const {
+        if(isWrapped(type) || m_types.Get(type).kind != TypeKind::Struct || isVoid(type) || m_fieldOrders[type].size() > MAX_SPLIT_FIELDS)
+            return false;
+        for(std::uint32_t fieldIdx : m_fieldOrders[type]) {
+            const TypeInterner::Field& field = m_types.GetFields(type)[fieldIdx];
+            TypeId fieldType = getCType(field.type);
+            TypeKind kind = m_types.Get(fieldType).kind;
+            if(field.reps != 1 || isFlagged(fieldType) || (kind != TypeKind::Primitive && kind != TypeKind::Pointer && kind != TypeKind::Function))
+                return false;
+        }
+        return true;
+    }
+
+    const Transpiler::Function * Transpiler::getFunction(const Declaration& decl) const {
+        auto it = m_functionIdxs.find(decl.id);
+        return it == m_functionIdxs.end() ? nullptr : &m_functions[it->second];
+    }
+
+    // Literals are written as they are, the other operand of a forwarded operation is not written
+    void Transpiler::collectSimplified(std::size_t functionIdx) {
+        const IR::Function& function = m_irs[functionIdx];
+        Simplified& simplified = m_simplified[functionIdx];
+        simplified = Simplified();
+        auto getValue = [&](const ASTNode::Expression& expr) {
+            auto it = function.values.find(&expr);
+            return it == function.values.end() ? IR::NONE : IR::Resolve(function, it->second);
+        };
+
+        for(const auto& [expr, exprValue] : function.values) {
+            if(function.effects.contains(expr) || m_compValues.contains(expr) || std::holds_alternative<ASTNode::ExpressionLiteral>(expr->Get()))
+                continue;
+            IR::Value value = IR::Resolve(function, exprValue);
+            const IR::Instruction& instruction = function.instructions[value];
+            if(instruction.op == IR::Op::Const) {
+                if(std::optional<TypeId> type = m_typer.GetType(*expr))
+                    simplified.constants.emplace_back(expr, Ctee::Value{type.value(), {instruction.imm}});
+                continue;
+            }
+
+            auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&expr->Get());
+            if(!binOp || instruction.op == IR::Op::Nop || instruction.scalar.width == 0)
+                continue;
+            bool isShift = false;
+            switch(binOp->GetKind()) {
+                case BinOpKind::BitLShift:
+                case BinOpKind::BitRShift:
+                    isShift = true;
+                    break;
+                case BinOpKind::Add:
+                case BinOpKind::Sub:
+                case BinOpKind::Mul:
+                case BinOpKind::Div:
+                case BinOpKind::Mod:
+                case BinOpKind::BitOr:
+                case BinOpKind::BitXor:
+                case BinOpKind::BitAnd:
+                    break;
+                default:
+                    continue;
+            }
+            const ASTNode::Expression& first = *binOp->GetOperands().first;
+            const ASTNode::Expression& second = *binOp->GetOperands().second;
+            if(getValue(first) == value && !function.effects.contains(&second))
+                simplified.forwards.emplace_back(expr, &first);
+            else if(!isShift && getValue(second) == value && !function.effects.contains(&first))
+                simplified.forwards.emplace_back(expr, &second);
+        }
+
+        // the operation lowered for the AST is still there, multiplications, divisions and remainders may have become shifts and masks
+        auto isSafe = [&](IR::Value value, IR::Op op) {
+            const IR::Instruction& instruction = function.instructions[value];
+            return instruction.isSafe && (instruction.op == op
+                || (op == IR::Op::Mul && instruction.op == IR::Op::Shl)
+                || (op == IR::Op::Div && instruction.op == IR::Op::Shr)
+                || (op == IR::Op::Mod && instruction.op == IR::Op::And));
+        };
+        for(const auto& [expr, value] : function.values) {
+            IR::Op op = IR::Op::Nop;
+            if(auto binOp = std::get_if<ASTNode::ExpressionBinaryOperation>(&expr->Get())) {
+                switch(binOp->GetKind()) {
+                    case BinOpKind::Add:       op = IR::Op::Add; break;
+                    case BinOpKind::Sub:       op = IR::Op::Sub; break;
+                    case BinOpKind::Mul:       op = IR::Op::Mul; break;
+                    case BinOpKind::Div:       op = IR::Op::Div; break;
+                    case BinOpKind::Mod:       op = IR::Op::Mod; break;
+                    case BinOpKind::BitLShift: op = IR::Op::Shl; break;
+                    case BinOpKind::BitRShift: op = IR::Op::Shr; break;
+                    default: break;
+                }
+            }
+            else if(auto unaryOp = std::get_if<ASTNode::ExpressionUnaryOperation>(&expr->Get()))
+                op = unaryOp->GetKind() == UnOpKind::ArithmeticNegation ? IR::Op::Neg : IR::Op::Nop;
+            if(op != IR::Op::Nop && isSafe(value, op))
+                simplified.safe.push_back(expr);
+        }
+        using StmtBinOpKind = ASTNode::StatementBinaryOperation::Kind;
+        for(const auto& [stmt, value] : function.assignments) {
+            IR::Op op = IR::Op::Nop;
+            switch(std::get<ASTNode::StatementBinaryOperation>(stmt->Get()).GetKind()) {
+                case StmtBinOpKind::AddEq:       op = IR::Op::Add; break;
+                case StmtBinOpKind::SubEq:       op = IR::Op::Sub; break;
+                case StmtBinOpKind::MulEq:       op = IR::Op::Mul; break;
+                case StmtBinOpKind::DivEq:       op = IR::Op::Div; break;
+                case StmtBinOpKind::ModEq:       op = IR::Op::Mod; break;
+                case StmtBinOpKind::BitLShiftEq: op = IR::Op::Shl; break;
+                case StmtBinOpKind::BitRShiftEq: op = IR::Op::Shr; break;
+                default: break;
+            }
+            if(op != IR::Op::Nop && isSafe(value, op))
+                simplified.safeAssignments.push_back(stmt);
+        }
+    }
+
+    /*
+     *
+     * Output
+     *
+     */
+
+    // Unnamed fields are named by their index, named ones that C reserves get a '_' appended
+    void Transpiler::writeFieldName(CodeWriter& out, TypeId type, std::size_t fieldIdx) const {
+        std::string_view name = m_types.GetFields(type)[fieldIdx].name;
+        if(name.empty()) {
+            out.Write('_');
+            out.WriteUInt(fieldIdx);
+            return;
+        }
+        out.Write(name);
+        if(name.front() == '_' || std::find(std::begin(RESERVED_NAMES), std::end(RESERVED_NAMES), name) != std::end(RESERVED_NAMES))
+            out.Write('_');
+    }
+
+    // The array of a field of a transposed field, e.g. _0_x
+    void Transpiler::writeColumnName(CodeWriter& out, TypeId type, std::size_t fieldIdx, std::size_t elementFieldIdx) const {
+        writeFieldName(out, type, fieldIdx);
+        out.Write('_');
+        writeFieldName(out, m_types.GetFields(type)[fieldIdx].type, elementFieldIdx);
+    }
+
+    void Transpiler::writeZero(CodeWriter& out, TypeId type) const {
+        TypeId cType = getCType(type);
+        if(isWrapped(cType)) {
+            writeNull(out, cType);
+            return;
+        }
+        switch(m_types.Get(cType).kind) {
+            case TypeKind::Primitive:
+                if(getVectorShape(cType)) {
+                    out.Write("((");
+                    out.Write(getTypeName(cType));
+                    out.Write("){ 0 })");
+                    return;
+                }
+                out.Write('0');
+                return;
+            case TypeKind::Pointer:
+            case TypeKind::Function:
+                out.Write("NULL");
+                return;
+            case TypeKind::Struct:
+                if(isVoid(cType)) {
+                    out.Write("((void)0)");
+                    return;
+                }
+                out.Write("((");
+                out.Write(getTypeName(cType));
+                out.Write("){ 0 })");
+                return;
+        }
+    }
+
+    // An optional without a value, pointers are NULL
+    void Transpiler::writeNull(CodeWriter& out, TypeId type) const {
+        const std::string& name = getTypeName(type);
+        if(isFlagged(type)) {
+            out.Write("((");
+            out.Write(name);
+            out.Write("){ .isSet = false })");
+            return;
+        }
+        out.Write("ry_null_");
+        out.Write(std::string_view(name).substr(3));
+        out.Write("()");
+    }
+
+    // The minimum divided by -1 wraps and leaves no remainder, dividing by zero fails like a compile-time evaluation does
+    void Transpiler::writeDivisionHelpers(CodeWriter& out, TypeId type) const {
+        const std::string& name = getTypeName(type);
+        Scalar scalar = getScalar(type).value();
+        std::string suffix = getIntegerSuffix(scalar);
+        std::string_view unsignedType = scalar.width <= 32 ? "uint32_t" : scalar.width <= 64 ? "uint64_t" : "unsigned __int128";
+        std::string_view check = "    if(b == 0) {\n        fputs(\"division by zero\\n\", stderr);\n        abort();\n    }\n";
+
+        out.Write(std::format("static inline {0} ry_div_{1}({0} a, {0} b) {{\n{2}", name, suffix, check));
+        if(scalar.isSigned)
+            out.Write(std::format("    return b == -1 ? ({0})(({1})0 - ({1})a) : ({0})(a / b);\n}}\n", name, unsignedType));
+        else
+            out.Write(std::format("    return ({0})(a / b);\n}}\n", name));
+        out.Write(std::format("static inline {0} ry_mod_{1}({0} a, {0} b) {{\n{2}", name, suffix, check));
+        if(scalar.isSigned)
+            out.Write(std::format("    return b == -1 ? 0 : ({0})(a % b);\n}}\n", name));
+        else
+            out.Write(std::format("    return ({0})(a % b);\n}}\n", name));
+    }
+
+    // Shifted at 64 bits, or 128 for 128-bit integers, an amount of at least that many fails like a compile-time evaluation does
+    void Transpiler::writeShiftHelpers(CodeWriter& out, TypeId type) const {
+        const std::string& name = getTypeName(type);
+        Scalar scalar = getScalar(type).value();
+        std::string suffix = getIntegerSuffix(scalar);
+        bool isWide = scalar.width > 64;
+        std::string_view unsignedType = isWide ? "unsigned __int128" : "uint64_t";
+        std::string_view signedType = isWide ? "__int128" : "int64_t";
+        std::string check = std::format(
+            "    if(b >= {}) {{\n        fputs(\"shift amount out of range\\n\", stderr);\n        abort();\n    }}\n", isWide ? 128 : 64
+        );
+
+        out.Write(std::format("static inline {0} ry_shl_{1}({0} a, {2} b) {{\n{3}", name, suffix, unsignedType, check));
+        out.Write(std::format("    return ({0})(({1})a << b);\n}}\n", name, unsignedType));
+        out.Write(std::format("static inline {0} ry_shr_{1}({0} a, {2} b) {{\n{3}", name, suffix, unsignedType, check));
+        out.Write(std::format("    return ({0})(({1})a >> b);\n}}\n", name, scalar.isSigned ? signedType : unsignedType));
+    }
+
+    // ry_set_ tells an optional in a niche has a value, ry_null_ makes one that has none
+    void Transpiler::writeNicheHelpers(CodeWriter& out, TypeId type) const {
+        std::string_view name = getTypeName(type);
+        std::string_view suffix = name.substr(3);
+        const Niche& niche = getNiche(type);
+        auto scalar = getScalar(type);
+        std::string_view floatType = scalar && scalar->width == 64 ? "double" : "float";
+        std::string_view bitsType = scalar && scalar->width == 64 ? "uint64_t" : "uint32_t";
+        // a quiet NaN with a payload that arithmetic on other values does not produce
+        std::string_view nan = scalar && scalar->width == 64 ? "0x7ff8000000000052u" : "0x7fc00052u";
+
+        out.Write(std::format("static inline bool ry_set_{}({} a) {{\n", suffix, name));
+        if(niche.kind == Niche::Kind::NaN)
+            out.Write(std::format("    union {{ {} f; {} u; }} b = {{ a }};\n    return b.u != {};\n}}\n\n", floatType, bitsType, nan));
+        else
+            out.Write(std::format("    return *(unsigned char *)&a{} != {};\n}}\n\n", niche.path, unsigned(niche.value)));
+
+        out.Write(std::format("static inline {} ry_null_{}(void) {{\n", name, suffix));
+        if(niche.kind == Niche::Kind::NaN)
+            out.Write(std::format("    union {{ {} u; {} f; }} b = {{ {} }};\n    return b.f;\n}}\n\n", bitsType, floatType, nan));
+        else
+            out.Write(std::format("    {} a = {{ 0 }};\n    *(unsigned char *)&a{} = {};\n    return a;\n}}\n\n", name, niche.path, unsigned(niche.value)));
+    }
+
+    void Transpiler::writeEqualsHelper(CodeWriter& out, TypeId type) {
+        const std::string& name = getTypeName(type);
+        out.Write("static inline bool ry_eq_");
+        out.Write(std::string_view(name).substr(3));
+        out.Write('(');
+        out.Write(name);
+        out.Write(" a, ");
+        out.Write(name);
+        out.Write(" b) {\n");
+
+        // compares two values of a field or payload
+        auto writeEquals = [&](TypeId fieldType, std::string_view first, std::string_view second) {
+            TypeId cType = getCType(fieldType);
+            if(isWrapped(cType) || m_types.Get(cType).kind == TypeKind::Struct || getVectorShape(cType)) {
+                out.Write("ry_eq_");
+                out.Write(std::string_view(getTypeName(cType)).substr(3));
+                out.Write('(');
+                out.Write(first);
+                out.Write(", ");
+                out.Write(second);
+                out.Write(')');
+            }
+            else {
+                out.Write(first);
+                out.Write(" == ");
+                out.Write(second);
+            }
+        };
+
+        if(isFlagged(type)) {
+            out.Write("    return a.isSet == b.isSet && (!a.isSet");
+            if(!isVoid(getValueType(type))) {
+                out.Write(" || ");
+                writeEquals(getValueType(type), "a.value", "b.value");
+            }
+            out.Write(");\n}\n\n");
+            return;
+        }
+        if(isWrapped(type)) {
+            std::string_view suffix = std::string_view(name).substr(3);
+            out.Write(std::format("    return ry_set_{}(a) == ry_set_{}(b) && (!ry_set_{}(a) || ", suffix, suffix, suffix));
+            writeEquals(getValueType(type), "a", "b");
+            out.Write(");\n}\n\n");
+            return;
+        }
+
+        if(auto shape = getVectorShape(type)) {
+            out.Write("    for(size_t i = 0; i < ");
+            out.WriteUInt(shape->numLanes);
+            out.Write("; i++)\n        if(!(");
+            writeEquals(m_elementTypes[type], "a[i]", "b[i]");
+            out.Write("))\n            return false;\n    return true;\n}\n\n");
+            return;
+        }
+
+        std::span<const TypeInterner::Field> fields = m_types.GetFields(type);
+        std::string first, second;
+        for(std::size_t i = 0; i < fields.size(); i++) {
+            if(fields[i].reps <= 1 || isVoid(fields[i].type))
+                continue;
+            if(isTransposed(type, i)) {
+                std::span<const TypeInterner::Field> elementFields = m_types.GetFields(fields[i].type);
+                for(std::uint32_t j : m_fieldOrders[fields[i].type]) {
+                    out.Write("    for(size_t i = 0; i < ");
+                    out.WriteUInt(fields[i].reps);
+                    out.Write("; i++)\n");
+                    CodeWriter column;
+                    writeColumnName(column, type, i, j);
+                    first = std::format("a.{}[i]", column.GetText());
+                    second = std::format("b.{}[i]", column.GetText());
+                    if(elementFields[j].reps > 1) {
+                        out.Write("        for(size_t j = 0; j < ");
+                        out.WriteUInt(elementFields[j].reps);
+                        out.Write("; j++)\n    ");
+                        first += "[j]";
+                        second += "[j]";
+                    }
+                    out.Write("        if(!(");
+                    writeEquals(elementFields[j].type, first, second);
+                    out.Write(elementFields[j].reps > 1 ? "))\n                return false;\n" : "))\n            return false;\n");
+                }
+                continue;
+            }
+            out.Write("    for(size_t i = 0; i < ");
+            out.WriteUInt(fields[i].reps);
+            out.Write("; i++)\n        if(!(");
+            CodeWriter field;
+            writeFieldName(field, type, i);
+            first = std::format("a.{}[i]", field.GetText());
+            second = std::format("b.{}[i]", field.GetText());
+            writeEquals(fields[i].type, first, second);
+            out.Write("))\n            return false;\n");
+        }
+        out.Write("    return ");
+        bool isFirst = true;
+        for(std::size_t i = 0; i < fields.size(); i++) {
+            if(fields[i].reps != 1 || isVoid(fields[i].type))
+                continue;
+            CodeWriter field;
+            writeFieldName(field, type, i);
+            first = std::format("a.{}", field.GetText());
+            second = std::format("b.{}", field.GetText());
+            if(!isFirst)
+                out.Write(" && ");
+            isFirst = false;
+            writeEquals(fields[i].type, first, second);
+        }
+        out.Write(isFirst ? "true;\n}\n\n" : ";\n}\n\n");
+    }
+
+    // The types it is made of are defined first
+    void Transpiler::writeTypeDefinition(CodeWriter& out, TypeId type) {
+        if(m_isDefined[type] || !m_isSupported[type])
+            return;
+        m_isDefined[type] = true;
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+
+        if(isWrapped(type) && !isFlagged(type)) {
+            writeTypeDefinition(out, getValueType(type));
+            writeNicheHelpers(out, type);
+            writeEqualsHelper(out, type);
+            return;
+        }
+        if(isWrapped(type)) {
+            TypeId valueType = getValueType(type);
+            writeTypeDefinition(out, valueType);
+            out.Write("struct ");
+            out.Write(getTypeName(type));
+            out.Write(" {\n");
+            if(!isVoid(valueType)) {
+                out.Write("    ");
+                out.Write(getTypeName(valueType));
+                out.Write(" value;\n");
+            }
+            out.Write("    uint8_t isSet;\n};\n\n");
+            writeEqualsHelper(out, type);
+            return;
+        }
+
+        switch(info.kind) {
+            case TypeKind::Primitive: {
+                auto shape = ASTNode::GetVectorShape(info.primitive);
+                if(!shape)
+                    return;
+                out.Write("typedef ");
+                out.Write(getTypeName(m_elementTypes[type]));
+                out.Write(' ');
+                out.Write(getTypeName(type));
+                out.Write(" __attribute__((vector_size(");
+                out.WriteUInt(m_layouts[type].size);
+                out.Write(")));\n\n");
+                writeEqualsHelper(out, type);
+                return;
+            }
+            case TypeKind::Pointer:
+                writeTypeDefinition(out, info.pointee);
+                return;
+            case TypeKind::Struct: {
+                if(isVoid(type))
+                    return;
+                std::span<const TypeInterner::Field> fields = m_types.GetFields(type);
+                for(const TypeInterner::Field& field : fields)
+                    writeTypeDefinition(out, field.type);
+                out.Write("struct ");
+                out.Write(getTypeName(type));
+                out.Write(" {\n");
+                for(std::uint32_t i : m_fieldOrders[type]) {
+                    if(isTransposed(type, i)) {
+                        std::span<const TypeInterner::Field> elementFields = m_types.GetFields(fields[i].type);
+                        for(std::uint32_t j : m_fieldOrders[fields[i].type]) {
+                            out.Write("    ");
+                            out.Write(getTypeName(elementFields[j].type));
+                            out.Write(' ');
+                            writeColumnName(out, type, i, j);
+                            out.Write('[');
+                            out.WriteUInt(fields[i].reps);
+                            out.Write(']');
+                            if(elementFields[j].reps > 1) {
+                                out.Write('[');
+                                out.WriteUInt(elementFields[j].reps);
+                                out.Write(']');
+                            }
+                            out.Write(";\n");
+                        }
+                        continue;
+                    }
+                    out.Write("    ");
+                    out.Write(getTypeName(fields[i].type));
+                    out.Write(' ');
+                    writeFieldName(out, type, i);
+                    if(fields[i].reps > 1) {
+                        out.Write('[');
+                        out.WriteUInt(fields[i].reps);
+                        out.Write(']');
+                    }
+                    out.Write(";\n");
+                }
+                out.Write("};\n\n");
+                writeEqualsHelper(out, type);
+                return;
+            }
+            case TypeKind::Function: {
+                std::span<const TypeInterner::Field> fields = m_types.GetFields(info.arguments);
+                for(const TypeInterner::Field& field : fields)
+                    writeTypeDefinition(out, field.type);
+                writeTypeDefinition(out, info.pointee);
+                out.Write("typedef ");
+                out.Write(getTypeName(info.pointee));
+                out.Write(" (*");
+                out.Write(getTypeName(type));
+                out.Write(")(");
+                bool isFirst = true;
+                for(const TypeInterner::Field& field : fields) {
+                    if(isVoid(field.type))
+                        continue;
+                    for(std::uint64_t rep = 0; rep < field.reps; rep++) {
+                        if(!isFirst)
+                            out.Write(", ");
+                        isFirst = false;
+                        out.Write(getTypeName(field.type));
+                    }
+                }
+                out.Write(isFirst ? "void);\n\n" : ");\n\n");
+                return;
+            }
+        }
+    }
+
+    // Arguments are passed one by one, repetitions expanded, named ones get _a appended, pointers
+    // are const and restrict where the alias analysis proves it, so the C compiler can keep what
+    // they point to in registers across writes through the others
+    // Structs passed as their fields have a parameter per field, e.g. p_a_f0, in layout order
+    void Transpiler::writeSignature(CodeWriter& out, const Function& function) const {
+        TypeId type = getValueType(m_typer.GetType(*function.decl).value());
+        const TypeInterner::TypeInfo& info = m_types.Get(type);
+        out.Write("static ");
+        out.Write(function.isReturnedThrough ? "void" : getTypeName(info.pointee));
+        out.Write(' ');
+        out.Write(function.decl->name);
+        out.Write('_');
+        out.WriteUInt(function.decl->id);
+        out.Write('(');
+        bool isFirst = true;
+        if(function.isReturnedThrough) {
+            out.Write(getTypeName(info.pointee));
+            out.Write(" * restrict _r");
+            isFirst = false;
+        }
+        std::span<const TypeInterner::Field> fields = m_types.GetFields(info.arguments);
+        std::size_t paramIdx = 0;
+        for(std::size_t i = 0; i < fields.size(); i++) {
+            const TypeInterner::Field& field = fields[i];
+            Passing passing = i < function.passings.size() ? function.passings[i] : Passing::Value;
+            for(std::uint64_t rep = 0; rep < field.reps; rep++, paramIdx++) {
+                if(isVoid(field.type))
+                    continue;
+                if(!isFirst)
+                    out.Write(", ");
+                isFirst = false;
+                if(passing == Passing::Fields) {
+                    TypeId cType = getCType(field.type);
+                    const std::vector<std::uint32_t>& order = m_fieldOrders[cType];
+                    for(std::size_t k = 0; k < order.size(); k++) {
+                        if(k > 0)
+                            out.Write(", ");
+                        out.Write(getTypeName(m_types.GetFields(cType)[order[k]].type));
+                        out.Write(' ');
+                        out.Write(field.name);
+                        out.Write("_a_f");
+                        out.WriteUInt(k);
+                    }
+                    continue;
+                }
+                if(passing == Passing::Pointer) {
+                    out.Write(getTypeName(field.type));
+                    out.Write(" const * restrict");
+                }
+                else if(m_aliases.IsConst(*function.decl, paramIdx)) {
+                    out.Write(getTypeName(m_types.Get(getValueType(field.type)).pointee));
+                    out.Write(" const *");
+                }
+                else
+                    out.Write(getTypeName(field.type));
+                if(passing == Passing::Value && m_aliases.IsRestrict(*function.decl, paramIdx))
+                    out.Write(" restrict");
+                out.Write(' ');
+                if(field.name.empty()) {
+                    out.Write('_');
+                    out.WriteUInt(paramIdx);
+                }
+                else {
+                    out.Write(field.name);
+                    out.Write("_a");
+                }
+            }
+        }
+        if(isFirst)
+            out.Write("void");
+        out.Write(')');
+    }
+
+    void Transpiler::writePrelude(CodeWriter& out) {
+        out.Write("// Generated by ry from ");
+        out.Write(m_infos.GetId());
+        out.Write("\n\n#include <math.h>\n#include <stdbool.h>\n#include <stddef.h>\n#include <stdint.h>\n");
+        if(!m_divisions.empty() || !m_shifts.empty())
+            out.Write("#include <stdio.h>\n#include <stdlib.h>\n");
+        out.Write('\n');
+
+        // structs may point to each other, optionals in a niche are their value
+        bool hasStructs = false;
+        for(TypeId type = 0; type < m_types.Size(); type++) {
+            if(m_cTypes[type] != type || !m_isSupported[type] || isVoid(type))
+                continue;
+            if(isWrapped(type) ? !isFlagged(type) : m_types.Get(type).kind != TypeKind::Struct)
+                continue;
+            out.Write("typedef struct ");
+            out.Write(getTypeName(type));
+            out.Write(' ');
+            out.Write(getTypeName(type));
+            out.Write(";\n");
+            hasStructs = true;
+        }
+        for(TypeId type = 0; type < m_types.Size(); type++) {
+            if(m_cTypes[type] != type || !m_isSupported[type] || !isWrapped(type) || isFlagged(type))
+                continue;
+            const TypeInterner::TypeInfo& valueInfo = m_types.Get(getValueType(type));
+            bool isBool = valueInfo.kind == TypeKind::Primitive && valueInfo.primitive == Primitive::Bool;
+            out.Write("typedef ");
+            out.Write(isBool ? "uint8_t" : getTypeName(getValueType(type)));
+            out.Write(' ');
+            out.Write(getTypeName(type));
+            out.Write(";\n");
+            hasStructs = true;
+        }
+        if(hasStructs)
+            out.Write('\n');
+        for(TypeId type = 0; type < m_types.Size(); type++)
+            if(m_cTypes[type] == type)
+                writeTypeDefinition(out, type);
+        for(TypeId type : m_divisions)
+            writeDivisionHelpers(out, type);
+        for(TypeId type : m_shifts)
+            writeShiftHelpers(out, type);
+        if(!m_divisions.empty() || !m_shifts.empty())
+            out.Write('\n');
+
+        bool hasGlobals = false;
+        for(const Declaration * decl : m_globals) {
+            auto type = m_typer.GetType(*decl);
+            if(!type || isVoid(type.value()) || !isSupported(type.value()))
+                continue;
+            out.Write("static ");
+            out.Write(getTypeName(type.value()));
+            out.Write(' ');
+            out.Write(decl->name);
+            out.Write('_');
+            out.WriteUInt(decl->id);
+            out.Write(";\n");
+            hasGlobals = true;
+        }
+        if(hasGlobals)
+            out.Write('\n');
+
+        for(const Function& function : m_functions) {
+            auto type = m_typer.GetType(*function.decl);
+            if(!type || !isSupported(type.value()) || function.isRemoved)
+                continue;
+            writeSignature(out, function);
+            out.Write(";\n");
+        }
+        if(!m_functions.empty())
+            out.Write('\n');
+    }
+
+    // Runs the top-level statements, then the program's main with zero arguments
+    void Transpiler::writeMain(CodeWriter& out) const {
+        out.Write("int main(void) {\n    ry_init();\n");
+        auto type = m_main ? m_typer.GetType(*m_functions[m_main.value()].decl) : std::nullopt;
+        if(type && isSupported(type.value())) {
+            const Function& function = m_functions[m_main.value()];
+            const TypeInterner::TypeInfo& info = m_types.Get(getValueType(type.value()));
+            auto scalar = getScalar(info.pointee);
+            bool isExitCode = scalar && !scalar->isFloat && scalar->width > 1 && !isWrapped(info.pointee);
+            out.Write(isExitCode ? "    return (int)" : "    ");
+            out.Write(function.decl->name);
+            out.Write('_');
+            out.WriteUInt(function.decl->id);
+            out.Write('(');
+            bool isFirst = true;
+            for(const TypeInterner::Field& field : m_types.GetFields(info.arguments)) {
+                if(isVoid(field.type))
+                    continue;
+                for(std::uint64_t rep = 0; rep < field.reps; rep++) {
+                    if(!isFirst)
+                        out.Write(", ");
+                    isFirst = false;
+                    writeZero(out, field.type);
+                }
+            }
+            out.Write(");\n");
+            if(isExitCode) {
+                out.Write("}\n");
+                return;
+            }
+        }
+        out.Write("    return 0;\n}\n");
+    }
+
+    // Tasks are taken in order by whichever thread is free, each writes only its own results
+    void Transpiler::runParallel(std::size_t numThreads, std::size_t numTasks, const std::function<void(std::size_t)>& task) {
+        std::size_t numWorkers = std::min(numThreads, numTasks);
+        if(numWorkers <= 1) {
+            for(std::size_t idx = 0; idx < numTasks; idx++)
+                task(idx);
+            return;
+        }
+        std::atomic<std::size_t> nextIdx = 0;
+        std::vector<std::thread> workers;
+        for(std::size_t i = 0; i < numWorkers; i++)
+            workers.emplace_back([&]() {
+                for(std::size_t idx; (idx = nextIdx++) < numTasks;)
+                    task(idx);
+            });
+        for(std::thread& worker : workers)
+            worker.join();
+    }
+
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "AliasAnalysis.hpp"
+#include "Analyzer.hpp"
+#include "CodeWriter.hpp"
+#include "Ctee.hpp"
+#include "IR.hpp"
+#include "Infos.hpp"
+#include "Inliner.hpp"
+#include "PassManager.hpp"
+#include "TypeInterner.hpp"
+#include "Typer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ry {
+
+    //
+    // C code generation.
+    //
+    // Walks the typed AST and streams C99 (with GCC's __int128 and vector extensions) into a
+    // CodeWriter, no text is built per node. Struct types become structs laid out by the backend,
+    // function types function pointers, and optionals that are not pointers their value with a flag
+    // or in a niche. Functions, nested ones included, are hoisted to the top level, the top-level
+    // statements run in ry_init before the program's main.
+    //
+    // Each function body is lowered to IR and run through the passes first, what they prove makes
+    // the C simpler. Expressions that C has no counterpart for (blocks, ifs and loops with a value)
+    // are written as statements whose breaks assign their value where it goes. Integer arithmetic
+    // wraps like at compile time, comp expressions are replaced by their values.
+    //
+    // The prelude declares every type, global and function, so the top-level statements and each
+    // function are generated independently on a pool of threads. The output does not depend on
+    // their number.
+    //
+    class Transpiler {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+
+        // NaN boxing makes one NaN of optional floats their null, calls are inlined up to a cost of the threshold
+        Transpiler(
+            const Infos& infos, const Analyzer& analyzer, const Typer& typer, TypeInterner& types, const Ctee& ctee,
+            bool isNaNBoxing = false, std::uint32_t inlineThreshold = Inliner::DEFAULT_THRESHOLD, const PassManager& passes = PassManager()
+        );
+
+        const Infos& GetInfos() const;
+
+        // false if the program can not be generated, the reason is reported
+        bool Transpile(const ASTNode& ast, CodeWriter& out, std::size_t numThreads = 1);
+
+        std::size_t GetFunctionCount() const;
+        std::size_t GetInlinedCount() const;
+        // Of the IR of the functions after the passes
+        std::size_t GetIRInstructionCount() const;
+        std::size_t GetIRBlockCount() const;
+        // Size and padding of the structs written by the last Transpile
+        std::string StringifyLayouts() const;
+        // Which calls the last Transpile inlined, and why the others are not
+        std::string StringifyInlining() const;
+        // The IR of each function after the passes, in source order
+        std::string StringifyIR() const;
+
+    private:
+        class Emitter;
+
+        static constexpr std::uint32_t GLOBAL = UINT32_MAX;       // owner of top-level definitions
+        static constexpr std::uint32_t FUNCTION = UINT32_MAX - 1; // owner of function definitions
+        static constexpr std::uint64_t MAX_REGISTERS_SIZE = 16;  // of an argument passed in registers
+        static constexpr std::size_t MAX_SPLIT_FIELDS = 4;       // of a struct passed as its fields
+
+        // How a function takes an argument
+        enum class Passing : std::uint8_t {
+            Value,
+            Fields,  // each field of the struct a parameter of its own
+            Pointer  // to the caller's value, which is only read
+        };
+
+        // A function definition, hoisted to the top level
+        struct Function {
+            const Declaration * decl;
+            const ASTNode::TypeFunction * type;
+            const ASTNode::Expression * body;
+            std::vector<Passing> passings = {}; // by field of its arguments
+            bool isReturnedThrough = false;     // the result is written through a pointer from the caller
+            bool isRemoved = false;             // every call of it is inlined, it is not written
+        };
+
+        struct Layout {
+            std::uint64_t size = 0;
+            std::uint64_t align = 1;
+            std::uint64_t padding = 0;      // bytes that are not part of a field
+            std::uint64_t declaredSize = 0; // with the fields in declaration order
+        };
+
+        // How an optional that is not a pointer tells it has no value
+        struct Niche {
+            enum class Kind : std::uint8_t {
+                Flag, // a flag after the value
+                Byte, // a byte of the value that it never has, e.g. 2 in a bool
+                NaN   // one NaN of a float, with --nan-boxing
+            };
+
+            Kind kind = Kind::Flag;
+            std::string path;       // Byte: of the byte in the value, e.g. ".b" or ".x.isSet", empty if it is the value
+            std::uint8_t value = 0; // Byte: when there is no value
+        };
+
+        struct Scalar {
+            std::uint8_t width;
+            bool isSigned;
+            bool isFloat;
+        };
+
+        // A loop whose condition compares a variable stepped by a constant to a bound that does not
+        // change in it, written as a for with the bound computed once
+        struct CountedLoop {
+            const ASTNode::Expression * bound;
+            std::uint32_t counter; // declaration id
+        };
+
+        // What the passes show of the expressions of a function
+        struct Simplified {
+            std::vector<std::pair<const ASTNode::Expression *, Ctee::Value>> constants;
+            std::vector<std::pair<const ASTNode::Expression *, const ASTNode::Expression *>> forwards; // the operand they equal
+            std::vector<const ASTNode::Expression *> safe;             // operations the range analysis proves do not overflow
+            std::vector<const ASTNode::Statement *> safeAssignments;   // compound assignments it proves do not
+            std::vector<std::pair<const ASTNode::ExpressionLoop *, CountedLoop>> loops;
+        };
+
+        static const ASTNode::ExpressionBlock * getTopLevelBlock(const ASTNode& ast);
+        static const ASTNode::StatementTypedVariableDefinition * getFunctionDefinition(const Declaration& decl);
+
+        // C types, mutability is ignored
+        void nameTypes();
+        void nameType(TypeId type);
+        TypeId canonicalize(TypeId type);
+        TypeId getCType(TypeId type) const;     // the type that names its C type
+        TypeId getValueType(TypeId type) const; // C type that is not optional
+        const std::string& getTypeName(TypeId type) const;
+        bool isVoid(TypeId type) const;         // no value, e.g. []
+        bool isWrapped(TypeId type) const;      // optional that is not a pointer
+        bool isFlagged(TypeId type) const;      // optional with a flag
+        const Niche& getNiche(TypeId type) const;
+        // A byte that values of the C type never have, to tell an optional of it has no value
+        std::optional<Niche> findNiche(TypeId type) const;
+        bool isSupported(TypeId type) const;
+        // A repeated struct field of a C struct type, written as one array per field of its struct.
+        // Only the layout changes, no access is rewritten to read the arrays.
+        bool isTransposed(TypeId type, std::size_t fieldIdx) const;
+        std::optional<Scalar> getScalar(TypeId type) const;
+        std::optional<ASTNode::VectorShape> getVectorShape(TypeId type) const;
+        static std::optional<Scalar> getPrimitiveScalar(ASTNode::TypePrimitive primitive);
+        // e.g. i32, u8, naming the helpers of an integer scalar
+        static std::string getIntegerSuffix(const Scalar& scalar);
+
+        // Units: 0 is the top level, the functions follow
+        void collectExpression(const ASTNode::Expression& expr, std::uint32_t unit);
+        void collectStatement(const ASTNode::Statement& stmt, std::uint32_t unit, bool isTopLevel);
+
+        // Small structs of scalars are passed as their fields, other structs that do not fit in registers by
+        // a pointer if the callee only reads them, results that do not fit through a pointer
+        void chooseConvention(Function& function);
+        bool isSplit(TypeId type) const;
+        const Function * getFunction(const Declaration& decl) const;
+        // Expressions without effects that the IR of the function computes to a constant or to one of their operands
+        void collectSimplified(std::size_t functionIdx);
+        void collectCountedLoops(std::size_t functionIdx);
+        // Defined before the loop of the header, or computed from such values
+        static bool isInvariant(const IR::Function& function, IR::Value value, IR::BlockId header);
+
+        void writeFieldName(CodeWriter& out, TypeId type, std::size_t fieldIdx) const;
+        void writeColumnName(CodeWriter& out, TypeId type, std::size_t fieldIdx, std::size_t elementFieldIdx) const;
+        void writeZero(CodeWriter& out, TypeId type) const;
+        void writeNull(CodeWriter& out, TypeId type) const;
+        void writeNicheHelpers(CodeWriter& out, TypeId type) const;
+        void writeDivisionHelpers(CodeWriter& out, TypeId type) const;
+        void writeShiftHelpers(CodeWriter& out, TypeId type) const;
+        void writeEqualsHelper(CodeWriter& out, TypeId type);
+        void writeTypeDefinition(CodeWriter& out, TypeId type);
+        void writeSignature(CodeWriter& out, const Function& function) const;
+        void writePrelude(CodeWriter& out);
+        void writeMain(CodeWriter& out) const;
+
+        // task(idx) for each idx below numTasks, on up to numThreads threads
+        static void runParallel(std::size_t numThreads, std::size_t numTasks, const std::function<void(std::size_t)>& task);
+
+        Infos m_infos;
+        const Analyzer& m_analyzer;
+        const Typer& m_typer;
+        TypeInterner& m_types;
+        const Ctee& m_ctee;
+        AliasAnalysis m_aliases;
+        Inliner m_inliner;
+        PassManager m_passes;
+        bool m_isNaNBoxing;
+        std::uint32_t m_inlineThreshold;
+
+        std::vector<TypeId> m_cTypes;          // by type
+        std::vector<TypeId> m_valueTypes;      // by type
+        std::vector<TypeId> m_elementTypes;    // by C vector type, the type of its lanes
+        std::vector<std::string> m_typeNames;  // by C type
+        std::vector<bool> m_isVoid;            // by C type
+        std::vector<bool> m_isSupported;       // by C type, false if a repetition is not a constant
+        std::vector<bool> m_isOrdered;         // by C type, fields in declaration order
+        std::vector<bool> m_isSoA;             // by C type, repeated struct fields transposed
+        std::vector<Layout> m_layouts;         // by C type
+        std::vector<Niche> m_niches;           // by C optional type
+        std::vector<std::vector<std::uint32_t>> m_fieldOrders; // by C struct type, non-void field indices in layout order
+        std::vector<bool> m_isDefined;         // by C type, written to the output
+
+        std::vector<Function> m_functions;                  // in source order
+        std::unordered_map<std::uint32_t, std::size_t> m_functionIdxs; // by declaration id
+        std::vector<const Declaration *> m_globals;         // in source order
+        std::vector<std::uint32_t> m_owners;                // by declaration id, unit of its definition
+        std::optional<std::size_t> m_main;                  // top-level function named main
+        std::unordered_map<const ASTNode::Expression *, const Ctee::Value *> m_compValues;
+        std::vector<IR::Function> m_irs;                    // by function
+        std::vector<Simplified> m_simplified;               // by function
+        std::unordered_map<const ASTNode::Expression *, const ASTNode::Expression *> m_forwards; // written as the operand they equal
+        std::vector<bool> m_isElided;                       // by declaration id, locals whose reads are all constants
+        std::unordered_set<const ASTNode::Expression *> m_safe;          // written as the plain C operation
+        std::unordered_set<const ASTNode::Statement *> m_safeAssignments;
+        std::unordered_map<const ASTNode::ExpressionLoop *, CountedLoop> m_countedLoops;
+        std::vector<bool> m_isWidened;                      // by declaration id, counters narrower than int defined as int
+        std::vector<TypeId> m_divisions;                    // integer types divided through the checked helpers, one of each scalar
+        std::vector<TypeId> m_shifts;                       // integer types shifted through the checked helpers, one of each scalar
+    };
+
+}
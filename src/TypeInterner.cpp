@@ -0,0 +1,223 @@
+#include "TypeInterner.hpp"
+#include "Hash.hpp"
+#include "ry.hpp"
+
+#include <variant>
+
+namespace ry {
+
+    using TypeId = TypeInterner::TypeId;
+    using Field = TypeInterner::Field;
+    using TypeInfo = TypeInterner::TypeInfo;
+
+    static constexpr std::size_t INITIAL_SLOTS = 64;
+
+    TypeInterner::TypeInterner():
+        m_slots(INITIAL_SLOTS, Slot{0, EMPTY_SLOT})
+    {}
+
+    TypeId TypeInterner::Intern(const ASTNode::Type& type) {
+        return std::visit(overloaded{
+            [&](ASTNode::TypePrimitive primitive) {
+                return InternPrimitive(primitive, type.GetAttribs());
+            },
+            [&](const ASTNode::TypePointer& pointer) {
+                return InternPointer(Intern(*pointer), type.GetAttribs());
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                TypeId arguments = Intern(function.GetArgumentsType());
+                return InternFunction(arguments, Intern(*function.GetReturnType()), type.GetAttribs());
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                return Intern(structType, type.GetAttribs());
+            }
+        }, type.Get());
+    }
+
+    TypeId TypeInterner::Intern(const ASTNode::TypeStruct& structType, const Attribs& attribs) {
+        // field types are interned first, so nested structs are done with the scratch space above ours
+        std::size_t mark = m_scratchFields.size();
+        for(const ASTNode::TypeStruct::Field& field : structType.GetFields()) {
+            std::visit(overloaded{
+                [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                    TypeId type = Intern(*namedField.GetType());
+                    for(std::string_view name : namedField.GetNames())
+                        m_scratchFields.push_back(Field{name, type});
+                },
+                [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                    TypeId type = Intern(*unnamedField.GetType());
+                    std::uint64_t reps = 1;
+                    if(unnamedField.GetTypeReps()) {
+                        reps = Field::UNKNOWN_REPS;
+                        const auto& constant = unnamedField.GetTypeReps().value()->GetConstant();
+                        if(constant)
+                            if(auto intValue = std::get_if<ASTNode::Constant::Int>(&constant->Get()); intValue && *intValue > 0)
+                                reps = std::uint64_t(*intValue);
+                    }
+                    m_scratchFields.push_back(Field{{}, type, reps});
+                }
+            }, field);
+        }
+
+        TypeId id = InternStruct(std::span(m_scratchFields).subspan(mark), attribs);
+        m_scratchFields.resize(mark);
+        return id;
+    }
+
+    TypeId TypeInterner::InternPrimitive(ASTNode::TypePrimitive primitive, const Attribs& attribs) {
+        return intern(TypeInfo{.kind = Kind::Primitive, .attribs = attribs, .primitive = primitive}, {});
+    }
+
+    TypeId TypeInterner::InternPointer(TypeId pointee, const Attribs& attribs) {
+        return intern(TypeInfo{.kind = Kind::Pointer, .attribs = attribs, .pointee = pointee}, {});
+    }
+
+    TypeId TypeInterner::InternStruct(std::span<const Field> fields, const Attribs& attribs) {
+        return intern(TypeInfo{.kind = Kind::Struct, .attribs = attribs, .numFields = std::uint32_t(fields.size())}, fields);
+    }
+
+    TypeId TypeInterner::InternFunction(TypeId arguments, TypeId returnType, const Attribs& attribs) {
+        return intern(TypeInfo{.kind = Kind::Function, .attribs = attribs, .pointee = returnType, .arguments = arguments}, {});
+    }
+
+    TypeId TypeInterner::WithAttribs(TypeId id, const Attribs& attribs) {
+        TypeInfo info = m_types[id];
+        if(info.attribs.isMutable == attribs.isMutable && info.attribs.isOptional == attribs.isOptional && info.attribs.isOrdered == attribs.isOrdered && info.attribs.isSoA == attribs.isSoA)
+            return id;
+        info.attribs = attribs;
+        return intern(info, GetFields(id));
+    }
+
+    const TypeInfo& TypeInterner::Get(TypeId id) const {
+        return m_types[id];
+    }
+
+    std::span<const Field> TypeInterner::GetFields(TypeId id) const {
+        const TypeInfo& info = m_types[id];
+        return std::span(m_fields).subspan(info.firstField, info.numFields);
+    }
+
+    std::size_t TypeInterner::Size() const {
+        return m_types.size();
+    }
+
+    std::string TypeInterner::StringifyPretty(TypeId id) const {
+        const TypeInfo& info = m_types[id];
+
+        std::string str;
+        if(info.attribs.isMutable)
+            str += '~';
+        if(info.attribs.isOptional)
+            str += '?';
+        if(info.attribs.isOrdered)
+            str += '!';
+        if(info.attribs.isSoA)
+            str += '^';
+
+        auto stringifyFields = [&](TypeId structId) {
+            std::string str = "[";
+            std::span<const Field> fields = GetFields(structId);
+            for(std::size_t i = 0; i < fields.size(); i++) {
+                if(!fields[i].name.empty()) {
+                    str += fields[i].name;
+                    str += ' ';
+                }
+                str += StringifyPretty(fields[i].type);
+                if(fields[i].reps == Field::UNKNOWN_REPS)
+                    str += " * ?";
+                else if(fields[i].reps != 1)
+                    str += " * " + std::to_string(fields[i].reps);
+                if(i != fields.size() - 1)
+                    str += "; ";
+            }
+            return str + ']';
+        };
+
+        switch(info.kind) {
+            case Kind::Primitive: return str + ASTNode::Type::StringifyPrimitiveType(info.primitive);
+            case Kind::Pointer:   return str + "*" + StringifyPretty(info.pointee);
+            case Kind::Struct:    return str + stringifyFields(id);
+            case Kind::Function:  return str + stringifyFields(info.arguments) + " => " + StringifyPretty(info.pointee);
+        }
+        return str;
+    }
+
+    std::uint64_t TypeInterner::hash(const TypeInfo& info, std::span<const Field> fields) {
+        std::uint64_t header =
+            std::uint64_t(info.kind)
+            | std::uint64_t(info.attribs.isMutable) << 8
+            | std::uint64_t(info.attribs.isOptional) << 9
+            | std::uint64_t(info.attribs.isOrdered) << 10
+            | std::uint64_t(info.attribs.isSoA) << 11
+            | std::uint64_t(info.primitive) << 16;
+        std::uint64_t hash = Hash::Combine(header, std::uint64_t(info.pointee) << 32 | info.arguments);
+        for(const Field& field : fields) {
+            hash = Hash::Combine(hash, Hash::Compute(field.name));
+            hash = Hash::Combine(hash, std::uint64_t(field.type) << 32 ^ field.reps);
+        }
+        return hash;
+    }
+
+    bool TypeInterner::equals(TypeId id, const TypeInfo& info, std::span<const Field> fields) const {
+        const TypeInfo& other = m_types[id];
+        if(other.kind != info.kind
+            || other.attribs.isMutable != info.attribs.isMutable
+            || other.attribs.isOptional != info.attribs.isOptional
+            || other.attribs.isOrdered != info.attribs.isOrdered
+            || other.attribs.isSoA != info.attribs.isSoA
+            || other.primitive != info.primitive
+            || other.pointee != info.pointee
+            || other.arguments != info.arguments
+            || other.numFields != fields.size())
+            return false;
+        std::span<const Field> otherFields = GetFields(id);
+        for(std::size_t i = 0; i < fields.size(); i++)
+            if(otherFields[i].name != fields[i].name
+                || otherFields[i].type != fields[i].type
+                || otherFields[i].reps != fields[i].reps)
+                return false;
+        return true;
+    }
+
+    TypeId TypeInterner::intern(TypeInfo info, std::span<const Field> fields) {
+        std::uint64_t typeHash = hash(info, fields);
+        std::size_t mask = m_slots.size() - 1;
+        for(std::size_t idx = typeHash & mask;; idx = (idx + 1) & mask) {
+            Slot& slot = m_slots[idx];
+            if(slot.id == EMPTY_SLOT) {
+                // the fields may be those of an interned type (WithAttribs), copy before growing m_fields
+                std::vector<Field> ownFields;
+                if(!fields.empty() && fields.data() >= m_fields.data() && fields.data() < m_fields.data() + m_fields.size()) {
+                    ownFields.assign(fields.begin(), fields.end());
+                    fields = ownFields;
+                }
+                info.firstField = std::uint32_t(m_fields.size());
+                info.numFields = std::uint32_t(fields.size());
+                m_fields.insert(m_fields.end(), fields.begin(), fields.end());
+
+                slot = Slot{typeHash, TypeId(m_types.size())};
+                m_types.push_back(info);
+                if(m_types.size() * 2 > m_slots.size())
+                    grow();
+                return TypeId(m_types.size() - 1);
+            }
+            if(slot.hash == typeHash && equals(slot.id, info, fields))
+                return slot.id;
+        }
+    }
+
+    void TypeInterner::grow() {
+        std::vector<Slot> slots(m_slots.size() * 2, Slot{0, EMPTY_SLOT});
+        std::size_t mask = slots.size() - 1;
+        for(const Slot& slot : m_slots) {
+            if(slot.id == EMPTY_SLOT)
+                continue;
+            std::size_t idx = slot.hash & mask;
+            while(slots[idx].id != EMPTY_SLOT)
+                idx = (idx + 1) & mask;
+            slots[idx] = slot;
+        }
+        m_slots = std::move(slots);
+    }
+
+}
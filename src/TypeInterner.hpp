@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ASTNode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Hash-consed types. Every structurally distinct type (attributes included) is stored
+    // once and named by a dense TypeId, so type equality is an integer compare and nested
+    // types share their storage.
+    //
+    // Struct types are identified by their fields' names, types and repetitions, default
+    // values are not part of the type. Field names are not copied, they must outlive the interner.
+    //
+    class TypeInterner {
+    public:
+        using TypeId = std::uint32_t;
+        using Attribs = ASTNode::Type::Attribs;
+
+        enum class Kind : std::uint8_t {
+            Primitive, Pointer, Struct, Function
+        };
+
+        struct Field {
+            static constexpr std::uint64_t UNKNOWN_REPS = 0; // repetitions that are not a constant
+
+            std::string_view name; // empty if unnamed
+            TypeId type;
+            std::uint64_t reps = 1;
+        };
+
+        struct TypeInfo {
+            Kind kind;
+            Attribs attribs;
+            ASTNode::TypePrimitive primitive = {}; // Primitive
+            TypeId pointee = 0;                    // Pointer: pointed type, Function: return type
+            TypeId arguments = 0;                  // Function: struct type of the arguments
+            std::uint32_t firstField = 0;          // Struct
+            std::uint32_t numFields = 0;
+        };
+
+        TypeInterner();
+
+        TypeId Intern(const ASTNode::Type& type);
+        TypeId Intern(const ASTNode::TypeStruct& structType, const Attribs& attribs = {});
+
+        TypeId InternPrimitive(ASTNode::TypePrimitive primitive, const Attribs& attribs = {});
+        TypeId InternPointer(TypeId pointee, const Attribs& attribs = {});
+        TypeId InternStruct(std::span<const Field> fields, const Attribs& attribs = {});
+        TypeId InternFunction(TypeId arguments, TypeId returnType, const Attribs& attribs = {});
+
+        // Same type with other attributes
+        TypeId WithAttribs(TypeId id, const Attribs& attribs);
+
+        const TypeInfo& Get(TypeId id) const;
+        std::span<const Field> GetFields(TypeId id) const;
+        std::size_t Size() const;
+
+        std::string StringifyPretty(TypeId id) const;
+
+    private:
+        static constexpr TypeId EMPTY_SLOT = 0xFFFFFFFF;
+
+        struct Slot {
+            std::uint64_t hash;
+            TypeId id;
+        };
+
+        static std::uint64_t hash(const TypeInfo& info, std::span<const Field> fields);
+        bool equals(TypeId id, const TypeInfo& info, std::span<const Field> fields) const;
+
+        TypeId intern(TypeInfo info, std::span<const Field> fields);
+        void grow();
+
+        std::vector<Slot> m_slots; // power of two size, at most half full
+        std::vector<TypeInfo> m_types;
+        std::vector<Field> m_fields;
+        std::vector<Field> m_scratchFields; // fields of struct types being interned, nested structs push on top
+    };
+
+}
@@ -0,0 +1,1176 @@
+#include "Typer.hpp"
+#include "Trace.hpp"
+#include "ry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <variant>
+
+namespace ry {
+
+    using TypeId = Typer::TypeId;
+    using Declaration = Typer::Declaration;
+    using TypeInfo = TypeInterner::TypeInfo;
+    using TypeKind = TypeInterner::Kind;
+    using Primitive = ASTNode::TypePrimitive;
+
+    /*
+     *
+     * Unit
+     *
+     */
+
+    class Typer::Unit {
+    public:
+        struct Result {
+            std::vector<Infos::Info> infos;
+            std::vector<std::pair<const ASTNode::Expression *, TypeId>> expressionTypes;
+            std::vector<std::pair<std::uint32_t, TypeId>> declarationTypes;
+            std::vector<UnitInput> functions; // nested function bodies, typed after this unit
+        };
+
+        Unit(Typer& typer, const UnitInput& input);
+
+        Result Run();
+
+    private:
+        using TermId = std::uint32_t;
+
+        struct Term {
+            enum class Kind : std::uint8_t {
+                Var, Type, Pointer, Struct, Error
+            };
+            // What a variable can still become
+            enum class Class : std::uint8_t {
+                Any, Number, Integer, Float
+            };
+
+            Kind kind;
+            Class cls = Class::Any;
+            bool isNull = false;  // Var: holds null, so it must become an optional or a pointer
+            bool isValue = false; // Var: value of a block or loop, [] if nothing is broken with
+            std::uint32_t rank = 0;
+            TermId parent = 0;
+            TypeId type = 0;                              // Type
+            TermId pointee = 0;                           // Pointer
+            std::uint32_t firstField = 0;                 // Struct, in m_fields
+            std::uint32_t numFields = 0;
+            const ASTNode::Expression * origin = nullptr; // Var: reported if it can not be inferred
+        };
+
+        struct Field {
+            std::optional<std::string_view> name;
+            TermId term;
+        };
+
+        // A block or loop that can be broken out of
+        struct Target {
+            ASTNode::ExpressionBlock::Label label;
+            bool isLoop;
+            TermId term;
+        };
+
+        void error(std::string_view msg, const std::optional<SourcePosition>& srcPos);
+        void expect(TermId expected, TermId actual, const std::optional<SourcePosition>& srcPos);
+
+        TermId newTerm(const Term& term);
+        TermId newVar(Term::Class cls, const ASTNode::Expression * origin);
+        TermId typeTerm(TypeId type);
+        TermId errorTerm();
+        TermId pointerTerm(TermId pointee);
+        TermId structTerm(const std::vector<Field>& fields);
+        std::vector<Field> getFields(TermId id) const;
+
+        TermId find(TermId id);
+        void link(TermId from, TermId to);
+        bool unify(TermId a, TermId b);
+        bool unifyVar(TermId var, TermId other);
+        bool unifyStructWithType(TermId structTerm, TypeId type);
+        bool constrain(TermId id, Term::Class cls);
+        bool typesMatch(TypeId a, TypeId b) const;
+        std::optional<ASTNode::VectorShape> getVectorShape(TermId id);
+
+        std::optional<TypeId> resolve(TermId id);
+        std::string describe(TermId id);
+
+        TermId declarationTerm(const Declaration& decl);
+        void typeTypeExpressions(const ASTNode::Type& type);
+        TermId typeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit);
+        TermId typeExpression(const ASTNode::Expression& expr, bool isUsed);
+        TermId typeMemberAccess(TermId object, const ASTNode::Expression& member);
+        TermId typeLValue(const ASTNode::Expression::LValue& lvalue);
+        TermId typeStatementValue(const ASTNode::Statement& stmt, bool isUsed);
+        void typeStatement(const ASTNode::Statement& stmt);
+
+        Typer& m_typer;
+        UnitInput m_input;
+        Result m_result;
+
+        std::vector<Term> m_terms;
+        std::vector<Field> m_fields;
+        std::vector<Target> m_targets;
+        std::optional<TermId> m_returnTerm; // function body: of its declared return type
+        std::unordered_map<std::uint32_t, TermId> m_declarationTerms;         // by declaration id
+        std::vector<std::pair<const ASTNode::Expression *, TermId>> m_expressionTerms;
+        std::vector<std::pair<std::uint32_t, TermId>> m_inferredDeclarations; // untyped definitions
+
+        enum class ResolveState : std::uint8_t {
+            None, InProgress, Done, Failed
+        };
+        std::vector<ResolveState> m_resolveStates; // by term
+        std::vector<TypeId> m_resolvedTypes;       // by term
+    };
+
+    Typer::Unit::Unit(Typer& typer, const UnitInput& input):
+        m_typer(typer),
+        m_input(input)
+    {}
+
+    Typer::Unit::Result Typer::Unit::Run() {
+        if(m_input.ast) {
+            std::visit(overloaded{
+                [&](const ASTNode::Type& type)       { typeTypeExpressions(type); },
+                [&](const ASTNode::Expression& expr) { typeExpression(expr, false); },
+                [&](const ASTNode::Statement& stmt)  { typeStatement(stmt); }
+            }, m_input.ast->Get());
+        }
+        else {
+            m_returnTerm = typeTerm(m_typer.intern(*m_input.function->GetReturnType()));
+            TermId bodyTerm = typeExpression(*m_input.body, true);
+            expect(m_returnTerm.value(), bodyTerm, m_input.body->GetSourcePosition());
+        }
+
+        m_resolveStates.assign(m_terms.size(), ResolveState::None);
+        m_resolvedTypes.assign(m_terms.size(), 0);
+        for(auto [decl, term] : m_inferredDeclarations)
+            if(auto type = resolve(term))
+                m_result.declarationTypes.push_back({decl, type.value()});
+        for(auto [expr, term] : m_expressionTerms)
+            if(auto type = resolve(term))
+                m_result.expressionTypes.push_back({expr, type.value()});
+
+        return std::move(m_result);
+    }
+
+    void Typer::Unit::error(std::string_view msg, const std::optional<SourcePosition>& srcPos) {
+        if(srcPos)
+            m_result.infos.push_back(Infos::Info(Infos::Info::Level::ERROR, msg, srcPos.value()));
+        else
+            m_result.infos.push_back(Infos::Info(Infos::Info::Level::ERROR, msg));
+    }
+
+    void Typer::Unit::expect(TermId expected, TermId actual, const std::optional<SourcePosition>& srcPos) {
+        if(!unify(expected, actual))
+            error(std::format("Mismatched types, expected {}, got {}", describe(expected), describe(actual)), srcPos);
+    }
+
+    /*
+     *
+     * Terms
+     *
+     */
+
+    Typer::Unit::TermId Typer::Unit::newTerm(const Term& term) {
+        TermId id = TermId(m_terms.size());
+        m_terms.push_back(term);
+        m_terms.back().parent = id;
+        return id;
+    }
+
+    Typer::Unit::TermId Typer::Unit::newVar(Term::Class cls, const ASTNode::Expression * origin) {
+        return newTerm(Term{.kind = Term::Kind::Var, .cls = cls, .origin = origin});
+    }
+
+    Typer::Unit::TermId Typer::Unit::typeTerm(TypeId type) {
+        return newTerm(Term{.kind = Term::Kind::Type, .type = type});
+    }
+
+    Typer::Unit::TermId Typer::Unit::errorTerm() {
+        return newTerm(Term{.kind = Term::Kind::Error});
+    }
+
+    Typer::Unit::TermId Typer::Unit::pointerTerm(TermId pointee) {
+        return newTerm(Term{.kind = Term::Kind::Pointer, .pointee = pointee});
+    }
+
+    Typer::Unit::TermId Typer::Unit::structTerm(const std::vector<Field>& fields) {
+        std::uint32_t firstField = std::uint32_t(m_fields.size());
+        m_fields.insert(m_fields.end(), fields.begin(), fields.end());
+        return newTerm(Term{.kind = Term::Kind::Struct, .firstField = firstField, .numFields = std::uint32_t(fields.size())});
+    }
+
+    std::vector<Typer::Unit::Field> Typer::Unit::getFields(TermId id) const {
+        const Term& term = m_terms[id];
+        return std::vector<Field>(m_fields.begin() + term.firstField, m_fields.begin() + term.firstField + term.numFields);
+    }
+
+    Typer::Unit::TermId Typer::Unit::find(TermId id) {
+        TermId root = id;
+        while(m_terms[root].parent != root)
+            root = m_terms[root].parent;
+        while(m_terms[id].parent != root) {
+            TermId parent = m_terms[id].parent;
+            m_terms[id].parent = root;
+            id = parent;
+        }
+        return root;
+    }
+
+    // Only roots are linked, variables are always linked under what they become.
+    // Structured terms are linked once all their children unified, so that failures can still describe them.
+    void Typer::Unit::link(TermId from, TermId to) {
+        m_terms[from].parent = to;
+    }
+
+    bool Typer::Unit::unify(TermId a, TermId b) {
+        using Kind = Term::Kind;
+
+        a = find(a);
+        b = find(b);
+        if(a == b)
+            return true;
+
+        // errors are already reported, anything goes with them without spreading to the other term
+        if(m_terms[a].kind == Kind::Error || m_terms[b].kind == Kind::Error)
+            return true;
+
+        if(m_terms[a].kind == Kind::Var)
+            return unifyVar(a, b);
+        if(m_terms[b].kind == Kind::Var)
+            return unifyVar(b, a);
+
+        // concrete types win, so that the root of a set is the most precise term
+        if(m_terms[b].kind == Kind::Type)
+            std::swap(a, b);
+        Term termA = m_terms[a];
+        Term termB = m_terms[b];
+
+        if(termA.kind == Kind::Type) {
+            if(termB.kind == Kind::Type) {
+                if(!typesMatch(termA.type, termB.type))
+                    return false;
+                // types that only differ in attributes are compatible but stay apart, each keeps its own
+                if(termA.type == termB.type)
+                    link(b, a);
+                return true;
+            }
+            TypeInfo info = m_typer.getTypeInfo(termA.type);
+            if(termB.kind == Kind::Pointer) {
+                if(info.kind != TypeKind::Pointer || !unify(termB.pointee, typeTerm(info.pointee)))
+                    return false;
+                link(b, a);
+                return true;
+            }
+            if(termB.kind == Kind::Struct) {
+                bool isVector = info.kind == TypeKind::Primitive && ASTNode::GetVectorShape(info.primitive);
+                if((info.kind != TypeKind::Struct && !isVector) || !unifyStructWithType(b, termA.type))
+                    return false;
+                link(b, a);
+                return true;
+            }
+            return false;
+        }
+
+        if(termA.kind != termB.kind)
+            return false;
+        if(termA.kind == Kind::Pointer) {
+            if(!unify(termA.pointee, termB.pointee))
+                return false;
+            link(b, a);
+            return true;
+        }
+
+        // two struct literals
+        std::vector<Field> fieldsA = getFields(a);
+        std::vector<Field> fieldsB = getFields(b);
+        if(fieldsA.size() != fieldsB.size())
+            return false;
+        for(std::size_t i = 0; i < fieldsA.size(); i++)
+            if(fieldsA[i].name != fieldsB[i].name)
+                return false;
+        bool isOk = true;
+        for(std::size_t i = 0; i < fieldsA.size(); i++)
+            isOk = unify(fieldsA[i].term, fieldsB[i].term) && isOk;
+        if(isOk)
+            link(b, a);
+        return isOk;
+    }
+
+    bool Typer::Unit::unifyVar(TermId var, TermId other) {
+        using Kind = Term::Kind;
+        using Class = Term::Class;
+
+        Term& varTerm = m_terms[var];
+        Term& otherTerm = m_terms[other];
+        switch(otherTerm.kind) {
+            case Kind::Var: {
+                if(!constrain(other, varTerm.cls))
+                    return false;
+                Term merged = otherTerm;
+                merged.isNull = otherTerm.isNull || varTerm.isNull;
+                merged.isValue = otherTerm.isValue && varTerm.isValue;
+                merged.origin = otherTerm.origin ? otherTerm.origin : varTerm.origin;
+                merged.rank = std::max(varTerm.rank, otherTerm.rank) + (varTerm.rank == otherTerm.rank);
+                auto [root, child] = varTerm.rank > otherTerm.rank ? std::pair(var, other) : std::pair(other, var);
+                merged.parent = root;
+                m_terms[root] = merged;
+                link(child, root);
+                return true;
+            }
+            case Kind::Type: {
+                if(!constrain(other, varTerm.cls))
+                    return false;
+                if(varTerm.isNull) {
+                    TypeInfo info = m_typer.getTypeInfo(otherTerm.type);
+                    if(!info.attribs.isOptional && info.kind != TypeKind::Pointer)
+                        return false;
+                }
+                link(var, other);
+                return true;
+            }
+            case Kind::Pointer:
+                if(varTerm.cls != Class::Any)
+                    return false;
+                link(var, other);
+                return true;
+            case Kind::Struct:
+                if(varTerm.cls != Class::Any || varTerm.isNull)
+                    return false;
+                link(var, other);
+                return true;
+            case Kind::Error:
+                return true;
+        }
+        return false;
+    }
+
+    // Struct literal fields are matched by name, or by position after the previous field.
+    // The lanes of a vector are unnamed fields of its element type.
+    bool Typer::Unit::unifyStructWithType(TermId structTerm, TypeId type) {
+        std::vector<std::pair<std::string_view, TypeId>> typeFields;
+        TypeInfo info = m_typer.getTypeInfo(type);
+        if(info.kind == TypeKind::Primitive) {
+            if(auto shape = ASTNode::GetVectorShape(info.primitive))
+                typeFields.assign(shape->numLanes, {std::string_view(), m_typer.internPrimitive(shape->element)});
+        }
+        else {
+            for(const TypeInterner::Field& field : m_typer.getTypeFields(type))
+                for(std::uint64_t rep = 0; rep < std::max<std::uint64_t>(field.reps, 1); rep++)
+                    typeFields.push_back({field.name, field.type});
+        }
+
+        std::vector<Field> fields = getFields(structTerm);
+        if(fields.size() > typeFields.size())
+            return false;
+
+        // missing fields take their default values
+        bool isOk = true;
+        std::size_t fieldIdx = 0;
+        for(const Field& field : fields) {
+            if(field.name) {
+                auto it = std::find_if(typeFields.begin(), typeFields.end(), [&](const auto& typeField) {
+                    return typeField.first == field.name.value();
+                });
+                if(it == typeFields.end())
+                    return false;
+                fieldIdx = std::size_t(it - typeFields.begin());
+            }
+            if(fieldIdx >= typeFields.size())
+                return false;
+            isOk = unify(field.term, typeTerm(typeFields[fieldIdx].second)) && isOk;
+            fieldIdx++;
+        }
+        return isOk;
+    }
+
+    bool Typer::Unit::constrain(TermId id, Term::Class cls) {
+        using Kind = Term::Kind;
+        using Class = Term::Class;
+
+        if(cls == Class::Any)
+            return true;
+        id = find(id);
+        Term& term = m_terms[id];
+        switch(term.kind) {
+            case Kind::Var:
+                if(term.cls == Class::Any || term.cls == Class::Number)
+                    term.cls = cls == Class::Number && term.cls == Class::Number ? Class::Number : cls;
+                else if(cls != Class::Number && cls != term.cls)
+                    return false;
+                return true;
+            case Kind::Type: {
+                TypeInfo info = m_typer.getTypeInfo(term.type);
+                if(info.kind != TypeKind::Primitive)
+                    return false;
+                // vectors are numbers of their element's class
+                Primitive primitive = info.primitive;
+                if(auto shape = ASTNode::GetVectorShape(primitive))
+                    primitive = shape->element;
+                bool isInteger = primitive >= Primitive::I8 && primitive <= Primitive::U128;
+                bool isFloat = primitive == Primitive::F32 || primitive == Primitive::F64;
+                switch(cls) {
+                    case Class::Number:  return isInteger || isFloat;
+                    case Class::Integer: return isInteger;
+                    case Class::Float:   return isFloat;
+                    default:             return true;
+                }
+            }
+            case Kind::Error:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Attributes are not compared
+    bool Typer::Unit::typesMatch(TypeId a, TypeId b) const {
+        if(a == b)
+            return true;
+        TypeInfo infoA = m_typer.getTypeInfo(a);
+        TypeInfo infoB = m_typer.getTypeInfo(b);
+        if(infoA.kind != infoB.kind)
+            return false;
+        switch(infoA.kind) {
+            case TypeKind::Primitive:
+                return infoA.primitive == infoB.primitive;
+            case TypeKind::Pointer:
+                return typesMatch(infoA.pointee, infoB.pointee);
+            case TypeKind::Function:
+                return typesMatch(infoA.arguments, infoB.arguments) && typesMatch(infoA.pointee, infoB.pointee);
+            case TypeKind::Struct: {
+                // the layout attributes make a struct of another C type, a value or pointer of one is no other
+                if(infoA.attribs.isOrdered != infoB.attribs.isOrdered || infoA.attribs.isSoA != infoB.attribs.isSoA)
+                    return false;
+                std::vector<TypeInterner::Field> fieldsA = m_typer.getTypeFields(a);
+                std::vector<TypeInterner::Field> fieldsB = m_typer.getTypeFields(b);
+                if(fieldsA.size() != fieldsB.size())
+                    return false;
+                for(std::size_t i = 0; i < fieldsA.size(); i++)
+                    if(fieldsA[i].name != fieldsB[i].name
+                        || fieldsA[i].reps != fieldsB[i].reps
+                        || !typesMatch(fieldsA[i].type, fieldsB[i].type))
+                        return false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::optional<ASTNode::VectorShape> Typer::Unit::getVectorShape(TermId id) {
+        const Term& term = m_terms[find(id)];
+        if(term.kind != Term::Kind::Type)
+            return {};
+        TypeInfo info = m_typer.getTypeInfo(term.type);
+        if(info.kind != TypeKind::Primitive)
+            return {};
+        return ASTNode::GetVectorShape(info.primitive);
+    }
+
+    std::optional<TypeId> Typer::Unit::resolve(TermId id) {
+        using Kind = Term::Kind;
+        using Class = Term::Class;
+
+        id = find(id);
+        switch(m_resolveStates[id]) {
+            case ResolveState::Done:   return m_resolvedTypes[id];
+            case ResolveState::Failed: return {};
+            case ResolveState::InProgress:
+                m_resolveStates[id] = ResolveState::Failed;
+                error("Recursive type", m_terms[id].origin ? m_terms[id].origin->GetSourcePosition() : std::nullopt);
+                return {};
+            case ResolveState::None:
+                break;
+        }
+        m_resolveStates[id] = ResolveState::InProgress;
+
+        const Term term = m_terms[id];
+        std::optional<TypeId> type;
+        switch(term.kind) {
+            case Kind::Var:
+                if(term.isNull)
+                    error("Cannot infer the type of null", term.origin ? term.origin->GetSourcePosition() : std::nullopt);
+                else if(term.cls == Class::Number || term.cls == Class::Integer)
+                    type = m_typer.m_i32Type;
+                else if(term.cls == Class::Float)
+                    type = m_typer.m_f64Type;
+                else if(term.isValue)
+                    type = m_typer.m_emptyType;
+                else
+                    error("Cannot infer the type", term.origin ? term.origin->GetSourcePosition() : std::nullopt);
+                break;
+            case Kind::Type:
+                type = term.type;
+                break;
+            case Kind::Pointer:
+                if(auto pointee = resolve(term.pointee))
+                    type = m_typer.internPointer(pointee.value());
+                break;
+            case Kind::Struct: {
+                std::vector<TypeInterner::Field> fields;
+                for(const Field& field : getFields(id)) {
+                    auto fieldType = resolve(field.term);
+                    if(!fieldType)
+                        break;
+                    fields.push_back(TypeInterner::Field{field.name.value_or(std::string_view()), fieldType.value()});
+                }
+                if(fields.size() == term.numFields)
+                    type = m_typer.internStruct(fields);
+                break;
+            }
+            case Kind::Error:
+                break;
+        }
+
+        if(m_resolveStates[id] == ResolveState::Failed)
+            return {};
+        m_resolveStates[id] = type ? ResolveState::Done : ResolveState::Failed;
+        if(type)
+            m_resolvedTypes[id] = type.value();
+        return type;
+    }
+
+    std::string Typer::Unit::describe(TermId id) {
+        using Kind = Term::Kind;
+        using Class = Term::Class;
+
+        id = find(id);
+        const Term term = m_terms[id];
+        switch(term.kind) {
+            case Kind::Var:
+                if(term.isNull)
+                    return "null";
+                switch(term.cls) {
+                    case Class::Number:  return "{number}";
+                    case Class::Integer: return "{integer}";
+                    case Class::Float:   return "{float}";
+                    default:             return "{unknown}";
+                }
+            case Kind::Type:
+                return m_typer.stringifyType(term.type);
+            case Kind::Pointer:
+                return "*" + describe(term.pointee);
+            case Kind::Struct: {
+                std::string str = "[";
+                std::vector<Field> fields = getFields(id);
+                for(std::size_t i = 0; i < fields.size(); i++) {
+                    if(fields[i].name) {
+                        str += fields[i].name.value();
+                        str += ' ';
+                    }
+                    str += describe(fields[i].term);
+                    if(i != fields.size() - 1)
+                        str += "; ";
+                }
+                return str + ']';
+            }
+            case Kind::Error:
+                return "{error}";
+        }
+        return "";
+    }
+
+    /*
+     *
+     * Type
+     *
+     */
+
+    Typer::Unit::TermId Typer::Unit::declarationTerm(const Declaration& decl) {
+        if(auto it = m_declarationTerms.find(decl.id); it != m_declarationTerms.end())
+            return it->second;
+
+        // declared outside of this unit, or typed
+        TermId term;
+        if(auto type = m_typer.m_declarationTypes[decl.id])
+            term = typeTerm(type.value());
+        else if(decl.kind == Declaration::Kind::Parameter)
+            term = typeTerm(m_typer.intern(*decl.parameter->GetType()));
+        else if(auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get()))
+            if(auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef))
+                term = typeTerm(m_typer.intern(typedVarDef->GetType()));
+            else
+                term = errorTerm(); // its initializer failed to type
+        else
+            term = errorTerm();
+        m_declarationTerms[decl.id] = term;
+        return term;
+    }
+
+    // Default values and repetitions
+    void Typer::Unit::typeTypeExpressions(const ASTNode::Type& type) {
+        auto typeStruct = [&](const ASTNode::TypeStruct& structType) {
+            for(const ASTNode::TypeStruct::Field& field : structType.GetFields()) {
+                std::visit(overloaded{
+                    [&](const ASTNode::TypeStruct::NamedField& namedField) {
+                        typeTypeExpressions(*namedField.GetType());
+                        if(const auto& defaultValue = namedField.GetDefaultValue()) {
+                            TermId valueTerm = typeExpression(*defaultValue.value(), true);
+                            expect(typeTerm(m_typer.intern(*namedField.GetType())), valueTerm, defaultValue.value()->GetSourcePosition());
+                        }
+                    },
+                    [&](const ASTNode::TypeStruct::UnnamedField& unnamedField) {
+                        typeTypeExpressions(*unnamedField.GetType());
+                        if(const auto& typeReps = unnamedField.GetTypeReps()) {
+                            TermId repsTerm = typeExpression(*typeReps.value(), true);
+                            if(!constrain(repsTerm, Term::Class::Integer))
+                                error(std::format("Expected an integer, got {}", describe(repsTerm)), typeReps.value()->GetSourcePosition());
+                        }
+                        if(const auto& defaultValue = unnamedField.GetDefaultValue()) {
+                            TermId valueTerm = typeExpression(*defaultValue.value(), true);
+                            expect(typeTerm(m_typer.intern(*unnamedField.GetType())), valueTerm, defaultValue.value()->GetSourcePosition());
+                        }
+                    }
+                }, field);
+            }
+        };
+
+        std::visit(overloaded{
+            [&](ASTNode::TypePrimitive) {},
+            [&](const ASTNode::TypePointer& pointer) {
+                typeTypeExpressions(*pointer);
+            },
+            [&](const ASTNode::TypeFunction& function) {
+                typeStruct(function.GetArgumentsType());
+                typeTypeExpressions(*function.GetReturnType());
+            },
+            [&](const ASTNode::TypeStruct& structType) {
+                typeStruct(structType);
+            }
+        }, type.Get());
+    }
+
+    /*
+     *
+     * Expression
+     *
+     */
+
+    Typer::Unit::TermId Typer::Unit::typeStructLiteral(const ASTNode::ExpressionLiteral::Struct& structLit) {
+        std::vector<Field> fields;
+        fields.reserve(structLit.GetFields().size());
+        for(const ASTNode::ExpressionLiteral::Struct::Field& field : structLit.GetFields())
+            fields.push_back(Field{field.GetName(), typeExpression(*field.GetValue(), true)});
+        return structTerm(fields);
+    }
+
+    Typer::Unit::TermId Typer::Unit::typeExpression(const ASTNode::Expression& expr, bool isUsed) {
+        using UnOpKind = ASTNode::ExpressionUnaryOperation::Kind;
+        using BinOpKind = ASTNode::ExpressionBinaryOperation::Kind;
+        using Class = Term::Class;
+
+        const std::optional<SourcePosition>& srcPos = expr.GetSourcePosition();
+        auto expectClass = [&](TermId term, Class cls, const std::optional<SourcePosition>& srcPos) {
+            if(constrain(term, cls))
+                return;
+            const char * what = cls == Class::Integer ? "an integer" : cls == Class::Float ? "a float" : "a number";
+            error(std::format("Expected {}, got {}", what, describe(term)), srcPos);
+        };
+        auto boolTerm = [&]() {
+            return typeTerm(m_typer.m_boolType);
+        };
+
+        TermId term = std::visit(overloaded{
+            [&](const ASTNode::ExpressionLiteral& literal) -> TermId {
+                if(!literal.Get()) {
+                    TermId term = newVar(Class::Any, &expr);
+                    m_terms[term].isNull = true;
+                    return term;
+                }
+                return std::visit(overloaded{
+                    [&](ASTNode::ExpressionLiteral::Int)           { return newVar(Class::Number, &expr); },
+                    [&](ASTNode::ExpressionLiteral::Float)         { return newVar(Class::Float, &expr); },
+                    [&](const ASTNode::ExpressionLiteral::String&) { return typeTerm(m_typer.m_stringType); },
+                    [&](ASTNode::ExpressionLiteral::Char)          { return typeTerm(m_typer.m_charType); },
+                    [&](ASTNode::ExpressionLiteral::Bool)          { return boolTerm(); },
+                    [&](const ASTNode::ExpressionLiteral::Struct& structLit) {
+                        return typeStructLiteral(structLit);
+                    }
+                }, literal.Get().value());
+            },
+            [&](const ASTNode::ExpressionFunctionCall& funcCall) -> TermId {
+                TermId function = find(typeExpression(*funcCall.GetFunction(), true));
+                TermId arguments = typeStructLiteral(funcCall.GetParameters());
+                const Term& functionTerm = m_terms[function];
+                if(functionTerm.kind == Term::Kind::Error)
+                    return errorTerm();
+                if(functionTerm.kind == Term::Kind::Type) {
+                    TypeInfo info = m_typer.getTypeInfo(functionTerm.type);
+                    if(info.kind == TypeKind::Function) {
+                        TermId argumentsType = typeTerm(info.arguments);
+                        if(!unify(argumentsType, arguments))
+                            error(std::format("Mismatched arguments, expected {}, got {}", describe(argumentsType), describe(arguments)), srcPos);
+                        return typeTerm(info.pointee);
+                    }
+                }
+                error(std::format("Called value is not a function, got {}", describe(function)), funcCall.GetFunction()->GetSourcePosition());
+                return errorTerm();
+            },
+            [&](const ASTNode::ExpressionBlock& block) -> TermId {
+                TermId value = newVar(Class::Any, &expr);
+                m_terms[value].isValue = true;
+                // the body of a function breaks with its declared return type, whichever break comes first
+                if(&expr == m_input.body && m_returnTerm)
+                    unify(value, m_returnTerm.value());
+                m_targets.push_back(Target{block.GetLabel(), false, value});
+                for(const ASTNode::Statement& stmt : block.GetStatements())
+                    typeStatement(stmt);
+                m_targets.pop_back();
+                return value;
+            },
+            [&](const ASTNode::ExpressionIf& ifExpr) -> TermId {
+                TermId condition = typeExpression(*ifExpr.GetCondition(), true);
+                expect(boolTerm(), condition, ifExpr.GetCondition()->GetSourcePosition());
+                TermId success = typeStatementValue(*ifExpr.GetSuccessStatement(), isUsed);
+                if(!ifExpr.GetFailStatement())
+                    return typeTerm(m_typer.m_emptyType);
+                const ASTNode::Statement& failStmt = *ifExpr.GetFailStatement().value();
+                TermId fail = typeStatementValue(failStmt, isUsed);
+                if(!isUsed)
+                    return typeTerm(m_typer.m_emptyType);
+                expect(success, fail, failStmt.GetSourcePosition());
+                return success;
+            },
+            [&](const ASTNode::ExpressionLoop& loop) -> TermId {
+                TermId value = newVar(Class::Any, &expr);
+                m_terms[value].isValue = true;
+                if(loop.GetInitStatement())
+                    typeStatement(*loop.GetInitStatement().value());
+                if(loop.GetCondition()) {
+                    const ASTNode::Expression& conditionExpr = *loop.GetCondition().value();
+                    expect(boolTerm(), typeExpression(conditionExpr, true), conditionExpr.GetSourcePosition());
+                }
+                m_targets.push_back(Target{{}, true, value});
+                if(loop.GetPostStatement())
+                    typeStatement(*loop.GetPostStatement().value());
+                typeStatement(*loop.GetBodyStatement());
+                m_targets.pop_back();
+                return value;
+            },
+            [&](const ASTNode::ExpressionUnaryOperation& unaryOp) -> TermId {
+                const ASTNode::Expression& operandExpr = *unaryOp.GetOperand();
+                TermId operand = typeExpression(operandExpr, true);
+                switch(unaryOp.GetKind()) {
+                    case UnOpKind::ArithmeticNegation:
+                        expectClass(operand, Class::Number, operandExpr.GetSourcePosition());
+                        return operand;
+                    case UnOpKind::BitwiseNegation:
+                        expectClass(operand, Class::Integer, operandExpr.GetSourcePosition());
+                        return operand;
+                    case UnOpKind::LogicalNegation:
+                        expect(boolTerm(), operand, operandExpr.GetSourcePosition());
+                        return boolTerm();
+                    case UnOpKind::AddressOf:
+                        return pointerTerm(operand);
+                    case UnOpKind::PointerDereference: {
+                        TermId pointee = newVar(Class::Any, &expr);
+                        TermId pointer = pointerTerm(pointee);
+                        if(!unify(pointer, operand)) {
+                            error(std::format("Dereferenced value is not a pointer, got {}", describe(operand)), operandExpr.GetSourcePosition());
+                            return errorTerm();
+                        }
+                        return pointee;
+                    }
+                    case UnOpKind::Comp:
+                        return operand;
+                }
+                return errorTerm();
+            },
+            [&](const ASTNode::ExpressionBinaryOperation& binOp) -> TermId {
+                const ASTNode::Expression& firstExpr = *binOp.GetOperands().first;
+                const ASTNode::Expression& secondExpr = *binOp.GetOperands().second;
+                TermId first = typeExpression(firstExpr, true);
+                switch(binOp.GetKind()) {
+                    case BinOpKind::StructMemberAccess:
+                        return typeMemberAccess(first, secondExpr);
+                    case BinOpKind::TypeCast:
+                        // the target type is parsed as an expression, there is nothing to cast to yet
+                        error("Type casts are not supported yet", srcPos);
+                        return errorTerm();
+                    default:
+                        break;
+                }
+
+                TermId second = typeExpression(secondExpr, true);
+                switch(binOp.GetKind()) {
+                    case BinOpKind::Add:
+                    case BinOpKind::Sub:
+                    case BinOpKind::Mul:
+                    case BinOpKind::Div:
+                        expectClass(first, Class::Number, firstExpr.GetSourcePosition());
+                        expect(first, second, secondExpr.GetSourcePosition());
+                        return first;
+                    case BinOpKind::Mod:
+                    case BinOpKind::BitOr:
+                    case BinOpKind::BitXor:
+                    case BinOpKind::BitAnd:
+                        expectClass(first, Class::Integer, firstExpr.GetSourcePosition());
+                        expect(first, second, secondExpr.GetSourcePosition());
+                        return first;
+                    case BinOpKind::BitLShift:
+                    case BinOpKind::BitRShift:
+                        expectClass(first, Class::Integer, firstExpr.GetSourcePosition());
+                        expectClass(second, Class::Integer, secondExpr.GetSourcePosition());
+                        return first;
+                    case BinOpKind::Eq:
+                    case BinOpKind::Uneq:
+                        expect(first, second, secondExpr.GetSourcePosition());
+                        return boolTerm();
+                    case BinOpKind::Less:
+                    case BinOpKind::LessEqual:
+                    case BinOpKind::Great:
+                    case BinOpKind::GreatEqual:
+                        expectClass(first, Class::Number, firstExpr.GetSourcePosition());
+                        expect(first, second, secondExpr.GetSourcePosition());
+                        if(getVectorShape(first))
+                            error(std::format("Vectors are not ordered, got {}", describe(first)), firstExpr.GetSourcePosition());
+                        return boolTerm();
+                    case BinOpKind::Or:
+                    case BinOpKind::And:
+                        expect(boolTerm(), first, firstExpr.GetSourcePosition());
+                        expect(boolTerm(), second, secondExpr.GetSourcePosition());
+                        return boolTerm();
+                    default:
+                        return errorTerm();
+                }
+            },
+            [&](const ASTNode::ExpressionName& name) -> TermId {
+                const Declaration * decl = m_typer.m_analyzer.GetDeclaration(name);
+                if(!decl)
+                    return errorTerm(); // reported by the analyzer
+                return declarationTerm(*decl);
+            }
+        }, expr.Get());
+
+        m_expressionTerms.push_back({&expr, term});
+        return term;
+    }
+
+    Typer::Unit::TermId Typer::Unit::typeMemberAccess(TermId object, const ASTNode::Expression& member) {
+        auto name = std::get_if<ASTNode::ExpressionName>(&member.Get());
+        if(!name) {
+            error("Expected a member name", member.GetSourcePosition());
+            return errorTerm();
+        }
+
+        object = find(object);
+        const Term objectTerm = m_terms[object];
+        if(objectTerm.kind == Term::Kind::Error)
+            return errorTerm();
+        if(objectTerm.kind == Term::Kind::Struct) {
+            for(const Field& field : getFields(object))
+                if(field.name == *name)
+                    return field.term;
+        }
+        else if(objectTerm.kind == Term::Kind::Type && m_typer.getTypeInfo(objectTerm.type).kind == TypeKind::Struct) {
+            for(const TypeInterner::Field& field : m_typer.getTypeFields(objectTerm.type))
+                if(field.name == *name)
+                    return typeTerm(field.type);
+        }
+        else if(auto shape = getVectorShape(object)) {
+            // one lane is an element, several a shuffle into another vector
+            if(auto lanes = ASTNode::GetLanes(*name, shape->numLanes)) {
+                if(lanes->size() == 1)
+                    return typeTerm(m_typer.internPrimitive(shape->element));
+                if(auto primitive = ASTNode::GetVectorPrimitive(shape->element, std::uint32_t(lanes->size())))
+                    return typeTerm(m_typer.internPrimitive(primitive.value()));
+                error(std::format("No vector of {} lanes of {}", lanes->size(), ASTNode::Type::StringifyPrimitiveType(shape->element)), member.GetSourcePosition());
+                return errorTerm();
+            }
+        }
+        else if(objectTerm.kind == Term::Kind::Var) {
+            error(std::format("Member \"{}\" of a value of unknown type", *name), member.GetSourcePosition());
+            return errorTerm();
+        }
+        error(std::format("No member \"{}\" in {}", *name, describe(object)), member.GetSourcePosition());
+        return errorTerm();
+    }
+
+    Typer::Unit::TermId Typer::Unit::typeLValue(const ASTNode::Expression::LValue& lvalue) {
+        return std::visit(overloaded{
+            [&](const ASTNode::ExpressionName& name) -> TermId {
+                const Declaration * decl = m_typer.m_analyzer.GetDeclaration(name);
+                return decl ? declarationTerm(*decl) : errorTerm();
+            },
+            [&](const ASTNode::Expression::PointerDereference& operand) -> TermId {
+                TermId pointee = newVar(Term::Class::Any, operand.get());
+                if(!unify(pointerTerm(pointee), typeExpression(*operand, true))) {
+                    error("Dereferenced value is not a pointer", operand->GetSourcePosition());
+                    return errorTerm();
+                }
+                return pointee;
+            },
+            [&](const ASTNode::Expression::StructMemberAccess& operands) -> TermId {
+                TermId object = typeExpression(*operands.first, true);
+                auto name = std::get_if<ASTNode::ExpressionName>(&operands.second->Get());
+                if(auto shape = getVectorShape(object); shape && name) {
+                    auto lanes = ASTNode::GetLanes(*name, shape->numLanes);
+                    if(lanes && lanes->size() > 1) {
+                        error("Only one lane of a vector can be assigned to", operands.second->GetSourcePosition());
+                        return errorTerm();
+                    }
+                }
+                return typeMemberAccess(object, *operands.second);
+            }
+        }, lvalue);
+    }
+
+    /*
+     *
+     * Statement
+     *
+     */
+
+    // Only expression statements have a value, others are []
+    Typer::Unit::TermId Typer::Unit::typeStatementValue(const ASTNode::Statement& stmt, bool isUsed) {
+        if(auto expr = std::get_if<ASTNode::StatementExpression>(&stmt.Get()))
+            return typeExpression(*expr, isUsed);
+        typeStatement(stmt);
+        return typeTerm(m_typer.m_emptyType);
+    }
+
+    void Typer::Unit::typeStatement(const ASTNode::Statement& stmt) {
+        using StmtBinOpKind = ASTNode::StatementBinaryOperation::Kind;
+        using Class = Term::Class;
+
+        const std::optional<SourcePosition>& srcPos = stmt.GetSourcePosition();
+
+        std::visit(overloaded{
+            [&](const ASTNode::StatementExpression& expr) {
+                typeExpression(expr, false);
+            },
+            [&](const ASTNode::StatementBinaryOperation& binOp) {
+                TermId lvalue = typeLValue(binOp.GetOperands().first);
+                const ASTNode::Expression& valueExpr = binOp.GetOperands().second;
+                TermId value = typeExpression(valueExpr, true);
+                StmtBinOpKind kind = binOp.GetKind();
+                bool isShift = kind == StmtBinOpKind::BitLShiftEq || kind == StmtBinOpKind::BitRShiftEq;
+                bool isArithmetic =
+                    kind == StmtBinOpKind::AddEq || kind == StmtBinOpKind::SubEq
+                    || kind == StmtBinOpKind::MulEq || kind == StmtBinOpKind::DivEq;
+                if(!constrain(lvalue, isArithmetic ? Class::Number : Class::Integer))
+                    error(std::format("Expected {}, got {}", isArithmetic ? "a number" : "an integer", describe(lvalue)), srcPos);
+                if(isShift) {
+                    if(!constrain(value, Class::Integer))
+                        error(std::format("Expected an integer, got {}", describe(value)), valueExpr.GetSourcePosition());
+                }
+                else
+                    expect(lvalue, value, valueExpr.GetSourcePosition());
+            },
+            [&](const ASTNode::StatementVariableDefinition& varDef) {
+                const Declaration * decl = m_typer.m_analyzer.GetDeclaration(stmt);
+                std::visit(overloaded{
+                    [&](const ASTNode::StatementTypedVariableDefinition& typedVarDef) {
+                        typeTypeExpressions(typedVarDef.GetType());
+                        TermId type = typeTerm(m_typer.intern(typedVarDef.GetType()));
+                        if(decl)
+                            m_declarationTerms[decl->id] = type;
+                        if(!typedVarDef.GetValue())
+                            return;
+                        const ASTNode::Expression& value = typedVarDef.GetValue().value();
+                        // function bodies are typed on their own, after this unit
+                        if(auto function = std::get_if<ASTNode::TypeFunction>(&typedVarDef.GetType().Get())) {
+                            m_result.functions.push_back(UnitInput{nullptr, function, &value});
+                            return;
+                        }
+                        expect(type, typeExpression(value, true), value.GetSourcePosition());
+                    },
+                    [&](const ASTNode::StatementUntypedVariableDefinition& untypedVarDef) {
+                        TermId value = typeExpression(untypedVarDef.GetValue(), true);
+                        if(decl) {
+                            m_declarationTerms[decl->id] = value;
+                            m_inferredDeclarations.push_back({decl->id, value});
+                        }
+                    }
+                }, varDef);
+            },
+            [&](const ASTNode::StatementAssignment& assign) {
+                TermId lvalue = typeLValue(assign.GetLValue());
+                expect(lvalue, typeExpression(assign.GetRValue(), true), assign.GetRValue().GetSourcePosition());
+            },
+            [&](const ASTNode::StatementContinue&) {},
+            [&](const ASTNode::StatementBreak& stmtBreak) {
+                TermId value = stmtBreak.GetValue()
+                    ? typeExpression(stmtBreak.GetValue().value(), true)
+                    : typeTerm(m_typer.m_emptyType);
+
+                // a labelled break leaves its block, otherwise the innermost loop, or block if there is none
+                const Target * target = nullptr;
+                for(auto it = m_targets.rbegin(); it != m_targets.rend(); it++) {
+                    if(stmtBreak.GetLabel() ? it->label == stmtBreak.GetLabel() : it->isLoop) {
+                        target = &*it;
+                        break;
+                    }
+                }
+                if(!target && !stmtBreak.GetLabel() && !m_targets.empty())
+                    target = &m_targets.back();
+                if(!target) {
+                    if(!stmtBreak.GetLabel())
+                        error("Break outside of a block or loop", srcPos);
+                    return; // unresolved labels are reported by the analyzer
+                }
+                expect(target->term, value, stmtBreak.GetValue() ? stmtBreak.GetValue()->GetSourcePosition() : srcPos);
+            }
+        }, stmt.Get());
+    }
+
+    /*
+     *
+     * Typer
+     *
+     */
+
+    Typer::Typer(const Infos& infos, const Analyzer& analyzer, TypeInterner& types):
+        m_infos(infos),
+        m_analyzer(analyzer),
+        m_types(types)
+    {
+        m_boolType = m_types.InternPrimitive(Primitive::Bool);
+        m_charType = m_types.InternPrimitive(Primitive::Char);
+        m_stringType = m_types.InternPointer(m_charType);
+        m_i32Type = m_types.InternPrimitive(Primitive::I32);
+        m_f64Type = m_types.InternPrimitive(Primitive::F64);
+        m_emptyType = m_types.InternStruct({});
+    }
+
+    const Infos& Typer::GetInfos() const {
+        return m_infos;
+    }
+
+    void Typer::Check(const ASTNode& ast, std::size_t numThreads) {
+        m_declarationTypes.assign(m_analyzer.GetDeclarationCount(), {});
+
+        std::vector<Infos::Info> infos;
+        std::vector<UnitInput> level = {UnitInput{&ast, nullptr, nullptr}};
+        while(!level.empty()) {
+            std::vector<Unit::Result> results(level.size());
+            auto run = [&](std::size_t idx) {
+                Trace::Scope traceScope("type-unit", m_infos.GetId());
+                results[idx] = Unit(*this, level[idx]).Run();
+            };
+
+            std::size_t numWorkers = std::min(numThreads, level.size());
+            if(numWorkers <= 1) {
+                for(std::size_t idx = 0; idx < level.size(); idx++)
+                    run(idx);
+            }
+            else {
+                std::atomic<std::size_t> nextIdx = 0;
+                std::vector<std::thread> workers;
+                for(std::size_t i = 0; i < numWorkers; i++)
+                    workers.emplace_back([&]() {
+                        for(std::size_t idx; (idx = nextIdx++) < level.size();)
+                            run(idx);
+                    });
+                for(std::thread& worker : workers)
+                    worker.join();
+            }
+
+            // merged in order, so the results do not depend on the scheduling
+            std::vector<UnitInput> nextLevel;
+            for(Unit::Result& result : results) {
+                infos.insert(infos.end(), result.infos.begin(), result.infos.end());
+                for(auto [expr, type] : result.expressionTypes)
+                    m_expressionTypes[expr] = type;
+                for(auto [decl, type] : result.declarationTypes)
+                    m_declarationTypes[decl] = type;
+                nextLevel.insert(nextLevel.end(), result.functions.begin(), result.functions.end());
+            }
+            m_numFunctionBodies += nextLevel.size();
+            level = std::move(nextLevel);
+        }
+
+        for(std::uint32_t id = 0; id < m_declarationTypes.size(); id++) {
+            if(m_declarationTypes[id])
+                continue;
+            const Declaration& decl = m_analyzer.GetDeclaration(id);
+            if(decl.kind == Declaration::Kind::Parameter)
+                m_declarationTypes[id] = intern(*decl.parameter->GetType());
+            else if(auto varDef = std::get_if<ASTNode::StatementVariableDefinition>(&decl.statement->Get()))
+                if(auto typedVarDef = std::get_if<ASTNode::StatementTypedVariableDefinition>(varDef))
+                    m_declarationTypes[id] = intern(typedVarDef->GetType());
+        }
+
+        std::stable_sort(infos.begin(), infos.end(), [](const Infos::Info& a, const Infos::Info& b) {
+            const SourcePosition& posA = a.GetSourcePosition();
+            const SourcePosition& posB = b.GetSourcePosition();
+            return std::pair(posA.startLine, posA.startColumn) < std::pair(posB.startLine, posB.startColumn);
+        });
+        for(const Infos::Info& info : infos)
+            m_infos.Push(info);
+    }
+
+    std::optional<TypeId> Typer::GetType(const ASTNode::Expression& expr) const {
+        auto it = m_expressionTypes.find(&expr);
+        if(it == m_expressionTypes.end())
+            return {};
+        return it->second;
+    }
+
+    std::optional<TypeId> Typer::GetType(const Declaration& decl) const {
+        if(decl.id >= m_declarationTypes.size())
+            return {};
+        return m_declarationTypes[decl.id];
+    }
+
+    std::size_t Typer::GetTypedExpressionCount() const {
+        return m_expressionTypes.size();
+    }
+
+    std::size_t Typer::GetFunctionBodyCount() const {
+        return m_numFunctionBodies;
+    }
+
+    std::string Typer::StringifyDeclarations() const {
+        std::string str;
+        for(std::uint32_t id = 0; id < m_declarationTypes.size(); id++) {
+            const Declaration& decl = m_analyzer.GetDeclaration(id);
+            str += decl.name;
+            str += ": ";
+            str += m_declarationTypes[id] ? stringifyType(m_declarationTypes[id].value()) : "?";
+            str += '\n';
+        }
+        return str;
+    }
+
+    TypeId Typer::intern(const ASTNode::Type& type) {
+        std::unique_lock lock(m_typesMutex);
+        return m_types.Intern(type);
+    }
+
+    TypeId Typer::internPrimitive(ASTNode::TypePrimitive primitive) {
+        std::unique_lock lock(m_typesMutex);
+        return m_types.InternPrimitive(primitive);
+    }
+
+    TypeId Typer::internPointer(TypeId pointee) {
+        std::unique_lock lock(m_typesMutex);
+        return m_types.InternPointer(pointee);
+    }
+
+    TypeId Typer::internStruct(const std::vector<TypeInterner::Field>& fields) {
+        std::unique_lock lock(m_typesMutex);
+        return m_types.InternStruct(fields);
+    }
+
+    TypeInterner::TypeInfo Typer::getTypeInfo(TypeId id) const {
+        std::shared_lock lock(m_typesMutex);
+        return m_types.Get(id);
+    }
+
+    std::vector<TypeInterner::Field> Typer::getTypeFields(TypeId id) const {
+        std::shared_lock lock(m_typesMutex);
+        std::span<const TypeInterner::Field> fields = m_types.GetFields(id);
+        return std::vector<TypeInterner::Field>(fields.begin(), fields.end());
+    }
+
+    std::string Typer::stringifyType(TypeId id) const {
+        std::shared_lock lock(m_typesMutex);
+        return m_types.StringifyPretty(id);
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ASTNode.hpp"
+#include "Analyzer.hpp"
+#include "Infos.hpp"
+#include "TypeInterner.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Type checking and inference.
+    //
+    // Every expression gets a term, terms are unified with union-find (path compression,
+    // union by rank), so inference is near-linear in the size of the AST. Untyped definitions,
+    // literals and struct literals start as type variables that are narrowed by their uses,
+    // unconstrained number literals default to i32 / f64, and valueless blocks and loops to [].
+    //
+    // Each function body is typed on its own, once the bodies it is nested in are done and the
+    // types of their declarations are fixed, so the bodies of one nesting level are independent
+    // and are typed in parallel. Diagnostics are reported in source order regardless.
+    //
+    // Type attributes (~ and ?) are not compared by unification, only null checks for them.
+    // Results are kept in side tables keyed by the address of each expression, the typed AST
+    // must outlive the typer and must not be copied in between.
+    //
+    class Typer {
+    public:
+        using TypeId = TypeInterner::TypeId;
+        using Declaration = Analyzer::Declaration;
+
+        Typer(const Infos& infos, const Analyzer& analyzer, TypeInterner& types);
+
+        const Infos& GetInfos() const;
+
+        void Check(const ASTNode& ast, std::size_t numThreads = 1);
+
+        // none if the type could not be inferred
+        std::optional<TypeId> GetType(const ASTNode::Expression& expr) const;
+        std::optional<TypeId> GetType(const Declaration& decl) const;
+
+        std::size_t GetTypedExpressionCount() const;
+        std::size_t GetFunctionBodyCount() const;
+
+        // Declarations and their types, in declaration order
+        std::string StringifyDeclarations() const;
+
+    private:
+        class Unit;
+
+        // A function body, or the top level
+        struct UnitInput {
+            const ASTNode * ast;                    // top level
+            const ASTNode::TypeFunction * function; // function body
+            const ASTNode::Expression * body;
+        };
+
+        // The interner is shared by the units of a nesting level
+        TypeId intern(const ASTNode::Type& type);
+        TypeId internPrimitive(ASTNode::TypePrimitive primitive);
+        TypeId internPointer(TypeId pointee);
+        TypeId internStruct(const std::vector<TypeInterner::Field>& fields);
+        TypeInterner::TypeInfo getTypeInfo(TypeId id) const;
+        std::vector<TypeInterner::Field> getTypeFields(TypeId id) const;
+        std::string stringifyType(TypeId id) const;
+
+        Infos m_infos;
+        const Analyzer& m_analyzer;
+        TypeInterner& m_types;
+        mutable std::shared_mutex m_typesMutex;
+
+        TypeId m_boolType;
+        TypeId m_charType;
+        TypeId m_stringType;
+        TypeId m_i32Type;
+        TypeId m_f64Type;
+        TypeId m_emptyType; // []
+
+        std::vector<std::optional<TypeId>> m_declarationTypes; // by declaration id, fixed once its unit is done
+        std::unordered_map<const ASTNode::Expression *, TypeId> m_expressionTypes;
+        std::size_t m_numFunctionBodies = 0;
+    };
+
+}
@@ -0,0 +1,349 @@
+#include "VM.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace ry {
+
+    using Slot = VM::Slot;
+    using Op = Bytecode::Op;
+    using Instruction = Bytecode::Instruction;
+
+    static Slot normalize(const Instruction& ins, Slot value) {
+        return Bytecode::Normalize(value, ins.width, ins.isSigned);
+    }
+
+    static double toFloat(Slot value) {
+        return Bytecode::ToFloat(value);
+    }
+
+    static Slot fromFloat(const Instruction& ins, double value) {
+        return Bytecode::FromFloat(value, ins.width);
+    }
+
+    VM::VM(const std::vector<Bytecode::Function>& functions, const Limits& limits):
+        m_functions(functions),
+        m_limits(limits),
+        m_maxRegisters(limits.maxMemory / sizeof(Slot)),
+        m_context{limits.maxSteps, nullptr, nullptr, nullptr, 0, 0, 0, 0, this, &callFromNative}
+    {
+        if(JIT::IsSupported() && limits.jitThreshold > 0)
+            m_jit.emplace();
+    }
+
+    VM::Status VM::Run(std::uint32_t function, std::span<const Slot> arguments, std::vector<Slot>& result) {
+        m_errorLocation.reset();
+        m_frames.clear();
+        m_context.numStepsLeft = m_limits.maxSteps;
+        if(m_jit)
+            resizeNative(m_functions.size());
+
+        if(!reserve(m_functions[function].numRegisters)) {
+            fail(function, 0);
+            return Status::MemoryLimit;
+        }
+        std::copy(arguments.begin(), arguments.end(), m_registers.begin());
+
+        Status status = interpret(function, 0);
+        m_numSteps += m_limits.maxSteps - m_context.numStepsLeft;
+        if(status == Status::Ok)
+            result.assign(m_registers.begin(), m_registers.begin() + m_functions[function].numReturnSlots);
+        return status;
+    }
+
+    void VM::Discard(std::uint32_t firstFunction) {
+        // their native code stays allocated until the VM is destroyed
+        if(firstFunction < m_native.size())
+            resizeNative(firstFunction);
+    }
+
+    VM::Status VM::interpret(std::uint32_t function, std::size_t base) {
+        const std::size_t entryDepth = m_frames.size();
+        std::uint64_t numStepsLeft = m_context.numStepsLeft;
+
+        std::uint32_t functionIdx = function;
+        std::uint32_t pc = 0;
+        const Instruction * code = nullptr;
+        Slot * r = nullptr;
+
+        auto enter = [&]() {
+            code = m_functions[functionIdx].code.data();
+            r = m_registers.data() + base;
+        };
+        auto finish = [&](Status status, std::uint32_t errorPc) {
+            m_context.numStepsLeft = numStepsLeft;
+            if(status != Status::Ok)
+                fail(functionIdx, errorPc);
+            return status;
+        };
+        // true once the entry frame returned, its value is moved to the start of its frame
+        auto ret = [&](const Slot * value, std::size_t numSlots) {
+            if(m_frames.size() == entryDepth) {
+                std::memmove(r, value, numSlots * sizeof(Slot));
+                return true;
+            }
+            Frame frame = m_frames.back();
+            m_frames.pop_back();
+            functionIdx = frame.function;
+            base = frame.base;
+            enter();
+            std::memmove(r + code[frame.pc].a, value, numSlots * sizeof(Slot));
+            pc = frame.pc + 1;
+            return false;
+        };
+        // native code counts steps in the context, the register stack may have grown
+        auto runNative = [&](std::uint32_t nativeFunction, std::uint32_t nativePc, std::size_t nativeBase) {
+            m_context.numStepsLeft = numStepsLeft;
+            Status status = this->runNative(nativeFunction, nativePc, nativeBase);
+            numStepsLeft = m_context.numStepsLeft;
+            enter();
+            return status;
+        };
+
+        enter();
+        for(;;) {
+            if(numStepsLeft == 0)
+                return finish(Status::StepLimit, pc);
+            numStepsLeft--;
+
+            const Instruction& ins = code[pc++];
+            switch(ins.op) {
+                case Op::LoadImm: r[ins.a] = Slot(ins.b) | Slot(ins.c) << 32; break;
+                case Op::Move:    r[ins.a] = r[ins.b]; break;
+                case Op::MoveN:   std::memmove(r + ins.a, r + ins.b, ins.c * sizeof(Slot)); break;
+
+                case Op::Add: r[ins.a] = normalize(ins, r[ins.b] + r[ins.c]); break;
+                case Op::Sub: r[ins.a] = normalize(ins, r[ins.b] - r[ins.c]); break;
+                case Op::Mul: r[ins.a] = normalize(ins, r[ins.b] * r[ins.c]); break;
+                case Op::DivS: {
+                    std::int64_t x = std::int64_t(r[ins.b]), y = std::int64_t(r[ins.c]);
+                    if(y == 0)
+                        return finish(Status::DivisionByZero, pc - 1);
+                    // i64 min / -1 overflows
+                    r[ins.a] = normalize(ins, y == -1 ? Slot(0) - Slot(x) : Slot(x / y));
+                    break;
+                }
+                case Op::DivU:
+                    if(r[ins.c] == 0)
+                        return finish(Status::DivisionByZero, pc - 1);
+                    r[ins.a] = r[ins.b] / r[ins.c];
+                    break;
+                case Op::ModS: {
+                    std::int64_t x = std::int64_t(r[ins.b]), y = std::int64_t(r[ins.c]);
+                    if(y == 0)
+                        return finish(Status::DivisionByZero, pc - 1);
+                    r[ins.a] = y == -1 ? 0 : Slot(x % y);
+                    break;
+                }
+                case Op::ModU:
+                    if(r[ins.c] == 0)
+                        return finish(Status::DivisionByZero, pc - 1);
+                    r[ins.a] = r[ins.b] % r[ins.c];
+                    break;
+
+                // results of normalized operands are normalized
+                case Op::And: r[ins.a] = r[ins.b] & r[ins.c]; break;
+                case Op::Or:  r[ins.a] = r[ins.b] | r[ins.c]; break;
+                case Op::Xor: r[ins.a] = r[ins.b] ^ r[ins.c]; break;
+                case Op::Shl:
+                    if(r[ins.c] >= 64)
+                        return finish(Status::ShiftOutOfRange, pc - 1);
+                    r[ins.a] = normalize(ins, r[ins.b] << r[ins.c]);
+                    break;
+                case Op::ShrS:
+                    if(r[ins.c] >= 64)
+                        return finish(Status::ShiftOutOfRange, pc - 1);
+                    r[ins.a] = Slot(std::int64_t(r[ins.b]) >> r[ins.c]);
+                    break;
+                case Op::ShrU:
+                    if(r[ins.c] >= 64)
+                        return finish(Status::ShiftOutOfRange, pc - 1);
+                    r[ins.a] = r[ins.b] >> r[ins.c];
+                    break;
+                case Op::Neg: r[ins.a] = normalize(ins, Slot(0) - r[ins.b]); break;
+                case Op::Not: r[ins.a] = normalize(ins, ~r[ins.b]); break;
+
+                case Op::FAdd: r[ins.a] = fromFloat(ins, toFloat(r[ins.b]) + toFloat(r[ins.c])); break;
+                case Op::FSub: r[ins.a] = fromFloat(ins, toFloat(r[ins.b]) - toFloat(r[ins.c])); break;
+                case Op::FMul: r[ins.a] = fromFloat(ins, toFloat(r[ins.b]) * toFloat(r[ins.c])); break;
+                case Op::FDiv: r[ins.a] = fromFloat(ins, toFloat(r[ins.b]) / toFloat(r[ins.c])); break;
+                case Op::FMod: r[ins.a] = fromFloat(ins, std::fmod(toFloat(r[ins.b]), toFloat(r[ins.c]))); break;
+                case Op::FNeg: r[ins.a] = fromFloat(ins, -toFloat(r[ins.b])); break;
+
+                case Op::Eq:  r[ins.a] = r[ins.b] == r[ins.c]; break;
+                case Op::Ne:  r[ins.a] = r[ins.b] != r[ins.c]; break;
+                case Op::LtS: r[ins.a] = std::int64_t(r[ins.b]) <  std::int64_t(r[ins.c]); break;
+                case Op::LeS: r[ins.a] = std::int64_t(r[ins.b]) <= std::int64_t(r[ins.c]); break;
+                case Op::LtU: r[ins.a] = r[ins.b] <  r[ins.c]; break;
+                case Op::LeU: r[ins.a] = r[ins.b] <= r[ins.c]; break;
+                case Op::FEq: r[ins.a] = toFloat(r[ins.b]) == toFloat(r[ins.c]); break;
+                case Op::FNe: r[ins.a] = toFloat(r[ins.b]) != toFloat(r[ins.c]); break;
+                case Op::FLt: r[ins.a] = toFloat(r[ins.b]) <  toFloat(r[ins.c]); break;
+                case Op::FLe: r[ins.a] = toFloat(r[ins.b]) <= toFloat(r[ins.c]); break;
+                case Op::LogicalNot: r[ins.a] = r[ins.b] ^ 1; break;
+
+                case Op::Jump:
+                    // hot loops continue natively from their next iteration
+                    if(ins.a < pc && isHot(functionIdx)) {
+                        Status status = runNative(functionIdx, ins.a, base);
+                        if(status != Status::Ok)
+                            return finish(status, pc - 1);
+                        if(ret(r, m_functions[functionIdx].numReturnSlots))
+                            return finish(Status::Ok, 0);
+                        break;
+                    }
+                    pc = ins.a;
+                    break;
+                case Op::JumpIf:
+                    if(r[ins.b])
+                        pc = ins.a;
+                    break;
+                case Op::JumpIfNot:
+                    if(!r[ins.b])
+                        pc = ins.a;
+                    break;
+
+                case Op::Call: {
+                    if(m_frames.size() + m_context.numNativeFrames >= m_limits.maxCallDepth)
+                        return finish(Status::CallDepthLimit, pc - 1);
+                    std::size_t calleeBase = base + ins.c;
+                    if(!reserve(calleeBase + m_functions[ins.b].numRegisters))
+                        return finish(Status::MemoryLimit, pc - 1);
+                    if(m_context.numNativeFrames < MAX_NATIVE_DEPTH && isHot(ins.b)) {
+                        Status status = runNative(ins.b, 0, calleeBase);
+                        if(status != Status::Ok)
+                            return finish(status, pc - 1);
+                        std::memmove(r + ins.a, r + ins.c, m_functions[ins.b].numReturnSlots * sizeof(Slot));
+                        break;
+                    }
+                    m_frames.push_back(Frame{functionIdx, pc - 1, base});
+                    functionIdx = ins.b;
+                    base = calleeBase;
+                    pc = 0;
+                    enter();
+                    break;
+                }
+                case Op::Return:
+                    if(ret(r + ins.a, ins.b))
+                        return finish(Status::Ok, 0);
+                    break;
+            }
+        }
+    }
+
+    VM::Status VM::runNative(std::uint32_t function, std::uint32_t pc, std::size_t base) {
+        // native frames called directly count towards the call depth as well
+        std::uint64_t maxNativeFrames = std::exchange(m_context.maxNativeFrames,
+            std::min(MAX_NATIVE_DEPTH, m_limits.maxCallDepth - std::min(m_limits.maxCallDepth, m_frames.size())));
+        m_context.numNativeFrames++;
+        auto status = Status(m_jit->Run(m_native[function].value(), pc, m_registers.data() + base, m_context));
+        m_context.numNativeFrames--;
+        m_context.maxNativeFrames = maxNativeFrames;
+        if(status != Status::Ok)
+            fail(m_context.errorFunction, m_context.errorPc);
+        return status;
+    }
+
+    std::uint32_t VM::callFromNative(JIT::Context * context, Slot * frame, std::uint32_t function, std::uint32_t pc) {
+        VM& vm = *static_cast<VM *>(context->vm);
+        const Instruction& ins = vm.m_functions[function].code[pc];
+        std::size_t base = std::size_t(frame - vm.m_registers.data());
+        std::size_t calleeBase = base + ins.c;
+
+        Status status = Status::Ok;
+        if(vm.m_frames.size() + vm.m_context.numNativeFrames >= vm.m_limits.maxCallDepth)
+            status = Status::CallDepthLimit;
+        else if(!vm.reserve(calleeBase + vm.m_functions[ins.b].numRegisters))
+            status = Status::MemoryLimit;
+        if(status != Status::Ok) {
+            vm.fail(function, pc);
+            return std::uint32_t(status);
+        }
+
+        if(vm.m_context.numNativeFrames < MAX_NATIVE_DEPTH && vm.isHot(ins.b))
+            status = vm.runNative(ins.b, 0, calleeBase);
+        else
+            status = vm.interpret(ins.b, calleeBase);
+        if(status == Status::Ok) {
+            Slot * r = vm.m_registers.data() + base;
+            std::memmove(r + ins.a, r + ins.c, vm.m_functions[ins.b].numReturnSlots * sizeof(Slot));
+        }
+        return std::uint32_t(status);
+    }
+
+    bool VM::isHot(std::uint32_t function) {
+        if(!m_jit)
+            return false;
+        if(m_native[function])
+            return true;
+        std::uint32_t& hotness = m_hotness[function];
+        if(hotness == NOT_COMPILABLE || ++hotness < m_limits.jitThreshold)
+            return false;
+
+        Trace::Scope traceScope("ctee-jit");
+        m_native[function] = m_jit->Compile(m_functions, function);
+        if(!m_native[function]) {
+            hotness = NOT_COMPILABLE;
+            return false;
+        }
+        m_nativeStarts[function] = m_native[function]->start;
+        m_numNativeFunctions++;
+        return true;
+    }
+
+    void VM::resizeNative(std::size_t numFunctions) {
+        m_hotness.resize(numFunctions, 0);
+        m_native.resize(numFunctions);
+        m_nativeStarts.resize(numFunctions, nullptr);
+        m_context.functions = m_nativeStarts.data();
+    }
+
+    bool VM::reserve(std::size_t top) {
+        if(top > m_maxRegisters)
+            return false;
+        if(m_registers.size() < top) {
+            m_registers.resize(top);
+            m_context.registers = m_registers.data();
+            m_context.registersEnd = m_registers.data() + m_registers.size();
+        }
+        return true;
+    }
+
+    void VM::fail(std::uint32_t function, std::uint32_t pc) {
+        // the innermost failure is kept
+        if(!m_errorLocation)
+            m_errorLocation = Location{function, pc};
+    }
+
+    const std::optional<VM::Location>& VM::GetErrorLocation() const {
+        return m_errorLocation;
+    }
+
+    std::uint64_t VM::GetStepCount() const {
+        return m_numSteps;
+    }
+
+    std::size_t VM::GetNativeFunctionCount() const {
+        return m_numNativeFunctions;
+    }
+
+    std::size_t VM::GetNativeCodeSize() const {
+        return m_jit ? m_jit->GetCodeSize() : 0;
+    }
+
+    const char * VM::StringifyStatus(Status status) {
+        switch(status) {
+            case Status::Ok:              return "ok";
+            case Status::DivisionByZero:  return "division by zero";
+            case Status::ShiftOutOfRange: return "shift amount out of range";
+            case Status::StepLimit:       return "step limit exceeded";
+            case Status::MemoryLimit:     return "memory limit exceeded";
+            case Status::CallDepthLimit:  return "call depth limit exceeded";
+        }
+        return "";
+    }
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Bytecode.hpp"
+#include "JIT.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ry {
+
+    //
+    // Interpreter of the CTEE bytecode, with a JIT tier.
+    //
+    // Frames live on one register stack and calls push a frame record instead of recursing,
+    // so deep compile-time recursion is bounded by the limits, not by the native stack.
+    // Every executed instruction is a step, runs that exceed a limit stop with its status.
+    //
+    // Functions that are called or loop more often than the JIT threshold are compiled to
+    // native code, loops switch to it at their next iteration. Native frames share the
+    // register stack, only their nesting is bounded, to keep the native stack small.
+    //
+    class VM {
+    public:
+        using Slot = Bytecode::Slot;
+
+        struct Limits {
+            std::uint64_t maxSteps = 100'000'000;
+            std::size_t maxMemory = 64 * 1024 * 1024; // bytes of registers
+            std::size_t maxCallDepth = 100'000;
+            std::uint32_t jitThreshold = 1000; // calls and loop iterations of a function, 0 never compiles
+        };
+
+        enum class Status {
+            Ok, DivisionByZero, ShiftOutOfRange, StepLimit, MemoryLimit, CallDepthLimit
+        };
+
+        // Instruction that stopped a failed run
+        struct Location {
+            std::uint32_t function;
+            std::uint32_t pc;
+        };
+
+        // Functions may be added between runs
+        VM(const std::vector<Bytecode::Function>& functions, const Limits& limits);
+
+        Status Run(std::uint32_t function, std::span<const Slot> arguments, std::vector<Slot>& result);
+        // Functions from the first one on were removed, other functions may reuse their index
+        void Discard(std::uint32_t firstFunction);
+
+        const std::optional<Location>& GetErrorLocation() const;
+        std::uint64_t GetStepCount() const; // of all runs
+        std::size_t GetNativeFunctionCount() const;
+        std::size_t GetNativeCodeSize() const;
+
+        static const char * StringifyStatus(Status status);
+
+    private:
+        static constexpr std::size_t MAX_NATIVE_DEPTH = 1024;
+        static constexpr std::uint32_t NOT_COMPILABLE = UINT32_MAX; // hotness of functions the JIT failed on
+
+        struct Frame {
+            std::uint32_t function;
+            std::uint32_t pc;       // of the call
+            std::size_t base;
+        };
+
+        static std::uint32_t callFromNative(JIT::Context * context, Slot * frame, std::uint32_t function, std::uint32_t pc);
+
+        // Runs the function's frame until it returns, the value is left at the start of the frame
+        Status interpret(std::uint32_t function, std::size_t base);
+        Status runNative(std::uint32_t function, std::uint32_t pc, std::size_t base);
+        // Counts a call or loop iteration, true if the function has native code
+        bool isHot(std::uint32_t function);
+        void resizeNative(std::size_t numFunctions);
+        // false if the frame does not fit, the register stack only grows
+        bool reserve(std::size_t top);
+        void fail(std::uint32_t function, std::uint32_t pc);
+
+        const std::vector<Bytecode::Function>& m_functions;
+        Limits m_limits;
+
+        std::vector<Slot> m_registers;
+        std::size_t m_maxRegisters;
+        std::vector<Frame> m_frames;
+        std::optional<Location> m_errorLocation;
+        std::uint64_t m_numSteps = 0;
+
+        std::optional<JIT> m_jit;
+        JIT::Context m_context;
+        std::vector<std::uint32_t> m_hotness;             // by function
+        std::vector<std::optional<JIT::Code>> m_native;   // by function
+        std::vector<const void *> m_nativeStarts;         // by function, read by native code
+        std::size_t m_numNativeFunctions = 0;
+    };
+
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+namespace ry {
+
+    // Compiler version, part of every on-disk cache key
+    static constexpr const char * VERSION = "0.1.0";
+
+}
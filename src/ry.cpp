@@ -1,44 +1,292 @@
+#include "Analyzer.hpp"
+#include "CodeWriter.hpp"
+#include "Ctee.hpp"
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "ASTNode.hpp"
+#include "ASTStats.hpp"
+#include "FrontendCache.hpp"
+#include "PassManager.hpp"
+#include "PhaseReport.hpp"
+#include "Trace.hpp"
+#include "Transpiler.hpp"
+#include "Typer.hpp"
+#include "TypeInterner.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
-int main() {
-    static constexpr const char * const FILENAME = "test.ry";
+int main(int argc, char ** argv) {
+    static constexpr const char * const DEFAULT_FILENAME = "test.ry";
+    static constexpr std::uint64_t DEFAULT_CACHE_MAX_SIZE = 256ULL * 1024 * 1024;
+    static constexpr std::uint64_t DEFAULT_TRACE_GRANULARITY = 10; // us
 
-    std::string src;
-    {
-        std::ifstream file(FILENAME);
-        std::stringstream ss;
-        ss << file.rdbuf();
-        src = ss.str();
+    std::vector<std::string> filenames;
+    std::optional<std::string> cacheDir;
+    std::uint64_t cacheMaxSize = DEFAULT_CACHE_MAX_SIZE;
+    bool timeReport = false;
+    bool memReport = false;
+    std::optional<std::string> tracePath;
+    std::uint64_t traceGranularity = DEFAULT_TRACE_GRANULARITY;
+    std::size_t numJobs = 1;
+    ry::VM::Limits cteeLimits;
+    std::optional<std::string> emitCDir;
+    bool layoutReport = false;
+    bool nanBoxing = false;
+    std::uint32_t inlineThreshold = ry::Inliner::DEFAULT_THRESHOLD;
+    bool inlineReport = false;
+    ry::PassManager passes;
+    bool irDump = false;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if(arg == "--cache-dir" && i + 1 < argc)
+            cacheDir = argv[++i];
+        else if(arg == "--cache-max-size" && i + 1 < argc)
+            cacheMaxSize = std::stoull(argv[++i]);
+        else if(arg == "--time-report")
+            timeReport = true;
+        else if(arg == "--mem-report")
+            memReport = true;
+        else if(arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if(arg == "--trace-granularity" && i + 1 < argc)
+            traceGranularity = std::stoull(argv[++i]);
+        else if(arg == "--jobs" && i + 1 < argc)
+            numJobs = std::max<std::size_t>(std::stoull(argv[++i]), 1);
+        else if(arg == "--ctee-max-steps" && i + 1 < argc)
+            cteeLimits.maxSteps = std::stoull(argv[++i]);
+        else if(arg == "--ctee-max-memory" && i + 1 < argc)
+            cteeLimits.maxMemory = std::stoull(argv[++i]);
+        else if(arg == "--ctee-jit-threshold" && i + 1 < argc)
+            cteeLimits.jitThreshold = std::uint32_t(std::stoul(argv[++i]));
+        else if(arg == "--emit-c" && i + 1 < argc)
+            emitCDir = argv[++i];
+        else if(arg == "--layout-report")
+            layoutReport = true;
+        else if(arg == "--nan-boxing")
+            nanBoxing = true;
+        else if(arg == "--inline-threshold" && i + 1 < argc)
+            inlineThreshold = std::uint32_t(std::stoul(argv[++i]));
+        else if(arg == "--inline-report")
+            inlineReport = true;
+        else if(arg == "--ir-passes" && i + 1 < argc) {
+            if(!passes.SetPipeline(argv[++i])) {
+                std::cerr << "Unknown IR pass in " << argv[i] << ", the passes are:" << std::endl;
+                for(const ry::PassManager::Entry& entry : ry::PassManager::GetPasses())
+                    std::cerr << "  " << entry.name << " - " << entry.description << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--ir-verify")
+            passes.SetVerifying(true);
+        else if(arg == "--ir-dump")
+            irDump = true;
+        else
+            filenames.push_back(std::string(arg));
     }
+    if(filenames.empty())
+        filenames.push_back(DEFAULT_FILENAME);
 
-    ry::Lexer lexer(FILENAME, src);
-    
+    if(tracePath.has_value())
+        ry::Trace::Start(traceGranularity);
+
+    std::optional<ry::FrontendCache> cache;
+    if(cacheDir.has_value())
+        cache.emplace(cacheDir.value(), cacheMaxSize);
+
+    ry::PhaseReport report;
     std::string header(20, '-');
-    std::cout << header << " Source" << std::endl;
-    std::cout << lexer.GetSource() << std::endl;
+    for(const std::string& filename : filenames) {
+        std::string src;
+        {
+            ry::PhaseReport::Scope scope(report, "read");
+            std::ifstream file(filename);
+            std::stringstream ss;
+            ss << file.rdbuf();
+            src = ss.str();
+            report.AddItems("read", "files", 1);
+            report.AddItems("read", "bytes", src.size());
+        }
+
+        std::cout << header << " Source" << std::endl;
+        std::cout << src << std::endl;
+
+        // the AST names point into either the tokens or the mapped entry
+        std::optional<ry::FrontendCache::Entry> entry;
+        std::vector<ry::Token> tokens;
+        ry::Infos infos(filename, src);
+        std::optional<ry::ASTNode> ast;
+
+        // a hit skips lexing and parsing
+        if(cache.has_value()) {
+            ry::PhaseReport::Scope scope(report, "cache-load");
+            entry = cache->Load(src);
+            if(entry.has_value()) {
+                for(const ry::Infos::Info& info : entry->GetInfos())
+                    infos.Push(info);
+                if(entry->GetAST().has_value())
+                    ast.emplace(entry->GetAST()->ToASTNode());
+            }
+            report.AddItems("cache-load", entry.has_value() ? "hits" : "misses", 1);
+        }
+
+        if(entry.has_value()) {
+            std::cout << header << " Cache" << std::endl;
+            std::cout << "hit" << std::endl;
+            std::cout << std::endl;
+        }
+        else {
+            ry::Lexer lexer(filename, src);
+            {
+                ry::PhaseReport::Scope scope(report, "lex");
+                tokens = lexer.Lex();
+            }
+            report.AddItems("lex", "tokens", tokens.size());
+            report.AddItems("lex", "diagnostics", lexer.GetInfos().Get().size());
+
+            std::cout << header << " Tokens" << std::endl;
+            for(const ry::Token& token : tokens)
+                std::cout << token.Stringify() << std::endl;
+
+            ry::Parser parser(tokens, lexer.GetInfos());
+            {
+                ry::PhaseReport::Scope scope(report, "parse");
+                if(std::optional<ry::ASTNode> parsed = parser.Parse())
+                    ast.emplace(parsed.value());
+            }
+            infos = parser.GetInfos();
+            report.AddItems("parse", "diagnostics", infos.Get().size() - lexer.GetInfos().Get().size());
+
+            if(cache.has_value()) {
+                ry::PhaseReport::Scope scope(report, "cache-store");
+                cache->Store(src, infos, ast);
+            }
+        }
+
+        if(ast.has_value() && (timeReport || memReport)) {
+            ry::ASTStats stats;
+            stats.Add(ast.value());
+            report.AddASTStats("parse", stats);
+        }
+
+        std::cout << header << " AST" << std::endl;
+        if(ast.has_value())
+            std::cout << ast.value().Stringify() << std::endl;
+        std::cout << std::endl;
 
-    std::cout << header << " Tokens" << std::endl;
-    std::vector<ry::Token> tokens = lexer.Lex();
-    for(const ry::Token& token : tokens)
-        std::cout << token.Stringify() << std::endl;
+        ry::Analyzer analyzer(infos);
+        if(ast.has_value()) {
+            ry::PhaseReport::Scope scope(report, "analyze");
+            analyzer.Analyze(ast.value());
+        }
+        report.AddItems("analyze", "declarations", analyzer.GetDeclarationCount());
+        report.AddItems("analyze", "resolved-names", analyzer.GetResolvedNameCount());
+        report.AddItems("analyze", "diagnostics", analyzer.GetInfos().Get().size() - infos.Get().size());
 
-    std::cout << header << " Lexer Info" << std::endl;
-    std::cout << lexer.GetInfos().Stringify() << std::endl;
+        ry::TypeInterner types;
+        ry::Typer typer(analyzer.GetInfos(), analyzer, types);
+        if(ast.has_value()) {
+            ry::PhaseReport::Scope scope(report, "type");
+            typer.Check(ast.value(), numJobs);
+        }
+        report.AddItems("type", "function-bodies", typer.GetFunctionBodyCount());
+        report.AddItems("type", "typed-expressions", typer.GetTypedExpressionCount());
+        report.AddItems("type", "types", types.Size());
+        report.AddItems("type", "diagnostics", typer.GetInfos().Get().size() - analyzer.GetInfos().Get().size());
 
-    ry::Parser parser(tokens, lexer.GetInfos());
-    std::optional<ry::ASTNode> ast = parser.Parse();
+        ry::Ctee ctee(typer.GetInfos(), analyzer, typer, types, cteeLimits);
+        if(ast.has_value()) {
+            ry::PhaseReport::Scope scope(report, "ctee");
+            ctee.EvaluateAll(ast.value());
+        }
+        report.AddItems("ctee", "evaluations", ctee.GetResults().size());
+        report.AddItems("ctee", "functions", ctee.GetFunctionCount());
+        report.AddItems("ctee", "instructions", ctee.GetInstructionCount());
+        report.AddItems("ctee", "steps", ctee.GetStepCount());
+        report.AddItems("ctee", "native-functions", ctee.GetNativeFunctionCount());
+        report.AddItems("ctee", "native-bytes", ctee.GetNativeCodeSize());
+        report.AddItems("ctee", "diagnostics", ctee.GetInfos().Get().size() - typer.GetInfos().Get().size());
 
-    std::cout << header << " AST" << std::endl;
-    if(ast.has_value())
-        std::cout << ast.value().Stringify() << std::endl;
-    std::cout << std::endl;
+        // only programs without errors are generated
+        ry::Transpiler transpiler(ctee.GetInfos(), analyzer, typer, types, ctee, nanBoxing, inlineThreshold, passes);
+        bool hasErrors = std::any_of(ctee.GetInfos().Get().begin(), ctee.GetInfos().Get().end(), [](const ry::Infos::Info& info) {
+            return info.GetLevel() == ry::Infos::Info::Level::ERROR;
+        });
+        if(emitCDir.has_value() && ast.has_value() && !hasErrors) {
+            std::filesystem::path path = std::filesystem::path(emitCDir.value()) / std::filesystem::path(filename).stem();
+            path += ".c";
+            ry::CodeWriter out;
+            bool isOpen = false;
+            bool isTranspiled = false;
+            bool isClosed = false;
+            {
+                ry::PhaseReport::Scope scope(report, "transpile");
+                isOpen = out.Open(path.string());
+                if(isOpen) {
+                    isTranspiled = transpiler.Transpile(ast.value(), out, numJobs);
+                    isClosed = out.Close();
+                }
+            }
+            report.AddItems("transpile", "bytes", out.GetSize());
+            report.AddItems("transpile", "functions", transpiler.GetFunctionCount());
+            report.AddItems("transpile", "inlined-calls", transpiler.GetInlinedCount());
+            report.AddItems("transpile", "ir-instructions", transpiler.GetIRInstructionCount());
+            report.AddItems("transpile", "ir-blocks", transpiler.GetIRBlockCount());
+            report.AddItems("transpile", "diagnostics", transpiler.GetInfos().Get().size() - ctee.GetInfos().Get().size());
+            // the reason a program is not generated is reported
+            if(!isOpen || !isClosed)
+                std::cerr << "Failed to write C to " << path.string() << std::endl;
+            if(isOpen && !isTranspiled)
+                std::filesystem::remove(path);
+        }
 
-    std::cout << header << " Parser Info" << std::endl;
-    std::cout << parser.GetInfos().Stringify() << std::endl;
-}
\ No newline at end of file
+        std::cout << header << " Types" << std::endl;
+        std::cout << typer.StringifyDeclarations() << std::endl;
+
+        std::cout << header << " CTEE" << std::endl;
+        std::cout << ctee.StringifyResults() << std::endl;
+
+        std::cout << header << " Info" << std::endl;
+        std::cout << transpiler.GetInfos().Stringify() << std::endl;
+
+        if(layoutReport && emitCDir.has_value() && ast.has_value() && !hasErrors) {
+            std::cout << header << " Layout Report" << std::endl;
+            std::cout << transpiler.StringifyLayouts() << std::endl;
+        }
+        if(inlineReport && emitCDir.has_value() && ast.has_value() && !hasErrors) {
+            std::cout << header << " Inline Report" << std::endl;
+            std::cout << transpiler.StringifyInlining() << std::endl;
+        }
+        if(irDump && emitCDir.has_value() && ast.has_value() && !hasErrors) {
+            std::cout << header << " IR" << std::endl;
+            std::cout << transpiler.StringifyIR() << std::endl;
+        }
+    }
+
+    if(cache.has_value()) {
+        ry::PhaseReport::Scope scope(report, "cache-trim");
+        cache->Trim();
+    }
+
+    if(tracePath.has_value() && !ry::Trace::Stop(tracePath.value()))
+        std::cerr << "Failed to write trace to " << tracePath.value() << std::endl;
+
+    if(timeReport) {
+        std::cout << header << " Time Report" << std::endl;
+        std::cout << report.StringifyTime() << std::endl;
+    }
+    if(memReport) {
+        std::cout << header << " Memory Report" << std::endl;
+        std::cout << report.StringifyMem() << std::endl;
+    }
+    if(timeReport || memReport) {
+        std::cout << header << " Item Report" << std::endl;
+        std::cout << report.StringifyItems() << std::endl;
+    }
+}